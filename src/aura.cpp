@@ -20,13 +20,16 @@
 
 #include "aura.h"
 #include "crc32.h"
-#include "sha1.h"
 #include "csvparser.h"
 #include "config.h"
 #include "socket.h"
+#include "poller.h"
 #include "auradb.h"
 #include "bnet.h"
 #include "map.h"
+#include "maploader.h"
+#include "resolver.h"
+#include "gameworker.h"
 #include "gameplayer.h"
 #include "gameprotocol.h"
 #include "gpsprotocol.h"
@@ -38,7 +41,9 @@
 #include <csignal>
 #include <cstdlib>
 #include <thread>
+#include <algorithm>
 #include <fstream>
+#include <map>
 
 #define __STORMLIB_SELF__
 #include <StormLib.h>
@@ -54,11 +59,9 @@
 
 using namespace std;
 
-#undef FD_SETSIZE
-#define FD_SETSIZE 512
-
-static CAura* gAura    = nullptr;
-bool          gRestart = false;
+static CAura*                gAura         = nullptr;
+static volatile sig_atomic_t gCaughtSIGINT = 0; // set by the SIGINT handler, the main loop prints the message and shuts down
+bool                         gRestart      = false;
 
 void Print2(const string& message)
 {
@@ -68,6 +71,19 @@ void Print2(const string& message)
     gAura->m_IRC->SendMessageIRC(message, string());
 }
 
+static inline uint64_t GetReconnectIndexKey(uint8_t PID, uint32_t reconnectKey)
+{
+  return static_cast<uint64_t>(reconnectKey) << 8 | PID;
+}
+
+static inline bool IsLocalAddress(uint32_t address)
+{
+  // loopback, link-local and the private ranges (the address is in network byte order)
+
+  const uint32_t IP = ntohl(address);
+  return (IP >> 24) == 127 || (IP >> 24) == 10 || (IP >> 20) == 0xAC1 || (IP >> 16) == 0xC0A8 || (IP >> 16) == 0xA9FE;
+}
+
 //
 // main
 //
@@ -89,18 +105,14 @@ int main(const int, const char* argv[])
 
   Print("[AURA] starting up");
 
+  // the handler can run on any thread, even in the middle of a Print, so it mustn't do anything but set a flag (no locks, no output)
+  // a second SIGINT means the shutdown is stuck so we quit right away
+
   signal(SIGINT, [](int32_t) -> void {
-    Print("[!!!] caught signal SIGINT, exiting NOW");
+    if (gCaughtSIGINT)
+      _Exit(1);
 
-    if (gAura)
-    {
-      if (gAura->m_Exiting)
-        exit(1);
-      else
-        gAura->m_Exiting = true;
-    }
-    else
-      exit(1);
+    gCaughtSIGINT = 1;
   });
 
 #ifndef WIN32
@@ -179,14 +191,20 @@ int main(const int, const char* argv[])
 
 CAura::CAura(CConfig* CFG)
   : m_IRC(nullptr),
+    m_Poller(CPoller::Create(CFG->GetString("bot_poller", string()))),
     m_UDPSocket(new CUDPSocket()),
     m_ReconnectSocket(new CTCPServer()),
+    m_LobbySocket(new CTCPServer()),
+    m_LobbyProtocol(new CGameProtocol(this)),
     m_GPSProtocol(new CGPSProtocol()),
     m_CRC(new CCRC32()),
-    m_SHA(new CSHA1()),
-    m_CurrentGame(nullptr),
+    m_AdvertisedLobby(nullptr),
+    m_Jobs(new CJobQueue(m_Poller)),
     m_DB(new CAuraDB(CFG)),
     m_Map(nullptr),
+    m_MapCache(new CMapCache(CFG->GetString("bot_mapcachefile", "mapcache.txt"))),
+    m_MapLoader(new CMapLoader(this)),
+    m_Resolver(new CResolver(CFG->GetInt("bot_dnscachettl", 300))),
     m_Version(VERSION),
     m_HostCounter(1),
     m_Exiting(false),
@@ -200,7 +218,10 @@ CAura::CAura(CConfig* CFG)
   m_UDPSocket->SetBroadcastTarget(CFG->GetString("udp_broadcasttarget", string()));
   m_UDPSocket->SetDontRoute(CFG->GetInt("udp_dontroute", 0) == 0 ? false : true);
 
+  Print("[AURA] using " + string(m_Poller->GetName()) + " to wait for socket events");
+
   m_ReconnectPort = CFG->GetInt("bot_reconnectport", 6113);
+  m_ReconnectSocket->SetPoller(m_Poller);
 
   if (m_ReconnectSocket->Listen(m_BindAddress, m_ReconnectPort))
     Print("[AURA] listening for GProxy++ reconnects on port " + to_string(m_ReconnectPort));
@@ -212,15 +233,54 @@ CAura::CAura(CConfig* CFG)
   }
 
   m_CRC->Initialize();
-  m_HostPort       = CFG->GetInt("bot_hostport", 6112);
-  m_DefaultMap     = CFG->GetString("bot_defaultmap", "dota");
-  m_LANWar3Version = CFG->GetInt("lan_war3version", 27);
+  m_HostPort                  = CFG->GetInt("bot_hostport", 6112);
+  m_DefaultMap                = CFG->GetString("bot_defaultmap", "dota");
+  m_LANWar3Version            = CFG->GetInt("lan_war3version", 27);
+  m_LANBroadcastInterval      = CFG->GetInt("lan_broadcastinterval", 5);
+  m_LANSearchPublic           = CFG->GetInt("lan_searchpublic", 0) != 0;
   m_NumPlayersToStartGameOver = CFG->GetInt("bot_gameoverplayernumber", 1);
 
   // read the rest of the general configuration
 
   SetConfigs(CFG);
 
+  // start listening for connections to the lobbies, every lobby shares this port and joins are routed to a lobby by the host counter in W3GS_REQJOIN
+
+  if (!m_BindAddress.empty())
+    Print("[AURA] attempting to bind to address [" + m_BindAddress + "]");
+
+  m_LobbySocket->SetPoller(m_Poller);
+
+  if (m_LobbySocket->Listen(m_BindAddress, m_HostPort))
+    Print("[AURA] listening for game connections on port " + to_string(m_HostPort));
+  else
+  {
+    Print("[AURA] error listening for game connections on port " + to_string(m_HostPort));
+    m_Ready = false;
+    return;
+  }
+
+  // answer LAN game searches on the port Warcraft III searches on, we can still broadcast the lobbies if this fails
+
+  const uint16_t LANSearchPort = CFG->GetInt("lan_searchport", 6112);
+
+  if (LANSearchPort != 0 && m_UDPSocket->Bind(LANSearchPort))
+  {
+    m_UDPSocket->SetPoller(m_Poller);
+    m_UDPSocket->Register();
+    Print("[AURA] answering LAN game searches on port " + to_string(LANSearchPort));
+  }
+
+  // start the game worker threads, each one gets its own poller for the sockets of the games it updates
+
+  const uint32_t GameThreads = min<uint32_t>(CFG->GetInt("bot_gamethreads", 0), 64);
+
+  for (uint32_t i = 0; i < GameThreads; ++i)
+    m_GameWorkers.push_back(new CGameWorker(this, CPoller::Create(CFG->GetString("bot_poller", string()))));
+
+  if (GameThreads > 0)
+    Print("[AURA] updating games in progress on " + to_string(GameThreads) + " game worker threads");
+
   // get the irc configuration
 
   string   IRC_Server         = CFG->GetString("irc_server", string());
@@ -339,7 +399,8 @@ CAura::CAura(CConfig* CFG)
   // these two files are necessary for calculating "map_crc" when loading maps so we make sure to do it before loading the default map
   // see CMap :: Load for more information
 
-  ExtractScripts(HighestWar3Version);
+  m_War3Version = HighestWar3Version;
+  ExtractScripts(m_War3Version);
 
   // load the default maps (note: make sure to run ExtractScripts first)
 
@@ -348,7 +409,7 @@ CAura::CAura(CConfig* CFG)
 
   CConfig MapCFG;
   MapCFG.Read(m_MapCFGPath + m_DefaultMap);
-  m_Map = new CMap(this, &MapCFG, m_MapCFGPath + m_DefaultMap);
+  m_Map = new CMap(this, GetMapLoadSettings(), &MapCFG, m_MapCFGPath + m_DefaultMap);
 
   // load the iptocountry data
 
@@ -357,22 +418,40 @@ CAura::CAura(CConfig* CFG)
 
 CAura::~CAura()
 {
+  // the map loader thread uses m_CRC and m_MapCache so stop it first
+
+  delete m_MapLoader;
+  delete m_Resolver;
+
+  // the game worker threads have to stop before the games they update are deleted below
+
+  for (auto& worker : m_GameWorkers)
+    delete worker;
+
+  delete m_Jobs;
   delete m_UDPSocket;
   delete m_CRC;
-  delete m_SHA;
   delete m_ReconnectSocket;
+  delete m_LobbySocket;
+  delete m_LobbyProtocol;
   delete m_GPSProtocol;
 
   if (m_Map)
     delete m_Map;
 
+  delete m_MapCache;
+
   for (auto& socket : m_ReconnectSockets)
     delete socket;
 
+  for (auto& potential : m_Potentials)
+    delete potential;
+
   for (auto& bnet : m_BNETs)
     delete bnet;
 
-  delete m_CurrentGame;
+  for (auto& lobby : m_Lobbies)
+    delete lobby;
 
   for (auto& game : m_Games)
     delete game;
@@ -381,154 +460,309 @@ CAura::~CAura()
 
   if (m_IRC)
     delete m_IRC;
+
+  // every socket must be gone before the poller is
+
+  delete m_Poller;
 }
 
 bool CAura::Update()
 {
-  uint32_t NumFDs = 0;
-
-  // take every socket we own and throw it in one giant select statement so we can block on all sockets
+  if (m_ReconnectSocket->HasError())
+  {
+    Print("[AURA] GProxy++ reconnect listener error (" + m_ReconnectSocket->GetErrorString() + ")");
+    return true;
+  }
 
-  int32_t nfds = 0;
-  fd_set  fd, send_fd;
-  FD_ZERO(&fd);
-  FD_ZERO(&send_fd);
+  if (m_LobbySocket->HasError())
+  {
+    Print("[AURA] game listener error (" + m_LobbySocket->GetErrorString() + ")");
+    return true;
+  }
 
-  // 1. the current game's server and player sockets
+  // every socket we own is registered with the poller once so all we have to do here is wait for something to happen
+  // before we wait we need to determine how long to block for
+  // 50 ms is the hard maximum
 
-  if (m_CurrentGame)
-    NumFDs += m_CurrentGame->SetFD(&fd, &send_fd, &nfds);
+  int64_t usecBlock = 50000;
 
-  // 2. all running games' player sockets
+  for (auto& lobby : m_Lobbies)
+  {
+    if (lobby->GetNextTimedActionMicroTicks() < usecBlock)
+      usecBlock = lobby->GetNextTimedActionMicroTicks();
+  }
 
   for (auto& game : m_Games)
-    NumFDs += game->SetFD(&fd, &send_fd, &nfds);
+  {
+    if (!game->GetWorker() && game->GetNextTimedActionMicroTicks() < usecBlock)
+      usecBlock = game->GetNextTimedActionMicroTicks();
+  }
 
-  // 3. all battle.net sockets
+  m_Poller->Wait(usecBlock);
 
-  for (auto& bnet : m_BNETs)
-    NumFDs += bnet->SetFD(&fd, &send_fd, &nfds);
+  if (gCaughtSIGINT && !m_Exiting)
+  {
+    Print("[!!!] caught signal SIGINT, exiting NOW");
+    m_Exiting = true;
+  }
 
-  // 4. irc socket
+  bool Exit = false;
 
-  if (m_IRC)
-    NumFDs += m_IRC->SetFD(&fd, &send_fd, &nfds);
+  // run the jobs posted by the game worker threads
 
-  // 5. reconnect socket
+  m_Jobs->Run();
 
-  if (m_ReconnectSocket->HasError())
-  {
-    Print("[AURA] GProxy++ reconnect listener error (" + m_ReconnectSocket->GetErrorString() + ")");
-    return true;
-  }
-  else
+  // update running games, the ones handed over to a game worker thread are updated there
+
+  for (auto i = begin(m_Games); i != end(m_Games);)
   {
-    m_ReconnectSocket->SetFD(&fd, &send_fd, &nfds);
-    ++NumFDs;
+    if ((*i)->GetWorker())
+      ++i;
+    else if ((*i)->Update())
+    {
+      Print2("[AURA] deleting game [" + (*i)->GetGameName() + "]");
+      EventGameDeleted(*i);
+      delete *i;
+      i = m_Games.erase(i);
+    }
+    else
+    {
+      (*i)->UpdatePost();
+      ++i;
+    }
   }
 
-  // 6. reconnect sockets
+  // accept every new connection to the lobbies
+  // they're routed to a lobby as soon as they send a W3GS_REQJOIN packet (see EventPlayerJoined)
+  // a flood of connections is turned away before anything is allocated for them, there can only be m_MaxPotentials connections which haven't joined yet and m_MaxPotentialsPerIP from the same address
 
-  for (auto& socket : m_ReconnectSockets)
+  if (m_LobbySocket->GetReadable())
   {
-    socket->SetFD(&fd, &send_fd, &nfds);
-    ++NumFDs;
-  }
+    map<uint32_t, uint32_t> PotentialsPerIP;
+    vector<CTCPSocket*>     NewSockets;
 
-  // before we call select we need to determine how long to block for
-  // 50 ms is the hard maximum
+    for (auto& potential : m_Potentials)
+    {
+      if (potential->GetSocket())
+        ++PotentialsPerIP[potential->GetSocket()->GetIPAddress()];
+    }
 
-  int64_t usecBlock = 50000;
+    const uint32_t Rejected = m_LobbySocket->Accept(NewSockets, [&](const struct sockaddr_in& address) {
+      if (m_Potentials.size() + NewSockets.size() >= m_MaxPotentials)
+        return false;
 
-  for (auto& game : m_Games)
-  {
-    if (game->GetNextTimedActionTicks() * 1000 < usecBlock)
-      usecBlock = game->GetNextTimedActionTicks() * 1000;
-  }
+      uint32_t& Count = PotentialsPerIP[address.sin_addr.s_addr];
 
-  struct timeval tv;
-  tv.tv_sec  = 0;
-  tv.tv_usec = static_cast<long int>(usecBlock);
+      if (Count >= m_MaxPotentialsPerIP)
+        return false;
 
-  struct timeval send_tv;
-  send_tv.tv_sec  = 0;
-  send_tv.tv_usec = 0;
+      ++Count;
+      return true;
+    });
 
-#ifdef WIN32
-  select(1, &fd, nullptr, nullptr, &tv);
-  select(1, nullptr, &send_fd, nullptr, &send_tv);
-#else
-  select(nfds + 1, &fd, nullptr, nullptr, &tv);
-  select(nfds + 1, nullptr, &send_fd, nullptr, &send_tv);
-#endif
+    for (auto& socket : NewSockets)
+      m_Potentials.push_back(new CPotentialPlayer(m_LobbyProtocol, this, socket));
+
+    if (Rejected > 0)
+      Print("[AURA] rejected " + to_string(Rejected) + " connection(s) to the lobbies (too many connections waiting to join)");
+  }
 
-  if (NumFDs == 0)
+  for (auto i = begin(m_Potentials); i != end(m_Potentials);)
   {
-    // we don't have any sockets (i.e. we aren't connected to battle.net and irc maybe due to a lost connection and there aren't any games running)
-    // select will return immediately and we'll chew up the CPU if we let it loop so just sleep for 200ms to kill some time
+    if ((*i)->Update())
+    {
+      // flush the socket (e.g. in case a rejection message is queued)
+
+      if ((*i)->GetSocket())
+        (*i)->GetSocket()->DoSend();
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      delete *i;
+      i = m_Potentials.erase(i);
+    }
+    else
+      ++i;
   }
 
-  bool Exit = false;
+  // answer LAN game searches right away with the game info of every lobby which hasn't started its countdown
+  // the client only lists the games of the version it's searching for so there's no point answering other versions
+  // the source of a UDP packet can be spoofed and the answer is much bigger than the search so we'd make a fine reflector for attacks on other hosts
+  // to prevent that only local addresses are answered (unless lan_searchpublic is set) and each address at most once a second
 
-  // update running games
+  if (m_UDPSocket->GetReadable())
+  {
+    vector<uint8_t>    Packet;
+    struct sockaddr_in From;
+    const int64_t      Ticks = GetTicks();
 
-  for (auto i = begin(m_Games); i != end(m_Games);)
+    while (m_UDPSocket->RecvFrom(Packet, From))
+    {
+      if (Packet.size() < 4 || Packet[0] != W3GS_HEADER_CONSTANT || Packet[1] != CGameProtocol::W3GS_SEARCHGAME)
+        continue;
+
+      if (m_LobbyProtocol->RECEIVE_W3GS_SEARCHGAME(CByteView(Packet.data(), Packet.size())) != m_LANWar3Version)
+        continue;
+
+      if (!m_LANSearchPublic && !IsLocalAddress(From.sin_addr.s_addr))
+        continue;
+
+      auto LastReply = m_LANSearchReplies.find(From.sin_addr.s_addr);
+
+      if (LastReply != end(m_LANSearchReplies) && Ticks - LastReply->second < 1000)
+        continue;
+
+      if (m_LANSearchReplies.size() >= 256)
+      {
+        for (auto j = begin(m_LANSearchReplies); j != end(m_LANSearchReplies);)
+        {
+          if (Ticks - j->second >= 1000)
+            j = m_LANSearchReplies.erase(j);
+          else
+            ++j;
+        }
+
+        if (m_LANSearchReplies.size() >= 256)
+          continue;
+      }
+
+      m_LANSearchReplies[From.sin_addr.s_addr] = Ticks;
+
+      for (auto& lobby : m_Lobbies)
+      {
+        if (!lobby->GetCountDownStarted())
+          m_UDPSocket->SendTo(From, lobby->GetLANGameInfo());
+      }
+    }
+  }
+
+  // update the lobbies, the ones which started loading are moved to the games in progress
+
+  for (auto i = begin(m_Lobbies); i != end(m_Lobbies);)
   {
-    if ((*i)->Update(&fd, &send_fd))
+    CGame* Lobby = *i;
+
+    if (Lobby->Update())
     {
-      Print2("[AURA] deleting game [" + (*i)->GetGameName() + "]");
-      EventGameDeleted(*i);
-      delete *i;
-      i = m_Games.erase(i);
+      Print2("[AURA] deleting current game [" + Lobby->GetGameName() + "]");
+      i = m_Lobbies.erase(i);
+
+      if (Lobby == m_AdvertisedLobby)
+        AdvertiseLobby(m_Lobbies.empty() ? nullptr : m_Lobbies.back());
+
+      delete Lobby;
+    }
+    else if (Lobby->GetGameLoading())
+    {
+      Lobby->UpdatePost();
+      i = m_Lobbies.erase(i);
+      m_Games.push_back(Lobby);
+
+      for (const auto& key : Lobby->GetReconnectKeys())
+        m_ReconnectIndex.emplace(GetReconnectIndexKey(key.first, key.second), Lobby);
+
+      if (Lobby == m_AdvertisedLobby)
+        AdvertiseLobby(m_Lobbies.empty() ? nullptr : m_Lobbies.back());
     }
     else
     {
-      (*i)->UpdatePost(&send_fd);
+      Lobby->UpdatePost();
       ++i;
     }
   }
 
-  // update current game
+  // hand games which just started loading over to the game worker thread with the fewest games
 
-  if (m_CurrentGame)
+  if (!m_GameWorkers.empty())
   {
-    if (m_CurrentGame->Update(&fd, &send_fd))
+    for (auto& game : m_Games)
     {
-      Print2("[AURA] deleting current game [" + m_CurrentGame->GetGameName() + "]");
-      delete m_CurrentGame;
-      m_CurrentGame = nullptr;
+      if (game->GetWorker())
+        continue;
+
+      CGameWorker* Worker   = nullptr;
+      uint32_t     NumGames = 0;
 
-      for (auto& bnet : m_BNETs)
+      for (auto& worker : m_GameWorkers)
       {
-        bnet->QueueGameUncreate();
-        bnet->QueueEnterChat();
+        const uint32_t WorkerGames = count_if(begin(m_Games), end(m_Games), [worker](CGame* other) { return other->GetWorker() == worker; });
+
+        if (!Worker || WorkerGames < NumGames)
+        {
+          Worker   = worker;
+          NumGames = WorkerGames;
+        }
       }
+
+      game->SetWorker(Worker);
+      game->SetPoller(nullptr);
+      Worker->Adopt(game);
     }
-    else if (m_CurrentGame)
-      m_CurrentGame->UpdatePost(&send_fd);
   }
 
+  // hand the finished host name lookups to whoever asked for them (battle.net and irc connect once their server is resolved)
+
+  m_Resolver->Update();
+
   // update battle.net connections
 
   for (auto& bnet : m_BNETs)
   {
-    if (bnet->Update(&fd, &send_fd))
+    if (bnet->Update())
       Exit = true;
   }
 
   // update irc
 
-  if (m_IRC && m_IRC->Update(&fd, &send_fd))
+  if (m_IRC && m_IRC->Update())
     Exit = true;
 
+  // swap in maps which have finished loading on the map loader thread
+  // games in progress have their own copy of the map so the old one can be deleted right away
+
+  for (CMapLoadRequest* Request = m_MapLoader->GetFinished(); Request; Request = m_MapLoader->GetFinished())
+  {
+    const char* ErrorMessage = Request->m_Map->CheckValid();
+
+    if (Request->m_Server)
+    {
+      if (ErrorMessage)
+        Request->m_Server->QueueChatCommand(std::string("Error while loading map: [") + ErrorMessage + "]", Request->m_User, Request->m_Whisper, Request->m_IRC);
+      else
+        Request->m_Server->QueueChatCommand("Loaded map/config file [" + Request->m_CFGFile + "]", Request->m_User, Request->m_Whisper, Request->m_IRC);
+    }
+
+    delete m_Map;
+    m_Map          = Request->m_Map;
+    Request->m_Map = nullptr;
+    delete Request;
+  }
+
   // update GProxy++ reliable reconnect sockets
+  // after a network problem every GProxy++ player of every game reconnects at once so accept them all in one go
+  // the same limits as for the lobbies apply so a flood of connections can't pile up while each one waits up to 10 seconds for its reconnect packet
+
+  if (m_ReconnectSocket->GetReadable())
+  {
+    map<uint32_t, uint32_t> ReconnectsPerIP;
 
-  CTCPSocket* NewSocket = m_ReconnectSocket->Accept(&fd);
+    for (auto& socket : m_ReconnectSockets)
+      ++ReconnectsPerIP[socket->GetIPAddress()];
 
-  if (NewSocket)
-    m_ReconnectSockets.push_back(NewSocket);
+    const uint32_t Rejected = m_ReconnectSocket->Accept(m_ReconnectSockets, [&](const struct sockaddr_in& address) {
+      if (m_ReconnectSockets.size() >= m_MaxPendingReconnects)
+        return false;
+
+      uint32_t& Count = ReconnectsPerIP[address.sin_addr.s_addr];
+
+      if (Count >= m_MaxPendingReconnectsPerIP)
+        return false;
+
+      ++Count;
+      return true;
+    });
+
+    if (Rejected > 0)
+      Print("[AURA] rejected " + to_string(Rejected) + " GProxy++ reconnect connection(s) (too many connections waiting to reconnect)");
+  }
 
   for (auto i = begin(m_ReconnectSockets); i != end(m_ReconnectSockets);)
   {
@@ -539,93 +773,97 @@ bool CAura::Update()
       continue;
     }
 
-    (*i)->DoRecv(&fd);
-    string*                    RecvBuffer = (*i)->GetBytes();
-    const std::vector<uint8_t> Bytes      = CreateByteArray((uint8_t*)RecvBuffer->c_str(), RecvBuffer->size());
+    // nothing has arrived since the last time we looked so there's nothing new to parse
+
+    if (!(*i)->GetReadable())
+    {
+      ++i;
+      continue;
+    }
+
+    (*i)->DoRecv();
+    CByteBuffer*    RecvBuffer = (*i)->GetBytes();
+    const CByteView Bytes      = CByteView(RecvBuffer->GetData(), RecvBuffer->GetSize());
 
-    // a packet is at least 4 bytes
+    // a packet is at least 4 bytes, the header alone tells us whether it can be a reconnect so wait for the rest of it only if it can
 
-    if (Bytes.size() >= 4)
+    if (Bytes.size() < 4)
     {
-      if (Bytes[0] == GPS_HEADER_CONSTANT)
-      {
-        // bytes 2 and 3 contain the length of the packet
+      ++i;
+      continue;
+    }
 
-        const uint16_t Length = static_cast<uint16_t>(Bytes[3] << 8 | Bytes[2]);
+    // bytes 2 and 3 contain the length of the packet
 
-        if (Bytes.size() >= Length)
-        {
-          if (Bytes[1] == CGPSProtocol::GPS_RECONNECT && Length == 13)
-          {
-            const uint32_t ReconnectKey = ByteArrayToUInt32(Bytes, false, 5);
-            const uint32_t LastPacket   = ByteArrayToUInt32(Bytes, false, 9);
-
-            // look for a matching player in a running game
-
-            CGamePlayer* Match = nullptr;
-
-            for (auto& game : m_Games)
-            {
-              if (game->GetGameLoaded())
-              {
-                CGamePlayer* Player = game->GetPlayerFromPID(Bytes[4]);
-
-                if (Player && Player->GetGProxy() && Player->GetGProxyReconnectKey() == ReconnectKey)
-                {
-                  Match = Player;
-                  break;
-                }
-              }
-            }
-
-            if (Match)
-            {
-              // reconnect successful!
-
-              *RecvBuffer = RecvBuffer->substr(Length);
-              Match->EventGProxyReconnect(*i, LastPacket);
-              i = m_ReconnectSockets.erase(i);
-              continue;
-            }
-            else
-            {
-              (*i)->PutBytes(m_GPSProtocol->SEND_GPSS_REJECT(REJECTGPS_NOTFOUND));
-              (*i)->DoSend(&send_fd);
-              delete *i;
-              i = m_ReconnectSockets.erase(i);
-              continue;
-            }
-          }
-          else
-          {
-            (*i)->PutBytes(m_GPSProtocol->SEND_GPSS_REJECT(REJECTGPS_INVALID));
-            (*i)->DoSend(&send_fd);
-            delete *i;
-            i = m_ReconnectSockets.erase(i);
-            continue;
-          }
-        }
-        else
-        {
-          (*i)->PutBytes(m_GPSProtocol->SEND_GPSS_REJECT(REJECTGPS_INVALID));
-          (*i)->DoSend(&send_fd);
-          delete *i;
-          i = m_ReconnectSockets.erase(i);
-          continue;
-        }
+    const uint16_t Length = static_cast<uint16_t>(Bytes[3] << 8 | Bytes[2]);
+
+    if (Bytes[0] != GPS_HEADER_CONSTANT || Bytes[1] != CGPSProtocol::GPS_RECONNECT || Length != 13)
+    {
+      (*i)->PutBytes(m_GPSProtocol->SEND_GPSS_REJECT(REJECTGPS_INVALID));
+      (*i)->DoSend();
+      delete *i;
+      i = m_ReconnectSockets.erase(i);
+      continue;
+    }
+
+    if (Bytes.size() < Length)
+    {
+      ++i;
+      continue;
+    }
+
+    const uint8_t  PID          = Bytes[4];
+    const uint32_t ReconnectKey = ByteArrayToUInt32(Bytes, false, 5);
+    const uint32_t LastPacket   = ByteArrayToUInt32(Bytes, false, 9);
+    RecvBuffer->Consume(Length);
+
+    // look for a matching player in a running game
+    // games updated by a game worker thread are matched on the keys they had when they started loading and the worker checks the player again
+
+    CGamePlayer* Match     = nullptr;
+    CGame*       MatchGame = nullptr;
+    const auto   Range     = m_ReconnectIndex.equal_range(GetReconnectIndexKey(PID, ReconnectKey));
+
+    for (auto j = Range.first; j != Range.second; ++j)
+    {
+      CGame* Game = j->second;
+
+      if (Game->GetWorker())
+      {
+        MatchGame = Game;
+        break;
       }
-      else
+      else if (Game->GetGameLoaded())
       {
-        (*i)->PutBytes(m_GPSProtocol->SEND_GPSS_REJECT(REJECTGPS_INVALID));
-        (*i)->DoSend(&send_fd);
-        delete *i;
-        i = m_ReconnectSockets.erase(i);
-        continue;
+        CGamePlayer* Player = Game->GetPlayerFromPID(PID);
+
+        if (Player && Player->GetGProxy() && Player->GetGProxyReconnectKey() == ReconnectKey)
+        {
+          Match = Player;
+          break;
+        }
       }
     }
 
-    (*i)->DoSend(&send_fd);
-    ++i;
+    if (Match)
+    {
+      // reconnect successful!
+
+      Match->EventGProxyReconnect(*i, LastPacket);
+    }
+    else if (MatchGame)
+    {
+      (*i)->SetPoller(nullptr);
+      MatchGame->GetWorker()->Reconnect(MatchGame, *i, PID, ReconnectKey, LastPacket);
+    }
+    else
+    {
+      (*i)->PutBytes(m_GPSProtocol->SEND_GPSS_REJECT(REJECTGPS_NOTFOUND));
+      (*i)->DoSend();
+      delete *i;
+    }
+
+    i = m_ReconnectSockets.erase(i);
   }
 
   return m_Exiting || Exit;
@@ -633,31 +871,44 @@ bool CAura::Update()
 
 void CAura::EventBNETGameRefreshFailed(CBNET* bnet)
 {
-  if (m_CurrentGame)
+  if (m_AdvertisedLobby)
   {
     // If the game has someone in it, advertise the fail only in the lobby (as it is probably a rehost).
     // Otherwise whisper the game creator that the (re)host failed.
 
-    if (m_CurrentGame->GetNumHumanPlayers() != 0)
-      m_CurrentGame->SendAllChat("Unable to create game on server [" + bnet->GetServer() + "]. Try another name");
+    if (m_AdvertisedLobby->GetNumHumanPlayers() != 0)
+      m_AdvertisedLobby->SendAllChat("Unable to create game on server [" + bnet->GetServer() + "]. Try another name");
     else
-      m_CurrentGame->GetCreatorServer()->QueueChatCommand("Unable to create game on server [" + bnet->GetServer() + "]. Try another name", m_CurrentGame->GetCreatorName(), true, string());
+      m_AdvertisedLobby->GetCreatorServer()->QueueChatCommand("Unable to create game on server [" + bnet->GetServer() + "]. Try another name", m_AdvertisedLobby->GetCreatorName(), true, string());
 
-    Print2("[GAME: " + m_CurrentGame->GetGameName() + "] Unable to create game on server [" + bnet->GetServer() + "]. Try another name");
+    Print2("[GAME: " + m_AdvertisedLobby->GetGameName() + "] Unable to create game on server [" + bnet->GetServer() + "]. Try another name");
 
     // we take the easy route and simply close the lobby if a refresh fails
     // it's possible at least one refresh succeeded and therefore the game is still joinable on at least one battle.net (plus on the local network) but we don't keep track of that
     // we only close the game if it has no players since we support game rehosting (via !priv and !pub in the lobby)
 
-    if (m_CurrentGame->GetNumHumanPlayers() == 0)
-      m_CurrentGame->SetExiting(true);
+    if (m_AdvertisedLobby->GetNumHumanPlayers() == 0)
+      m_AdvertisedLobby->SetExiting(true);
 
-    m_CurrentGame->SetRefreshError(true);
+    m_AdvertisedLobby->SetRefreshError(true);
   }
 }
 
 void CAura::EventGameDeleted(CGame* game)
 {
+  for (const auto& key : game->GetReconnectKeys())
+  {
+    const auto Range = m_ReconnectIndex.equal_range(GetReconnectIndexKey(key.first, key.second));
+
+    for (auto i = Range.first; i != Range.second;)
+    {
+      if (i->second == game)
+        i = m_ReconnectIndex.erase(i);
+      else
+        ++i;
+    }
+  }
+
   for (auto& bnet : m_BNETs)
   {
     bnet->QueueChatCommand("Game [" + game->GetDescription() + "] is over");
@@ -667,11 +918,119 @@ void CAura::EventGameDeleted(CGame* game)
   }
 }
 
+void CAura::EventPlayerJoined(CPotentialPlayer* potential, CIncomingJoinPlayer* joinPlayer)
+{
+  // route the join to the lobby with a matching host counter
+  // only the lower 28 bits are sent in W3GS_GAMEINFO and the client echoes them back in W3GS_REQJOIN
+
+  const uint32_t HostCounter = joinPlayer->GetHostCounter() & 0x0FFFFFFF;
+  CGame*         Lobby       = nullptr;
+
+  for (auto& lobby : m_Lobbies)
+  {
+    if ((lobby->GetHostCounter() & 0x0FFFFFFF) == HostCounter)
+    {
+      Lobby = lobby;
+      break;
+    }
+  }
+
+  // with a single lobby any host counter is accepted like before there could be more than one (e.g. a join started before the lobby was rehosted)
+
+  if (!Lobby && m_Lobbies.size() == 1)
+    Lobby = m_Lobbies[0];
+
+  if (!Lobby)
+  {
+    Print("[AURA] player [" + joinPlayer->GetName() + "|" + potential->GetExternalIPString() + "] is trying to join a game which isn't in the lobby (host counter " + to_string(HostCounter) + ")");
+    potential->Send(m_LobbyProtocol->SEND_W3GS_REJECTJOIN(REJECTJOIN_STARTED));
+    potential->SetDeleteMe(true);
+    return;
+  }
+
+  potential->m_Protocol = Lobby->GetProtocol();
+  potential->m_Game     = Lobby;
+  Lobby->EventPlayerJoined(potential, joinPlayer);
+}
+
+void CAura::RunOnMain(function<void()> job)
+{
+  if (CGameWorker::GetCurrent())
+    m_Jobs->Post(std::move(job));
+  else
+    job();
+}
+
+void CAura::RunOnGame(uint32_t hostCounter, function<void(CGame*)> job)
+{
+  for (auto& lobby : m_Lobbies)
+  {
+    if (lobby->GetHostCounter() == hostCounter)
+    {
+      job(lobby);
+      return;
+    }
+  }
+
+  for (auto& game : m_Games)
+  {
+    if (game->GetHostCounter() == hostCounter)
+    {
+      if (game->GetWorker())
+        game->GetWorker()->Post(game, std::move(job));
+      else
+        job(game);
+
+      return;
+    }
+  }
+}
+
+void CAura::QueryGame(CGame* game, function<string(CGame*)> query, function<void(const string&)> reply)
+{
+  RunOnGame(game->GetHostCounter(), [this, query, reply](CGame* game) {
+    const string Result = query(game);
+    RunOnMain([Result, reply]() { reply(Result); });
+  });
+}
+
+void CAura::DeleteGame(CGame* game)
+{
+  // called when a game worker thread hands a finished game back
+
+  Print2("[AURA] deleting game [" + game->GetGameName() + "]");
+  EventGameDeleted(game);
+  m_Games.erase(find(begin(m_Games), end(m_Games), game));
+  delete game;
+}
+
 void CAura::ReloadConfigs()
 {
   CConfig CFG;
   CFG.Read("aura.cfg");
   SetConfigs(&CFG);
+
+  // the games keep their own copies of the values they use so games on other threads don't race with SetConfigs, hand them the new ones
+
+  const uint32_t AutoKickPing       = m_AutoKickPing;
+  const uint32_t VoteKickPercentage = m_VoteKickPercentage;
+  const int32_t  CommandTrigger     = m_CommandTrigger;
+  const bool     LCPings            = m_LCPings;
+
+  for (auto& lobby : m_Lobbies)
+    lobby->SetConfigs(AutoKickPing, VoteKickPercentage, CommandTrigger, LCPings);
+
+  for (auto& game : m_Games)
+    RunOnGame(game->GetHostCounter(), [=](CGame* game) { game->SetConfigs(AutoKickPing, VoteKickPercentage, CommandTrigger, LCPings); });
+}
+
+CMapLoadSettings CAura::GetMapLoadSettings() const
+{
+  CMapLoadSettings Settings;
+  Settings.m_MapPath     = m_MapPath;
+  Settings.m_MapCFGPath  = m_MapCFGPath;
+  Settings.m_War3Version = m_War3Version;
+  return Settings;
 }
 
 void CAura::SetConfigs(CConfig* CFG)
@@ -679,12 +1038,17 @@ void CAura::SetConfigs(CConfig* CFG)
   // this doesn't set EVERY config value since that would potentially require reconfiguring the battle.net connections
   // it just set the easily reloadable values
 
-  m_Warcraft3Path          = AddPathSeparator(CFG->GetString("bot_war3path", R"(C:\Program Files\Warcraft III\)"));
-  m_BindAddress            = CFG->GetString("bot_bindaddress", string());
-  m_ReconnectWaitTime      = CFG->GetInt("bot_reconnectwaittime", 3);
-  m_MaxGames               = CFG->GetInt("bot_maxgames", 20);
-  string BotCommandTrigger = CFG->GetString("bot_commandtrigger", "!");
-  m_CommandTrigger         = BotCommandTrigger[0];
+  m_Warcraft3Path             = AddPathSeparator(CFG->GetString("bot_war3path", R"(C:\Program Files\Warcraft III\)"));
+  m_BindAddress               = CFG->GetString("bot_bindaddress", string());
+  m_ReconnectWaitTime         = CFG->GetInt("bot_reconnectwaittime", 3);
+  m_MaxGames                  = CFG->GetInt("bot_maxgames", 20);
+  m_MaxLobbies                = max<uint32_t>(CFG->GetInt("bot_maxlobbies", 1), 1);
+  m_MaxPotentials             = max<uint32_t>(CFG->GetInt("bot_maxpendingjoins", 100), 1);
+  m_MaxPotentialsPerIP        = max<uint32_t>(CFG->GetInt("bot_maxpendingjoinsperip", 8), 1);
+  m_MaxPendingReconnects      = max<uint32_t>(CFG->GetInt("bot_maxpendingreconnects", 200), 1);
+  m_MaxPendingReconnectsPerIP = max<uint32_t>(CFG->GetInt("bot_maxpendingreconnectsperip", 12), 1);
+  string BotCommandTrigger    = CFG->GetString("bot_commandtrigger", "!");
+  m_CommandTrigger            = BotCommandTrigger[0];
 
   m_MapCFGPath      = AddPathSeparator(CFG->GetString("bot_mapcfgpath", string()));
   m_MapPath         = AddPathSeparator(CFG->GetString("bot_mappath", string()));
@@ -814,56 +1178,31 @@ void CAura::LoadIPToCountryData()
   {
     Print("[AURA] started loading [ip-to-country.csv]");
 
-    // the begin and commit statements are optimizations
-    // we're about to insert ~4 MB of data into the database so if we allow the database to treat each insert as a transaction it will take a LONG time
-
-    if (!m_DB->Begin())
-      Print("[AURA] warning - failed to begin database transaction, iptocountry data not loaded");
-    else
-    {
-      uint8_t   Percent = 0;
-      string    Line, Skip, IP1, IP2, Country;
-      CSVParser parser;
-
-      // get length of file for the progress meter
-
-      in.seekg(0, ios::end);
-      const uint32_t FileLength = in.tellg();
-      in.seekg(0, ios::beg);
-
-      while (!in.eof())
-      {
-        getline(in, Line);
-
-        if (Line.empty())
-          continue;
+    // the ranges are kept in memory (it used to take ~10 seconds to insert them into SQLite3 on a 3.2 GHz P4, now it's well under a second)
 
-        parser << Line;
-        parser >> Skip;
-        parser >> Skip;
-        parser >> IP1;
-        parser >> IP2;
-        parser >> Country;
-        m_DB->FromAdd(stoul(IP1), stoul(IP2), Country);
+    uint32_t  Ranges = 0;
+    string    Line, Skip, IP1, IP2, Country;
+    CSVParser parser;
 
-        // it's probably going to take awhile to load the iptocountry data (~10 seconds on my 3.2 GHz P4 when using SQLite3)
-        // so let's print a progress meter just to keep the user from getting worried
+    while (!in.eof())
+    {
+      getline(in, Line);
 
-        uint8_t NewPercent = static_cast<uint8_t>((float)in.tellg() / FileLength * 100);
+      if (Line.empty())
+        continue;
 
-        if (NewPercent != Percent && NewPercent % 10 == 0)
-        {
-          Percent = NewPercent;
-          Print("[AURA] iptocountry data: " + to_string(Percent) + "% loaded");
-        }
-      }
+      parser << Line;
+      parser >> Skip;
+      parser >> Skip;
+      parser >> IP1;
+      parser >> IP2;
+      parser >> Country;
 
-      if (!m_DB->Commit())
-        Print("[AURA] warning - failed to commit database transaction, iptocountry data not loaded");
-      else
-        Print("[AURA] finished loading [ip-to-country.csv]");
+      if (m_DB->FromAdd(stoul(IP1), stoul(IP2), Country))
+        ++Ranges;
     }
 
+    Print("[AURA] finished loading [ip-to-country.csv] (" + to_string(Ranges) + " ranges)");
     in.close();
   }
 }
@@ -888,13 +1227,19 @@ void CAura::CreateGame(CMap* map, uint8_t gameState, string gameName, string own
     return;
   }
 
-  if (m_CurrentGame)
+  if (m_Lobbies.size() >= m_MaxLobbies)
   {
-    creatorServer->QueueChatCommand("Unable to create game [" + gameName + "]. Another game [" + m_CurrentGame->GetDescription() + "] is in the lobby", creatorName, whisper, string());
+    if (m_MaxLobbies == 1)
+      creatorServer->QueueChatCommand("Unable to create game [" + gameName + "]. Another game [" + m_Lobbies.back()->GetDescription() + "] is in the lobby", creatorName, whisper, string());
+    else
+      creatorServer->QueueChatCommand("Unable to create game [" + gameName + "]. The maximum number of simultaneous lobbies (" + to_string(m_MaxLobbies) + ") has been reached", creatorName, whisper, string());
+
     return;
   }
 
-  if (m_Games.size() >= m_MaxGames)
+  // the lobbies count towards the limit since every one of them turns into a game in progress
+
+  if (m_Games.size() + m_Lobbies.size() >= m_MaxGames)
   {
     creatorServer->QueueChatCommand("Unable to create game [" + gameName + "]. The maximum number of simultaneous games (" + to_string(m_MaxGames) + ") has been reached", creatorName, whisper, string());
     return;
@@ -902,7 +1247,14 @@ void CAura::CreateGame(CMap* map, uint8_t gameState, string gameName, string own
 
   Print2("[AURA] creating game [" + gameName + "]");
 
-  m_CurrentGame = new CGame(this, map, m_HostPort, gameState, gameName, ownerName, creatorName, creatorServer);
+  CGame* Lobby = new CGame(this, map, m_HostPort, gameState, gameName, ownerName, creatorName, creatorServer);
+  m_Lobbies.push_back(Lobby);
+
+  // battle.net only lets us advertise one game at a time so the new lobby takes over the advertisement
+  // the other lobbies can still be joined on the local network
+
+  CGame* PreviousLobby = m_AdvertisedLobby;
+  m_AdvertisedLobby    = Lobby;
 
   for (auto& bnet : m_BNETs)
   {
@@ -925,12 +1277,19 @@ void CAura::CreateGame(CMap* map, uint8_t gameState, string gameName, string own
         bnet->QueueChatCommand("Creating public game [" + gameName + "] started by [" + ownerName + "]");
     }
 
-    bnet->QueueGameCreate(gameState, gameName, map, m_CurrentGame->GetHostCounter());
+    if (PreviousLobby)
+    {
+      bnet->UnqueueGameRefreshes();
+      bnet->QueueGameUncreate();
+      bnet->QueueEnterChat();
+    }
+
+    bnet->QueueGameCreate(gameState, gameName, map, Lobby->GetHostCounter());
 
     // hold friends and/or clan members
 
-    bnet->HoldFriends(m_CurrentGame);
-    bnet->HoldClan(m_CurrentGame);
+    bnet->HoldFriends(Lobby);
+    bnet->HoldClan(Lobby);
 
     // if we're creating a private game we don't need to send any game refresh messages so we can rejoin the chat immediately
     // unfortunately this doesn't work on PVPGN servers because they consider an enterchat message to be a gameuncreate message when in a game
@@ -940,3 +1299,43 @@ void CAura::CreateGame(CMap* map, uint8_t gameState, string gameName, string own
       bnet->QueueEnterChat();
   }
 }
+
+void CAura::AdvertiseLobby(CGame* lobby)
+{
+  // called when the advertised lobby started or was deleted, lobby is the one to advertise instead (nullptr if none is left)
+
+  m_AdvertisedLobby = lobby;
+
+  for (auto& bnet : m_BNETs)
+  {
+    bnet->UnqueueGameRefreshes();
+    bnet->QueueGameUncreate();
+    bnet->QueueEnterChat();
+
+    if (!lobby)
+      continue;
+
+    bnet->QueueGameCreate(lobby->GetGameState(), lobby->GetGameName(), lobby->GetMap(), lobby->GetHostCounter());
+
+    // see CreateGame
+
+    if (lobby->GetGameState() == GAME_PRIVATE && !bnet->GetPvPGN())
+      bnet->QueueEnterChat();
+  }
+}
+
+CGame* CAura::GetLobby(const string& user) const
+{
+  // the lobby battle.net commands act on: the newest one owned by the user or else the newest one
+
+  if (m_Lobbies.empty())
+    return nullptr;
+
+  for (auto i = m_Lobbies.rbegin(); i != m_Lobbies.rend(); ++i)
+  {
+    if ((*i)->IsOwner(user))
+      return *i;
+  }
+
+  return m_Lobbies.back();
+}
@@ -24,6 +24,8 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <functional>
+#include <unordered_map>
 
 //
 // CAura
@@ -34,58 +36,86 @@ class CTCPSocket;
 class CTCPServer;
 class CGPSProtocol;
 class CCRC32;
-class CSHA1;
 class CBNET;
 class CGame;
+class CGameProtocol;
+class CPotentialPlayer;
+class CIncomingJoinPlayer;
 class CAuraDB;
 class CMap;
+class CMapLoadSettings;
+class CMapCache;
+class CMapLoader;
+class CResolver;
 class CConfig;
 class CIRC;
+class CPoller;
+class CGameWorker;
+class CJobQueue;
 
 class CAura
 {
 public:
-  CIRC*                    m_IRC;
-  CUDPSocket*              m_UDPSocket;                  // a UDP socket for sending broadcasts and other junk (used with !sendlan)
-  CTCPServer*              m_ReconnectSocket;            // listening socket for GProxy++ reliable reconnects
-  std::vector<CTCPSocket*> m_ReconnectSockets;           // std::vector of sockets attempting to reconnect (connected but not identified yet)
-  CGPSProtocol*            m_GPSProtocol;                // class for gproxy protocol
-  CCRC32*                  m_CRC;                        // for calculating CRC's
-  CSHA1*                   m_SHA;                        // for calculating SHA1's
-  std::vector<CBNET*>      m_BNETs;                      // all our battle.net connections (there can be more than one)
-  CGame*                   m_CurrentGame;                // this game is still in the lobby state
-  std::vector<CGame*>      m_Games;                      // these games are in progress
-  CAuraDB*                 m_DB;                         // database
-  CMap*                    m_Map;                        // the currently loaded map
-  std::string              m_Version;                    // Aura++ version string
-  std::string              m_MapCFGPath;                 // config value: map cfg path
-  std::string              m_MapPath;                    // config value: map path
-  std::string              m_VirtualHostName;            // config value: virtual host name
-  std::string              m_LanguageFile;               // config value: language file
-  std::string              m_Warcraft3Path;              // config value: Warcraft 3 path
-  std::string              m_BindAddress;                // config value: the address to host games on
-  std::string              m_DefaultMap;                 // config value: default map (map.cfg)
-  uint32_t                 m_ReconnectWaitTime;          // config value: the maximum number of minutes to wait for a GProxy++ reliable reconnect
-  uint32_t                 m_MaxGames;                   // config value: maximum number of games in progress
-  uint32_t                 m_HostCounter;                // the current host counter (a unique number to identify a game, incremented each time a game is created)
-  uint32_t                 m_AllowDownloads;             // config value: allow map downloads or not
-  uint32_t                 m_MaxDownloaders;             // config value: maximum number of map downloaders at the same time
-  uint32_t                 m_MaxDownloadSpeed;           // config value: maximum total map download speed in KB/sec
-  uint32_t                 m_AutoKickPing;               // config value: auto kick players with ping higher than this
-  uint32_t                 m_LobbyTimeLimit;             // config value: auto close the game lobby after this many minutes without any reserved players
-  uint32_t                 m_Latency;                    // config value: the latency (by default)
-  uint32_t                 m_SyncLimit;                  // config value: the maximum number of packets a player can fall out of sync before starting the lag screen (by default)
-  uint32_t                 m_VoteKickPercentage;         // config value: percentage of players required to vote yes for a votekick to pass
-  uint32_t                 m_NumPlayersToStartGameOver;  // config value: when this player count is reached, the game over timer will start
-  uint16_t                 m_HostPort;                   // config value: the port to host games on
-  uint16_t                 m_ReconnectPort;              // config value: the port to listen for GProxy++ reliable reconnects on
-  uint8_t                  m_LANWar3Version;             // config value: LAN warcraft 3 version
-  int32_t                  m_CommandTrigger;             // config value: the command trigger inside games
-  bool                     m_Exiting;                    // set to true to force aura to shutdown next update (used by SignalCatcher)
-  bool                     m_Enabled;                    // set to false to prevent new games from being created
-  bool                     m_AutoLock;                   // config value: auto lock games when the owner is present
-  bool                     m_Ready;                      // indicates if there's lacking configuration info so we can quit
-  bool                     m_LCPings;                    // config value: use LC style pings (divide actual pings by two)
+  CIRC*                          m_IRC;
+  CPoller*                       m_Poller;                     // waits for socket events (io_uring, epoll or select)
+  CUDPSocket*                    m_UDPSocket;                  // a UDP socket for sending broadcasts and other junk (used with !sendlan)
+  CTCPServer*                    m_ReconnectSocket;            // listening socket for GProxy++ reliable reconnects
+  CTCPServer*                    m_LobbySocket;                // listening socket shared by all the lobbies, joins are routed to a lobby by host counter
+  CGameProtocol*                 m_LobbyProtocol;              // game protocol for connections which haven't been routed to a lobby yet
+  std::vector<CPotentialPlayer*> m_Potentials;                 // connections to m_LobbySocket which haven't joined a lobby yet
+  std::vector<CTCPSocket*>       m_ReconnectSockets;           // std::vector of sockets attempting to reconnect (connected but not identified yet)
+  CGPSProtocol*                  m_GPSProtocol;                // class for gproxy protocol
+  CCRC32*                        m_CRC;                        // for calculating CRC's
+  std::vector<CBNET*>            m_BNETs;                      // all our battle.net connections (there can be more than one)
+  std::vector<CGame*>            m_Lobbies;                    // these games are still in the lobby state, in the order they were created
+  CGame*                         m_AdvertisedLobby;            // the lobby advertised on battle.net (only one game can be advertised at a time)
+  std::vector<CGame*>            m_Games;                      // these games are in progress
+  std::unordered_multimap<uint64_t, CGame*> m_ReconnectIndex;  // GProxy++ reconnect key and PID -> the game in progress the player was in when it started loading
+  std::unordered_map<uint32_t, int64_t> m_LANSearchReplies;    // address -> GetTicks when we last answered a LAN game search from it
+  std::vector<CGameWorker*>      m_GameWorkers;                // threads updating the games in progress (none to update them on the main thread)
+  CJobQueue*                     m_Jobs;                       // jobs posted to the main thread by the game worker threads
+  CAuraDB*                       m_DB;                         // database
+  CMap*                          m_Map;                        // the currently loaded map
+  CMapCache*                     m_MapCache;                   // the values calculated from map files by earlier map loads
+  CMapLoader*                    m_MapLoader;                  // loads maps on a separate thread
+  CResolver*                     m_Resolver;                   // resolves host names on a separate thread
+  std::string                    m_Version;                    // Aura++ version string
+  std::string                    m_MapCFGPath;                 // config value: map cfg path
+  std::string                    m_MapPath;                    // config value: map path
+  std::string                    m_VirtualHostName;            // config value: virtual host name
+  std::string                    m_LanguageFile;               // config value: language file
+  std::string                    m_Warcraft3Path;              // config value: Warcraft 3 path
+  std::string                    m_BindAddress;                // config value: the address to host games on
+  std::string                    m_DefaultMap;                 // config value: default map (map.cfg)
+  uint32_t                       m_ReconnectWaitTime;          // config value: the maximum number of minutes to wait for a GProxy++ reliable reconnect
+  uint32_t                       m_MaxGames;                   // config value: maximum number of games in progress and in the lobby
+  uint32_t                       m_MaxLobbies;                 // config value: maximum number of games in the lobby state at the same time
+  uint32_t                       m_MaxPotentials;              // config value: maximum number of connections to the lobbies which haven't joined yet
+  uint32_t                       m_MaxPotentialsPerIP;         // config value: maximum number of connections to the lobbies which haven't joined yet from the same address
+  uint32_t                       m_MaxPendingReconnects;       // config value: maximum number of connections to the GProxy++ reconnect port which haven't sent their reconnect packet yet
+  uint32_t                       m_MaxPendingReconnectsPerIP;  // config value: maximum number of connections to the GProxy++ reconnect port which haven't sent their reconnect packet yet from the same address
+  uint32_t                       m_HostCounter;                // the current host counter (a unique number to identify a game, incremented each time a game is created)
+  uint32_t                       m_AllowDownloads;             // config value: allow map downloads or not
+  uint32_t                       m_MaxDownloaders;             // config value: maximum number of map downloaders at the same time
+  uint32_t                       m_MaxDownloadSpeed;           // config value: maximum total map download speed in KB/sec
+  uint32_t                       m_AutoKickPing;               // config value: auto kick players with ping higher than this
+  uint32_t                       m_LobbyTimeLimit;             // config value: auto close the game lobby after this many minutes without any reserved players
+  uint32_t                       m_Latency;                    // config value: the latency (by default)
+  uint32_t                       m_SyncLimit;                  // config value: the maximum number of packets a player can fall out of sync before starting the lag screen (by default)
+  uint32_t                       m_VoteKickPercentage;         // config value: percentage of players required to vote yes for a votekick to pass
+  uint32_t                       m_NumPlayersToStartGameOver;  // config value: when this player count is reached, the game over timer will start
+  uint16_t                       m_HostPort;                   // config value: the port to host games on
+  uint16_t                       m_ReconnectPort;              // config value: the port to listen for GProxy++ reliable reconnects on
+  uint8_t                        m_LANWar3Version;             // config value: LAN warcraft 3 version
+  uint32_t                       m_LANBroadcastInterval;       // config value: the number of seconds between broadcasts of each lobby to the local network (0 to only answer searches)
+  bool                           m_LANSearchPublic;            // config value: answer LAN game searches from public addresses too
+  uint8_t                        m_War3Version;                // the warcraft 3 version common.j and blizzard.j were extracted for
+  int32_t                        m_CommandTrigger;             // config value: the command trigger inside games
+  bool                           m_Exiting;                    // set to true to force aura to shutdown next update (used by SignalCatcher)
+  bool                           m_Enabled;                    // set to false to prevent new games from being created
+  bool                           m_AutoLock;                   // config value: auto lock games when the owner is present
+  bool                           m_Ready;                      // indicates if there's lacking configuration info so we can quit
+  bool                           m_LCPings;                    // config value: use LC style pings (divide actual pings by two)
 
   explicit CAura(CConfig* CFG);
   ~CAura();
@@ -99,14 +129,28 @@ public:
 
   void EventBNETGameRefreshFailed(CBNET* bnet);
   void EventGameDeleted(CGame* game);
+  void EventPlayerJoined(CPotentialPlayer* potential, CIncomingJoinPlayer* joinPlayer);
+
+  // threading functions
+  // battle.net, irc and the database belong to the main thread while games in progress might be updated by a game worker thread
+  // RunOnMain runs the job right away when called on the main thread and posts it otherwise
+  // RunOnGame must be called on the main thread, it runs the job on the thread updating the game (or drops it if the game is gone)
+
+  void RunOnMain(std::function<void()> job);
+  void RunOnGame(uint32_t hostCounter, std::function<void(CGame*)> job);
+  void QueryGame(CGame* game, std::function<std::string(CGame*)> query, std::function<void(const std::string&)> reply);
+  void DeleteGame(CGame* game);
 
   // other functions
 
   void ReloadConfigs();
   void SetConfigs(CConfig* CFG);
+  CMapLoadSettings GetMapLoadSettings() const;
   void ExtractScripts(const uint8_t War3Version);
   void LoadIPToCountryData();
   void CreateGame(CMap* map, uint8_t gameState, std::string gameName, std::string ownerName, std::string creatorName, CBNET* nCreatorServer, bool whisper);
+  void AdvertiseLobby(CGame* lobby);
+  CGame* GetLobby(const std::string& user) const;
 
   inline bool GetReady() const
   {
@@ -38,23 +38,131 @@ CSQLITE3::CSQLITE3(const string& filename)
 {
   if (sqlite3_open_v2(filename.c_str(), reinterpret_cast<sqlite3**>(&m_DB), SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK)
     m_Ready = false;
+
+  // the database writer thread has a connection of its own, wait for its (short) transactions instead of failing with SQLITE_BUSY
+
+  sqlite3_busy_timeout(static_cast<sqlite3*>(m_DB), 5000);
 }
 
 CSQLITE3::~CSQLITE3()
 {
+  for (auto& statement : m_Statements)
+    sqlite3_finalize(static_cast<sqlite3_stmt*>(statement.second));
+
   sqlite3_close(static_cast<sqlite3*>(m_DB));
 }
 
+void* CSQLITE3::GetStatement(const string& query)
+{
+  auto Cached = m_Statements.find(query);
+
+  if (Cached != end(m_Statements))
+  {
+    sqlite3_reset(static_cast<sqlite3_stmt*>(Cached->second));
+    sqlite3_clear_bindings(static_cast<sqlite3_stmt*>(Cached->second));
+    return Cached->second;
+  }
+
+  void* Statement = nullptr;
+
+  if (Prepare(query, &Statement) != SQLITE_OK || !Statement)
+    return nullptr;
+
+  m_Statements[query] = Statement;
+  return Statement;
+}
+
+//
+// CDBWriter
+//
+
+CDBWriter::CDBWriter(const string& file, const string& pragmas, size_t nMaxBatches)
+  : m_DB(new CSQLITE3(file)),
+    m_MaxBatches(nMaxBatches),
+    m_Exiting(false)
+{
+  if (!m_DB->GetReady())
+    return;
+
+  if (m_DB->Exec(pragmas) != SQLITE_OK)
+    Print("[SQLITE3] error setting pragmas for the writer thread - " + m_DB->GetError());
+
+  m_Thread = thread(&CDBWriter::Run, this);
+}
+
+CDBWriter::~CDBWriter()
+{
+  if (m_Thread.joinable())
+  {
+    {
+      lock_guard<mutex> Lock(m_Mutex);
+      m_Exiting = true;
+    }
+
+    m_Wake.notify_one();
+    m_Thread.join();
+  }
+
+  delete m_DB;
+}
+
+void CDBWriter::Run()
+{
+  unique_lock<mutex> Lock(m_Mutex);
+
+  while (true)
+  {
+    m_Wake.wait(Lock, [this]() { return m_Exiting || !m_Batches.empty(); });
+
+    // flush whatever is left before exiting so no stats are lost when shutting down
+
+    if (m_Batches.empty())
+      return;
+
+    queue<vector<function<void(CSQLITE3*)>>> Batches;
+    Batches.swap(m_Batches);
+
+    Lock.unlock();
+    m_Space.notify_all();
+
+    // take the write lock up front, a deferred transaction which reads first can't wait for another connection's write to finish
+
+    if (m_DB->Exec("BEGIN IMMEDIATE TRANSACTION") != SQLITE_OK)
+      Print("[SQLITE3] error beginning transaction - " + m_DB->GetError());
+
+    while (!Batches.empty())
+    {
+      for (auto& write : Batches.front())
+        write(m_DB);
+
+      Batches.pop();
+    }
+
+    if (m_DB->Exec("COMMIT TRANSACTION") != SQLITE_OK)
+      Print("[SQLITE3] error committing transaction - " + m_DB->GetError());
+
+    Lock.lock();
+  }
+}
+
+void CDBWriter::Write(vector<function<void(CSQLITE3*)>>&& batch)
+{
+  {
+    unique_lock<mutex> Lock(m_Mutex);
+    m_Space.wait(Lock, [this]() { return m_Batches.size() < m_MaxBatches; });
+    m_Batches.push(std::move(batch));
+  }
+
+  m_Wake.notify_one();
+}
+
 //
 // CAuraDB
 //
 
 CAuraDB::CAuraDB(CConfig* CFG)
-  : FromAddStmt(nullptr),
-    FromCheckStmt(nullptr),
-    BanCheckStmt(nullptr),
-    AdminCheckStmt(nullptr),
-    RootAdminCheckStmt(nullptr),
+  : m_Writer(nullptr),
+    m_IPRangesSorted(true),
     m_HasError(false)
 {
   Print("[SQLITE3] version " + string(SQLITE_VERSION));
@@ -74,10 +182,41 @@ CAuraDB::CAuraDB(CConfig* CFG)
     return;
   }
 
-  // find the schema number so we can determine whether we need to upgrade or not
+  // the write-ahead log lets the writer thread commit without blocking our reads and, with synchronous = NORMAL, only syncs at checkpoints
+  // the journal mode is stored in the database file, the rest has to be set on every connection (the writer thread's as well)
+
+  string Synchronous = CFG->GetString("db_sqlite3_synchronous", "NORMAL");
+  transform(begin(Synchronous), end(Synchronous), begin(Synchronous), ::toupper);
+
+  if (Synchronous != "OFF" && Synchronous != "NORMAL" && Synchronous != "FULL" && Synchronous != "EXTRA")
+  {
+    Print("[SQLITE3] invalid synchronous level [" + Synchronous + "], using NORMAL");
+    Synchronous = "NORMAL";
+  }
+
+  const string Pragmas = "PRAGMA synchronous = " + Synchronous + "; PRAGMA mmap_size = " + to_string(CFG->GetInt("db_sqlite3_mmapsize", 67108864)) + "; PRAGMA cache_size = -" + to_string(CFG->GetInt("db_sqlite3_cachesize", 8192)) + ";";
 
-  string        SchemaNumber;
   sqlite3_stmt* Statement;
+  m_DB->Prepare("PRAGMA journal_mode = WAL", reinterpret_cast<void**>(&Statement));
+
+  if (Statement)
+  {
+    if (m_DB->Step(Statement) == SQLITE_ROW)
+      Print("[SQLITE3] journal mode [" + string((char*)sqlite3_column_text(Statement, 0)) + "], synchronous [" + Synchronous + "]");
+    else
+      Print("[SQLITE3] error setting journal mode - " + m_DB->GetError());
+
+    m_DB->Finalize(Statement);
+  }
+  else
+    Print("[SQLITE3] prepare error setting journal mode - " + m_DB->GetError());
+
+  if (m_DB->Exec(Pragmas) != SQLITE_OK)
+    Print("[SQLITE3] error setting pragmas - " + m_DB->GetError());
+
+  // find the schema number so we can determine whether we need to upgrade or not
+
+  string SchemaNumber;
   m_DB->Prepare(R"(SELECT value FROM config WHERE name="schema_number")", reinterpret_cast<void**>(&Statement));
 
   if (Statement)
@@ -137,180 +276,220 @@ CAuraDB::CAuraDB(CConfig* CFG)
     }
     else
       Print("[SQLITE3] prepare error inserting schema number [1] - " + m_DB->GetError());
+
+    SchemaNumber = "1";
   }
   else
     Print("[SQLITE3] found schema number [" + SchemaNumber + "]");
 
-  if (m_DB->Exec("CREATE TEMPORARY TABLE iptocountry ( ip1 INTEGER NOT NULL, ip2 INTEGER NOT NULL, country TEXT NOT NULL, PRIMARY KEY ( ip1, ip2 ) )") != SQLITE_OK)
-    Print("[SQLITE3] error creating temporary iptocountry table - " + m_DB->GetError());
-
-  if (m_DB->Exec(R"(CREATE TEMPORARY TABLE rootadmins ( id INTEGER PRIMARY KEY, name TEXT NOT NULL, server TEXT NOT NULL DEFAULT "" ))") != SQLITE_OK)
-    Print("[SQLITE3] error creating temporary rootadmins table - " + m_DB->GetError());
-}
-
-CAuraDB::~CAuraDB()
-{
-  Print("[SQLITE3] closing database [" + m_File + "]");
-
-  if (FromAddStmt)
-    m_DB->Finalize(FromAddStmt);
+  // new databases are created with the first schema and upgraded from there like any other
 
-  if (BanCheckStmt)
-    m_DB->Finalize(BanCheckStmt);
+  if (!Upgrade(strtoul(SchemaNumber.c_str(), nullptr, 10)))
+  {
+    m_HasError = true;
+    m_Error    = "error upgrading database";
+    return;
+  }
 
-  if (FromCheckStmt)
-    m_DB->Finalize(FromCheckStmt);
+  // load the admins and bans, from now on they're only read from memory
 
-  if (AdminCheckStmt)
-    m_DB->Finalize(AdminCheckStmt);
+  Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("SELECT server, name FROM admins"));
 
-  if (RootAdminCheckStmt)
-    m_DB->Finalize(RootAdminCheckStmt);
+  if (Statement)
+  {
+    while (m_DB->Step(Statement) == SQLITE_ROW)
+      m_Admins[string((char*)sqlite3_column_text(Statement, 0))].insert(string((char*)sqlite3_column_text(Statement, 1)));
 
-  delete m_DB;
-}
+    m_DB->Reset(Statement);
+  }
+  else
+    Print("[SQLITE3] prepare error loading admins - " + m_DB->GetError());
 
-uint32_t CAuraDB::AdminCount(const string& server)
-{
-  uint32_t      Count = 0;
-  sqlite3_stmt* Statement;
-  m_DB->Prepare("SELECT COUNT(*) FROM admins WHERE server=?", reinterpret_cast<void**>(&Statement));
+  Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("SELECT server, name, date, admin, reason FROM bans ORDER BY id"));
 
   if (Statement)
   {
-    sqlite3_bind_text(Statement, 1, server.c_str(), -1, SQLITE_TRANSIENT);
+    uint32_t Bans = 0;
 
-    const int32_t RC = m_DB->Step(Statement);
+    while (m_DB->Step(Statement) == SQLITE_ROW)
+    {
+      const string Server = string((char*)sqlite3_column_text(Statement, 0));
+      const string Name   = string((char*)sqlite3_column_text(Statement, 1));
+      const char*  Reason = (char*)sqlite3_column_text(Statement, 4);
 
-    if (RC == SQLITE_ROW)
-      Count = sqlite3_column_int(Statement, 0);
-    else if (RC == SQLITE_ERROR)
-      Print("[SQLITE3] error counting admins [" + server + "] - " + m_DB->GetError());
+      m_Bans[Server].emplace(Name, CDBBan(Server, Name, string((char*)sqlite3_column_text(Statement, 2)), string((char*)sqlite3_column_text(Statement, 3)), Reason ? string(Reason) : string()));
+      ++Bans;
+    }
 
-    m_DB->Finalize(Statement);
+    m_DB->Reset(Statement);
+    Print("[SQLITE3] loaded " + to_string(Bans) + " bans");
   }
   else
-    Print("[SQLITE3] prepare error counting admins [" + server + "] - " + m_DB->GetError());
+    Print("[SQLITE3] prepare error loading bans - " + m_DB->GetError());
 
-  return Count;
+  // the writer opens its own connection now that the tables are there
+
+  m_Writer = new CDBWriter(m_File, Pragmas, static_cast<size_t>(max(1, CFG->GetInt("db_maxqueuedgames", 32))));
+
+  if (!m_Writer->GetReady())
+  {
+    Print("[SQLITE3] error opening database [" + m_File + "] for the writer thread, game stats will be written on the main thread");
+    delete m_Writer;
+    m_Writer = nullptr;
+  }
 }
 
-bool CAuraDB::AdminCheck(const string& server, string user)
+bool CAuraDB::Upgrade(uint32_t schemaNumber)
 {
-  bool IsAdmin = false;
-  transform(begin(user), end(user), begin(user), ::tolower);
+  // the statements upgrading schema number i + 1 to i + 2, each upgrade is applied in its own transaction along with the new schema number
+  // note to self: append an upgrade here (and update the schema in auradb.h) when making a new schema, never change one which has been released
+
+  static const vector<vector<string>> Upgrades = {
+    // 2: index every column we look players, bans and admins up by, names are matched case-folded so make sure they're stored that way
+    // the name goes first so the lookups by name alone (e.g. !delban on every realm) can use the index too
 
-  if (!AdminCheckStmt)
-    m_DB->Prepare("SELECT * FROM admins WHERE server=? AND name=?", &AdminCheckStmt);
+    {"UPDATE players SET name=lower(name)",
+     "UPDATE bans SET name=lower(name)",
+     "UPDATE admins SET name=lower(name)",
+     "CREATE INDEX players_name ON players ( name )",
+     "CREATE INDEX bans_name_server ON bans ( name, server )",
+     "CREATE INDEX admins_name_server ON admins ( name, server )"}};
 
-  if (AdminCheckStmt)
+  if (schemaNumber == 0)
   {
-    sqlite3_bind_text(static_cast<sqlite3_stmt*>(AdminCheckStmt), 1, server.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(static_cast<sqlite3_stmt*>(AdminCheckStmt), 2, user.c_str(), -1, SQLITE_TRANSIENT);
+    Print("[SQLITE3] invalid schema number");
+    return false;
+  }
 
-    const int32_t RC = m_DB->Step(AdminCheckStmt);
+  if (schemaNumber > Upgrades.size() + 1)
+  {
+    Print("[SQLITE3] schema number [" + to_string(schemaNumber) + "] is newer than this version of Aura knows about, continuing anyway");
+    return true;
+  }
 
-    // we're just checking to see if the query returned a row, we don't need to check the row data itself
+  for (; schemaNumber <= Upgrades.size(); ++schemaNumber)
+  {
+    const string Target = to_string(schemaNumber + 1);
+    Print("[SQLITE3] upgrading schema number [" + to_string(schemaNumber) + "] to [" + Target + "]");
 
-    if (RC == SQLITE_ROW)
-      IsAdmin = true;
-    else if (RC == SQLITE_ERROR)
-      Print("[SQLITE3] error checking admin [" + server + " : " + user + "] - " + m_DB->GetError());
+    if (!Begin())
+    {
+      Print("[SQLITE3] error beginning transaction - " + m_DB->GetError());
+      return false;
+    }
 
-    m_DB->Reset(AdminCheckStmt);
+    bool Success = true;
+
+    for (auto& query : Upgrades[schemaNumber - 1])
+    {
+      if (m_DB->Exec(query) != SQLITE_OK)
+      {
+        Print("[SQLITE3] error upgrading to schema number [" + Target + "] - " + m_DB->GetError());
+        Success = false;
+        break;
+      }
+    }
+
+    if (Success && m_DB->Exec(R"(UPDATE config SET value=")" + Target + R"(" WHERE name="schema_number")") != SQLITE_OK)
+    {
+      Print("[SQLITE3] error updating schema number [" + Target + "] - " + m_DB->GetError());
+      Success = false;
+    }
+
+    if (!Success)
+    {
+      m_DB->Exec("ROLLBACK TRANSACTION");
+      return false;
+    }
+
+    if (!Commit())
+    {
+      Print("[SQLITE3] error committing transaction - " + m_DB->GetError());
+      m_DB->Exec("ROLLBACK TRANSACTION");
+      return false;
+    }
   }
-  else
-    Print("[SQLITE3] prepare error checking admin [" + server + " : " + user + "] - " + m_DB->GetError());
 
-  return IsAdmin;
+  return true;
 }
 
-bool CAuraDB::AdminCheck(string user)
+CAuraDB::~CAuraDB()
 {
-  bool IsAdmin = false;
-  transform(begin(user), end(user), begin(user), ::tolower);
+  Print("[SQLITE3] closing database [" + m_File + "]");
 
-  sqlite3_stmt* Statement;
-  m_DB->Prepare("SELECT * FROM admins WHERE name=?", reinterpret_cast<void**>(&Statement));
+  // write any stats which haven't been written yet
+
+  SubmitBatch();
+  delete m_Writer;
+  delete m_DB;
+}
+
+uint32_t CAuraDB::AdminCount(const string& server)
+{
+  // only used by a rarely used command, it counts the rows like it always did rather than the distinct names we keep in memory
+
+  uint32_t      Count     = 0;
+  sqlite3_stmt* Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("SELECT COUNT(*) FROM admins WHERE server=?"));
 
   if (Statement)
   {
-    sqlite3_bind_text(Statement, 1, user.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(Statement, 1, server.c_str(), -1, SQLITE_TRANSIENT);
 
     const int32_t RC = m_DB->Step(Statement);
 
-    // we're just checking to see if the query returned a row, we don't need to check the row data itself
-
     if (RC == SQLITE_ROW)
-      IsAdmin = true;
+      Count = sqlite3_column_int(Statement, 0);
     else if (RC == SQLITE_ERROR)
-      Print("[SQLITE3] error checking admin [" + user + "] - " + m_DB->GetError());
+      Print("[SQLITE3] error counting admins [" + server + "] - " + m_DB->GetError());
 
     m_DB->Reset(Statement);
   }
   else
-    Print("[SQLITE3] prepare error checking admin [" + user + "] - " + m_DB->GetError());
+    Print("[SQLITE3] prepare error counting admins [" + server + "] - " + m_DB->GetError());
 
-  return IsAdmin;
+  return Count;
 }
 
-bool CAuraDB::RootAdminCheck(const string& server, string user)
+bool CAuraDB::AdminCheck(const string& server, string user)
 {
-  bool IsRoot = false;
   transform(begin(user), end(user), begin(user), ::tolower);
 
-  if (!RootAdminCheckStmt)
-    m_DB->Prepare("SELECT * FROM rootadmins WHERE server=? AND name=?", &RootAdminCheckStmt);
-
-  if (RootAdminCheckStmt)
-  {
-    sqlite3_bind_text(static_cast<sqlite3_stmt*>(RootAdminCheckStmt), 1, server.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(static_cast<sqlite3_stmt*>(RootAdminCheckStmt), 2, user.c_str(), -1, SQLITE_TRANSIENT);
+  auto Admins = m_Admins.find(server);
+  return Admins != end(m_Admins) && Admins->second.find(user) != end(Admins->second);
+}
 
-    const int32_t RC = m_DB->Step(static_cast<sqlite3_stmt*>(RootAdminCheckStmt));
+bool CAuraDB::AdminCheck(string user)
+{
+  transform(begin(user), end(user), begin(user), ::tolower);
 
-    // we're just checking to see if the query returned a row, we don't need to check the row data itself
+  for (auto& admins : m_Admins)
+  {
+    if (admins.second.find(user) != end(admins.second))
+      return true;
+  }
 
-    if (RC == SQLITE_ROW)
-      IsRoot = true;
-    else if (RC == SQLITE_ERROR)
-      Print("[SQLITE3] error checking admin [" + user + "] - " + m_DB->GetError());
+  return false;
+}
 
-    m_DB->Reset(static_cast<sqlite3_stmt*>(RootAdminCheckStmt));
-  }
-  else
-    Print("[SQLITE3] prepare error checking admin [" + user + "] - " + m_DB->GetError());
+bool CAuraDB::RootAdminCheck(const string& server, string user)
+{
+  transform(begin(user), end(user), begin(user), ::tolower);
 
-  return IsRoot;
+  auto RootAdmins = m_RootAdmins.find(server);
+  return RootAdmins != end(m_RootAdmins) && RootAdmins->second.find(user) != end(RootAdmins->second);
 }
 
 bool CAuraDB::RootAdminCheck(string user)
 {
-  bool IsRoot = false;
   transform(begin(user), end(user), begin(user), ::tolower);
 
-  sqlite3_stmt* Statement;
-  m_DB->Prepare("SELECT * FROM rootadmins WHERE name=?", reinterpret_cast<void**>(&Statement));
-
-  if (Statement)
+  for (auto& rootAdmins : m_RootAdmins)
   {
-    sqlite3_bind_text(Statement, 1, user.c_str(), -1, SQLITE_TRANSIENT);
-
-    const int32_t RC = m_DB->Step(Statement);
-
-    // we're just checking to see if the query returned a row, we don't need to check the row data itself
-
-    if (RC == SQLITE_ROW)
-      IsRoot = true;
-    else if (RC == SQLITE_ERROR)
-      Print("[SQLITE3] error checking admin [" + user + "] - " + m_DB->GetError());
-
-    m_DB->Finalize(Statement);
+    if (rootAdmins.second.find(user) != end(rootAdmins.second))
+      return true;
   }
-  else
-    Print("[SQLITE3] prepare error checking admin [" + user + "] - " + m_DB->GetError());
 
-  return IsRoot;
+  return false;
 }
 
 bool CAuraDB::AdminAdd(const string& server, string user)
@@ -318,8 +497,7 @@ bool CAuraDB::AdminAdd(const string& server, string user)
   bool Success = false;
   transform(begin(user), end(user), begin(user), ::tolower);
 
-  sqlite3_stmt* Statement;
-  m_DB->Prepare("INSERT INTO admins ( server, name ) VALUES ( ?, ? )", reinterpret_cast<void**>(&Statement));
+  sqlite3_stmt* Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("INSERT INTO admins ( server, name ) VALUES ( ?, ? )"));
 
   if (Statement)
   {
@@ -329,11 +507,14 @@ bool CAuraDB::AdminAdd(const string& server, string user)
     const int32_t RC = m_DB->Step(Statement);
 
     if (RC == SQLITE_DONE)
+    {
       Success = true;
+      m_Admins[server].insert(user);
+    }
     else if (RC == SQLITE_ERROR)
       Print("[SQLITE3] error adding admin [" + server + " : " + user + "] - " + m_DB->GetError());
 
-    m_DB->Finalize(Statement);
+    m_DB->Reset(Statement);
   }
   else
     Print("[SQLITE3] prepare error adding admin [" + server + " : " + user + "] - " + m_DB->GetError());
@@ -343,38 +524,19 @@ bool CAuraDB::AdminAdd(const string& server, string user)
 
 bool CAuraDB::RootAdminAdd(const string& server, string user)
 {
-  bool Success = false;
-  transform(begin(user), end(user), begin(user), ::tolower);
-
-  sqlite3_stmt* Statement;
-  m_DB->Prepare("INSERT INTO rootadmins ( server, name ) VALUES ( ?, ? )", reinterpret_cast<void**>(&Statement));
-
-  if (Statement)
-  {
-    sqlite3_bind_text(Statement, 1, server.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(Statement, 2, user.c_str(), -1, SQLITE_TRANSIENT);
-
-    const int32_t RC = m_DB->Step(Statement);
-
-    if (RC == SQLITE_DONE)
-      Success = true;
-    else if (RC == SQLITE_ERROR)
-      Print("[SQLITE3] error adding root admin [" + server + " : " + user + "] - " + m_DB->GetError());
+  // the root admins come from the config file every time the bot starts so they're only kept in memory
 
-    m_DB->Finalize(Statement);
-  }
-  else
-    Print("[SQLITE3] prepare error adding root admin [" + server + " : " + user + "] - " + m_DB->GetError());
-
-  return Success;
+  transform(begin(user), end(user), begin(user), ::tolower);
+  m_RootAdmins[server].insert(user);
+  return true;
 }
 
 bool CAuraDB::AdminRemove(const string& server, string user)
 {
-  bool          Success = false;
-  sqlite3_stmt* Statement;
+  bool Success = false;
   transform(begin(user), end(user), begin(user), ::tolower);
-  m_DB->Prepare("DELETE FROM admins WHERE server=? AND name=?", reinterpret_cast<void**>(&Statement));
+
+  sqlite3_stmt* Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("DELETE FROM admins WHERE server=? AND name=?"));
 
   if (Statement)
   {
@@ -384,11 +546,14 @@ bool CAuraDB::AdminRemove(const string& server, string user)
     const int32_t RC = m_DB->Step(Statement);
 
     if (RC == SQLITE_DONE)
+    {
       Success = true;
+      m_Admins[server].erase(user);
+    }
     else if (RC == SQLITE_ERROR)
       Print("[SQLITE3] error removing admin [" + server + " : " + user + "] - " + m_DB->GetError());
 
-    m_DB->Finalize(Statement);
+    m_DB->Reset(Statement);
   }
   else
     Print("[SQLITE3] prepare error removing admin [" + server + " : " + user + "] - " + m_DB->GetError());
@@ -398,9 +563,10 @@ bool CAuraDB::AdminRemove(const string& server, string user)
 
 uint32_t CAuraDB::BanCount(const string& server)
 {
-  uint32_t      Count = 0;
-  sqlite3_stmt* Statement;
-  m_DB->Prepare("SELECT COUNT(*) FROM bans WHERE server=?", reinterpret_cast<void**>(&Statement));
+  // counts the rows like AdminCount
+
+  uint32_t      Count     = 0;
+  sqlite3_stmt* Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("SELECT COUNT(*) FROM bans WHERE server=?"));
 
   if (Statement)
   {
@@ -413,7 +579,7 @@ uint32_t CAuraDB::BanCount(const string& server)
     else if (RC == SQLITE_ERROR)
       Print("[SQLITE3] error counting bans [" + server + "] - " + m_DB->GetError());
 
-    m_DB->Finalize(Statement);
+    m_DB->Reset(Statement);
   }
   else
     Print("[SQLITE3] prepare error counting bans [" + server + "] - " + m_DB->GetError());
@@ -423,66 +589,69 @@ uint32_t CAuraDB::BanCount(const string& server)
 
 CDBBan* CAuraDB::BanCheck(const string& server, string user)
 {
-  CDBBan* Ban = nullptr;
   transform(begin(user), end(user), begin(user), ::tolower);
 
-  if (!BanCheckStmt)
-    m_DB->Prepare("SELECT name, date, admin, reason FROM bans WHERE server=? AND name=?", &BanCheckStmt);
+  auto Bans = m_Bans.find(server);
 
-  if (BanCheckStmt)
-  {
-    sqlite3_bind_text(static_cast<sqlite3_stmt*>(BanCheckStmt), 1, server.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(static_cast<sqlite3_stmt*>(BanCheckStmt), 2, user.c_str(), -1, SQLITE_TRANSIENT);
+  if (Bans == end(m_Bans))
+    return nullptr;
 
-    const int32_t RC = m_DB->Step(BanCheckStmt);
+  auto Ban = Bans->second.find(user);
 
-    if (RC == SQLITE_ROW)
-    {
-      if (sqlite3_column_count(static_cast<sqlite3_stmt*>(BanCheckStmt)) == 4)
-      {
-        string Name   = string((char*)sqlite3_column_text(static_cast<sqlite3_stmt*>(BanCheckStmt), 0));
-        string Date   = string((char*)sqlite3_column_text(static_cast<sqlite3_stmt*>(BanCheckStmt), 1));
-        string Admin  = string((char*)sqlite3_column_text(static_cast<sqlite3_stmt*>(BanCheckStmt), 2));
-        string Reason = string((char*)sqlite3_column_text(static_cast<sqlite3_stmt*>(BanCheckStmt), 3));
-
-        Ban = new CDBBan(server, Name, Date, Admin, Reason);
-      }
-      else
-        Print("[SQLITE3] error checking ban [" + server + " : " + user + "] - row doesn't have 4 columns");
-    }
-    else if (RC == SQLITE_ERROR)
-      Print("[SQLITE3] error checking ban [" + server + " : " + user + "] - " + m_DB->GetError());
-
-    m_DB->Reset(BanCheckStmt);
-  }
-  else
-    Print("[SQLITE3] prepare error checking ban [" + server + " : " + user + "] - " + m_DB->GetError());
+  if (Ban == end(Bans->second))
+    return nullptr;
 
-  return Ban;
+  return new CDBBan(Ban->second);
 }
 
 bool CAuraDB::BanAdd(const string& server, string user, const string& admin, const string& reason)
 {
-  bool          Success = false;
-  sqlite3_stmt* Statement;
+  bool Success = false;
   transform(begin(user), end(user), begin(user), ::tolower);
-  m_DB->Prepare("INSERT INTO bans ( server, name, date, admin, reason ) VALUES ( ?, ?, date('now'), ?, ? )", reinterpret_cast<void**>(&Statement));
+
+  // get the date first so the ban we keep in memory has the same date as the one in the database
+
+  string        Date;
+  sqlite3_stmt* Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("SELECT date('now')"));
+
+  if (Statement)
+  {
+    if (m_DB->Step(Statement) == SQLITE_ROW)
+      Date = string((char*)sqlite3_column_text(Statement, 0));
+
+    m_DB->Reset(Statement);
+  }
+
+  if (Date.empty())
+  {
+    Print("[SQLITE3] error getting the date for ban [" + server + " : " + user + " : " + admin + " : " + reason + "] - " + m_DB->GetError());
+    return false;
+  }
+
+  Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("INSERT INTO bans ( server, name, date, admin, reason ) VALUES ( ?, ?, ?, ?, ? )"));
 
   if (Statement)
   {
     sqlite3_bind_text(Statement, 1, server.c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(Statement, 2, user.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(Statement, 3, admin.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(Statement, 4, reason.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(Statement, 3, Date.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(Statement, 4, admin.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(Statement, 5, reason.c_str(), -1, SQLITE_TRANSIENT);
 
     const int32_t RC = m_DB->Step(Statement);
 
     if (RC == SQLITE_DONE)
+    {
       Success = true;
+
+      // there can be more than one ban for the same name (e.g. added by different admins), BanCheck has always returned the first one
+
+      m_Bans[server].emplace(user, CDBBan(server, user, Date, admin, reason));
+    }
     else if (RC == SQLITE_ERROR)
       Print("[SQLITE3] error adding ban [" + server + " : " + user + " : " + admin + " : " + reason + "] - " + m_DB->GetError());
 
-    m_DB->Finalize(Statement);
+    m_DB->Reset(Statement);
   }
   else
     Print("[SQLITE3] prepare error adding ban [" + server + " : " + user + " : " + admin + " : " + reason + "] - " + m_DB->GetError());
@@ -492,10 +661,10 @@ bool CAuraDB::BanAdd(const string& server, string user, const string& admin, con
 
 bool CAuraDB::BanRemove(const string& server, string user)
 {
-  bool          Success = false;
-  sqlite3_stmt* Statement;
+  bool Success = false;
   transform(begin(user), end(user), begin(user), ::tolower);
-  m_DB->Prepare("DELETE FROM bans WHERE server=? AND name=?", reinterpret_cast<void**>(&Statement));
+
+  sqlite3_stmt* Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("DELETE FROM bans WHERE server=? AND name=?"));
 
   if (Statement)
   {
@@ -505,11 +674,14 @@ bool CAuraDB::BanRemove(const string& server, string user)
     const int32_t RC = m_DB->Step(Statement);
 
     if (RC == SQLITE_DONE)
+    {
       Success = true;
+      m_Bans[server].erase(user);
+    }
     else if (RC == SQLITE_ERROR)
       Print("[SQLITE3] error removing ban [" + server + " : " + user + "] - " + m_DB->GetError());
 
-    m_DB->Finalize(Statement);
+    m_DB->Reset(Statement);
   }
   else
     Print("[SQLITE3] prepare error removing ban [" + server + " : " + user + "] - " + m_DB->GetError());
@@ -519,10 +691,10 @@ bool CAuraDB::BanRemove(const string& server, string user)
 
 bool CAuraDB::BanRemove(string user)
 {
-  bool          Success = false;
-  sqlite3_stmt* Statement;
+  bool Success = false;
   transform(begin(user), end(user), begin(user), ::tolower);
-  m_DB->Prepare("DELETE FROM bans WHERE name=?", reinterpret_cast<void**>(&Statement));
+
+  sqlite3_stmt* Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("DELETE FROM bans WHERE name=?"));
 
   if (Statement)
   {
@@ -531,11 +703,16 @@ bool CAuraDB::BanRemove(string user)
     const int32_t RC = m_DB->Step(Statement);
 
     if (RC == SQLITE_DONE)
+    {
       Success = true;
+
+      for (auto& bans : m_Bans)
+        bans.second.erase(user);
+    }
     else if (RC == SQLITE_ERROR)
       Print("[SQLITE3] error removing ban [" + user + "] - " + m_DB->GetError());
 
-    m_DB->Finalize(Statement);
+    m_DB->Reset(Statement);
   }
   else
     Print("[SQLITE3] prepare error removing ban [" + user + "] - " + m_DB->GetError());
@@ -543,23 +720,22 @@ bool CAuraDB::BanRemove(string user)
   return Success;
 }
 
-void CAuraDB::GamePlayerAdd(string name, uint64_t loadingtime, uint64_t duration, uint64_t left)
+static void WriteGamePlayer(CSQLITE3* DB, const string& name, uint64_t loadingtime, uint64_t duration, uint64_t left)
 {
   sqlite3_stmt* Statement;
-  transform(begin(name), end(name), begin(name), ::tolower);
 
   // check if entry exists
 
   int32_t  RC;
   uint32_t Games = 0;
 
-  m_DB->Prepare("SELECT games, loadingtime, duration, left FROM players WHERE name=?", reinterpret_cast<void**>(&Statement));
+  Statement = static_cast<sqlite3_stmt*>(DB->GetStatement("SELECT games, loadingtime, duration, left FROM players WHERE name=?"));
 
   if (Statement)
   {
     sqlite3_bind_text(Statement, 1, name.c_str(), -1, SQLITE_TRANSIENT);
 
-    RC = m_DB->Step(Statement);
+    RC = DB->Step(Statement);
 
     if (RC == SQLITE_ROW)
     {
@@ -569,11 +745,11 @@ void CAuraDB::GamePlayerAdd(string name, uint64_t loadingtime, uint64_t duration
       left += sqlite3_column_int64(Statement, 3);
     }
 
-    m_DB->Finalize(Statement);
+    DB->Reset(Statement);
   }
   else
   {
-    Print("[SQLITE3] prepare error adding gameplayer [" + name + "] - " + m_DB->GetError());
+    Print("[SQLITE3] prepare error adding gameplayer [" + name + "] - " + DB->GetError());
     return;
   }
 
@@ -581,11 +757,11 @@ void CAuraDB::GamePlayerAdd(string name, uint64_t loadingtime, uint64_t duration
   {
     // insert new entry
 
-    m_DB->Prepare("INSERT INTO players ( name, games, loadingtime, duration, left ) VALUES ( ?, ?, ?, ?, ? )", reinterpret_cast<void**>(&Statement));
+    Statement = static_cast<sqlite3_stmt*>(DB->GetStatement("INSERT INTO players ( name, games, loadingtime, duration, left ) VALUES ( ?, ?, ?, ?, ? )"));
 
     if (Statement == nullptr)
     {
-      Print("[SQLITE3] prepare error inserting gameplayer [" + name + "] - " + m_DB->GetError());
+      Print("[SQLITE3] prepare error inserting gameplayer [" + name + "] - " + DB->GetError());
       return;
     }
 
@@ -599,11 +775,11 @@ void CAuraDB::GamePlayerAdd(string name, uint64_t loadingtime, uint64_t duration
   {
     // update existing entry
 
-    m_DB->Prepare("UPDATE players SET games=?, loadingtime=?, duration=?, left=? WHERE name=?", reinterpret_cast<void**>(&Statement));
+    Statement = static_cast<sqlite3_stmt*>(DB->GetStatement("UPDATE players SET games=?, loadingtime=?, duration=?, left=? WHERE name=?"));
 
     if (Statement == nullptr)
     {
-      Print("[SQLITE3] prepare error updating gameplayer [" + name + "] - " + m_DB->GetError());
+      Print("[SQLITE3] prepare error updating gameplayer [" + name + "] - " + DB->GetError());
       return;
     }
 
@@ -614,12 +790,18 @@ void CAuraDB::GamePlayerAdd(string name, uint64_t loadingtime, uint64_t duration
     sqlite3_bind_text(Statement, 5, name.c_str(), -1, SQLITE_TRANSIENT);
   }
 
-  RC = m_DB->Step(Statement);
+  RC = DB->Step(Statement);
 
   if (RC != SQLITE_DONE)
-    Print("[SQLITE3] error adding gameplayer [" + name + "] - " + m_DB->GetError());
+    Print("[SQLITE3] error adding gameplayer [" + name + "] - " + DB->GetError());
+
+  DB->Reset(Statement);
+}
 
-  m_DB->Finalize(Statement);
+void CAuraDB::GamePlayerAdd(string name, uint64_t loadingtime, uint64_t duration, uint64_t left)
+{
+  transform(begin(name), end(name), begin(name), ::tolower);
+  m_Batch.push_back([name, loadingtime, duration, left](CSQLITE3* DB) { WriteGamePlayer(DB, name, loadingtime, duration, left); });
 }
 
 CDBGamePlayerSummary* CAuraDB::GamePlayerSummaryCheck(string name)
@@ -627,7 +809,7 @@ CDBGamePlayerSummary* CAuraDB::GamePlayerSummaryCheck(string name)
   sqlite3_stmt*         Statement;
   CDBGamePlayerSummary* GamePlayerSummary = nullptr;
   transform(begin(name), end(name), begin(name), ::tolower);
-  m_DB->Prepare("SELECT games, loadingtime, duration, left FROM players WHERE name=?", reinterpret_cast<void**>(&Statement));
+  Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("SELECT games, loadingtime, duration, left FROM players WHERE name=?"));
 
   if (Statement)
   {
@@ -652,7 +834,7 @@ CDBGamePlayerSummary* CAuraDB::GamePlayerSummaryCheck(string name)
     else if (RC == SQLITE_ERROR)
       Print("[SQLITE3] error checking gameplayersummary [" + name + "] - " + m_DB->GetError());
 
-    m_DB->Finalize(Statement);
+    m_DB->Reset(Statement);
   }
   else
     Print("[SQLITE3] prepare error checking gameplayersummary [" + name + "] - " + m_DB->GetError());
@@ -660,12 +842,10 @@ CDBGamePlayerSummary* CAuraDB::GamePlayerSummaryCheck(string name)
   return GamePlayerSummary;
 }
 
-void CAuraDB::DotAPlayerAdd(string name, uint32_t winner, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t neutralkills, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills)
+static void WriteDotAPlayer(CSQLITE3* DB, const string& name, uint32_t winner, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t neutralkills, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills)
 {
-  bool          Success = false;
-  sqlite3_stmt* Statement;
-  transform(begin(name), end(name), begin(name), ::tolower);
-  m_DB->Prepare("SELECT dotas, wins, losses, kills, deaths, creepkills, creepdenies, assists, neutralkills, towerkills, raxkills, courierkills FROM players WHERE name=?", reinterpret_cast<void**>(&Statement));
+  bool          Success   = false;
+  sqlite3_stmt* Statement = static_cast<sqlite3_stmt*>(DB->GetStatement("SELECT dotas, wins, losses, kills, deaths, creepkills, creepdenies, assists, neutralkills, towerkills, raxkills, courierkills FROM players WHERE name=?"));
 
   int32_t  RC;
   uint32_t Dotas  = 1;
@@ -681,7 +861,7 @@ void CAuraDB::DotAPlayerAdd(string name, uint32_t winner, uint32_t kills, uint32
   {
     sqlite3_bind_text(Statement, 1, name.c_str(), -1, SQLITE_TRANSIENT);
 
-    RC = m_DB->Step(Statement);
+    RC = DB->Step(Statement);
 
     if (RC == SQLITE_ROW)
     {
@@ -701,11 +881,11 @@ void CAuraDB::DotAPlayerAdd(string name, uint32_t winner, uint32_t kills, uint32
       Success = true;
     }
 
-    m_DB->Finalize(Statement);
+    DB->Reset(Statement);
   }
   else
   {
-    Print("[SQLITE3] prepare error adding dotaplayer [" + name + "] - " + m_DB->GetError());
+    Print("[SQLITE3] prepare error adding dotaplayer [" + name + "] - " + DB->GetError());
     return;
   }
 
@@ -717,11 +897,11 @@ void CAuraDB::DotAPlayerAdd(string name, uint32_t winner, uint32_t kills, uint32
     return;
   }
 
-  m_DB->Prepare("UPDATE players SET dotas=?, wins=?, losses=?, kills=?, deaths=?, creepkills=?, creepdenies=?, assists=?, neutralkills=?, towerkills=?, raxkills=?, courierkills=? WHERE name=?", reinterpret_cast<void**>(&Statement));
+  Statement = static_cast<sqlite3_stmt*>(DB->GetStatement("UPDATE players SET dotas=?, wins=?, losses=?, kills=?, deaths=?, creepkills=?, creepdenies=?, assists=?, neutralkills=?, towerkills=?, raxkills=?, courierkills=? WHERE name=?"));
 
   if (Statement == nullptr)
   {
-    Print("[SQLITE3] prepare error updating dotalayer [" + name + "] - " + m_DB->GetError());
+    Print("[SQLITE3] prepare error updating dotalayer [" + name + "] - " + DB->GetError());
     return;
   }
 
@@ -739,12 +919,44 @@ void CAuraDB::DotAPlayerAdd(string name, uint32_t winner, uint32_t kills, uint32
   sqlite3_bind_int(Statement, 12, courierkills);
   sqlite3_bind_text(Statement, 13, name.c_str(), -1, SQLITE_TRANSIENT);
 
-  RC = m_DB->Step(Statement);
+  RC = DB->Step(Statement);
 
   if (RC != SQLITE_DONE)
-    Print("[SQLITE3] error adding dotaplayer [" + name + "] - " + m_DB->GetError());
+    Print("[SQLITE3] error adding dotaplayer [" + name + "] - " + DB->GetError());
+
+  DB->Reset(Statement);
+}
 
-  m_DB->Finalize(Statement);
+void CAuraDB::DotAPlayerAdd(string name, uint32_t winner, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t neutralkills, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills)
+{
+  transform(begin(name), end(name), begin(name), ::tolower);
+  m_Batch.push_back([name, winner, kills, deaths, creepkills, creepdenies, assists, neutralkills, towerkills, raxkills, courierkills](CSQLITE3* DB) { WriteDotAPlayer(DB, name, winner, kills, deaths, creepkills, creepdenies, assists, neutralkills, towerkills, raxkills, courierkills); });
+}
+
+void CAuraDB::SubmitBatch()
+{
+  if (m_Batch.empty())
+    return;
+
+  if (m_Writer)
+  {
+    m_Writer->Write(std::move(m_Batch));
+    m_Batch.clear();
+    return;
+  }
+
+  // there's no writer thread so write the batch ourselves, still in a single transaction
+
+  if (!Begin())
+    Print("[SQLITE3] error beginning transaction - " + m_DB->GetError());
+
+  for (auto& write : m_Batch)
+    write(m_DB);
+
+  if (!Commit())
+    Print("[SQLITE3] error committing transaction - " + m_DB->GetError());
+
+  m_Batch.clear();
 }
 
 CDBDotAPlayerSummary* CAuraDB::DotAPlayerSummaryCheck(string name)
@@ -752,7 +964,7 @@ CDBDotAPlayerSummary* CAuraDB::DotAPlayerSummaryCheck(string name)
   sqlite3_stmt*         Statement;
   CDBDotAPlayerSummary* DotAPlayerSummary = nullptr;
   transform(begin(name), end(name), begin(name), ::tolower);
-  m_DB->Prepare("SELECT dotas, wins, losses, kills, deaths, creepkills, creepdenies, assists, neutralkills, towerkills, raxkills, courierkills FROM players WHERE name=?", reinterpret_cast<void**>(&Statement));
+  Statement = static_cast<sqlite3_stmt*>(m_DB->GetStatement("SELECT dotas, wins, losses, kills, deaths, creepkills, creepdenies, assists, neutralkills, towerkills, raxkills, courierkills FROM players WHERE name=?"));
 
   if (Statement)
   {
@@ -787,7 +999,7 @@ CDBDotAPlayerSummary* CAuraDB::DotAPlayerSummaryCheck(string name)
         Print("[SQLITE3] error checking dotaplayersummary [" + name + "] - row doesn't have 12 columns");
     }
 
-    m_DB->Finalize(Statement);
+    m_DB->Reset(Statement);
   }
   else
     Print("[SQLITE3] prepare error checking dotaplayersummary [" + name + "] - " + m_DB->GetError());
@@ -799,68 +1011,41 @@ string CAuraDB::FromCheck(uint32_t ip)
 {
   // a big thank you to tjado for help with the iptocountry feature
 
-  string From = "??";
-
-  if (!FromCheckStmt)
-    m_DB->Prepare("SELECT country FROM iptocountry WHERE ip1<=? AND ip2>=?", &FromCheckStmt);
-
-  if (FromCheckStmt)
+  if (!m_IPRangesSorted)
   {
-    // we bind the ip as an int32_t64 because SQLite treats it as signed
-
-    sqlite3_bind_int64(static_cast<sqlite3_stmt*>(FromCheckStmt), 1, ip);
-    sqlite3_bind_int64(static_cast<sqlite3_stmt*>(FromCheckStmt), 2, ip);
+    sort(begin(m_IPRanges), end(m_IPRanges), [](const CIPRange& a, const CIPRange& b) { return a.m_First < b.m_First; });
+    m_IPRangesSorted = true;
+  }
 
-    const int32_t RC = m_DB->Step(FromCheckStmt);
+  // find the last range starting at or before the address, it's the only one which can contain it
 
-    if (RC == SQLITE_ROW)
-    {
-      if (sqlite3_column_count(static_cast<sqlite3_stmt*>(FromCheckStmt)) == 1)
-        From = string((char*)sqlite3_column_text(static_cast<sqlite3_stmt*>(FromCheckStmt), 0));
-      else
-        Print("[SQLITE3] error checking iptocountry [" + to_string(ip) + "] - row doesn't have 1 column");
-    }
-    else if (RC == SQLITE_ERROR)
-      Print("[SQLITE3] error checking iptocountry [" + to_string(ip) + "] - " + m_DB->GetError());
+  auto Range = upper_bound(begin(m_IPRanges), end(m_IPRanges), ip, [](uint32_t value, const CIPRange& range) { return value < range.m_First; });
 
-    m_DB->Reset(FromCheckStmt);
-  }
-  else
-    Print("[SQLITE3] prepare error checking iptocountry [" + to_string(ip) + "] - " + m_DB->GetError());
+  if (Range == begin(m_IPRanges) || (--Range)->m_Last < ip)
+    return "??";
 
-  return From;
+  return m_Countries[Range->m_Country];
 }
 
 bool CAuraDB::FromAdd(uint32_t ip1, uint32_t ip2, const string& country)
 {
   // a big thank you to tjado for help with the iptocountry feature
 
-  bool Success = false;
-
-  if (!FromAddStmt)
-    m_DB->Prepare("INSERT INTO iptocountry VALUES ( ?, ?, ? )", &FromAddStmt);
+  auto Country = m_CountryIndex.find(country);
 
-  if (FromAddStmt)
+  if (Country == end(m_CountryIndex))
   {
-    // we bind the ip as an int32_t64 because SQLite treats it as signed
-
-    sqlite3_bind_int64(static_cast<sqlite3_stmt*>(FromAddStmt), 1, ip1);
-    sqlite3_bind_int64(static_cast<sqlite3_stmt*>(FromAddStmt), 2, ip2);
-    sqlite3_bind_text(static_cast<sqlite3_stmt*>(FromAddStmt), 3, country.c_str(), -1, SQLITE_TRANSIENT);
-
-    int32_t RC = m_DB->Step(FromAddStmt);
+    Country = m_CountryIndex.emplace(country, static_cast<uint32_t>(m_Countries.size())).first;
+    m_Countries.push_back(country);
+  }
 
-    if (RC == SQLITE_DONE)
-      Success = true;
-    else if (RC == SQLITE_ERROR)
-      Print("[SQLITE3] error adding iptocountry [" + to_string(ip1) + " : " + to_string(ip2) + " : " + country + "] - " + m_DB->GetError());
+  // the file is sorted already so this almost never happens
 
-    m_DB->Reset(FromAddStmt);
-  }
-  else
-    Print("[SQLITE3] prepare error adding iptocountry [" + to_string(ip1) + " : " + to_string(ip2) + " : " + country + "] - " + m_DB->GetError());
+  if (!m_IPRanges.empty() && ip1 < m_IPRanges.back().m_First)
+    m_IPRangesSorted = false;
 
-  return Success;
+  m_IPRanges.push_back(CIPRange{ip1, ip2, Country->second});
+  return true;
 }
 
 //
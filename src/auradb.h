@@ -27,6 +27,8 @@
  *** SCHEMA ***
  **************
 
+schema number 2, older databases are upgraded by CAuraDB::Upgrade
+
 CREATE TABLE admins (
     id INTEGER PRIMARY KEY,
     name TEXT NOT NULL,
@@ -68,18 +70,11 @@ CREATE TABLE config (
     value TEXT NOT NULL
 )
 
-CREATE TEMPORARY TABLE iptocountry (
-    ip1 INTEGER NOT NULL,
-    ip2 INTEGER NOT NULL,
-    country TEXT NOT NULL,
-    PRIMARY KEY ( ip1, ip2 )
-)
+CREATE INDEX players_name ON players ( name )
 
-CREATE TEMPORARY TABLE rootadmins (
-    id INTEGER PRIMARY KEY,
-    name TEXT NOT NULL,
-    server TEXT NOT NULL DEFAULT ""
-)
+CREATE INDEX bans_name_server ON bans ( name, server )
+
+CREATE INDEX admins_name_server ON admins ( name, server )
 
  **************
  *** SCHEMA ***
@@ -91,14 +86,24 @@ CREATE TEMPORARY TABLE rootadmins (
 
 #include "includes.h"
 
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <queue>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 struct sqlite3;
 struct sqlite3_stmt;
 
 class CSQLITE3
 {
 private:
-  void* m_DB;
-  bool  m_Ready;
+  std::map<std::string, void*> m_Statements; // prepared statements by their SQL text, kept until the connection is closed
+  void*                        m_DB;
+  bool                         m_Ready;
 
 public:
   explicit CSQLITE3(const std::string& filename);
@@ -113,6 +118,70 @@ public:
   inline int32_t Finalize(void* Statement) { return sqlite3_finalize(static_cast<sqlite3_stmt*>(Statement)); }
   inline int32_t Reset(void* Statement) { return sqlite3_reset(static_cast<sqlite3_stmt*>(Statement)); }
   inline int32_t Exec(const std::string& query) { return sqlite3_exec(static_cast<sqlite3*>(m_DB), query.c_str(), nullptr, nullptr, nullptr); }
+
+  // preparing a statement takes far longer than running the simple queries we use so every statement is only prepared once
+  // returns the cached statement for query (nullptr if it couldn't be prepared) reset and with its bindings cleared
+  // Reset it once done with it so it doesn't keep a read transaction open
+
+  void* GetStatement(const std::string& query);
+};
+
+//
+// CDBWriter
+//
+
+// the end of game stats used to be written on the main loop, one synchronous transaction per statement, while every other game waited
+// now they're written by a separate thread with its own connection, everything queued by the time it gets to them goes in a single transaction
+// a batch is all the writes of one game so a game's stats are never split across transactions
+
+class CDBWriter
+{
+private:
+  std::queue<std::vector<std::function<void(CSQLITE3*)>>> m_Batches; // batches waiting to be written
+  std::mutex                                              m_Mutex;   // protects m_Batches and m_Exiting
+  std::condition_variable                                 m_Wake;    // signalled when a batch is queued or we're exiting
+  std::condition_variable                                 m_Space;   // signalled when the writer takes batches off the queue
+  std::thread                                             m_Thread;
+  CSQLITE3*                                               m_DB;
+  size_t                                                  m_MaxBatches;
+  bool                                                    m_Exiting;
+
+  void Run();
+
+public:
+  CDBWriter(const std::string& file, const std::string& pragmas, size_t nMaxBatches);
+  ~CDBWriter(); // writes every batch which is still queued before returning
+  CDBWriter(CDBWriter&) = delete;
+
+  inline bool GetReady() const { return m_DB->GetReady(); }
+
+  // blocks if m_MaxBatches batches are already waiting, the writer must be falling way behind the disk for that to happen
+
+  void Write(std::vector<std::function<void(CSQLITE3*)>>&& batch);
+};
+
+//
+// CDBBan
+//
+
+class CDBBan
+{
+private:
+  std::string m_Server;
+  std::string m_Name;
+  std::string m_Date;
+  std::string m_Admin;
+  std::string m_Reason;
+
+public:
+  CDBBan(std::string nServer, std::string nName, std::string nDate, std::string nAdmin, std::string nReason);
+  ~CDBBan();
+
+  inline std::string GetServer() const { return m_Server; }
+  inline std::string GetName() const { return m_Name; }
+  inline std::string GetDate() const { return m_Date; }
+  inline std::string GetAdmin() const { return m_Admin; }
+  inline std::string GetReason() const { return m_Reason; }
 };
 
 //
@@ -122,27 +191,44 @@ public:
 class CDBDotAPlayerSummary;
 class CDBGamePlayerSummary;
 class CConfig;
-class CDBBan;
 
 class CAuraDB
 {
 private:
   CSQLITE3*   m_DB;
+  CDBWriter*  m_Writer; // writes the end of game stats on its own thread, nullptr if its connection couldn't be opened
   std::string m_File;
   std::string m_Error;
 
-  // we keep some prepared statements in memory rather than recreating them each function call
-  // this is an optimization because preparing statements takes time
-  // however it only pays off if you're going to be using the statement extremely often
+  std::vector<std::function<void(CSQLITE3*)>> m_Batch; // writes queued by GamePlayerAdd and DotAPlayerAdd since the last call to SubmitBatch
 
-  void* FromAddStmt;        // for faster startup time
-  void* FromCheckStmt;      // frequently used
-  void* BanCheckStmt;       // frequently used
-  void* AdminCheckStmt;     // frequently used
-  void* RootAdminCheckStmt; // frequently used
+  // the admins and bans of every realm (server -> lower case name) loaded when the database is opened and kept in sync by the functions changing them
+  // the root admins only live here, they're added from the config file on every start
+  // they're checked on every join, every command and every map download update so this keeps the database out of those completely
+
+  std::unordered_map<std::string, std::unordered_set<std::string>>         m_Admins;
+  std::unordered_map<std::string, std::unordered_set<std::string>>         m_RootAdmins;
+  std::unordered_map<std::string, std::unordered_map<std::string, CDBBan>> m_Bans;
+
+  // the iptocountry data used to go into a temporary table which can't answer "which range contains this address" with an index
+  // now the ranges are kept sorted by their first address and FromCheck binary searches them, the countries are only stored once
+
+  struct CIPRange
+  {
+    uint32_t m_First;
+    uint32_t m_Last;
+    uint32_t m_Country; // index into m_Countries
+  };
+
+  std::vector<CIPRange>                     m_IPRanges;
+  std::vector<std::string>                  m_Countries;
+  std::unordered_map<std::string, uint32_t> m_CountryIndex;   // country -> index into m_Countries (only used while adding ranges)
+  bool                                      m_IPRangesSorted; // cleared when a range is added out of order, FromCheck sorts them again
 
   bool m_HasError;
 
+  bool Upgrade(uint32_t schemaNumber); // brings the schema up to date from schemaNumber, returns false if an upgrade failed (and was rolled back)
+
 public:
   explicit CAuraDB(CConfig* CFG);
   ~CAuraDB();
@@ -173,30 +259,10 @@ public:
   CDBGamePlayerSummary* GamePlayerSummaryCheck(std::string name);
   void DotAPlayerAdd(std::string name, uint32_t winner, uint32_t kills, uint32_t deaths, uint32_t creepkills, uint32_t creepdenies, uint32_t assists, uint32_t neutralkills, uint32_t towerkills, uint32_t raxkills, uint32_t courierkills);
   CDBDotAPlayerSummary* DotAPlayerSummaryCheck(std::string name);
-};
 
-//
-// CDBBan
-//
+  // GamePlayerAdd and DotAPlayerAdd only queue their writes, this hands everything queued so far to the writer thread as one batch
 
-class CDBBan
-{
-private:
-  std::string m_Server;
-  std::string m_Name;
-  std::string m_Date;
-  std::string m_Admin;
-  std::string m_Reason;
-
-public:
-  CDBBan(std::string nServer, std::string nName, std::string nDate, std::string nAdmin, std::string nReason);
-  ~CDBBan();
-
-  inline std::string GetServer() const { return m_Server; }
-  inline std::string GetName() const { return m_Name; }
-  inline std::string GetDate() const { return m_Date; }
-  inline std::string GetAdmin() const { return m_Admin; }
-  inline std::string GetReason() const { return m_Reason; }
+  void SubmitBatch();
 };
 
 //
@@ -24,10 +24,12 @@
 #include "fileutil.h"
 #include "config.h"
 #include "socket.h"
+#include "resolver.h"
 #include "auradb.h"
 #include "bncsutilinterface.h"
 #include "bnetprotocol.h"
 #include "map.h"
+#include "maploader.h"
 #include "gameprotocol.h"
 #include "game.h"
 #include "irc.h"
@@ -62,8 +64,6 @@ CBNET::CBNET(CAura* nAura, string nServer, const string& nServerAlias, const str
     m_LastConnectionAttemptTime(0),
     m_LastNullTime(0),
     m_LastOutPacketTicks(0),
-    m_LastAdminRefreshTime(GetTime()),
-    m_LastBanRefreshTime(GetTime()),
     m_LastOutPacketSize(0),
     m_LocaleID(nLocaleID),
     m_HostCounterID(nHostCounterID),
@@ -72,9 +72,12 @@ CBNET::CBNET(CAura* nAura, string nServer, const string& nServerAlias, const str
     m_Exiting(false),
     m_FirstConnect(true),
     m_WaitingToConnect(true),
+    m_Resolving(false),
     m_LoggedIn(false),
     m_InChat(false)
 {
+  m_Socket->SetPoller(m_Aura->m_Poller);
+
   if (m_PasswordHashType == "pvpgn" || m_EXEVersion.size() == 4 || m_EXEVersionHash.size() == 4)
   {
     m_PvPGN          = true;
@@ -117,18 +120,7 @@ CBNET::~CBNET()
   delete m_BNCSUtil;
 }
 
-uint32_t CBNET::SetFD(void* fd, void* send_fd, int32_t* nfds)
-{
-  if (!m_Socket->HasError() && m_Socket->GetConnected())
-  {
-    m_Socket->SetFD(static_cast<fd_set*>(fd), static_cast<fd_set*>(send_fd), nfds);
-    return 1;
-  }
-
-  return 0;
-}
-
-bool CBNET::Update(void* fd, void* send_fd)
+bool CBNET::Update()
 {
   const int64_t Ticks = GetTicks(), Time = GetTime();
 
@@ -155,13 +147,15 @@ bool CBNET::Update(void* fd, void* send_fd)
   {
     // the socket is connected and everything appears to be working properly
 
-    m_Socket->DoRecv(static_cast<fd_set*>(fd));
+    m_Socket->DoRecv();
 
     // extract as many packets as possible from the socket's receive buffer and put them in the m_Packets queue
 
-    string*              RecvBuffer      = m_Socket->GetBytes();
-    std::vector<uint8_t> Bytes           = CreateByteArray((uint8_t*)RecvBuffer->c_str(), RecvBuffer->size());
-    uint32_t             LengthProcessed = 0;
+    // the packets are parsed in place so nothing may touch the receive buffer until we're done with Bytes
+
+    CByteBuffer* RecvBuffer      = m_Socket->GetBytes();
+    CByteView    Bytes           = CByteView(RecvBuffer->GetData(), RecvBuffer->GetSize());
+    uint32_t     LengthProcessed = 0;
 
     CIncomingGameHost*  GameHost;
     CIncomingChatEvent* ChatEvent;
@@ -176,11 +170,12 @@ bool CBNET::Update(void* fd, void* send_fd)
       {
         // bytes 2 and 3 contain the length of the packet
 
-        const uint16_t             Length = static_cast<uint16_t>(Bytes[3] << 8 | Bytes[2]);
-        const std::vector<uint8_t> Data   = std::vector<uint8_t>(begin(Bytes), begin(Bytes) + Length);
+        const uint16_t Length = static_cast<uint16_t>(Bytes[3] << 8 | Bytes[2]);
 
-        if (Bytes.size() >= Length)
+        if (Length >= 4 && Bytes.size() >= Length)
         {
+          const CByteView Data = Bytes.SubView(0, Length);
+
           switch (Bytes[1])
           {
             case CBNETProtocol::SID_NULL:
@@ -386,14 +381,16 @@ bool CBNET::Update(void* fd, void* send_fd)
           }
 
           LengthProcessed += Length;
-          Bytes = std::vector<uint8_t>(begin(Bytes) + Length, end(Bytes));
+          Bytes = Bytes.SubView(Length);
         }
         else
           break;
       }
+      else
+        break;
     }
 
-    *RecvBuffer = RecvBuffer->substr(LengthProcessed);
+    RecvBuffer->Consume(LengthProcessed);
 
     // check if at least one packet is waiting to be sent and if we've waited long enough to prevent flooding
     // this formula has changed many times but currently we wait 1 second if the last packet was "small", 3.5 seconds if it was "medium", and 4 seconds if it was "big"
@@ -426,7 +423,7 @@ bool CBNET::Update(void* fd, void* send_fd)
       m_LastNullTime = Time;
     }
 
-    m_Socket->DoSend(static_cast<fd_set*>(send_fd));
+    m_Socket->DoSend();
     return m_Exiting;
   }
 
@@ -444,36 +441,41 @@ bool CBNET::Update(void* fd, void* send_fd)
     return m_Exiting;
   }
 
-  if (!m_Socket->GetConnecting() && !m_Socket->GetConnected() && (m_FirstConnect || (Time - m_LastDisconnectedTime >= m_ReconnectDelay)))
+  if (!m_Socket->GetConnecting() && !m_Socket->GetConnected() && !m_Resolving && (m_FirstConnect || (Time - m_LastDisconnectedTime >= m_ReconnectDelay)))
   {
     // attempt to connect to battle.net
+    // the server name is resolved on the resolver thread, we connect when the address comes back (right away if it's cached)
 
     m_FirstConnect = false;
+    m_Resolving    = true;
     Print("[BNET: " + m_ServerAlias + "] connecting to server [" + m_Server + "] on port 6112");
 
     if (!m_Aura->m_BindAddress.empty())
       Print("[BNET: " + m_ServerAlias + "] attempting to bind to address [" + m_Aura->m_BindAddress + "]");
 
-    if (m_ServerIP.empty())
-    {
-      m_Socket->Connect(m_Aura->m_BindAddress, m_Server, 6112);
+    m_Aura->m_Resolver->Resolve(m_Server, [this](const string& address) {
+      m_Resolving = false;
 
-      if (!m_Socket->HasError())
+      if (!address.empty())
       {
-        m_ServerIP = m_Socket->GetIPString();
-        Print("[BNET: " + m_ServerAlias + "] resolved and cached server IP address " + m_ServerIP);
+        if (address != m_ServerIP)
+          Print("[BNET: " + m_ServerAlias + "] resolved server IP address " + address);
+
+        m_ServerIP = address;
+      }
+      else if (!m_ServerIP.empty())
+        Print("[BNET: " + m_ServerAlias + "] unable to resolve server [" + m_Server + "], using the last known server IP address " + m_ServerIP);
+      else
+      {
+        Print("[BNET: " + m_ServerAlias + "] unable to resolve server [" + m_Server + "], waiting " + to_string(m_ReconnectDelay) + " seconds to reconnect");
+        m_LastDisconnectedTime = GetTime();
+        return;
       }
-    }
-    else
-    {
-      // use cached server IP address since resolving takes time and is blocking
 
-      Print("[BNET: " + m_ServerAlias + "] using cached server IP address " + m_ServerIP);
       m_Socket->Connect(m_Aura->m_BindAddress, m_ServerIP, 6112);
-    }
-
-    m_WaitingToConnect          = false;
-    m_LastConnectionAttemptTime = Time;
+      m_WaitingToConnect          = false;
+      m_LastConnectionAttemptTime = GetTime();
+    });
   }
 
   if (m_Socket->GetConnecting())
@@ -487,7 +489,7 @@ bool CBNET::Update(void* fd, void* send_fd)
       Print2("[BNET: " + m_ServerAlias + "] connected");
       m_Socket->PutBytes(m_Protocol->SEND_PROTOCOL_INITIALIZE_SELECTOR());
       m_Socket->PutBytes(m_Protocol->SEND_SID_AUTH_INFO(m_War3Version, m_LocaleID, m_CountryAbbrev, m_Country));
-      m_Socket->DoSend(static_cast<fd_set*>(send_fd));
+      m_Socket->DoSend();
       m_LastNullTime       = Time;
       m_LastOutPacketTicks = Ticks;
 
@@ -519,15 +521,17 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
   string                           User    = chatEvent->GetUser();
   string                           Message = chatEvent->GetMessage();
 
-  // handle spoof checking for current game
+  // handle spoof checking for the lobbies
   // this case covers whispers - we assume that anyone who sends a whisper to the bot with message "spoofcheck" should be considered spoof checked
   // note that this means you can whisper "spoofcheck" even in a public game to manually spoofcheck if the /whois fails
 
-  if (Event == CBNETProtocol::EID_WHISPER && m_Aura->m_CurrentGame)
+  if (Event == CBNETProtocol::EID_WHISPER && !m_Aura->m_Lobbies.empty())
   {
     if (Message == "s" || Message == "sc" || Message == "spoofcheck")
     {
-      m_Aura->m_CurrentGame->AddToSpoofed(m_Server, User, true);
+      for (auto& lobby : m_Aura->m_Lobbies)
+        lobby->AddToSpoofed(m_Server, User, true);
+
       return;
     }
   }
@@ -618,15 +622,7 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
                   if (File.find("DotA") != string::npos)
                     MapCFG.Set("map_type", "dota");
 
-                  m_Aura->m_Map->Load(&MapCFG, File);
-
-                  if (m_Aura->m_Map)
-                  {
-                    const char* ErrorMessage = m_Aura->m_Map->CheckValid();
-
-                    if (ErrorMessage)
-                      QueueChatCommand(std::string("Error while loading map: [") + ErrorMessage + "]", User, Whisper, m_IRC);
-                  }
+                  m_Aura->m_MapLoader->Load(new CMapLoadRequest(MapCFG, m_Aura->GetMapLoadSettings(), File, User, m_IRC, this, Whisper));
                 }
                 else
                 {
@@ -650,19 +646,21 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
           case HashCode("unhost"):
           case HashCode("uh"):
           {
-            if (m_Aura->m_CurrentGame)
+            CGame* Lobby = m_Aura->GetLobby(User);
+
+            if (Lobby)
             {
-              if (m_Aura->m_CurrentGame->GetCountDownStarted())
-                QueueChatCommand("Unable to unhost game [" + m_Aura->m_CurrentGame->GetDescription() + "]. The countdown has started, just wait a few seconds", User, Whisper, m_IRC);
+              if (Lobby->GetCountDownStarted())
+                QueueChatCommand("Unable to unhost game [" + Lobby->GetDescription() + "]. The countdown has started, just wait a few seconds", User, Whisper, m_IRC);
 
               // if the game owner is still in the game only allow the root admin to unhost the game
 
-              else if (m_Aura->m_CurrentGame->GetPlayerFromName(m_Aura->m_CurrentGame->GetOwnerName(), false) && !IsRootAdmin(User))
-                QueueChatCommand("You can't unhost that game because the game owner [" + m_Aura->m_CurrentGame->GetOwnerName() + "] is in the lobby", User, Whisper, m_IRC);
+              else if (Lobby->GetPlayerFromName(Lobby->GetOwnerName(), false) && !IsRootAdmin(User))
+                QueueChatCommand("You can't unhost that game because the game owner [" + Lobby->GetOwnerName() + "] is in the lobby", User, Whisper, m_IRC);
               else
               {
-                QueueChatCommand("Unhosting game [" + m_Aura->m_CurrentGame->GetDescription() + "]", User, Whisper, m_IRC);
-                m_Aura->m_CurrentGame->SetExiting(true);
+                QueueChatCommand("Unhosting game [" + Lobby->GetDescription() + "]", User, Whisper, m_IRC);
+                Lobby->SetExiting(true);
               }
             }
             else
@@ -722,7 +720,7 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
                   QueueChatCommand("Loading config file [" + m_Aura->m_MapCFGPath + File + "]", User, Whisper, m_IRC);
                   CConfig MapCFG;
                   MapCFG.Read(m_Aura->m_MapCFGPath + File);
-                  m_Aura->m_Map->Load(&MapCFG, m_Aura->m_MapCFGPath + File);
+                  m_Aura->m_MapLoader->Load(new CMapLoadRequest(MapCFG, m_Aura->GetMapLoadSettings(), m_Aura->m_MapCFGPath + File, User, m_IRC, this, Whisper));
                 }
                 else
                 {
@@ -868,10 +866,12 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
 
           case HashCode("close"):
           {
-            if (Payload.empty() || !m_Aura->m_CurrentGame)
+            CGame* Lobby = m_Aura->GetLobby(User);
+
+            if (Payload.empty() || !Lobby)
               break;
 
-            if (!m_Aura->m_CurrentGame->GetLocked())
+            if (!Lobby->GetLocked())
             {
               // close as many slots as specified, e.g. "5 10" closes slots 5 and 10
 
@@ -889,7 +889,7 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
                   break;
                 }
                 else
-                  m_Aura->m_CurrentGame->CloseSlot(static_cast<uint8_t>(SID - 1), true);
+                  Lobby->CloseSlot(static_cast<uint8_t>(SID - 1), true);
               }
             }
             else
@@ -904,11 +904,13 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
 
           case HashCode("closeall"):
           {
-            if (!m_Aura->m_CurrentGame)
+            CGame* Lobby = m_Aura->GetLobby(User);
+
+            if (!Lobby)
               break;
 
-            if (!m_Aura->m_CurrentGame->GetLocked())
-              m_Aura->m_CurrentGame->CloseAllSlots();
+            if (!Lobby->GetLocked())
+              Lobby->CloseAllSlots();
             else
               QueueChatCommand("This command is disabled while the game is locked", User, Whisper, m_IRC);
 
@@ -1066,14 +1068,19 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
               {
                 // if the game owner is still in the game only allow the root admin to end the game
 
-                if (m_Aura->m_Games[GameNumber]->GetPlayerFromName(m_Aura->m_Games[GameNumber]->GetOwnerName(), false) && !IsRootAdmin(User))
-                  QueueChatCommand("You can't end that game because the game owner [" + m_Aura->m_Games[GameNumber]->GetOwnerName() + "] is still playing", User, Whisper, m_IRC);
-                else
-                {
-                  QueueChatCommand("Ending game [" + m_Aura->m_Games[GameNumber]->GetDescription() + "]", User, Whisper, m_IRC);
-                  Print("[GAME: " + m_Aura->m_Games[GameNumber]->GetGameName() + "] is over (admin ended game)");
-                  m_Aura->m_Games[GameNumber]->StopPlayers("was disconnected (admin ended game)");
-                }
+                const bool RootAdmin = IsRootAdmin(User);
+
+                const auto EndGame = [RootAdmin](CGame* game) {
+                  if (game->GetPlayerFromName(game->GetOwnerName(), false) && !RootAdmin)
+                    return "You can't end that game because the game owner [" + game->GetOwnerName() + "] is still playing";
+
+                  Print("[GAME: " + game->GetGameName() + "] is over (admin ended game)");
+                  game->StopPlayers("was disconnected (admin ended game)");
+                  return "Ending game [" + game->GetDescription() + "]";
+                };
+
+                const string IRC = m_IRC;
+                m_Aura->QueryGame(m_Aura->m_Games[GameNumber], EndGame, [this, User, Whisper, IRC](const string& message) { QueueChatCommand(message, User, Whisper, IRC); });
               }
               else
                 QueueChatCommand("Game number " + Payload + " doesn't exist", User, Whisper, m_IRC);
@@ -1092,7 +1099,9 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
 
           case HashCode("hold"):
           {
-            if (Payload.empty() || !m_Aura->m_CurrentGame)
+            CGame* Lobby = m_Aura->GetLobby(User);
+
+            if (Payload.empty() || !Lobby)
               break;
 
             // hold as many players as specified, e.g. "Varlock Kilranin" holds players "Varlock" and "Kilranin"
@@ -1113,7 +1122,7 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
               else
               {
                 QueueChatCommand("Added player [" + HoldName + "] to the hold list", User, Whisper, m_IRC);
-                m_Aura->m_CurrentGame->AddToReserved(HoldName);
+                Lobby->AddToReserved(HoldName);
               }
             }
 
@@ -1126,7 +1135,9 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
 
           case HashCode("sendlan"):
           {
-            if (Payload.empty() || !m_Aura->m_CurrentGame || m_Aura->m_CurrentGame->GetCountDownStarted())
+            CGame* Lobby = m_Aura->GetLobby(User);
+
+            if (Payload.empty() || !Lobby || Lobby->GetCountDownStarted())
               break;
 
             // extract the ip and the port
@@ -1145,26 +1156,16 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
               QueueChatCommand("Bad input to sendlan command", User, Whisper, m_IRC);
             else
             {
-              // construct a fixed host counter which will be used to identify players from this "realm" (i.e. LAN)
-              // the fixed host counter's 4 most significant bits will contain a 4 bit ID (0-15)
-              // the rest of the fixed host counter will contain the 28 least significant bits of the actual host counter
-              // since we're destroying 4 bits of information here the actual host counter should not be greater than 2^28 which is a reasonable assumption
-              // when a player joins a game we can obtain the ID from the received host counter
-              // note: LAN broadcasts use an ID of 0, battle.net refreshes use an ID of 1-10, the rest are unused
-
-              // we send 12 for SlotsTotal because this determines how many PID's Warcraft 3 allocates
-              // we need to make sure Warcraft 3 allocates at least SlotsTotal + 1 but at most 12 PID's
-              // this is because we need an extra PID for the virtual host player (but we always delete the virtual host player when the 12th person joins)
-              // however, we can't send 13 for SlotsTotal because this causes Warcraft 3 to crash when sharing control of units
-              // nor can we send SlotsTotal because then Warcraft 3 crashes when playing maps with less than 12 PID's (because of the virtual host player taking an extra PID)
-              // we also send 12 for SlotsOpen because Warcraft 3 assumes there's always at least one player in the game (the host)
-              // so if we try to send accurate numbers it'll always be off by one and results in Warcraft 3 assuming the game is full when it still needs one more player
-              // the easiest solution is to simply send 12 for both so the game will always show up as (1/12) players
-
-              // note: the PrivateGame flag is not set when broadcasting to LAN (as you might expect)
-              // note: we do not use m_Map->GetMapGameType because none of the filters are set when broadcasting to LAN (also as you might expect)
-              
-              m_Aura->m_UDPSocket->SendTo(IP, Port, m_Aura->m_CurrentGame->GetProtocol()->SEND_W3GS_GAMEINFO(m_Aura->m_LANWar3Version, CreateByteArray(static_cast<uint32_t>(MAPGAMETYPE_UNKNOWN0), false), m_Aura->m_CurrentGame->GetMap()->GetMapGameFlags(), m_Aura->m_CurrentGame->GetMap()->GetMapWidth(), m_Aura->m_CurrentGame->GetMap()->GetMapHeight(), m_Aura->m_CurrentGame->GetGameName(), "Clan 007", 0, m_Aura->m_CurrentGame->GetMap()->GetMapPath(), m_Aura->m_CurrentGame->GetMap()->GetMapCRC(), MAX_SLOTS, MAX_SLOTS, m_Aura->m_CurrentGame->GetHostPort(), m_Aura->m_CurrentGame->GetHostCounter() & 0x0FFFFFFF, m_Aura->m_CurrentGame->GetEntryKey()));
+              // see CGame::GetLANGameInfo for what goes into the game info
+              // note: the packet is sent once the ip has been resolved (it can be a host name)
+
+              CAura*                Aura     = m_Aura;
+              const vector<uint8_t> GameInfo = Lobby->GetLANGameInfo();
+
+              m_Aura->m_Resolver->Resolve(IP, [Aura, Port, GameInfo](const string& address) {
+                if (!address.empty())
+                  Aura->m_UDPSocket->SendTo(address, Port, GameInfo);
+              });
             }
 
             break;
@@ -1251,10 +1252,12 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
 
           case HashCode("open"):
           {
-            if (Payload.empty() || !m_Aura->m_CurrentGame)
+            CGame* Lobby = m_Aura->GetLobby(User);
+
+            if (Payload.empty() || !Lobby)
               break;
 
-            if (!m_Aura->m_CurrentGame->GetLocked())
+            if (!Lobby->GetLocked())
             {
               // open as many slots as specified, e.g. "5 10" opens slots 5 and 10
 
@@ -1272,7 +1275,7 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
                   break;
                 }
                 else
-                  m_Aura->m_CurrentGame->OpenSlot(static_cast<uint8_t>(SID - 1), true);
+                  Lobby->OpenSlot(static_cast<uint8_t>(SID - 1), true);
               }
             }
             else
@@ -1287,11 +1290,13 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
 
           case HashCode("openall"):
           {
-            if (!m_Aura->m_CurrentGame)
+            CGame* Lobby = m_Aura->GetLobby(User);
+
+            if (!Lobby)
               break;
 
-            if (!m_Aura->m_CurrentGame->GetLocked())
-              m_Aura->m_CurrentGame->OpenAllSlots();
+            if (!Lobby->GetLocked())
+              Lobby->OpenAllSlots();
             else
               QueueChatCommand("This command is disabled while the game is locked", User, Whisper, m_IRC);
 
@@ -1415,7 +1420,7 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
                     Message = Message.substr(Start);
 
                   if (GameNumber - 1 < m_Aura->m_Games.size())
-                    m_Aura->m_Games[GameNumber - 1]->SendAllChat("ADMIN: " + Message);
+                    m_Aura->RunOnGame(m_Aura->m_Games[GameNumber - 1]->GetHostCounter(), [Message](CGame* game) { game->SendAllChat("ADMIN: " + Message); });
                   else
                     QueueChatCommand("Game number " + to_string(GameNumber) + " doesn't exist", User, Whisper, m_IRC);
                 }
@@ -1438,19 +1443,19 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
 
             if (IsRootAdmin(User))
             {
-              if (m_Aura->m_CurrentGame)
-                m_Aura->m_CurrentGame->SendAllChat(Payload);
+              for (auto& lobby : m_Aura->m_Lobbies)
+                lobby->SendAllChat(Payload);
 
               for (auto& game : m_Aura->m_Games)
-                game->SendAllChat("ADMIN: " + Payload);
+                m_Aura->RunOnGame(game->GetHostCounter(), [Payload](CGame* game) { game->SendAllChat("ADMIN: " + Payload); });
             }
             else
             {
-              if (m_Aura->m_CurrentGame)
-                m_Aura->m_CurrentGame->SendAllChat(Payload);
+              for (auto& lobby : m_Aura->m_Lobbies)
+                lobby->SendAllChat(Payload);
 
               for (auto& game : m_Aura->m_Games)
-                game->SendAllChat("ADMIN (" + User + "): " + Payload);
+                m_Aura->RunOnGame(game->GetHostCounter(), [User, Payload](CGame* game) { game->SendAllChat("ADMIN (" + User + "): " + Payload); });
             }
 
             break;
@@ -1462,13 +1467,15 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
 
           case HashCode("sp"):
           {
-            if (!m_Aura->m_CurrentGame || m_Aura->m_CurrentGame->GetCountDownStarted())
+            CGame* Lobby = m_Aura->GetLobby(User);
+
+            if (!Lobby || Lobby->GetCountDownStarted())
               break;
 
-            if (!m_Aura->m_CurrentGame->GetLocked())
+            if (!Lobby->GetLocked())
             {
-              m_Aura->m_CurrentGame->SendAllChat("Shuffling players");
-              m_Aura->m_CurrentGame->ShuffleSlots();
+              Lobby->SendAllChat("Shuffling players");
+              Lobby->ShuffleSlots();
             }
             else
               QueueChatCommand("This command is disabled while the game is locked", User, Whisper, m_IRC);
@@ -1484,18 +1491,20 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
           case HashCode("s"):
           case HashCode("start"):
           {
-            if (!m_Aura->m_CurrentGame || m_Aura->m_CurrentGame->GetCountDownStarted() || m_Aura->m_CurrentGame->GetNumHumanPlayers() == 0)
+            CGame* Lobby = m_Aura->GetLobby(User);
+
+            if (!Lobby || Lobby->GetCountDownStarted() || Lobby->GetNumHumanPlayers() == 0)
               break;
 
-            if (!m_Aura->m_CurrentGame->GetLocked())
+            if (!Lobby->GetLocked())
             {
               // if the player sent "!start force" skip the checks and start the countdown
               // otherwise check that the game is ready to start
 
               if (Payload == "force")
-                m_Aura->m_CurrentGame->StartCountDown(true);
+                Lobby->StartCountDown(true);
               else
-                m_Aura->m_CurrentGame->StartCountDown(false);
+                Lobby->StartCountDown(false);
             }
             else
               QueueChatCommand("This command is disabled while the game is locked", User, Whisper, m_IRC);
@@ -1509,10 +1518,12 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
 
           case HashCode("swap"):
           {
-            if (Payload.empty() || !m_Aura->m_CurrentGame)
+            CGame* Lobby = m_Aura->GetLobby(User);
+
+            if (Payload.empty() || !Lobby)
               break;
 
-            if (!m_Aura->m_CurrentGame->GetLocked())
+            if (!Lobby->GetLocked())
             {
               uint32_t     SID1, SID2;
               stringstream SS;
@@ -1532,7 +1543,7 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
                   if (SS.fail())
                     Print("[BNET: " + m_ServerAlias + "] bad input #2 to swap command");
                   else
-                    m_Aura->m_CurrentGame->SwapSlots(static_cast<uint8_t>(SID1 - 1), static_cast<uint8_t>(SID2 - 1));
+                    Lobby->SwapSlots(static_cast<uint8_t>(SID1 - 1), static_cast<uint8_t>(SID2 - 1));
                 }
               }
             }
@@ -1548,7 +1559,7 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
 
           case HashCode("restart"):
           {
-            if ((!m_Aura->m_Games.size() && !m_Aura->m_CurrentGame) || Payload == "force")
+            if ((!m_Aura->m_Games.size() && m_Aura->m_Lobbies.empty()) || Payload == "force")
             {
               m_Exiting = true;
 
@@ -1661,7 +1672,7 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
                 m_Exiting = true;
               else
               {
-                if (m_Aura->m_CurrentGame || !m_Aura->m_Games.empty())
+                if (!m_Aura->m_Lobbies.empty() || !m_Aura->m_Games.empty())
                   QueueChatCommand("At least one game is in the lobby or in progress. Use 'force' to shutdown anyway", User, Whisper, m_IRC);
                 else
                   m_Exiting = true;
@@ -1728,8 +1739,10 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
           {
             if (Payload.empty())
             {
-              if (m_Aura->m_CurrentGame)
-                QueueChatCommand("Game [" + m_Aura->m_CurrentGame->GetDescription() + "] is in the lobby and there are " + to_string(m_Aura->m_Games.size()) + "/" + to_string(m_Aura->m_MaxGames) + " other games in progress", User, Whisper, m_IRC);
+              if (m_Aura->m_Lobbies.size() == 1)
+                QueueChatCommand("Game [" + m_Aura->m_Lobbies[0]->GetDescription() + "] is in the lobby and there are " + to_string(m_Aura->m_Games.size()) + "/" + to_string(m_Aura->m_MaxGames) + " other games in progress", User, Whisper, m_IRC);
+              else if (!m_Aura->m_Lobbies.empty())
+                QueueChatCommand(to_string(m_Aura->m_Lobbies.size()) + " games are in the lobby (the newest is [" + m_Aura->m_Lobbies.back()->GetDescription() + "]) and there are " + to_string(m_Aura->m_Games.size()) + "/" + to_string(m_Aura->m_MaxGames) + " other games in progress", User, Whisper, m_IRC);
               else
                 QueueChatCommand("There is no game in the lobby and there are " + to_string(m_Aura->m_Games.size()) + "/" + to_string(m_Aura->m_MaxGames) + " other games in progress", User, Whisper, m_IRC);
               break;
@@ -1740,7 +1753,10 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
               const uint32_t GameNumber = stoul(Payload) - 1;
 
               if (GameNumber < m_Aura->m_Games.size())
-                QueueChatCommand("Game number " + Payload + " is [" + m_Aura->m_Games[GameNumber]->GetDescription() + "]", User, Whisper, m_IRC);
+              {
+                const string IRC = m_IRC;
+                m_Aura->QueryGame(m_Aura->m_Games[GameNumber], [](CGame* game) { return game->GetDescription(); }, [this, Payload, User, Whisper, IRC](const string& description) { QueueChatCommand("Game number " + Payload + " is [" + description + "]", User, Whisper, IRC); });
+              }
               else
                 QueueChatCommand("Game number " + Payload + " doesn't exist", User, Whisper, m_IRC);
             }
@@ -1759,14 +1775,74 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
 
           case HashCode("getgames"):
           {
-            if (m_Aura->m_CurrentGame)
-              QueueChatCommand("Game [" + m_Aura->m_CurrentGame->GetDescription() + "] is in the lobby and there are " + to_string(m_Aura->m_Games.size()) + "/" + to_string(m_Aura->m_MaxGames) + " other games in progress", User, Whisper, m_IRC);
+            if (m_Aura->m_Lobbies.size() == 1)
+              QueueChatCommand("Game [" + m_Aura->m_Lobbies[0]->GetDescription() + "] is in the lobby and there are " + to_string(m_Aura->m_Games.size()) + "/" + to_string(m_Aura->m_MaxGames) + " other games in progress", User, Whisper, m_IRC);
+            else if (!m_Aura->m_Lobbies.empty())
+              QueueChatCommand(to_string(m_Aura->m_Lobbies.size()) + " games are in the lobby (the newest is [" + m_Aura->m_Lobbies.back()->GetDescription() + "]) and there are " + to_string(m_Aura->m_Games.size()) + "/" + to_string(m_Aura->m_MaxGames) + " other games in progress", User, Whisper, m_IRC);
             else
               QueueChatCommand("There is no game in the lobby and there are " + to_string(m_Aura->m_Games.size()) + "/" + to_string(m_Aura->m_MaxGames) + " other games in progress", User, Whisper, m_IRC);
 
             break;
           }
 
+          //
+          // !JITTER
+          //
+
+          case HashCode("jitter"):
+          {
+            if (Payload.empty())
+              break;
+
+            try
+            {
+              const uint32_t GameNumber = stoul(Payload) - 1;
+
+              if (GameNumber < m_Aura->m_Games.size())
+              {
+                const string IRC = m_IRC;
+                m_Aura->QueryGame(m_Aura->m_Games[GameNumber], [](CGame* game) { return game->GetActionJitter(); }, [this, User, Whisper, IRC](const string& message) { QueueChatCommand(message, User, Whisper, IRC); });
+              }
+              else
+                QueueChatCommand("Game number " + Payload + " doesn't exist", User, Whisper, m_IRC);
+            }
+            catch (...)
+            {
+              // do nothing
+            }
+
+            break;
+          }
+
+          //
+          // !SENDSTATS
+          //
+
+          case HashCode("sendstats"):
+          {
+            if (Payload.empty())
+              break;
+
+            try
+            {
+              const uint32_t GameNumber = stoul(Payload) - 1;
+
+              if (GameNumber < m_Aura->m_Games.size())
+              {
+                const string IRC = m_IRC;
+                m_Aura->QueryGame(m_Aura->m_Games[GameNumber], [](CGame* game) { return game->GetSendStats(); }, [this, User, Whisper, IRC](const string& message) { QueueChatCommand(message, User, Whisper, IRC); });
+              }
+              else
+                QueueChatCommand("Game number " + Payload + " doesn't exist", User, Whisper, m_IRC);
+            }
+            catch (...)
+            {
+              // do nothing
+            }
+
+            break;
+          }
+
           //
           // !GETPLAYERS
           // !GP
@@ -1781,9 +1857,12 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
             const int32_t GameNumber = stoi(Payload) - 1;
 
             if (-1 < GameNumber && GameNumber < static_cast<int32_t>(m_Aura->m_Games.size()))
-              QueueChatCommand("Players in game [" + m_Aura->m_Games[GameNumber]->GetGameName() + "] are: " + m_Aura->m_Games[GameNumber]->GetPlayers(), User, Whisper, m_IRC);
-            else if (GameNumber == -1 && m_Aura->m_CurrentGame)
-              QueueChatCommand("Players in lobby [" + m_Aura->m_CurrentGame->GetGameName() + "] are: " + m_Aura->m_CurrentGame->GetPlayers(), User, Whisper, m_IRC);
+            {
+              const string IRC = m_IRC;
+              m_Aura->QueryGame(m_Aura->m_Games[GameNumber], [](CGame* game) { return "Players in game [" + game->GetGameName() + "] are: " + game->GetPlayers(); }, [this, User, Whisper, IRC](const string& message) { QueueChatCommand(message, User, Whisper, IRC); });
+            }
+            else if (GameNumber == -1 && m_Aura->GetLobby(User))
+              QueueChatCommand("Players in lobby [" + m_Aura->GetLobby(User)->GetGameName() + "] are: " + m_Aura->GetLobby(User)->GetPlayers(), User, Whisper, m_IRC);
             else
               QueueChatCommand("Game number " + Payload + " doesn't exist", User, Whisper, m_IRC);
 
@@ -1804,9 +1883,12 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
             const int32_t GameNumber = stoi(Payload) - 1;
 
             if (-1 < GameNumber && GameNumber < static_cast<int32_t>(m_Aura->m_Games.size()))
-              QueueChatCommand("Observers in game [" + m_Aura->m_Games[GameNumber]->GetGameName() + "] are: " + m_Aura->m_Games[GameNumber]->GetObservers(), User, Whisper, m_IRC);
-            else if (GameNumber == -1 && m_Aura->m_CurrentGame)
-              QueueChatCommand("Observers in lobby [" + m_Aura->m_CurrentGame->GetGameName() + "] are: " + m_Aura->m_CurrentGame->GetObservers(), User, Whisper, m_IRC);
+            {
+              const string IRC = m_IRC;
+              m_Aura->QueryGame(m_Aura->m_Games[GameNumber], [](CGame* game) { return "Observers in game [" + game->GetGameName() + "] are: " + game->GetObservers(); }, [this, User, Whisper, IRC](const string& message) { QueueChatCommand(message, User, Whisper, IRC); });
+            }
+            else if (GameNumber == -1 && m_Aura->GetLobby(User))
+              QueueChatCommand("Observers in lobby [" + m_Aura->GetLobby(User)->GetGameName() + "] are: " + m_Aura->GetLobby(User)->GetObservers(), User, Whisper, m_IRC);
             else
               QueueChatCommand("Game number " + Payload + " doesn't exist", User, Whisper, m_IRC);
 
@@ -1893,7 +1975,7 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
     // extract the first word which we hope is the username
     // this is not necessarily true though since info messages also include channel MOTD's and such
 
-    if (m_Aura->m_CurrentGame)
+    if (!m_Aura->m_Lobbies.empty())
     {
       string            UserName;
       string::size_type Split = Message.find(' ');
@@ -1903,9 +1985,12 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
       else
         UserName = Message;
 
-      if (m_Aura->m_CurrentGame->GetPlayerFromName(UserName, true))
+      for (auto& lobby : m_Aura->m_Lobbies)
       {
-        // handle spoof checking for current game
+        if (!lobby->GetPlayerFromName(UserName, true))
+          continue;
+
+        // handle spoof checking for the lobby the player is in
         // this case covers whois results which are used when hosting a public game (we send out a "/whois [player]" for each player)
         // at all times you can still /w the bot with "spoofcheck" to manually spoof check
 
@@ -1915,10 +2000,10 @@ void CBNET::ProcessChatEvent(const CIncomingChatEvent* chatEvent)
           // this is because when the game is rehosted, players who joined recently will be in the previous game according to battle.net
           // note: if the game is rehosted more than once it is possible (but unlikely) for a false positive because only two game names are checked
 
-          if (Message.find(m_Aura->m_CurrentGame->GetGameName()) != string::npos || Message.find(m_Aura->m_CurrentGame->GetLastGameName()) != string::npos)
-            m_Aura->m_CurrentGame->AddToSpoofed(m_Server, UserName, false);
+          if (Message.find(lobby->GetGameName()) != string::npos || Message.find(lobby->GetLastGameName()) != string::npos)
+            lobby->AddToSpoofed(m_Server, UserName, false);
           else
-            m_Aura->m_CurrentGame->SendAllChat("Name spoof detected. The real [" + UserName + "] is in another game");
+            lobby->SendAllChat("Name spoof detected. The real [" + UserName + "] is in another game");
 
           return;
         }
@@ -55,7 +55,7 @@ private:
   std::vector<uint8_t>             m_EXEVersion;                // custom exe version for PvPGN users
   std::vector<uint8_t>             m_EXEVersionHash;            // custom exe version hash for PvPGN users
   std::string                      m_Server;                    // battle.net server to connect to
-  std::string                      m_ServerIP;                  // battle.net server to connect to (the IP address so we don't have to resolve it every time we connect)
+  std::string                      m_ServerIP;                  // the address m_Server last resolved to, used if resolving it fails the next time we connect
   std::string                      m_ServerAlias;               // battle.net server alias (short name, e.g. "USEast")
   std::string                      m_CDKeyROC;                  // ROC CD key
   std::string                      m_CDKeyTFT;                  // TFT CD key
@@ -71,8 +71,6 @@ private:
   int64_t                          m_LastConnectionAttemptTime; // GetTime when we last attempted to connect to battle.net
   int64_t                          m_LastNullTime;              // GetTime when the last null packet was sent for detecting disconnects
   int64_t                          m_LastOutPacketTicks;        // GetTicks when the last packet was sent for the m_OutPackets queue
-  int64_t                          m_LastAdminRefreshTime;      // GetTime when the admin list was last refreshed from the database
-  int64_t                          m_LastBanRefreshTime;        // GetTime when the ban list was last refreshed from the database
   int64_t                          m_ReconnectDelay;            // interval between two consecutive connect attempts
   uint32_t                         m_LastOutPacketSize;         // byte size of the last packet we sent from the m_OutPackets queue
   uint32_t                         m_LocaleID;                  // see: http://msdn.microsoft.com/en-us/library/0h88fahh%28VS.85%29.aspx
@@ -82,6 +80,7 @@ private:
   bool                             m_Exiting;                   // set to true and this class will be deleted next update
   bool                             m_FirstConnect;              // if we haven't tried to connect to battle.net yet
   bool                             m_WaitingToConnect;          // if we're waiting to reconnect to battle.net after being disconnected
+  bool                             m_Resolving;                 // if we're waiting for the server name to be resolved before connecting
   bool                             m_LoggedIn;                  // if we've logged into battle.net or not
   bool                             m_InChat;                    // if we've entered chat or not (but we're not necessarily in a chat channel yet
   bool                             m_PvPGN;                     // if this BNET connection is actually a PvPGN
@@ -112,8 +111,7 @@ public:
 
   // processing functions
 
-  uint32_t SetFD(void* fd, void* send_fd, int32_t* nfds);
-  bool Update(void* fd, void* send_fd);
+  bool Update();
   void ProcessChatEvent(const CIncomingChatEvent* chatEvent);
 
   // functions to send packets to battle.net
@@ -37,7 +37,7 @@ CBNETProtocol::~CBNETProtocol() = default;
 // RECEIVE FUNCTIONS //
 ///////////////////////
 
-bool CBNETProtocol::RECEIVE_SID_NULL(const std::vector<uint8_t>& data)
+bool CBNETProtocol::RECEIVE_SID_NULL(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_NULL" );
   // DEBUG_Print( data );
@@ -48,7 +48,7 @@ bool CBNETProtocol::RECEIVE_SID_NULL(const std::vector<uint8_t>& data)
   return ValidateLength(data);
 }
 
-CIncomingGameHost* CBNETProtocol::RECEIVE_SID_GETADVLISTEX(const std::vector<uint8_t>& data)
+CIncomingGameHost* CBNETProtocol::RECEIVE_SID_GETADVLISTEX(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_GETADVLISTEX" );
   // DEBUG_Print( data );
@@ -66,9 +66,7 @@ CIncomingGameHost* CBNETProtocol::RECEIVE_SID_GETADVLISTEX(const std::vector<uin
 
   if (ValidateLength(data) && data.size() >= 8)
   {
-    const std::vector<uint8_t> GamesFound = std::vector<uint8_t>(begin(data) + 4, begin(data) + 8);
-
-    if (ByteArrayToUInt32(GamesFound, false) > 0 && data.size() >= 25)
+    if (ByteArrayToUInt32(data, false, 4) > 0 && data.size() >= 25)
     {
       const std::vector<uint8_t> Port     = std::vector<uint8_t>(begin(data) + 18, begin(data) + 20);
       const std::vector<uint8_t> IP       = std::vector<uint8_t>(begin(data) + 20, begin(data) + 24);
@@ -94,7 +92,7 @@ CIncomingGameHost* CBNETProtocol::RECEIVE_SID_GETADVLISTEX(const std::vector<uin
   return nullptr;
 }
 
-bool CBNETProtocol::RECEIVE_SID_ENTERCHAT(const std::vector<uint8_t>& data)
+bool CBNETProtocol::RECEIVE_SID_ENTERCHAT(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_ENTERCHAT" );
   // DEBUG_Print( data );
@@ -112,7 +110,7 @@ bool CBNETProtocol::RECEIVE_SID_ENTERCHAT(const std::vector<uint8_t>& data)
   return false;
 }
 
-CIncomingChatEvent* CBNETProtocol::RECEIVE_SID_CHATEVENT(const std::vector<uint8_t>& data)
+CIncomingChatEvent* CBNETProtocol::RECEIVE_SID_CHATEVENT(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_CHATEVENT" );
   // DEBUG_Print( data );
@@ -128,12 +126,11 @@ CIncomingChatEvent* CBNETProtocol::RECEIVE_SID_CHATEVENT(const std::vector<uint8
 
   if (ValidateLength(data) && data.size() >= 29)
   {
-    const std::vector<uint8_t> EventID = std::vector<uint8_t>(begin(data) + 4, begin(data) + 8);
     // std::vector<uint8_t> Ping = std::vector<uint8_t>( data.begin( ) + 12, data.begin( ) + 16 );
     const std::vector<uint8_t> User    = ExtractCString(data, 28);
     const std::vector<uint8_t> Message = ExtractCString(data, User.size() + 29);
 
-    return new CIncomingChatEvent(static_cast<CBNETProtocol::IncomingChatEvent>(ByteArrayToUInt32(EventID, false)),
+    return new CIncomingChatEvent(static_cast<CBNETProtocol::IncomingChatEvent>(ByteArrayToUInt32(data, false, 4)),
                                   string(begin(User), end(User)),
                                   string(begin(Message), end(Message)));
   }
@@ -141,7 +138,7 @@ CIncomingChatEvent* CBNETProtocol::RECEIVE_SID_CHATEVENT(const std::vector<uint8
   return nullptr;
 }
 
-bool CBNETProtocol::RECEIVE_SID_CHECKAD(const std::vector<uint8_t>& data)
+bool CBNETProtocol::RECEIVE_SID_CHECKAD(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_CHECKAD" );
   // DEBUG_Print( data );
@@ -152,7 +149,7 @@ bool CBNETProtocol::RECEIVE_SID_CHECKAD(const std::vector<uint8_t>& data)
   return ValidateLength(data);
 }
 
-bool CBNETProtocol::RECEIVE_SID_STARTADVEX3(const std::vector<uint8_t>& data)
+bool CBNETProtocol::RECEIVE_SID_STARTADVEX3(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_STARTADVEX3" );
   // DEBUG_Print( data );
@@ -163,16 +160,14 @@ bool CBNETProtocol::RECEIVE_SID_STARTADVEX3(const std::vector<uint8_t>& data)
 
   if (ValidateLength(data) && data.size() >= 8)
   {
-    const std::vector<uint8_t> Status = std::vector<uint8_t>(begin(data) + 4, begin(data) + 8);
-
-    if (ByteArrayToUInt32(Status, false) == 0)
+    if (ByteArrayToUInt32(data, false, 4) == 0)
       return true;
   }
 
   return false;
 }
 
-std::vector<uint8_t> CBNETProtocol::RECEIVE_SID_PING(const std::vector<uint8_t>& data)
+std::vector<uint8_t> CBNETProtocol::RECEIVE_SID_PING(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_PING" );
   // DEBUG_Print( data );
@@ -187,7 +182,7 @@ std::vector<uint8_t> CBNETProtocol::RECEIVE_SID_PING(const std::vector<uint8_t>&
   return std::vector<uint8_t>();
 }
 
-bool CBNETProtocol::RECEIVE_SID_AUTH_INFO(const std::vector<uint8_t>& data)
+bool CBNETProtocol::RECEIVE_SID_AUTH_INFO(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_AUTH_INFO" );
   // DEBUG_Print( data );
@@ -214,7 +209,7 @@ bool CBNETProtocol::RECEIVE_SID_AUTH_INFO(const std::vector<uint8_t>& data)
   return false;
 }
 
-bool CBNETProtocol::RECEIVE_SID_AUTH_CHECK(const std::vector<uint8_t>& data)
+bool CBNETProtocol::RECEIVE_SID_AUTH_CHECK(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_AUTH_CHECK" );
   // DEBUG_Print( data );
@@ -236,7 +231,7 @@ bool CBNETProtocol::RECEIVE_SID_AUTH_CHECK(const std::vector<uint8_t>& data)
   return false;
 }
 
-bool CBNETProtocol::RECEIVE_SID_AUTH_ACCOUNTLOGON(const std::vector<uint8_t>& data)
+bool CBNETProtocol::RECEIVE_SID_AUTH_ACCOUNTLOGON(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_AUTH_ACCOUNTLOGON" );
   // DEBUG_Print( data );
@@ -250,9 +245,7 @@ bool CBNETProtocol::RECEIVE_SID_AUTH_ACCOUNTLOGON(const std::vector<uint8_t>& da
 
   if (ValidateLength(data) && data.size() >= 8)
   {
-    const std::vector<uint8_t> status = std::vector<uint8_t>(begin(data) + 4, begin(data) + 8);
-
-    if (ByteArrayToUInt32(status, false) == 0 && data.size() >= 72)
+    if (ByteArrayToUInt32(data, false, 4) == 0 && data.size() >= 72)
     {
       m_Salt            = std::vector<uint8_t>(begin(data) + 8, begin(data) + 40);
       m_ServerPublicKey = std::vector<uint8_t>(begin(data) + 40, begin(data) + 72);
@@ -263,7 +256,7 @@ bool CBNETProtocol::RECEIVE_SID_AUTH_ACCOUNTLOGON(const std::vector<uint8_t>& da
   return false;
 }
 
-bool CBNETProtocol::RECEIVE_SID_AUTH_ACCOUNTLOGONPROOF(const std::vector<uint8_t>& data)
+bool CBNETProtocol::RECEIVE_SID_AUTH_ACCOUNTLOGONPROOF(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_AUTH_ACCOUNTLOGONPROOF" );
   // DEBUG_Print( data );
@@ -274,7 +267,7 @@ bool CBNETProtocol::RECEIVE_SID_AUTH_ACCOUNTLOGONPROOF(const std::vector<uint8_t
 
   if (ValidateLength(data) && data.size() >= 8)
   {
-    uint32_t Status = ByteArrayToUInt32(std::vector<uint8_t>(begin(data) + 4, begin(data) + 8), false);
+    uint32_t Status = ByteArrayToUInt32(data, false, 4);
 
     if (Status == 0 || Status == 0xE)
       return true;
@@ -283,7 +276,7 @@ bool CBNETProtocol::RECEIVE_SID_AUTH_ACCOUNTLOGONPROOF(const std::vector<uint8_t
   return false;
 }
 
-vector<string> CBNETProtocol::RECEIVE_SID_FRIENDLIST(const std::vector<uint8_t>& data)
+vector<string> CBNETProtocol::RECEIVE_SID_FRIENDLIST(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_FRIENDSLIST" );
   // DEBUG_Print( data );
@@ -328,7 +321,7 @@ vector<string> CBNETProtocol::RECEIVE_SID_FRIENDLIST(const std::vector<uint8_t>&
   return Friends;
 }
 
-vector<string> CBNETProtocol::RECEIVE_SID_CLANMEMBERLIST(const std::vector<uint8_t>& data)
+vector<string> CBNETProtocol::RECEIVE_SID_CLANMEMBERLIST(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED SID_CLANMEMBERLIST" );
   // DEBUG_Print( data );
@@ -671,7 +664,7 @@ std::vector<uint8_t> CBNETProtocol::SEND_SID_CLANMEMBERLIST()
 // OTHER FUNCTIONS //
 /////////////////////
 
-bool CBNETProtocol::ValidateLength(const std::vector<uint8_t>& content)
+bool CBNETProtocol::ValidateLength(const CByteView& content)
 {
   // verify that bytes 3 and 4 (indices 2 and 3) of the content array describe the length
 
@@ -30,6 +30,7 @@
 #include <string>
 #include <vector>
 
+class CByteView;
 class CIncomingGameHost;
 class CIncomingChatEvent;
 
@@ -125,19 +126,19 @@ public:
 
   // receive functions
 
-  bool RECEIVE_SID_NULL(const std::vector<uint8_t>& data);
-  CIncomingGameHost* RECEIVE_SID_GETADVLISTEX(const std::vector<uint8_t>& data);
-  bool RECEIVE_SID_ENTERCHAT(const std::vector<uint8_t>& data);
-  CIncomingChatEvent* RECEIVE_SID_CHATEVENT(const std::vector<uint8_t>& data);
-  bool RECEIVE_SID_CHECKAD(const std::vector<uint8_t>& data);
-  bool RECEIVE_SID_STARTADVEX3(const std::vector<uint8_t>& data);
-  std::vector<uint8_t> RECEIVE_SID_PING(const std::vector<uint8_t>& data);
-  bool RECEIVE_SID_AUTH_INFO(const std::vector<uint8_t>& data);
-  bool RECEIVE_SID_AUTH_CHECK(const std::vector<uint8_t>& data);
-  bool RECEIVE_SID_AUTH_ACCOUNTLOGON(const std::vector<uint8_t>& data);
-  bool RECEIVE_SID_AUTH_ACCOUNTLOGONPROOF(const std::vector<uint8_t>& data);
-  std::vector<std::string> RECEIVE_SID_FRIENDLIST(const std::vector<uint8_t>& data);
-  std::vector<std::string> RECEIVE_SID_CLANMEMBERLIST(const std::vector<uint8_t>& data);
+  bool RECEIVE_SID_NULL(const CByteView& data);
+  CIncomingGameHost* RECEIVE_SID_GETADVLISTEX(const CByteView& data);
+  bool RECEIVE_SID_ENTERCHAT(const CByteView& data);
+  CIncomingChatEvent* RECEIVE_SID_CHATEVENT(const CByteView& data);
+  bool RECEIVE_SID_CHECKAD(const CByteView& data);
+  bool RECEIVE_SID_STARTADVEX3(const CByteView& data);
+  std::vector<uint8_t> RECEIVE_SID_PING(const CByteView& data);
+  bool RECEIVE_SID_AUTH_INFO(const CByteView& data);
+  bool RECEIVE_SID_AUTH_CHECK(const CByteView& data);
+  bool RECEIVE_SID_AUTH_ACCOUNTLOGON(const CByteView& data);
+  bool RECEIVE_SID_AUTH_ACCOUNTLOGONPROOF(const CByteView& data);
+  std::vector<std::string> RECEIVE_SID_FRIENDLIST(const CByteView& data);
+  std::vector<std::string> RECEIVE_SID_CLANMEMBERLIST(const CByteView& data);
 
   // send functions
 
@@ -164,7 +165,7 @@ public:
   // other functions
 
 private:
-  bool ValidateLength(const std::vector<uint8_t>& content);
+  bool ValidateLength(const CByteView& content);
 };
 
 //
@@ -23,6 +23,8 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #include <sys/stat.h>
 #include <fstream>
 #include <algorithm>
+#include <map>
+#include <mutex>
 
 #ifdef WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -190,3 +192,61 @@ bool FileWrite(const string& file, uint8_t* data, uint32_t length)
   OS.close();
   return true;
 }
+
+//
+// CSharedFile
+//
+
+CSharedFile::CSharedFile(int64_t nModifiedTime)
+  : m_ModifiedTime(nModifiedTime)
+{
+}
+
+CSharedFile::~CSharedFile() = default;
+
+shared_ptr<const CSharedFile> CSharedFile::Open(const string& file)
+{
+  static map<string, weak_ptr<const CSharedFile>> SharedFiles;
+  static mutex                                    SharedFilesMutex; // maps are loaded on the map loader thread
+
+  lock_guard<mutex> Lock(SharedFilesMutex);
+
+  struct stat fileinfo;
+
+  if (stat(file.c_str(), &fileinfo) != 0)
+  {
+    Print("[UTIL] warning - unable to read file [" + file + "]");
+    return nullptr;
+  }
+
+  // reuse the existing copy if the file hasn't changed since it was read
+
+  auto i = SharedFiles.find(file);
+
+  if (i != end(SharedFiles))
+  {
+    shared_ptr<const CSharedFile> Existing = i->second.lock();
+
+    if (Existing && Existing->GetSize() == static_cast<size_t>(fileinfo.st_size) && Existing->m_ModifiedTime == static_cast<int64_t>(fileinfo.st_mtime))
+      return Existing;
+  }
+
+  // forget about any files which aren't in use anymore while we're here
+
+  for (auto j = begin(SharedFiles); j != end(SharedFiles);)
+  {
+    if (j->second.expired())
+      j = SharedFiles.erase(j);
+    else
+      ++j;
+  }
+
+  shared_ptr<CSharedFile> SharedFile(new CSharedFile(fileinfo.st_mtime));
+  SharedFile->m_Data = FileRead(file);
+
+  if (SharedFile->m_Data.empty())
+    return nullptr;
+
+  SharedFiles[file] = SharedFile;
+  return SharedFile;
+}
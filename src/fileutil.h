@@ -23,6 +23,7 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 
 #include "includes.h"
 #include <vector>
+#include <memory>
 
 #ifdef WIN32
 bool FileExists(std::string file);
@@ -35,4 +36,31 @@ std::string FileRead(const std::string& file, uint32_t start, uint32_t length);
 std::string FileRead(const std::string& file);
 bool FileWrite(const std::string& file, uint8_t* data, uint32_t length);
 
+//
+// CSharedFile
+//
+
+// the read-only contents of a whole file, read into memory once and shared by everyone using the same file
+// Open hands out the existing object if the same file (with the same size and modification time) is already open, otherwise the file is read again
+// the contents are a private copy rather than a memory mapping so a map file which is overwritten in place doesn't change (or truncate) under the games still serving it
+
+class CSharedFile
+{
+private:
+  std::string m_Data;
+  int64_t     m_ModifiedTime; // the file's modification time when it was read, used to tell if it has changed since
+
+  explicit CSharedFile(int64_t nModifiedTime);
+
+public:
+  ~CSharedFile();
+  CSharedFile(CSharedFile&) = delete;
+
+  static std::shared_ptr<const CSharedFile> Open(const std::string& file);
+
+  inline const uint8_t* GetData() const { return reinterpret_cast<const uint8_t*>(m_Data.data()); }
+  inline size_t         GetSize() const { return m_Data.size(); }
+  inline int64_t        GetModifiedTime() const { return m_ModifiedTime; }
+};
+
 #endif // AURA_FILEUTIL_H_
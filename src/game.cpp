@@ -23,11 +23,13 @@
 #include "util.h"
 #include "config.h"
 #include "socket.h"
+#include "poller.h"
 #include "auradb.h"
 #include "bnet.h"
 #include "map.h"
 #include "gameplayer.h"
 #include "gameprotocol.h"
+#include "resolver.h"
 #include "stats.h"
 #include "irc.h"
 #include "hash.h"
@@ -38,18 +40,45 @@
 
 using namespace std;
 
+// sends each line of a QueryMain result as a separate chat message
+
+static void SendAllChatLines(CGame* game, const string& lines)
+{
+  stringstream SS(lines);
+  string       Line;
+
+  while (getline(SS, Line))
+    game->SendAllChat(Line);
+}
+
+// upper limits (in microseconds) of the action jitter histogram buckets, anything later than the last limit goes in the extra bucket at the end
+
+static const int64_t ActionJitterBuckets[] = {100, 250, 500, 1000, 2000, 5000, 10000};
+
 //
 // CGame
 //
 
 CGame::CGame(CAura* nAura, CMap* nMap, uint16_t nHostPort, uint8_t nGameState, string& nGameName, string& nOwnerName, string& nCreatorName, CBNET* nCreatorServer)
   : m_Aura(nAura),
-    m_Socket(new CTCPServer()),
     m_DBBanLast(nullptr),
     m_Stats(nullptr),
     m_Protocol(new CGameProtocol(nAura)),
     m_Slots(nMap->GetSlots()),
+    m_Actions(new CActionBuffer()),
     m_Map(new CMap(*nMap)),
+    m_Worker(nullptr),
+    m_Poller(nAura->m_Poller),
+    m_Timers(new CTimerWheel(GetTicks())),
+    m_PingTimer([this]() { EventPingTimer(); }),
+    m_BroadcastTimer([this]() { EventBroadcastTimer(); }),
+    m_RefreshTimer([this]() { EventRefreshTimer(); }),
+    m_LobbyTimer([this]() { EventLobbyTimer(); }),
+    m_DownloadTimer([this]() { EventDownloadTimer(); }),
+    m_CountDownTimer([this]() { EventCountDownTimer(); }),
+    m_LagScreenTimer([this]() { EventLagScreenTimer(); }),
+    m_KickVoteTimer([this]() { EventKickVoteTimer(); }),
+    m_GameOverTimer([this]() { EventGameOverTimer(); }),
     m_GameName(nGameName),
     m_LastGameName(nGameName),
     m_VirtualHostName(nAura->m_VirtualHostName),
@@ -60,26 +89,27 @@ CGame::CGame(CAura* nAura, CMap* nMap, uint16_t nHostPort, uint8_t nGameState, s
     m_MapPath(nMap->GetMapPath()),
     m_GameTicks(0),
     m_CreationTime(GetTime()),
-    m_LastPingTime(GetTime()),
-    m_LastRefreshTime(GetTime()),
-    m_LastDownloadTicks(GetTime()),
-    m_LastDownloadCounterResetTicks(GetTicks()),
-    m_LastCountDownTicks(0),
     m_StartedLoadingTicks(0),
-    m_LastActionSentTicks(0),
-    m_LastActionLateBy(0),
+    m_NextActionMicroTicks(0),
+    m_ActionJitter(),
+    m_ActionJitterTotal(0),
+    m_ActionJitterMax(0),
+    m_NumUpdates(0),
+    m_PacketsQueued(0),
+    m_SendCalls(0),
     m_StartedLaggingTime(0),
     m_LastLagScreenTime(0),
     m_LastReservedSeen(GetTime()),
-    m_StartedKickVoteTime(0),
     m_GameOverTime(0),
     m_LastPlayerLeaveTicks(0),
-    m_LastLagScreenResetTime(0),
     m_RandomSeed(GetTicks()),
     m_HostCounter(nAura->m_HostCounter++),
     m_EntryKey(rand()),
     m_Latency(nAura->m_Latency),
     m_SyncLimit(nAura->m_SyncLimit),
+    m_AutoKickPing(nAura->m_AutoKickPing),
+    m_VoteKickPercentage(nAura->m_VoteKickPercentage),
+    m_CommandTrigger(nAura->m_CommandTrigger),
     m_SyncCounter(0),
     m_DownloadCounter(0),
     m_CountDownCounter(0),
@@ -98,7 +128,8 @@ CGame::CGame(CAura* nAura, CMap* nMap, uint16_t nHostPort, uint8_t nGameState, s
     m_GameLoading(false),
     m_GameLoaded(false),
     m_Lagging(false),
-    m_Desynced(false)
+    m_Desynced(false),
+    m_LCPings(nAura->m_LCPings)
 {
 
   // wait time of 1 minute  = 0 empty actions required
@@ -111,29 +142,23 @@ CGame::CGame(CAura* nAura, CMap* nMap, uint16_t nHostPort, uint8_t nGameState, s
   if (m_GProxyEmptyActions > 9)
     m_GProxyEmptyActions = 9;
 
-  // start listening for connections
+  // start the periodic work, the rest of the timers are started when they're needed
 
-  if (!m_Aura->m_BindAddress.empty())
-    Print("[GAME: " + m_GameName + "] attempting to bind to address [" + m_Aura->m_BindAddress + "]");
+  m_Timers->Schedule(&m_PingTimer, 5000);
+  m_Timers->Schedule(&m_RefreshTimer, 3000);
+  m_Timers->Schedule(&m_LobbyTimer, 1000);
 
-  if (m_Socket->Listen(m_Aura->m_BindAddress, m_HostPort))
-    Print("[GAME: " + m_GameName + "] listening on port " + to_string(m_HostPort));
-  else
-  {
-    Print2("[GAME: " + m_GameName + "] error listening on port " + to_string(m_HostPort));
-    m_Exiting = true;
-  }
+  // broadcast the new lobby to the local network right away, LAN players searching for games get an answer from CAura::Update anyway
+
+  if (m_Aura->m_LANBroadcastInterval > 0)
+    m_Timers->Schedule(&m_BroadcastTimer, 0);
 }
 
 CGame::~CGame()
 {
-  delete m_Socket;
   delete m_Protocol;
   delete m_Map;
 
-  for (auto& potential : m_Potentials)
-    delete potential;
-
   for (auto& player : m_Players)
     delete player;
 
@@ -146,13 +171,13 @@ CGame::~CGame()
   // store the dota stats in the database
 
   if (m_Stats)
-    m_Stats->Save(m_Aura, m_Aura->m_DB);
+    m_Stats->Save(m_Aura->m_DB);
 
-  while (!m_Actions.empty())
-  {
-    delete m_Actions.front();
-    m_Actions.pop();
-  }
+  // everything above was only queued, the writer thread writes it in a single transaction
+
+  m_Aura->m_DB->SubmitBatch();
+
+  delete m_Actions;
 
   for (auto& player : m_DBGamePlayers)
     delete player;
@@ -161,24 +186,28 @@ CGame::~CGame()
     delete ban;
 
   delete m_Stats;
+  delete m_Timers;
 }
 
-int64_t CGame::GetNextTimedActionTicks() const
+int64_t CGame::GetNextTimedActionMicroTicks() const
 {
-  // return the number of ticks (ms) until the next "timed action", which for our purposes is the next game update
+  // return the number of ticks (ms) until the next "timed action", which for our purposes is the next action packet or the next timer
   // the main Aura++ loop will make sure the next loop update happens at or before this value
-  // note: there's no reason this function couldn't take into account the game's other timers too but they're far less critical
   // warning: this function must take into account when actions are not being sent (e.g. during loading or lagging)
 
-  if (!m_GameLoaded || m_Lagging)
-    return 50;
+  // the timers only have millisecond resolution but the action packets are scheduled in microseconds so they go out on time
 
-  const int64_t TicksSinceLastUpdate = GetTicks() - m_LastActionSentTicks;
+  const int64_t Ticks      = GetTicks();
+  const int64_t NextTimer  = m_Timers->GetNextExpiry();
+  int64_t       NextAction = 50000;
 
-  if (TicksSinceLastUpdate > m_Latency - m_LastActionLateBy)
-    return 0;
-  else
-    return m_Latency - m_LastActionLateBy - TicksSinceLastUpdate;
+  if (NextTimer != -1 && (NextTimer - Ticks) * 1000 < NextAction)
+    NextAction = max<int64_t>((NextTimer - Ticks) * 1000, 0);
+
+  if (!m_GameLoaded || m_Lagging)
+    return NextAction;
+
+  return max<int64_t>(min<int64_t>(m_NextActionMicroTicks - GetMicroTicks(), NextAction), 0);
 }
 
 uint32_t CGame::GetSlotsOccupied() const
@@ -277,85 +306,86 @@ string CGame::GetObservers() const
   return Observers;
 }
 
-uint32_t CGame::SetFD(void* fd, void* send_fd, int32_t* nfds)
+string CGame::GetActionJitter() const
 {
-  uint32_t NumFDs = 0;
+  uint32_t NumActions = 0;
 
-  if (m_Socket)
-  {
-    m_Socket->SetFD(static_cast<fd_set*>(fd), static_cast<fd_set*>(send_fd), nfds);
-    ++NumFDs;
-  }
+  for (const auto& count : m_ActionJitter)
+    NumActions += count;
 
-  for (auto& player : m_Players)
-  {
-    player->GetSocket()->SetFD(static_cast<fd_set*>(fd), static_cast<fd_set*>(send_fd), nfds);
-    ++NumFDs;
-  }
+  if (NumActions == 0)
+    return "no action packets have been sent in game [" + m_GameName + "] yet";
 
-  for (auto& potential : m_Potentials)
+  string Jitter = "action packets in game [" + m_GameName + "] were late by";
+
+  for (size_t i = 0; i < m_ActionJitter.size(); ++i)
   {
-    if (potential->GetSocket())
-    {
-      potential->GetSocket()->SetFD(static_cast<fd_set*>(fd), static_cast<fd_set*>(send_fd), nfds);
-      ++NumFDs;
-    }
+    if (i < m_ActionJitter.size() - 1)
+      Jitter += " <" + to_string(ActionJitterBuckets[i]) + "us: ";
+    else
+      Jitter += " >=" + to_string(ActionJitterBuckets[i - 1]) + "us: ";
+
+    Jitter += to_string(m_ActionJitter[i]);
   }
 
-  return NumFDs;
+  return Jitter + " (" + to_string(NumActions) + " packets, average " + to_string(m_ActionJitterTotal / NumActions) + "us, max " + to_string(m_ActionJitterMax) + "us)";
 }
 
-bool CGame::Update(void* fd, void* send_fd)
+string CGame::GetSendStats() const
 {
-  const int64_t Time = GetTime(), Ticks = GetTicks();
+  if (m_NumUpdates == 0)
+    return "game [" + m_GameName + "] hasn't been updated yet";
 
-  // ping every 5 seconds
-  // changed this to ping during game loading as well to hopefully fix some problems with people disconnecting during loading
-  // changed this to ping during the game as well
+  const double PerUpdate = static_cast<double>(m_NumUpdates);
 
-  if (Time - m_LastPingTime >= 5)
-  {
-    // note: we must send pings to players who are downloading the map because Warcraft III disconnects from the lobby if it doesn't receive a ping every ~90 seconds
-    // so if the player takes longer than 90 seconds to download the map they would be disconnected unless we keep sending pings
+  return "game [" + m_GameName + "] queued " + to_string(m_PacketsQueued) + " packets for its players and sent them with " + to_string(m_SendCalls) + " send calls over " + to_string(m_NumUpdates) + " updates (" + ToFormattedString(m_PacketsQueued / PerUpdate) + " packets and " + ToFormattedString(m_SendCalls / PerUpdate) + " send calls per update)";
+}
+
+const vector<uint8_t>& CGame::GetLANGameInfo()
+{
+  // the game info only changes when the game is rehosted (the slots aren't part of it, see below) so it's built once and reused for every broadcast and search reply
+
+  if (!m_LANGameInfo.empty())
+    return m_LANGameInfo;
+
+  // construct a fixed host counter which will be used to identify players from this "realm" (i.e. LAN)
+  // the fixed host counter's 4 most significant bits will contain a 4 bit ID (0-15)
+  // the rest of the fixed host counter will contain the 28 least significant bits of the actual host counter
+  // since we're destroying 4 bits of information here the actual host counter should not be greater than 2^28 which is a reasonable assumption
+  // when a player joins a game we can obtain the ID from the received host counter
+  // note: LAN broadcasts use an ID of 0, battle.net refreshes use an ID of 1-10, the rest are unused
+
+  // we send 12 for SlotsTotal because this determines how many PID's Warcraft 3 allocates
+  // we need to make sure Warcraft 3 allocates at least SlotsTotal + 1 but at most 12 PID's
+  // this is because we need an extra PID for the virtual host player (but we always delete the virtual host player when the 12th person joins)
+  // however, we can't send 13 for SlotsTotal because this causes Warcraft 3 to crash when sharing control of units
+  // nor can we send SlotsTotal because then Warcraft 3 crashes when playing maps with less than 12 PID's (because of the virtual host player taking an extra PID)
+  // we also send 12 for SlotsOpen because Warcraft 3 assumes there's always at least one player in the game (the host)
+  // so if we try to send accurate numbers it'll always be off by one and results in Warcraft 3 assuming the game is full when it still needs one more player
+  // the easiest solution is to simply send 12 for both so the game will always show up as (1/12) players
+
+  // note: the PrivateGame flag is not set when broadcasting to LAN (as you might expect)
+  // note: we do not use m_Map->GetMapGameType because none of the filters are set when broadcasting to LAN (also as you might expect)
+
+  m_LANGameInfo = m_Protocol->SEND_W3GS_GAMEINFO(m_Aura->m_LANWar3Version, CreateByteArray(static_cast<uint32_t>(MAPGAMETYPE_UNKNOWN0), false), m_Map->GetMapGameFlags(), m_Map->GetMapWidth(), m_Map->GetMapHeight(), m_GameName, "Clan 007", 0, m_Map->GetMapPath(), m_Map->GetMapCRC(), MAX_SLOTS, MAX_SLOTS, m_HostPort, m_HostCounter & 0x0FFFFFFF, m_EntryKey);
+  return m_LANGameInfo;
+}
 
-    SendAll(m_Protocol->SEND_W3GS_PING_FROM_HOST());
+bool CGame::Update()
+{
+  const int64_t Time = GetTime(), Ticks = GetTicks();
 
-    // we also broadcast the game to the local network every 5 seconds so we hijack this timer for our nefarious purposes
-    // however we only want to broadcast if the countdown hasn't started
-    // see the !sendlan code later in this file for some more information about how this works
+  ++m_NumUpdates;
 
-    if (!m_CountDownStarted)
-    {
-      // construct a fixed host counter which will be used to identify players from this "realm" (i.e. LAN)
-      // the fixed host counter's 4 most significant bits will contain a 4 bit ID (0-15)
-      // the rest of the fixed host counter will contain the 28 least significant bits of the actual host counter
-      // since we're destroying 4 bits of information here the actual host counter should not be greater than 2^28 which is a reasonable assumption
-      // when a player joins a game we can obtain the ID from the received host counter
-      // note: LAN broadcasts use an ID of 0, battle.net refreshes use an ID of 1-10, the rest are unused
-
-      // we send 12 for SlotsTotal because this determines how many PID's Warcraft 3 allocates
-      // we need to make sure Warcraft 3 allocates at least SlotsTotal + 1 but at most 12 PID's
-      // this is because we need an extra PID for the virtual host player (but we always delete the virtual host player when the 12th person joins)
-      // however, we can't send 13 for SlotsTotal because this causes Warcraft 3 to crash when sharing control of units
-      // nor can we send SlotsTotal because then Warcraft 3 crashes when playing maps with less than 12 PID's (because of the virtual host player taking an extra PID)
-      // we also send 12 for SlotsOpen because Warcraft 3 assumes there's always at least one player in the game (the host)
-      // so if we try to send accurate numbers it'll always be off by one and results in Warcraft 3 assuming the game is full when it still needs one more player
-      // the easiest solution is to simply send 12 for both so the game will always show up as (1/12) players
-
-      // note: the PrivateGame flag is not set when broadcasting to LAN (as you might expect)
-      // note: we do not use m_Map->GetMapGameType because none of the filters are set when broadcasting to LAN (also as you might expect)
-
-      m_Aura->m_UDPSocket->Broadcast(6112, m_Protocol->SEND_W3GS_GAMEINFO(m_Aura->m_LANWar3Version, CreateByteArray(static_cast<uint32_t>(MAPGAMETYPE_UNKNOWN0), false), m_Map->GetMapGameFlags(), m_Map->GetMapWidth(), m_Map->GetMapHeight(), m_GameName, "Clan 007", 0, m_Map->GetMapPath(), m_Map->GetMapCRC(), MAX_SLOTS, MAX_SLOTS, m_HostPort, m_HostCounter & 0x0FFFFFFF, m_EntryKey));
-    }
+  // fire the timers which are due, they take care of all the periodic work (pings, refreshes, map downloads, the countdown, ...)
 
-    m_LastPingTime = Time;
-  }
+  m_Timers->Advance(Ticks);
 
   // update players
 
   for (auto i = begin(m_Players); i != end(m_Players);)
   {
-    if ((*i)->Update(fd))
+    if ((*i)->Update())
     {
       EventPlayerDeleted(*i);
       delete *i;
@@ -365,22 +395,6 @@ bool CGame::Update(void* fd, void* send_fd)
       ++i;
   }
 
-  for (auto i = begin(m_Potentials); i != end(m_Potentials);)
-  {
-    if ((*i)->Update(fd))
-    {
-      // flush the socket (e.g. in case a rejection message is queued)
-
-      if ((*i)->GetSocket())
-        (*i)->GetSocket()->DoSend(static_cast<fd_set*>(send_fd));
-
-      delete *i;
-      i = m_Potentials.erase(i);
-    }
-    else
-      ++i;
-  }
-
   // keep track of the largest sync counter (the number of keepalive packets received by each player)
   // if anyone falls behind by more than m_SyncLimit keepalives we start the lag screen
 
@@ -415,13 +429,14 @@ bool CGame::Update(void* fd, void* send_fd)
 
         Print("[GAME: " + m_GameName + "] started lagging on [" + LaggingString + "]");
         SendAll(m_Protocol->SEND_W3GS_START_LAG(m_Players));
+        Flush();
 
         // reset everyone's drop vote
 
         for (auto& player : m_Players)
           player->SetDropVote(false);
 
-        m_LastLagScreenResetTime = Time;
+        m_Timers->Schedule(&m_LagScreenTimer, 60000);
       }
     }
 
@@ -446,46 +461,7 @@ bool CGame::Update(void* fd, void* send_fd)
       if (Time - m_StartedLaggingTime >= WaitTime)
         StopLaggers("was automatically dropped after " + to_string(WaitTime) + " seconds");
 
-      // we cannot allow the lag screen to stay up for more than ~65 seconds because Warcraft III disconnects if it doesn't receive an action packet at least this often
-      // one (easy) solution is to simply drop all the laggers if they lag for more than 60 seconds
-      // another solution is to reset the lag screen the same way we reset it when using load-in-game
-
-      if (Time - m_LastLagScreenResetTime >= 60)
-      {
-        for (auto& _i : m_Players)
-        {
-          // stop the lag screen
-
-          for (auto& player : m_Players)
-          {
-            if (player->GetLagging())
-              Send(_i, m_Protocol->SEND_W3GS_STOP_LAG(player));
-          }
-
-          // send an empty update
-          // this resets the lag screen timer
-
-          if (UsingGProxy && !(_i)->GetGProxy())
-          {
-            // we must send additional empty actions to non-GProxy++ players
-            // GProxy++ will insert these itself so we don't need to send them to GProxy++ players
-            // empty actions are used to extend the time a player can use when reconnecting
-
-            for (uint8_t j = 0; j < m_GProxyEmptyActions; ++j)
-              Send(_i, m_Protocol->SEND_W3GS_INCOMING_ACTION(queue<CIncomingAction*>(), 0));
-          }
-
-          Send(_i, m_Protocol->SEND_W3GS_INCOMING_ACTION(queue<CIncomingAction*>(), 0));
-
-          // start the lag screen
-
-          Send(_i, m_Protocol->SEND_W3GS_START_LAG(m_Players));
-        }
-
-        // Warcraft III doesn't seem to respond to empty actions
-
-        m_LastLagScreenResetTime = Time;
-      }
+      // the lag screen is reset by m_LagScreenTimer because Warcraft III disconnects if it doesn't receive an action packet at least every ~65 seconds
 
       // check if anyone has stopped lagging normally
       // we consider a player to have stopped lagging if they're less than half m_SyncLimit keepalives behind
@@ -503,6 +479,8 @@ bool CGame::Update(void* fd, void* send_fd)
         }
       }
 
+      Flush();
+
       // check if everyone has stopped lagging
 
       bool Lagging = false;
@@ -518,9 +496,12 @@ bool CGame::Update(void* fd, void* send_fd)
 
       m_Lagging = Lagging;
 
-      // reset m_LastActionSentTicks because we want the game to stop running while the lag screen is up
+      if (!m_Lagging)
+        m_LagScreenTimer.Cancel();
 
-      m_LastActionSentTicks = Ticks;
+      // push the next action packet back because we want the game to stop running while the lag screen is up
+
+      m_NextActionMicroTicks = GetMicroTicks() + m_Latency * 1000;
 
       // keep track of the last lag screen time so we can avoid timing out players
 
@@ -532,7 +513,7 @@ bool CGame::Update(void* fd, void* send_fd)
   // actions are at the heart of every Warcraft 3 game but luckily we don't need to know their contents to relay them
   // we queue player actions in EventPlayerAction then just resend them in batches to all players here
 
-  if (m_GameLoaded && !m_Lagging && Ticks - m_LastActionSentTicks >= m_Latency - m_LastActionLateBy)
+  if (m_GameLoaded && !m_Lagging && GetMicroTicks() >= m_NextActionMicroTicks)
     SendAllActions();
 
   // end the game if there aren't any players left
@@ -561,9 +542,9 @@ bool CGame::Update(void* fd, void* send_fd)
 
     if (FinishedLoading)
     {
-      m_LastActionSentTicks = Ticks;
-      m_GameLoading         = false;
-      m_GameLoaded          = true;
+      m_NextActionMicroTicks = GetMicroTicks() + m_Latency * 1000;
+      m_GameLoading          = false;
+      m_GameLoaded           = true;
       EventGameLoaded();
     }
   }
@@ -574,164 +555,12 @@ bool CGame::Update(void* fd, void* send_fd)
   {
     Print("[GAME: " + m_GameName + "] gameover timer started (" + std::to_string(m_Players.size()) + " player(s) left)");
     m_GameOverTime = Time;
-  }
-
-  // finish the gameover timer
-
-  if (m_GameOverTime != 0 && Time - m_GameOverTime >= 60)
-  {
-    for (auto& player : m_Players)
-    {
-      if (!player->GetDeleteMe())
-      {
-        Print("[GAME: " + m_GameName + "] is over (gameover timer finished)");
-        StopPlayers("was disconnected (gameover timer finished)");
-        break;
-      }
-    }
-  }
-
-  // expire the votekick
-
-  if (!m_KickVotePlayer.empty() && Time - m_StartedKickVoteTime >= 60)
-  {
-    Print("[GAME: " + m_GameName + "] votekick against player [" + m_KickVotePlayer + "] expired");
-    SendAllChat("A votekick against player [" + m_KickVotePlayer + "] has expired");
-    m_KickVotePlayer.clear();
-    m_StartedKickVoteTime = 0;
+    m_Timers->Schedule(&m_GameOverTimer, 60000);
   }
 
   if (m_GameLoaded)
     return m_Exiting;
 
-  // refresh every 3 seconds
-
-  if (!m_RefreshError && !m_CountDownStarted && m_GameState == GAME_PUBLIC && GetSlotsOpen() > 0 && Time - m_LastRefreshTime >= 3)
-  {
-    // send a game refresh packet to each battle.net connection
-
-    for (auto& bnet : m_Aura->m_BNETs)
-    {
-      // don't queue a game refresh message if the queue contains more than 1 packet because they're very low priority
-
-      if (bnet->GetOutPacketsQueued() <= 1)
-        bnet->QueueGameRefresh(m_GameState, m_GameName, m_Map, m_HostCounter);
-    }
-
-    m_LastRefreshTime = Time;
-  }
-
-  // send more map data
-
-  if (!m_GameLoading && !m_GameLoaded && Ticks - m_LastDownloadCounterResetTicks >= 1000)
-  {
-    // hackhack: another timer hijack is in progress here
-    // since the download counter is reset once per second it's a great place to update the slot info if necessary
-
-    if (m_SlotInfoChanged)
-      SendAllSlotInfo();
-
-    m_DownloadCounter               = 0;
-    m_LastDownloadCounterResetTicks = Ticks;
-  }
-
-  if (!m_GameLoading && Ticks - m_LastDownloadTicks >= 100)
-  {
-    uint32_t Downloaders = 0;
-
-    for (auto& player : m_Players)
-    {
-      if (player->GetDownloadStarted() && !player->GetDownloadFinished())
-      {
-        ++Downloaders;
-
-        if (m_Aura->m_MaxDownloaders > 0 && Downloaders > m_Aura->m_MaxDownloaders)
-          break;
-
-        // send up to 100 pieces of the map at once so that the download goes faster
-        // if we wait for each MAPPART packet to be acknowledged by the client it'll take a long time to download
-        // this is because we would have to wait the round trip time (the ping time) between sending every 1442 bytes of map data
-        // doing it this way allows us to send at least 140 KB in each round trip int32_terval which is much more reasonable
-        // the theoretical throughput is [140 KB * 1000 / ping] in KB/sec so someone with 100 ping (round trip ping, not LC ping) could download at 1400 KB/sec
-        // note: this creates a queue of map data which clogs up the connection when the client is on a slower connection (e.g. dialup)
-        // in this case any changes to the lobby are delayed by the amount of time it takes to send the queued data (i.e. 140 KB, which could be 30 seconds or more)
-        // for example, players joining and leaving, slot changes, chat messages would all appear to happen much later for the low bandwidth player
-        // note: the throughput is also limited by the number of times this code is executed each second
-        // e.g. if we send the maximum amount (140 KB) 10 times per second the theoretical throughput is 1400 KB/sec
-        // therefore the maximum throughput is 1400 KB/sec regardless of ping and this value slowly diminishes as the player's ping increases
-        // in addition to this, the throughput is limited by the configuration value bot_maxdownloadspeed
-        // in summary: the actual throughput is MIN( 140 * 1000 / ping, 1400, bot_maxdownloadspeed ) in KB/sec assuming only one player is downloading the map
-
-        const uint32_t MapSize = ByteArrayToUInt32(m_Map->GetMapSize(), false);
-
-        while (player->GetLastMapPartSent() < player->GetLastMapPartAcked() + 1442 * 100 && player->GetLastMapPartSent() < MapSize)
-        {
-          if (player->GetLastMapPartSent() == 0)
-          {
-            // overwrite the "started download ticks" since this is the first time we've sent any map data to the player
-            // prior to this we've only determined if the player needs to download the map but it's possible we could have delayed sending any data due to download limits
-
-            player->SetStartedDownloadingTicks(Ticks);
-          }
-
-          // limit the download speed if we're sending too much data
-          // the download counter is the # of map bytes downloaded in the last second (it's reset once per second)
-
-          if (m_Aura->m_MaxDownloadSpeed > 0 && m_DownloadCounter > m_Aura->m_MaxDownloadSpeed * 1024)
-            break;
-
-          Send(player, m_Protocol->SEND_W3GS_MAPPART(GetHostPID(), player->GetPID(), player->GetLastMapPartSent(), m_Map->GetMapData()));
-          player->SetLastMapPartSent(player->GetLastMapPartSent() + 1442);
-          m_DownloadCounter += 1442;
-        }
-      }
-    }
-
-    m_LastDownloadTicks = Ticks;
-  }
-
-  // countdown every 500 ms
-
-  if (m_CountDownStarted && Ticks - m_LastCountDownTicks >= 500)
-  {
-    if (m_CountDownCounter > 0)
-    {
-      // we use a countdown counter rather than a "finish countdown time" here because it might alternately round up or down the count
-      // this sometimes resulted in a countdown of e.g. "6 5 3 2 1" during my testing which looks pretty dumb
-      // doing it this way ensures it's always "5 4 3 2 1" but each int32_terval might not be *exactly* the same length
-
-      SendAllChat(to_string(m_CountDownCounter--) + ". . .");
-    }
-    else if (!m_GameLoading && !m_GameLoaded)
-      EventGameStarted();
-
-    m_LastCountDownTicks = Ticks;
-  }
-
-  // check if the lobby is "abandoned" and needs to be closed since it will never start
-
-  if (!m_GameLoading && !m_GameLoaded && m_Aura->m_LobbyTimeLimit > 0)
-  {
-    // check if there's a player with reserved status in the game
-
-    for (auto& player : m_Players)
-    {
-      if (player->GetReserved())
-      {
-        m_LastReservedSeen = Time;
-        break;
-      }
-    }
-
-    // check if we've hit the time limit
-
-    if (Time - m_LastReservedSeen > static_cast<int64_t>(m_Aura->m_LobbyTimeLimit * 60))
-    {
-      Print("[GAME: " + m_GameName + "] is over (lobby time limit hit)");
-      return true;
-    }
-  }
-
   // create the virtual host player
 
   if (!m_GameLoading && !m_GameLoaded && GetNumPlayers() < MAX_SLOTS)
@@ -745,42 +574,48 @@ bool CGame::Update(void* fd, void* send_fd)
     m_Locked = false;
   }
 
-  // accept new connections
-
-  if (m_Socket)
-  {
-    CTCPSocket* NewSocket = m_Socket->Accept(static_cast<fd_set*>(fd));
-
-    if (NewSocket)
-      m_Potentials.push_back(new CPotentialPlayer(m_Protocol, this, NewSocket));
-
-    if (m_Socket->HasError())
-      return true;
-  }
-
   return m_Exiting;
 }
 
-void CGame::UpdatePost(void* send_fd)
+void CGame::UpdatePost()
 {
   // we need to manually call DoSend on each player now because CGamePlayer :: Update doesn't do it
   // this is in case player 2 generates a packet for player 1 during the update but it doesn't get sent because player 1 already finished updating
-  // in reality since we're queueing actions it might not make a big difference but oh well
+  // everything else queued during the update (map parts, slot info, chat, pings, ...) goes out here in as few send calls as possible
+
+  Flush();
+}
+
+void CGame::Flush()
+{
+  // the latency critical packets (actions and the lag screen) are flushed as soon as they're queued instead of waiting for UpdatePost
+  // the sockets have Nagle's algorithm disabled so they go out right away
+  // the poller decides how: the io_uring poller sends to every player with a single system call, the others call DoSend on each socket
+
+  m_FlushSockets.clear();
 
   for (auto& player : m_Players)
-    player->GetSocket()->DoSend(static_cast<fd_set*>(send_fd));
+  {
+    if (player->GetSocket())
+      m_FlushSockets.push_back(player->GetSocket());
+  }
 
-  for (auto& potential : m_Potentials)
+  if (m_Poller)
+    m_SendCalls += m_Poller->Flush(m_FlushSockets);
+  else
   {
-    if (potential->GetSocket())
-      potential->GetSocket()->DoSend(static_cast<fd_set*>(send_fd));
+    for (auto& socket : m_FlushSockets)
+      m_SendCalls += socket->DoSend();
   }
 }
 
 void CGame::Send(CGamePlayer* player, const std::vector<uint8_t>& data)
 {
   if (player)
+  {
     player->Send(data);
+    ++m_PacketsQueued;
+  }
 }
 
 void CGame::Send(uint8_t PID, const std::vector<uint8_t>& data)
@@ -796,8 +631,19 @@ void CGame::Send(const std::vector<uint8_t>& PIDs, const std::vector<uint8_t>& d
 
 void CGame::SendAll(const std::vector<uint8_t>& data)
 {
+  SendAll(std::vector<uint8_t>(data));
+}
+
+void CGame::SendAll(std::vector<uint8_t>&& data)
+{
+  // build the packet once and share it between every player's send queue (and GProxy++ buffer) instead of copying it for each of them
+
+  const CSharedPacket Packet = make_shared<const std::vector<uint8_t>>(std::move(data));
+
   for (auto& player : m_Players)
-    player->Send(data);
+    player->Send(Packet);
+
+  m_PacketsQueued += m_Players.size();
 }
 
 void CGame::SendChat(uint8_t fromPID, CGamePlayer* player, const string& message)
@@ -933,7 +779,7 @@ void CGame::SendAllActions()
       if (!player->GetGProxy())
       {
         for (uint8_t j = 0; j < m_GProxyEmptyActions; ++j)
-          Send(player, m_Protocol->SEND_W3GS_INCOMING_ACTION(queue<CIncomingAction*>(), 0));
+          Send(player, m_Protocol->SEND_W3GS_INCOMING_ACTION(CByteView(), 0));
       }
     }
   }
@@ -941,63 +787,43 @@ void CGame::SendAllActions()
   ++m_SyncCounter;
 
   // we aren't allowed to send more than 1460 bytes in a single packet but it's possible we might have more than that many bytes waiting in the queue
+  // so we keep adding actions to the current packet until we reach the size limit (1452 because the INCOMING_ACTION and INCOMING_ACTION2 packets use an extra 8 bytes)
+  // the W3GS_INCOMING_ACTION2 packet handles the overflow but it must be sent *before* the corresponding W3GS_INCOMING_ACTION packet
 
-  if (!m_Actions.empty())
-  {
-    // we use a "sub actions queue" which we keep adding actions to until we reach the size limit
-    // start by adding one action to the sub actions queue
+  uint32_t Start = 0;
 
-    queue<CIncomingAction*> SubActions;
-    CIncomingAction*        Action = m_Actions.front();
-    m_Actions.pop();
-    SubActions.push(Action);
-    uint32_t SubActionsLength = Action->GetLength();
-
-    while (!m_Actions.empty())
+  for (uint32_t i = 1; i < m_Actions->GetNumActions(); ++i)
+  {
+    if (m_Actions->GetOffset(i + 1) - Start > 1452)
     {
-      Action = m_Actions.front();
-      m_Actions.pop();
-
-      // check if adding the next action to the sub actions queue would put us over the limit (1452 because the INCOMING_ACTION and INCOMING_ACTION2 packets use an extra 8 bytes)
-
-      if (SubActionsLength + Action->GetLength() > 1452)
-      {
-        // we'd be over the limit if we added the next action to the sub actions queue
-        // so send everything already in the queue and then clear it out
-        // the W3GS_INCOMING_ACTION2 packet handles the overflow but it must be sent *before* the corresponding W3GS_INCOMING_ACTION packet
-
-        SendAll(m_Protocol->SEND_W3GS_INCOMING_ACTION2(SubActions));
+      const uint32_t End = m_Actions->GetOffset(i);
+      m_Protocol->SEND_W3GS_INCOMING_ACTION2(m_ActionPacket, m_Actions->GetActions(Start, End));
+      SendAll(m_ActionPacket);
+      Start = End;
+    }
+  }
 
-        while (!SubActions.empty())
-        {
-          delete SubActions.front();
-          SubActions.pop();
-        }
+  m_Protocol->SEND_W3GS_INCOMING_ACTION(m_ActionPacket, m_Actions->GetActions(Start, m_Actions->GetSize()), m_Latency);
+  SendAll(m_ActionPacket);
+  m_Actions->Clear();
+  Flush();
 
-        SubActionsLength = 0;
-      }
+  // the packets are due every m_Latency milliseconds measured from when the game loaded rather than from when the last one was actually sent
+  // this way being late for one packet makes the next one due sooner instead of delaying every packet after it
 
-      SubActions.push(Action);
-      SubActionsLength += Action->GetLength();
-    }
+  const int64_t MicroTicks = GetMicroTicks();
+  const int64_t LateBy     = MicroTicks - m_NextActionMicroTicks;
+  size_t        Bucket     = 0;
 
-    SendAll(m_Protocol->SEND_W3GS_INCOMING_ACTION(SubActions, m_Latency));
+  while (Bucket < m_ActionJitter.size() - 1 && LateBy >= ActionJitterBuckets[Bucket])
+    ++Bucket;
 
-    while (!SubActions.empty())
-    {
-      delete SubActions.front();
-      SubActions.pop();
-    }
-  }
-  else
-    SendAll(m_Protocol->SEND_W3GS_INCOMING_ACTION(m_Actions, m_Latency));
+  ++m_ActionJitter[Bucket];
+  m_ActionJitterTotal += LateBy;
+  m_ActionJitterMax = max(m_ActionJitterMax, LateBy);
+  m_NextActionMicroTicks += m_Latency * 1000;
 
-  const int64_t Ticks                = GetTicks();
-  const int64_t ActualSendInterval   = Ticks - m_LastActionSentTicks;
-  const int64_t ExpectedSendInterval = m_Latency - m_LastActionLateBy;
-  m_LastActionLateBy                 = ActualSendInterval - ExpectedSendInterval;
-
-  if (m_LastActionLateBy > m_Latency)
+  if (LateBy > m_Latency * 1000)
   {
     // something is going terribly wrong - Aura++ is probably starved of resources
     // print a message because even though this will take more resources it should provide some information to the administrator for future reference
@@ -1005,11 +831,11 @@ void CGame::SendAllActions()
 
     // this program is SO FAST, I've yet to see this happen *coolface*
 
-    Print("[GAME: " + m_GameName + "] warning - the latency is " + to_string(m_Latency) + "ms but the last update was late by " + to_string(m_LastActionLateBy) + "ms");
-    m_LastActionLateBy = m_Latency;
-  }
+    // don't try to catch up by sending a burst of packets, start counting again from now
 
-  m_LastActionSentTicks = Ticks;
+    Print("[GAME: " + m_GameName + "] warning - the latency is " + to_string(m_Latency) + "ms but the last update was late by " + to_string(LateBy / 1000) + "ms");
+    m_NextActionMicroTicks = MicroTicks + m_Latency * 1000;
+  }
 }
 
 void CGame::EventPlayerDeleted(CGamePlayer* player)
@@ -1047,7 +873,7 @@ void CGame::EventPlayerDeleted(CGamePlayer* player)
     SendAllChat("A votekick against player [" + m_KickVotePlayer + "] has been cancelled");
 
   m_KickVotePlayer.clear();
-  m_StartedKickVoteTime = 0;
+  m_KickVoteTimer.Cancel();
 
   // record everything we need to know about the player for storing in the database later
   // since we haven't stored the game yet (it's not over yet!) we can't link the gameplayer to the game
@@ -1336,7 +1162,7 @@ void CGame::EventPlayerJoined(CPotentialPlayer* potential, CIncomingJoinPlayer*
 
   // turning the CPotentialPlayer into a CGamePlayer is a bit of a pain because we have to be careful not to close the socket
   // this problem is solved by setting the socket to nullptr before deletion and handling the nullptr case in the destructor
-  // we also have to be careful to not modify the m_Potentials vector since we're currently looping through it
+  // we also have to be careful to not modify CAura's m_Potentials vector since it's currently looping through it
 
   Print("[GAME: " + m_GameName + "] player [" + joinPlayer->GetName() + "|" + potential->GetExternalIPString() + "] joined the game");
   CGamePlayer* Player = new CGamePlayer(potential, GetNewPID(), JoinedRealm, joinPlayer->GetName(), joinPlayer->GetInternalIP(), Reserved);
@@ -1473,13 +1299,13 @@ void CGame::EventPlayerLoaded(CGamePlayer* player)
   SendAll(m_Protocol->SEND_W3GS_GAMELOADED_OTHERS(player->GetPID()));
 }
 
-void CGame::EventPlayerAction(CGamePlayer* player, CIncomingAction* action)
+void CGame::EventPlayerAction(CGamePlayer* player, const CIncomingAction& action)
 {
-  m_Actions.push(action);
+  m_Actions->Push(action.GetPID(), action.GetAction());
 
   // check for players saving the game and notify everyone
 
-  if (!action->GetAction()->empty() && (*action->GetAction())[0] == 6)
+  if (!action.GetAction().empty() && action.GetAction()[0] == 6)
   {
     Print("[GAME: " + m_GameName + "] player [" + player->GetName() + "] is saving the game");
     SendAllChat("Player [" + player->GetName() + "] is saving the game");
@@ -1487,10 +1313,11 @@ void CGame::EventPlayerAction(CGamePlayer* player, CIncomingAction* action)
 
   // give the stats class a chance to process the action
 
-  if (m_Stats && action->GetAction()->size() >= 6 && m_Stats->ProcessAction(action) && m_GameOverTime == 0)
+  if (m_Stats && action.GetAction().size() >= 6 && m_Stats->ProcessAction(action) && m_GameOverTime == 0)
   {
     Print("[GAME: " + m_GameName + "] gameover timer started (stats class reported game over)");
     m_GameOverTime = GetTime();
+    m_Timers->Schedule(&m_GameOverTimer, 60000);
   }
 }
 
@@ -1570,7 +1397,7 @@ void CGame::EventPlayerChatToHost(CGamePlayer* player, CIncomingChatPlayer* chat
 
       const string Message = chatPlayer->GetMessage();
 
-      if (!Message.empty() && (Message[0] == m_Aura->m_CommandTrigger || Message[0] == '/'))
+      if (!Message.empty() && (Message[0] == m_CommandTrigger || Message[0] == '/'))
       {
         // extract the command trigger, the command, and the payload
         // e.g. "!say hello world" -> command: "say", payload: "hello world"
@@ -1615,35 +1442,59 @@ void CGame::EventPlayerChatToHost(CGamePlayer* player, CIncomingChatPlayer* chat
   }
 }
 
-bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string& payload)
+void CGame::EventPlayerBotCommand(CGamePlayer* player, const string& command, const string& payload)
 {
-  const string User = player->GetName();
-  const std::string& Command = command;
-  const std::string& Payload = payload;
+  // the admin lists belong to the battle.net connections so check them on the main thread first
+  // when the game is updated by the main thread this all happens right away
 
-  bool AdminCheck = false, RootAdminCheck = false;
+  const string   User         = player->GetName();
+  const string   SpoofedRealm = player->GetSpoofedRealm();
+  const bool     LAN          = player->GetJoinedRealm().empty();
+  const uint8_t  PID          = player->GetPID();
+  CAura* const   Aura         = m_Aura;
+  const uint32_t HostCounter  = m_HostCounter;
 
-  for (auto& bnet : m_Aura->m_BNETs)
-  {
-    if ((bnet->GetServer() == player->GetSpoofedRealm() || player->GetJoinedRealm().empty()) && bnet->IsRootAdmin(User))
+  m_Aura->RunOnMain([=]() {
+    bool AdminCheck = false, RootAdminCheck = false;
+
+    for (auto& bnet : Aura->m_BNETs)
     {
-      RootAdminCheck = true;
-      AdminCheck     = true;
-      break;
+      if ((bnet->GetServer() == SpoofedRealm || LAN) && bnet->IsRootAdmin(User))
+      {
+        RootAdminCheck = true;
+        AdminCheck     = true;
+        break;
+      }
     }
-  }
 
-  if (!RootAdminCheck)
-  {
-    for (auto& bnet : m_Aura->m_BNETs)
+    if (!RootAdminCheck)
     {
-      if ((bnet->GetServer() == player->GetSpoofedRealm() || player->GetJoinedRealm().empty()) && bnet->IsAdmin(User))
+      for (auto& bnet : Aura->m_BNETs)
       {
-        AdminCheck = true;
-        break;
+        if ((bnet->GetServer() == SpoofedRealm || LAN) && bnet->IsAdmin(User))
+        {
+          AdminCheck = true;
+          break;
+        }
       }
     }
-  }
+
+    Aura->RunOnGame(HostCounter, [=](CGame* game) {
+      CGamePlayer* Player = game->GetPlayerFromPID(PID);
+
+      if (Player)
+        game->ExecutePlayerBotCommand(Player, command, payload, AdminCheck, RootAdminCheck);
+    });
+  });
+}
+
+void CGame::ExecutePlayerBotCommand(CGamePlayer* player, const string& command, const string& payload, bool adminCheck, bool rootAdminCheck)
+{
+  const string       User           = player->GetName();
+  const std::string& Command        = command;
+  const std::string& Payload        = payload;
+  const bool         AdminCheck     = adminCheck;
+  const bool         RootAdminCheck = rootAdminCheck;
 
   const uint64_t CommandHash = HashCode(Command);
 
@@ -1698,12 +1549,12 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
 
             if ((*i)->GetNumPings() > 0)
             {
-              Pings += to_string((*i)->GetPing(m_Aura->m_LCPings));
+              Pings += to_string((*i)->GetPing(m_LCPings));
 
-              if (!m_GameLoaded && !m_GameLoading && !(*i)->GetReserved() && KickPing > 0 && (*i)->GetPing(m_Aura->m_LCPings) > KickPing)
+              if (!m_GameLoaded && !m_GameLoading && !(*i)->GetReserved() && KickPing > 0 && (*i)->GetPing(m_LCPings) > KickPing)
               {
                 (*i)->SetDeleteMe(true);
-                (*i)->SetLeftReason("was kicked for excessive ping " + to_string((*i)->GetPing(m_Aura->m_LCPings)) + " > " + to_string(KickPing));
+                (*i)->SetLeftReason("was kicked for excessive ping " + to_string((*i)->GetPing(m_LCPings)) + " > " + to_string(KickPing));
                 (*i)->SetLeftCode(PLAYERLEAVE_LOBBY);
                 OpenSlot(GetSIDFromPID((*i)->GetPID()), false);
                 ++Kicked;
@@ -1742,31 +1593,49 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
         case HashCode("from"):
         case HashCode("f"):
         {
-          string Froms;
+          // the countries are looked up in the database on the main thread, one line per chat message
+
+          vector<pair<string, uint32_t>> Players;
 
-          for (auto i = begin(m_Players); i != end(m_Players); ++i)
+          for (auto& player : m_Players)
           {
             // we reverse the byte order on the IP because it's stored in network byte order
 
-            Froms += (*i)->GetName();
-            Froms += ": (";
-            Froms += m_Aura->m_DB->FromCheck(ByteArrayToUInt32((*i)->GetExternalIP(), true));
-            Froms += ")";
+            Players.emplace_back(player->GetName(), ByteArrayToUInt32(player->GetExternalIP(), true));
+          }
+
+          CAuraDB* const DB        = m_Aura->m_DB;
+          const bool     MultiLine = m_GameLoading || m_GameLoaded;
 
-            if (i != end(m_Players) - 1)
-              Froms += ", ";
+          const auto FromCheck = [DB, Players, MultiLine]() {
+            string Lines, Froms;
 
-            if ((m_GameLoading || m_GameLoaded) && Froms.size() > 100)
+            for (auto i = begin(Players); i != end(Players); ++i)
             {
-              // cut the text into multiple lines ingame
+              Froms += i->first;
+              Froms += ": (";
+              Froms += DB->FromCheck(i->second);
+              Froms += ")";
 
-              SendAllChat(Froms);
-              Froms.clear();
+              if (i != end(Players) - 1)
+                Froms += ", ";
+
+              if (MultiLine && Froms.size() > 100)
+              {
+                // cut the text into multiple lines ingame
+
+                Lines += Froms + '\n';
+                Froms.clear();
+              }
             }
-          }
 
-          if (!Froms.empty())
-            SendAllChat(Froms);
+            if (!Froms.empty())
+              Lines += Froms + '\n';
+
+            return Lines;
+          };
+
+          QueryMain(FromCheck, SendAllChatLines);
 
           break;
         }
@@ -1781,8 +1650,12 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
           if (!m_GameLoaded || m_Aura->m_BNETs.empty() || !m_DBBanLast)
             break;
 
-          m_Aura->m_DB->BanAdd(m_DBBanLast->GetServer(), m_DBBanLast->GetName(), User, Payload);
-          SendAllChat("Player [" + m_DBBanLast->GetName() + "] was banned by player [" + User + "] on server [" + m_DBBanLast->GetServer() + "]");
+          CAuraDB* const DB     = m_Aura->m_DB;
+          const string   Server = m_DBBanLast->GetServer();
+          const string   Name   = m_DBBanLast->GetName();
+
+          m_Aura->RunOnMain([DB, Server, Name, User, Payload]() { DB->BanAdd(Server, Name, User, Payload); });
+          SendAllChat("Player [" + Name + "] was banned by player [" + User + "] on server [" + Server + "]");
           break;
         }
 
@@ -2081,6 +1954,11 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
             m_GameName     = Payload;
             m_HostCounter  = m_Aura->m_HostCounter++;
             m_RefreshError = false;
+            m_LANGameInfo.clear();
+
+            // battle.net only lets us advertise one game at a time so this lobby takes over the advertisement from any other lobby
+
+            m_Aura->m_AdvertisedLobby = this;
 
             for (auto& bnet : m_Aura->m_BNETs)
             {
@@ -2100,8 +1978,8 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
                 bnet->QueueEnterChat();
             }
 
-            m_CreationTime    = GetTime();
-            m_LastRefreshTime = GetTime();
+            m_CreationTime = GetTime();
+            m_Timers->Schedule(&m_RefreshTimer, 3000);
           }
           else
             SendAllChat("Unable to create game [" + Payload + "]. The game name is too long (the maximum is 31 characters)");
@@ -2127,6 +2005,11 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
             m_GameName     = Payload;
             m_HostCounter  = m_Aura->m_HostCounter++;
             m_RefreshError = false;
+            m_LANGameInfo.clear();
+
+            // battle.net only lets us advertise one game at a time so this lobby takes over the advertisement from any other lobby
+
+            m_Aura->m_AdvertisedLobby = this;
 
             for (auto& bnet : m_Aura->m_BNETs)
             {
@@ -2141,7 +2024,8 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
               // the game creation message will be sent on the next refresh
             }
 
-            m_CreationTime = m_LastRefreshTime = GetTime();
+            m_CreationTime = GetTime();
+            m_Timers->Schedule(&m_RefreshTimer, 3000);
           }
           else
             SendAllChat("Unable to create game [" + Payload + "]. The game name is too long (the maximum is 31 characters)");
@@ -2341,6 +2225,9 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
                 LastMatch->SetDownloadAllowed(true);
                 LastMatch->SetDownloadStarted(true);
                 LastMatch->SetStartedDownloadingTicks(GetTicks());
+
+                if (!m_DownloadTimer.GetScheduled())
+                  m_Timers->Schedule(&m_DownloadTimer, 0);
               }
             }
           }
@@ -2362,22 +2249,25 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
 
           try
           {
+            // the setting belongs to the main thread (it's used by the lobbies) and this game might be on another one
+
             const uint32_t Downloads = stoul(Payload);
+            CAura*         Aura      = m_Aura;
 
             if (Downloads == 0)
             {
               SendAllChat("Map downloads disabled");
-              m_Aura->m_AllowDownloads = 0;
+              m_Aura->RunOnMain([Aura]() { Aura->m_AllowDownloads = 0; });
             }
             else if (Downloads == 1)
             {
               SendAllChat("Map downloads enabled");
-              m_Aura->m_AllowDownloads = 1;
+              m_Aura->RunOnMain([Aura]() { Aura->m_AllowDownloads = 1; });
             }
             else if (Downloads == 2)
             {
               SendAllChat("Conditional map downloads enabled");
-              m_Aura->m_AllowDownloads = 2;
+              m_Aura->RunOnMain([Aura]() { Aura->m_AllowDownloads = 2; });
             }
           }
           catch (...)
@@ -2518,7 +2408,11 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
               SendChat(player, "Unable to ban player [" + Victim + "]. No matches found");
             else if (Matches == 1)
             {
-              m_Aura->m_DB->BanAdd(LastMatch->GetServer(), LastMatch->GetName(), User, Reason);
+              CAuraDB* const DB     = m_Aura->m_DB;
+              const string   Server = LastMatch->GetServer();
+              const string   Name   = LastMatch->GetName();
+
+              m_Aura->RunOnMain([DB, Server, Name, User, Reason]() { DB->BanAdd(Server, Name, User, Reason); });
               SendAllChat("Player [" + LastMatch->GetName() + "] was banned by player [" + User + "] on server [" + LastMatch->GetServer() + "]");
             }
             else
@@ -2533,7 +2427,11 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
               SendChat(player, "Unable to ban player [" + Victim + "]. No matches found");
             else if (Matches == 1)
             {
-              m_Aura->m_DB->BanAdd(LastMatch->GetJoinedRealm(), LastMatch->GetName(), User, Reason);
+              CAuraDB* const DB     = m_Aura->m_DB;
+              const string   Server = LastMatch->GetJoinedRealm();
+              const string   Name   = LastMatch->GetName();
+
+              m_Aura->RunOnMain([DB, Server, Name, User, Reason]() { DB->BanAdd(Server, Name, User, Reason); });
               SendAllChat("Player [" + LastMatch->GetName() + "] was banned by player [" + User + "] on server [" + LastMatch->GetJoinedRealm() + "]");
             }
             else
@@ -2558,35 +2456,45 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
               SendChat(player, "Unable to check player [" + Payload + "]. No matches found");
             else if (Matches == 1)
             {
-              bool LastMatchAdminCheck = false;
+              // the country and the admin lists are checked on the main thread
 
-              for (auto& bnet : m_Aura->m_BNETs)
-              {
-                if ((bnet->GetServer() == LastMatch->GetSpoofedRealm() || LastMatch->GetJoinedRealm().empty()) && bnet->IsAdmin(LastMatch->GetName()))
-                {
-                  LastMatchAdminCheck = true;
-                  break;
-                }
-              }
+              CAura* const   Aura         = m_Aura;
+              const string   Name         = LastMatch->GetName();
+              const string   SpoofedRealm = LastMatch->GetSpoofedRealm();
+              const bool     LAN          = LastMatch->GetJoinedRealm().empty();
+              const uint32_t IP           = ByteArrayToUInt32(LastMatch->GetExternalIP(), true);
+              const string   Checked      = "Checked player [" + Name + "]. Ping: " + (LastMatch->GetNumPings() > 0 ? to_string(LastMatch->GetPing(m_LCPings)) + "ms" : "N/A") + ", From: ";
+              const string   Details      = ", Owner: " + string(IsOwner(Name) ? "Yes" : "No") + ", Spoof Checked: " + (LastMatch->GetSpoofed() ? "Yes" : "No") + ", Realm: " + (LAN ? "LAN" : LastMatch->GetJoinedRealm()) + ", Reserved: " + (LastMatch->GetReserved() ? "Yes" : "No");
 
-              bool LastMatchRootAdminCheck = false;
+              const auto Check = [Aura, Name, SpoofedRealm, LAN, IP]() {
+                bool LastMatchAdminCheck = false;
 
-              for (auto& bnet : m_Aura->m_BNETs)
-              {
-                if ((bnet->GetServer() == LastMatch->GetSpoofedRealm() || LastMatch->GetJoinedRealm().empty()) && bnet->IsRootAdmin(LastMatch->GetName()))
+                for (auto& bnet : Aura->m_BNETs)
                 {
-                  LastMatchRootAdminCheck = true;
-                  break;
+                  if ((bnet->GetServer() == SpoofedRealm || LAN) && (bnet->IsAdmin(Name) || bnet->IsRootAdmin(Name)))
+                  {
+                    LastMatchAdminCheck = true;
+                    break;
+                  }
                 }
-              }
 
-              SendAllChat("Checked player [" + LastMatch->GetName() + "]. Ping: " + (LastMatch->GetNumPings() > 0 ? to_string(LastMatch->GetPing(m_Aura->m_LCPings)) + "ms" : "N/A") + ", From: " + m_Aura->m_DB->FromCheck(ByteArrayToUInt32(LastMatch->GetExternalIP(), true)) + ", Admin: " + (LastMatchAdminCheck || LastMatchRootAdminCheck ? "Yes" : "No") + ", Owner: " + (IsOwner(LastMatch->GetName()) ? "Yes" : "No") + ", Spoof Checked: " + (LastMatch->GetSpoofed() ? "Yes" : "No") + ", Realm: " + (LastMatch->GetJoinedRealm().empty() ? "LAN" : LastMatch->GetJoinedRealm()) + ", Reserved: " + (LastMatch->GetReserved() ? "Yes" : "No"));
+                return Aura->m_DB->FromCheck(IP) + ", Admin: " + (LastMatchAdminCheck ? "Yes" : "No");
+              };
+
+              QueryMain(Check, [Checked, Details](CGame* game, const string& result) { game->SendAllChat(Checked + result + Details); });
             }
             else
               SendChat(player, "Unable to check player [" + Payload + "]. Found more than one match");
           }
           else
-            SendAllChat("Checked player [" + User + "]. Ping: " + (player->GetNumPings() > 0 ? to_string(player->GetPing(m_Aura->m_LCPings)) + "ms" : "N/A") + ", From: " + m_Aura->m_DB->FromCheck(ByteArrayToUInt32(player->GetExternalIP(), true)) + ", Admin: " + (AdminCheck || RootAdminCheck ? "Yes" : "No") + ", Owner: " + (IsOwner(User) ? "Yes" : "No") + ", Spoof Checked: " + (player->GetSpoofed() ? "Yes" : "No") + ", Realm: " + (player->GetJoinedRealm().empty() ? "LAN" : player->GetJoinedRealm()) + ", Reserved: " + (player->GetReserved() ? "Yes" : "No"));
+          {
+            CAuraDB* const DB      = m_Aura->m_DB;
+            const uint32_t IP      = ByteArrayToUInt32(player->GetExternalIP(), true);
+            const string   Checked = "Checked player [" + User + "]. Ping: " + (player->GetNumPings() > 0 ? to_string(player->GetPing(m_LCPings)) + "ms" : "N/A") + ", From: ";
+            const string   Details = ", Admin: " + string(AdminCheck || RootAdminCheck ? "Yes" : "No") + ", Owner: " + (IsOwner(User) ? "Yes" : "No") + ", Spoof Checked: " + (player->GetSpoofed() ? "Yes" : "No") + ", Realm: " + (player->GetJoinedRealm().empty() ? "LAN" : player->GetJoinedRealm()) + ", Reserved: " + (player->GetReserved() ? "Yes" : "No");
+
+            QueryMain([DB, IP]() { return DB->FromCheck(IP); }, [Checked, Details](CGame* game, const string& from) { game->SendAllChat(Checked + from + Details); });
+          }
 
           break;
         }
@@ -2600,19 +2508,28 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
           if (Payload.empty() || m_Aura->m_BNETs.empty())
             break;
 
-          for (auto& bnet : m_Aura->m_BNETs)
-          {
-            CDBBan* Ban = m_Aura->m_DB->BanCheck(bnet->GetServer(), Payload);
+          CAura* const Aura = m_Aura;
+
+          const auto CheckBan = [Aura, Payload]() {
+            string Lines;
 
-            if (Ban)
+            for (auto& bnet : Aura->m_BNETs)
             {
-              SendAllChat("User [" + Payload + "] was banned on server [" + bnet->GetServer() + "] on " + Ban->GetDate() + " by [" + Ban->GetAdmin() + "] because [" + Ban->GetReason() + "]");
-              delete Ban;
+              CDBBan* Ban = Aura->m_DB->BanCheck(bnet->GetServer(), Payload);
+
+              if (Ban)
+              {
+                Lines += "User [" + Payload + "] was banned on server [" + bnet->GetServer() + "] on " + Ban->GetDate() + " by [" + Ban->GetAdmin() + "] because [" + Ban->GetReason() + "]\n";
+                delete Ban;
+              }
+              else
+                Lines += "User [" + Payload + "] is not banned on server [" + bnet->GetServer() + "]\n";
             }
-            else
-              SendAllChat("User [" + Payload + "] is not banned on server [" + bnet->GetServer() + "]");
-          }
 
+            return Lines;
+          };
+
+          QueryMain(CheckBan, SendAllChatLines);
           break;
         }
 
@@ -2636,15 +2553,21 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
 
         case HashCode("status"):
         {
-          string message = "Status: ";
+          CAura* const Aura = m_Aura;
+
+          const auto Status = [Aura]() {
+            string message = "Status: ";
 
-          for (const auto& bnet : m_Aura->m_BNETs)
-            message += bnet->GetServer() + (bnet->GetLoggedIn() ? " [online], " : " [offline], ");
+            for (const auto& bnet : Aura->m_BNETs)
+              message += bnet->GetServer() + (bnet->GetLoggedIn() ? " [online], " : " [offline], ");
 
-          if (m_Aura->m_IRC)
-            message += m_Aura->m_IRC->m_Server + (!m_Aura->m_IRC->m_WaitingToConnect ? " [online]" : " [offline]");
+            if (Aura->m_IRC)
+              message += Aura->m_IRC->m_Server + (!Aura->m_IRC->m_WaitingToConnect ? " [online]" : " [offline]");
 
-          SendAllChat(message);
+            return message;
+          };
+
+          QueryMain(Status, [](CGame* game, const string& message) { game->SendAllChat(message); });
           break;
         }
 
@@ -2673,26 +2596,16 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
             Print("[GAME: " + m_GameName + "] bad inputs to sendlan command");
           else
           {
-            // construct a fixed host counter which will be used to identify players from this "realm" (i.e. LAN)
-            // the fixed host counter's 4 most significant bits will contain a 4 bit ID (0-15)
-            // the rest of the fixed host counter will contain the 28 least significant bits of the actual host counter
-            // since we're destroying 4 bits of information here the actual host counter should not be greater than 2^28 which is a reasonable assumption
-            // when a player joins a game we can obtain the ID from the received host counter
-            // note: LAN broadcasts use an ID of 0, battle.net refreshes use an ID of 1-10, the rest are unused
-
-            // we send 12 for SlotsTotal because this determines how many PID's Warcraft 3 allocates
-            // we need to make sure Warcraft 3 allocates at least SlotsTotal + 1 but at most 12 PID's
-            // this is because we need an extra PID for the virtual host player (but we always delete the virtual host player when the 12th person joins)
-            // however, we can't send 13 for SlotsTotal because this causes Warcraft 3 to crash when sharing control of units
-            // nor can we send SlotsTotal because then Warcraft 3 crashes when playing maps with less than 12 PID's (because of the virtual host player taking an extra PID)
-            // we also send 12 for SlotsOpen because Warcraft 3 assumes there's always at least one player in the game (the host)
-            // so if we try to send accurate numbers it'll always be off by one and results in Warcraft 3 assuming the game is full when it still needs one more player
-            // the easiest solution is to simply send 12 for both so the game will always show up as (1/12) players
-
-            // note: the PrivateGame flag is not set when broadcasting to LAN (as you might expect)
-            // note: we do not use m_Map->GetMapGameType because none of the filters are set when broadcasting to LAN (also as you might expect)
-            
-            m_Aura->m_UDPSocket->SendTo(IP, Port, m_Protocol->SEND_W3GS_GAMEINFO(m_Aura->m_LANWar3Version, CreateByteArray(static_cast<uint32_t>(MAPGAMETYPE_UNKNOWN0), false), m_Map->GetMapGameFlags(), m_Map->GetMapWidth(), m_Map->GetMapHeight(), m_GameName, "Clan 007", 0, m_Map->GetMapPath(), m_Map->GetMapCRC(), MAX_SLOTS, MAX_SLOTS, m_HostPort, m_HostCounter & 0x0FFFFFFF, m_EntryKey));
+            // see GetLANGameInfo for what goes into the game info
+            // note: the packet is sent once the ip has been resolved (it can be a host name) and the lobby might be gone by then so we don't touch it in the callback
+
+            CAura*                Aura     = m_Aura;
+            const vector<uint8_t> GameInfo = GetLANGameInfo();
+
+            m_Aura->m_Resolver->Resolve(IP, [Aura, Port, GameInfo](const string& address) {
+              if (!address.empty())
+                Aura->m_UDPSocket->SendTo(address, Port, GameInfo);
+            });
           }
 
           break;
@@ -2732,8 +2645,12 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
           if (Payload.empty())
             break;
 
-          for (auto& bnet : m_Aura->m_BNETs)
-            bnet->QueueChatCommand(Payload);
+          CAura* const Aura = m_Aura;
+
+          m_Aura->RunOnMain([Aura, Payload]() {
+            for (auto& bnet : Aura->m_BNETs)
+              bnet->QueueChatCommand(Payload);
+          });
 
           break;
         }
@@ -2917,9 +2834,8 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
           if (m_FakePlayers.empty() || !m_GameLoaded)
             break;
 
-          std::vector<uint8_t> CRC, Action;
-          Action.push_back(1);
-          m_Actions.push(new CIncomingAction(m_FakePlayers[rand() % m_FakePlayers.size()], CRC, Action));
+          const uint8_t Action = 1;
+          m_Actions->Push(m_FakePlayers[rand() % m_FakePlayers.size()], CByteView(&Action, 1));
           break;
         }
 
@@ -2933,9 +2849,8 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
           if (m_FakePlayers.empty() || !m_GameLoaded)
             break;
 
-          std::vector<uint8_t> CRC, Action;
-          Action.push_back(2);
-          m_Actions.push(new CIncomingAction(m_FakePlayers[0], CRC, Action));
+          const uint8_t Action = 2;
+          m_Actions->Push(m_FakePlayers[0], CByteView(&Action, 1));
           break;
         }
 
@@ -3041,7 +2956,7 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
 
           SendAllChat("A votekick against player [" + m_KickVotePlayer + "] has been cancelled");
           m_KickVotePlayer.clear();
-          m_StartedKickVoteTime = 0;
+          m_KickVoteTimer.Cancel();
           break;
         }
 
@@ -3065,8 +2980,12 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
             Name    = Payload.substr(0, MessageStart);
             Message = Payload.substr(MessageStart + 1);
 
-            for (auto& bnet : m_Aura->m_BNETs)
-              bnet->QueueChatCommand(Message, Name, true, string());
+            CAura* const Aura = m_Aura;
+
+            m_Aura->RunOnMain([Aura, Name, Message]() {
+              for (auto& bnet : Aura->m_BNETs)
+                bnet->QueueChatCommand(Message, Name, true, string());
+            });
           }
 
           break;
@@ -3081,8 +3000,12 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
           if (Payload.empty())
             break;
 
-          for (auto& bnet : m_Aura->m_BNETs)
-            bnet->QueueChatCommand("/whois " + Payload);
+          CAura* const Aura = m_Aura;
+
+          m_Aura->RunOnMain([Aura, Payload]() {
+            for (auto& bnet : Aura->m_BNETs)
+              bnet->QueueChatCommand("/whois " + Payload);
+          });
 
           break;
         }
@@ -3251,7 +3174,13 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
 
     case HashCode("checkme"):
     {
-      SendChat(player, "Checked player [" + User + "]. Ping: " + (player->GetNumPings() > 0 ? to_string(player->GetPing(m_Aura->m_LCPings)) + "ms" : "N/A") + ", From: " + m_Aura->m_DB->FromCheck(ByteArrayToUInt32(player->GetExternalIP(), true)) + ", Admin: " + (AdminCheck || RootAdminCheck ? "Yes" : "No") + ", Owner: " + (IsOwner(User) ? "Yes" : "No") + ", Spoof Checked: " + (player->GetSpoofed() ? "Yes" : "No") + ", Realm: " + (player->GetJoinedRealm().empty() ? "LAN" : player->GetJoinedRealm()) + ", Reserved: " + (player->GetReserved() ? "Yes" : "No"));
+      CAuraDB* const DB      = m_Aura->m_DB;
+      const uint32_t IP      = ByteArrayToUInt32(player->GetExternalIP(), true);
+      const uint8_t  PID     = player->GetPID();
+      const string   Checked = "Checked player [" + User + "]. Ping: " + (player->GetNumPings() > 0 ? to_string(player->GetPing(m_LCPings)) + "ms" : "N/A") + ", From: ";
+      const string   Details = ", Admin: " + string(AdminCheck || RootAdminCheck ? "Yes" : "No") + ", Owner: " + (IsOwner(User) ? "Yes" : "No") + ", Spoof Checked: " + (player->GetSpoofed() ? "Yes" : "No") + ", Realm: " + (player->GetJoinedRealm().empty() ? "LAN" : player->GetJoinedRealm()) + ", Reserved: " + (player->GetReserved() ? "Yes" : "No");
+
+      QueryMain([DB, IP]() { return DB->FromCheck(IP); }, [PID, Checked, Details](CGame* game, const string& from) { game->SendChat(PID, Checked + from + Details); });
       break;
     }
 
@@ -3268,24 +3197,35 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
 
       if (!StatsUser.empty() && StatsUser.size() < 16 && StatsUser[0] != '/')
       {
-        CDBGamePlayerSummary* GamePlayerSummary = m_Aura->m_DB->GamePlayerSummaryCheck(StatsUser);
+        // the summary and the admin check come from the database on the main thread, admins get the answer sent to everyone
 
-        if (GamePlayerSummary)
-        {
-          if (player->GetSpoofed() && (m_Aura->m_DB->AdminCheck(player->GetSpoofedRealm(), User) || RootAdminCheck || IsOwner(User)))
-            SendAllChat("[" + StatsUser + "] has played " + to_string(GamePlayerSummary->GetTotalGames()) + " games with this bot. Average loading time: " + to_string(GamePlayerSummary->GetAvgLoadingTime()) + " seconds. Average stay: " + to_string(GamePlayerSummary->GetAvgLeftPercent()) + " percent");
-          else
-            SendChat(player, "[" + StatsUser + "] has played " + to_string(GamePlayerSummary->GetTotalGames()) + " games with this bot. Average loading time: " + to_string(GamePlayerSummary->GetAvgLoadingTime()) + " seconds. Average stay: " + to_string(GamePlayerSummary->GetAvgLeftPercent()) + " percent");
+        CAura* const   Aura         = m_Aura;
+        const uint32_t HostCounter  = m_HostCounter;
+        const uint8_t  PID          = player->GetPID();
+        const bool     Spoofed      = player->GetSpoofed();
+        const string   SpoofedRealm = player->GetSpoofedRealm();
+        const bool     Privileged   = RootAdminCheck || IsOwner(User);
 
-          delete GamePlayerSummary;
-        }
-        else
-        {
-          if (player->GetSpoofed() && (m_Aura->m_DB->AdminCheck(player->GetSpoofedRealm(), User) || RootAdminCheck || IsOwner(User)))
-            SendAllChat("[" + StatsUser + "] hasn't played any games here");
+        m_Aura->RunOnMain([=]() {
+          CDBGamePlayerSummary* GamePlayerSummary = Aura->m_DB->GamePlayerSummaryCheck(StatsUser);
+          const bool            SendAll           = Spoofed && (Aura->m_DB->AdminCheck(SpoofedRealm, User) || Privileged);
+          string                Message;
+
+          if (GamePlayerSummary)
+          {
+            Message = "[" + StatsUser + "] has played " + to_string(GamePlayerSummary->GetTotalGames()) + " games with this bot. Average loading time: " + to_string(GamePlayerSummary->GetAvgLoadingTime()) + " seconds. Average stay: " + to_string(GamePlayerSummary->GetAvgLeftPercent()) + " percent";
+            delete GamePlayerSummary;
+          }
           else
-            SendChat(player, "[" + StatsUser + "] hasn't played any games here");
-        }
+            Message = "[" + StatsUser + "] hasn't played any games here";
+
+          Aura->RunOnGame(HostCounter, [=](CGame* game) {
+            if (SendAll)
+              game->SendAllChat(Message);
+            else
+              game->SendChat(PID, Message);
+          });
+        });
       }
 
       break;
@@ -3306,26 +3246,36 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
 
       if (!StatsUser.empty() && StatsUser.size() < 16 && StatsUser[0] != '/')
       {
-        CDBDotAPlayerSummary* DotAPlayerSummary = m_Aura->m_DB->DotAPlayerSummaryCheck(StatsUser);
+        // same as !stats
 
-        if (DotAPlayerSummary)
-        {
-          const string Summary = StatsUser + " - " + to_string(DotAPlayerSummary->GetTotalGames()) + " games (W/L: " + to_string(DotAPlayerSummary->GetTotalWins()) + "/" + to_string(DotAPlayerSummary->GetTotalLosses()) + ") Hero K/D/A: " + to_string(DotAPlayerSummary->GetTotalKills()) + "/" + to_string(DotAPlayerSummary->GetTotalDeaths()) + "/" + to_string(DotAPlayerSummary->GetTotalAssists()) + " (" + to_string(DotAPlayerSummary->GetAvgKills()) + "/" + to_string(DotAPlayerSummary->GetAvgDeaths()) + "/" + to_string(DotAPlayerSummary->GetAvgAssists()) + ") Creep K/D/N: " + to_string(DotAPlayerSummary->GetTotalCreepKills()) + "/" + to_string(DotAPlayerSummary->GetTotalCreepDenies()) + "/" + to_string(DotAPlayerSummary->GetTotalNeutralKills()) + " (" + to_string(DotAPlayerSummary->GetAvgCreepKills()) + "/" + to_string(DotAPlayerSummary->GetAvgCreepDenies()) + "/" + to_string(DotAPlayerSummary->GetAvgNeutralKills()) + ") T/R/C: " + to_string(DotAPlayerSummary->GetTotalTowerKills()) + "/" + to_string(DotAPlayerSummary->GetTotalRaxKills()) + "/" + to_string(DotAPlayerSummary->GetTotalCourierKills());
+        CAura* const   Aura         = m_Aura;
+        const uint32_t HostCounter  = m_HostCounter;
+        const uint8_t  PID          = player->GetPID();
+        const bool     Spoofed      = player->GetSpoofed();
+        const string   SpoofedRealm = player->GetSpoofedRealm();
+        const bool     Privileged   = RootAdminCheck || IsOwner(User);
 
-          if (player->GetSpoofed() && (m_Aura->m_DB->AdminCheck(player->GetSpoofedRealm(), User) || RootAdminCheck || IsOwner(User)))
-            SendAllChat(Summary);
-          else
-            SendChat(player, Summary);
+        m_Aura->RunOnMain([=]() {
+          CDBDotAPlayerSummary* DotAPlayerSummary = Aura->m_DB->DotAPlayerSummaryCheck(StatsUser);
+          const bool            SendAll           = Spoofed && (Aura->m_DB->AdminCheck(SpoofedRealm, User) || Privileged);
+          string                Message;
 
-          delete DotAPlayerSummary;
-        }
-        else
-        {
-          if (player->GetSpoofed() && (m_Aura->m_DB->AdminCheck(player->GetSpoofedRealm(), User) || RootAdminCheck || IsOwner(User)))
-            SendAllChat("[" + StatsUser + "] hasn't played any DotA games here");
+          if (DotAPlayerSummary)
+          {
+            Message = StatsUser + " - " + to_string(DotAPlayerSummary->GetTotalGames()) + " games (W/L: " + to_string(DotAPlayerSummary->GetTotalWins()) + "/" + to_string(DotAPlayerSummary->GetTotalLosses()) + ") Hero K/D/A: " + to_string(DotAPlayerSummary->GetTotalKills()) + "/" + to_string(DotAPlayerSummary->GetTotalDeaths()) + "/" + to_string(DotAPlayerSummary->GetTotalAssists()) + " (" + to_string(DotAPlayerSummary->GetAvgKills()) + "/" + to_string(DotAPlayerSummary->GetAvgDeaths()) + "/" + to_string(DotAPlayerSummary->GetAvgAssists()) + ") Creep K/D/N: " + to_string(DotAPlayerSummary->GetTotalCreepKills()) + "/" + to_string(DotAPlayerSummary->GetTotalCreepDenies()) + "/" + to_string(DotAPlayerSummary->GetTotalNeutralKills()) + " (" + to_string(DotAPlayerSummary->GetAvgCreepKills()) + "/" + to_string(DotAPlayerSummary->GetAvgCreepDenies()) + "/" + to_string(DotAPlayerSummary->GetAvgNeutralKills()) + ") T/R/C: " + to_string(DotAPlayerSummary->GetTotalTowerKills()) + "/" + to_string(DotAPlayerSummary->GetTotalRaxKills()) + "/" + to_string(DotAPlayerSummary->GetTotalCourierKills());
+
+            delete DotAPlayerSummary;
+          }
           else
-            SendChat(player, "[" + StatsUser + "] hasn't played any DotA games here");
-        }
+            Message = "[" + StatsUser + "] hasn't played any DotA games here";
+
+          Aura->RunOnGame(HostCounter, [=](CGame* game) {
+            if (SendAll)
+              game->SendAllChat(Message);
+            else
+              game->SendChat(PID, Message);
+          });
+        });
       }
 
       break;
@@ -3367,16 +3317,16 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
             SendChat(player, "Unable to votekick player [" + LastMatch->GetName() + "]. That player is reserved and cannot be votekicked");
           else
           {
-            m_KickVotePlayer      = LastMatch->GetName();
-            m_StartedKickVoteTime = GetTime();
+            m_KickVotePlayer = LastMatch->GetName();
+            m_Timers->Schedule(&m_KickVoteTimer, 60000);
 
             for (auto& player : m_Players)
               player->SetKickVote(false);
 
             player->SetKickVote(true);
             Print("[GAME: " + m_GameName + "] votekick against player [" + m_KickVotePlayer + "] started by player [" + User + "]");
-            SendAllChat("Player [" + User + "] voted to kick player [" + LastMatch->GetName() + "]. " + to_string(static_cast<uint32_t>(ceil((GetNumHumanPlayers() - 1) * static_cast<float>(m_Aura->m_VoteKickPercentage) / 100)) - 1) + " more votes are needed to pass");
-            SendAllChat("Type " + string(1, m_Aura->m_CommandTrigger) + "yes to vote");
+            SendAllChat("Player [" + User + "] voted to kick player [" + LastMatch->GetName() + "]. " + to_string(static_cast<uint32_t>(ceil((GetNumHumanPlayers() - 1) * static_cast<float>(m_VoteKickPercentage) / 100)) - 1) + " more votes are needed to pass");
+            SendAllChat("Type " + string(1, m_CommandTrigger) + "yes to vote");
           }
         }
         else
@@ -3396,7 +3346,7 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
         break;
 
       player->SetKickVote(true);
-      uint32_t Votes = 0, VotesNeeded = static_cast<uint32_t>(ceil((GetNumHumanPlayers() - 1) * static_cast<float>(m_Aura->m_VoteKickPercentage) / 100));
+      uint32_t Votes = 0, VotesNeeded = static_cast<uint32_t>(ceil((GetNumHumanPlayers() - 1) * static_cast<float>(m_VoteKickPercentage) / 100));
 
       for (auto& player : m_Players)
       {
@@ -3428,7 +3378,7 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
           SendAllChat("Error votekicking player [" + m_KickVotePlayer + "]");
 
         m_KickVotePlayer.clear();
-        m_StartedKickVoteTime = 0;
+        m_KickVoteTimer.Cancel();
       }
       else
         SendAllChat("Player [" + User + "] voted to kick player [" + m_KickVotePlayer + "]. " + to_string(VotesNeeded - Votes) + " more votes are needed to pass");
@@ -3436,8 +3386,6 @@ bool CGame::EventPlayerBotCommand(CGamePlayer* player, string& command, string&
       break;
     }
   }
-
-  return true;
 }
 
 void CGame::EventPlayerChangeTeam(CGamePlayer* player, uint8_t team)
@@ -3606,9 +3554,7 @@ void CGame::EventPlayerMapSize(CGamePlayer* player, CIncomingMapSize* mapSize)
 
     if (Admin || m_Aura->m_AllowDownloads)
     {
-      string* MapData = m_Map->GetMapData();
-
-      if (!MapData->empty())
+      if (!m_Map->GetMapData().empty())
       {
         if (Admin || m_Aura->m_AllowDownloads == 1 || (m_Aura->m_AllowDownloads == 2 && player->GetDownloadAllowed()))
         {
@@ -3620,6 +3566,9 @@ void CGame::EventPlayerMapSize(CGamePlayer* player, CIncomingMapSize* mapSize)
             Send(player, m_Protocol->SEND_W3GS_STARTDOWNLOAD(GetHostPID()));
             player->SetDownloadStarted(true);
             player->SetStartedDownloadingTicks(GetTicks());
+
+            if (!m_DownloadTimer.GetScheduled())
+              m_Timers->Schedule(&m_DownloadTimer, 0);
           }
           else
             player->SetLastMapPartAcked(mapSize->GetMapSize());
@@ -3682,13 +3631,13 @@ void CGame::EventPlayerPongToHost(CGamePlayer* player)
   // also don't kick anyone if the game is loading or loaded - this could happen because we send pings during loading but we stop sending them after the game is loaded
   // see the Update function for where we send pings
 
-  if (!m_GameLoading && !m_GameLoaded && !player->GetDeleteMe() && !player->GetReserved() && player->GetNumPings() >= 3 && player->GetPing(m_Aura->m_LCPings) > m_Aura->m_AutoKickPing)
+  if (!m_GameLoading && !m_GameLoaded && !player->GetDeleteMe() && !player->GetReserved() && player->GetNumPings() >= 3 && player->GetPing(m_LCPings) > m_AutoKickPing)
   {
     // send a chat message because we don't normally do so when a player leaves the lobby
 
-    SendAllChat("Autokicking player [" + player->GetName() + "] for excessive ping of " + to_string(player->GetPing(m_Aura->m_LCPings)));
+    SendAllChat("Autokicking player [" + player->GetName() + "] for excessive ping of " + to_string(player->GetPing(m_LCPings)));
     player->SetDeleteMe(true);
-    player->SetLeftReason("was autokicked for excessive ping of " + to_string(player->GetPing(m_Aura->m_LCPings)));
+    player->SetLeftReason("was autokicked for excessive ping of " + to_string(player->GetPing(m_LCPings)));
     player->SetLeftCode(PLAYERLEAVE_LOBBY);
     OpenSlot(GetSIDFromPID(player->GetPID()), false);
   }
@@ -3764,9 +3713,16 @@ void CGame::EventGameStarted()
   if (m_SlotInfoChanged)
     SendAllSlotInfo();
 
-  m_StartedLoadingTicks    = GetTicks();
-  m_LastLagScreenResetTime = GetTime();
-  m_GameLoading            = true;
+  m_StartedLoadingTicks = GetTicks();
+  m_GameLoading         = true;
+
+  // remember the reconnect keys so the main thread can tell which game a GProxy++ reconnect belongs to without touching the players
+  // nobody can join from now on so the keys of the players who are still here later on are a subset of these
+
+  m_ReconnectKeys.clear();
+
+  for (auto& player : m_Players)
+    m_ReconnectKeys[player->GetPID()] = player->GetGProxyReconnectKey();
 
   // since we use a fake countdown to deal with leavers during countdown the COUNTDOWN_START and COUNTDOWN_END packets are sent in quick succession
   // send a start countdown packet
@@ -3800,35 +3756,12 @@ void CGame::EventGameStarted()
       m_Stats = new CStats(this);
   }
 
-  // close the listening socket
-
-  delete m_Socket;
-  m_Socket = nullptr;
-
-  // delete any potential players that are still hanging around
-
-  for (auto& potential : m_Potentials)
-    delete potential;
-
-  m_Potentials.clear();
-
   // delete the map data
 
   delete m_Map;
   m_Map = nullptr;
 
-  // move the game to the games in progress vector
-
-  m_Aura->m_CurrentGame = nullptr;
-  m_Aura->m_Games.push_back(this);
-
-  // and finally reenter battle.net chat
-
-  for (auto& bnet : m_Aura->m_BNETs)
-  {
-    bnet->QueueGameUncreate();
-    bnet->QueueEnterChat();
-  }
+  // CAura moves the game to the games in progress vector (and stops advertising it on battle.net) once this update is over
 
   // record everything we need to ban each player in case we decide to do so later
   // this is because when a player leaves the game an admin might want to ban that player
@@ -3867,6 +3800,254 @@ void CGame::EventGameLoaded()
     SendChat(player, "Your load time was " + ToFormattedString(static_cast<double>(player->GetFinishedLoadingTicks() - m_StartedLoadingTicks) / 1000.f) + " seconds");
 }
 
+void CGame::EventPingTimer()
+{
+  // ping every 5 seconds
+  // changed this to ping during game loading as well to hopefully fix some problems with people disconnecting during loading
+  // changed this to ping during the game as well
+  // note: we must send pings to players who are downloading the map because Warcraft III disconnects from the lobby if it doesn't receive a ping every ~90 seconds
+  // so if the player takes longer than 90 seconds to download the map they would be disconnected unless we keep sending pings
+
+  SendAll(m_Protocol->SEND_W3GS_PING_FROM_HOST());
+
+  m_Timers->Schedule(&m_PingTimer, 5000);
+}
+
+void CGame::EventBroadcastTimer()
+{
+  // LAN players searching for games are answered right away by CAura::Update so this is only a fallback for the clients which don't search
+  // the lobby is broadcast until the game starts loading but not while the countdown is running (the countdown may still be aborted)
+
+  if (m_GameLoading || m_GameLoaded)
+    return;
+
+  if (!m_CountDownStarted)
+    m_Aura->m_UDPSocket->Broadcast(6112, GetLANGameInfo());
+
+  m_Timers->Schedule(&m_BroadcastTimer, m_Aura->m_LANBroadcastInterval * 1000);
+}
+
+void CGame::EventRefreshTimer()
+{
+  // the lobby is refreshed until the game starts loading (the countdown may still be aborted)
+
+  if (m_GameLoading || m_GameLoaded)
+    return;
+
+  if (!m_RefreshError && !m_CountDownStarted && m_Aura->m_AdvertisedLobby == this && m_GameState == GAME_PUBLIC && GetSlotsOpen() > 0)
+  {
+    // send a game refresh packet to each battle.net connection
+
+    for (auto& bnet : m_Aura->m_BNETs)
+    {
+      // don't queue a game refresh message if the queue contains more than 1 packet because they're very low priority
+
+      if (bnet->GetOutPacketsQueued() <= 1)
+        bnet->QueueGameRefresh(m_GameState, m_GameName, m_Map, m_HostCounter);
+    }
+  }
+
+  m_Timers->Schedule(&m_RefreshTimer, 3000);
+}
+
+void CGame::EventLobbyTimer()
+{
+  if (m_GameLoading || m_GameLoaded)
+    return;
+
+  // the download counter is reset once per second so this is a great place to update the slot info if necessary
+
+  if (m_SlotInfoChanged)
+    SendAllSlotInfo();
+
+  m_DownloadCounter = 0;
+
+  // check if the lobby is "abandoned" and needs to be closed since it will never start
+
+  if (m_Aura->m_LobbyTimeLimit > 0)
+  {
+    const int64_t Time = GetTime();
+
+    // check if there's a player with reserved status in the game
+
+    for (auto& player : m_Players)
+    {
+      if (player->GetReserved())
+      {
+        m_LastReservedSeen = Time;
+        break;
+      }
+    }
+
+    // check if we've hit the time limit
+
+    if (Time - m_LastReservedSeen > static_cast<int64_t>(m_Aura->m_LobbyTimeLimit * 60))
+    {
+      Print("[GAME: " + m_GameName + "] is over (lobby time limit hit)");
+      m_Exiting = true;
+      return;
+    }
+  }
+
+  m_Timers->Schedule(&m_LobbyTimer, 1000);
+}
+
+void CGame::EventDownloadTimer()
+{
+  if (m_GameLoading || m_GameLoaded)
+    return;
+
+  uint32_t Downloaders = 0;
+
+  for (auto& player : m_Players)
+  {
+    if (player->GetDownloadStarted() && !player->GetDownloadFinished())
+    {
+      ++Downloaders;
+
+      if (m_Aura->m_MaxDownloaders > 0 && Downloaders > m_Aura->m_MaxDownloaders)
+        break;
+      // send up to 100 pieces of the map at once so that the download goes faster
+      // if we wait for each MAPPART packet to be acknowledged by the client it'll take a long time to download
+      // this is because we would have to wait the round trip time (the ping time) between sending every 1442 bytes of map data
+      // doing it this way allows us to send at least 140 KB in each round trip int32_terval which is much more reasonable
+      // the theoretical throughput is [140 KB * 1000 / ping] in KB/sec so someone with 100 ping (round trip ping, not LC ping) could download at 1400 KB/sec
+      // note: this creates a queue of map data which clogs up the connection when the client is on a slower connection (e.g. dialup)
+      // in this case any changes to the lobby are delayed by the amount of time it takes to send the queued data (i.e. 140 KB, which could be 30 seconds or more)
+      // for example, players joining and leaving, slot changes, chat messages would all appear to happen much later for the low bandwidth player
+      // note: the throughput is also limited by the number of times this code is executed each second
+      // e.g. if we send the maximum amount (140 KB) 10 times per second the theoretical throughput is 1400 KB/sec
+      // therefore the maximum throughput is 1400 KB/sec regardless of ping and this value slowly diminishes as the player's ping increases
+      // in addition to this, the throughput is limited by the configuration value bot_maxdownloadspeed
+      // in summary: the actual throughput is MIN( 140 * 1000 / ping, 1400, bot_maxdownloadspeed ) in KB/sec assuming only one player is downloading the map
+
+      const uint32_t MapSize = ByteArrayToUInt32(m_Map->GetMapSize(), false);
+
+      while (player->GetLastMapPartSent() < player->GetLastMapPartAcked() + MAPPART_SIZE * 100 && player->GetLastMapPartSent() < MapSize)
+      {
+        if (player->GetLastMapPartSent() == 0)
+        {
+          // overwrite the "started download ticks" since this is the first time we've sent any map data to the player
+          // prior to this we've only determined if the player needs to download the map but it's possible we could have delayed sending any data due to download limits
+
+          player->SetStartedDownloadingTicks(GetTicks());
+        }
+
+        // limit the download speed if we're sending too much data
+        // the download counter is the # of map bytes downloaded in the last second (it's reset once per second)
+
+        if (m_Aura->m_MaxDownloadSpeed > 0 && m_DownloadCounter > m_Aura->m_MaxDownloadSpeed * 1024)
+          break;
+
+        const uint32_t Start = player->GetLastMapPartSent();
+        m_Protocol->SEND_W3GS_MAPPART(m_MapPartPacket, GetHostPID(), player->GetPID(), Start, m_Map->GetMapPart(Start), m_Map->GetMapPartCRC(Start));
+        Send(player, m_MapPartPacket);
+        player->SetLastMapPartSent(Start + MAPPART_SIZE);
+        m_DownloadCounter += MAPPART_SIZE;
+      }
+    }
+  }
+
+  // keep going as long as anyone is downloading the map, the timer is started again when the next download starts
+
+  if (IsDownloading())
+    m_Timers->Schedule(&m_DownloadTimer, 100);
+}
+
+void CGame::EventCountDownTimer()
+{
+  // the countdown may have been aborted since the timer was started
+
+  if (!m_CountDownStarted)
+    return;
+
+  if (m_CountDownCounter > 0)
+  {
+    // we use a countdown counter rather than a "finish countdown time" here because it might alternately round up or down the count
+    // this sometimes resulted in a countdown of e.g. "6 5 3 2 1" during my testing which looks pretty dumb
+    // doing it this way ensures it's always "5 4 3 2 1" but each int32_terval might not be *exactly* the same length
+
+    SendAllChat(to_string(m_CountDownCounter--) + ". . .");
+    m_Timers->Schedule(&m_CountDownTimer, 500);
+  }
+  else if (!m_GameLoading && !m_GameLoaded)
+    EventGameStarted();
+}
+
+void CGame::EventLagScreenTimer()
+{
+  // we cannot allow the lag screen to stay up for more than ~65 seconds because Warcraft III disconnects if it doesn't receive an action packet at least this often
+  // one (easy) solution is to simply drop all the laggers if they lag for more than 60 seconds
+  // another solution is to reset the lag screen the same way we reset it when using load-in-game
+
+  bool UsingGProxy = false;
+
+  for (auto& player : m_Players)
+  {
+    if (player->GetGProxy())
+    {
+      UsingGProxy = true;
+      break;
+    }
+  }
+
+  for (auto& _i : m_Players)
+  {
+    // stop the lag screen
+
+    for (auto& player : m_Players)
+    {
+      if (player->GetLagging())
+        Send(_i, m_Protocol->SEND_W3GS_STOP_LAG(player));
+    }
+
+    // send an empty update
+    // this resets the lag screen timer
+
+    if (UsingGProxy && !(_i)->GetGProxy())
+    {
+      // we must send additional empty actions to non-GProxy++ players
+      // GProxy++ will insert these itself so we don't need to send them to GProxy++ players
+      // empty actions are used to extend the time a player can use when reconnecting
+
+      for (uint8_t j = 0; j < m_GProxyEmptyActions; ++j)
+        Send(_i, m_Protocol->SEND_W3GS_INCOMING_ACTION(CByteView(), 0));
+    }
+
+    Send(_i, m_Protocol->SEND_W3GS_INCOMING_ACTION(CByteView(), 0));
+
+    // start the lag screen
+
+    Send(_i, m_Protocol->SEND_W3GS_START_LAG(m_Players));
+  }
+
+  Flush();
+
+  // Warcraft III doesn't seem to respond to empty actions
+
+  m_Timers->Schedule(&m_LagScreenTimer, 60000);
+}
+
+void CGame::EventKickVoteTimer()
+{
+  Print("[GAME: " + m_GameName + "] votekick against player [" + m_KickVotePlayer + "] expired");
+  SendAllChat("A votekick against player [" + m_KickVotePlayer + "] has expired");
+  m_KickVotePlayer.clear();
+}
+
+void CGame::EventGameOverTimer()
+{
+  for (auto& player : m_Players)
+  {
+    if (!player->GetDeleteMe())
+    {
+      Print("[GAME: " + m_GameName + "] is over (gameover timer finished)");
+      StopPlayers("was disconnected (gameover timer finished)");
+      break;
+    }
+  }
+}
+
 uint8_t CGame::GetSIDFromPID(uint8_t PID) const
 {
   if (m_Slots.size() > 255)
@@ -4558,6 +4739,7 @@ void CGame::StartCountDown(bool force)
     {
       m_CountDownStarted = true;
       m_CountDownCounter = 5;
+      m_Timers->Schedule(&m_CountDownTimer, 0);
     }
     else
     {
@@ -4617,6 +4799,7 @@ void CGame::StartCountDown(bool force)
       {
         m_CountDownStarted = true;
         m_CountDownCounter = 5;
+        m_Timers->Schedule(&m_CountDownTimer, 0);
       }
     }
   }
@@ -4714,3 +4897,50 @@ void CGame::DeleteFakePlayers()
   m_FakePlayers.clear();
   SendAllSlotInfo();
 }
+
+void CGame::SetWorker(CGameWorker* worker)
+{
+  m_Worker = worker;
+}
+
+void CGame::SetConfigs(uint32_t autoKickPing, uint32_t voteKickPercentage, int32_t commandTrigger, bool lcPings)
+{
+  // called by CAura::ReloadConfigs through RunOnGame so a game in progress picks up the new values on its own thread
+
+  m_AutoKickPing       = autoKickPing;
+  m_VoteKickPercentage = voteKickPercentage;
+  m_CommandTrigger     = commandTrigger;
+  m_LCPings            = lcPings;
+}
+
+void CGame::SetPoller(CPoller* poller)
+{
+  // move the player sockets to another poller, nullptr just takes them off the current one
+
+  m_Poller = poller;
+
+  for (auto& player : m_Players)
+  {
+    CTCPSocket* Socket = player->GetSocket();
+
+    if (!Socket)
+      continue;
+
+    Socket->SetPoller(poller);
+    Socket->Register();
+  }
+}
+
+void CGame::QueryMain(function<string()> query, function<void(CGame*, const string&)> reply)
+{
+  // runs query on the main thread (where battle.net, irc and the database live) and passes the result back to this game's thread
+  // the reply is dropped if the game is gone by then, so neither function may capture this or any of our players
+
+  CAura* const   Aura        = m_Aura;
+  const uint32_t HostCounter = m_HostCounter;
+
+  m_Aura->RunOnMain([Aura, HostCounter, query, reply]() {
+    const string Result = query();
+    Aura->RunOnGame(HostCounter, [Result, reply](CGame* game) { reply(game, Result); });
+  });
+}
@@ -22,9 +22,13 @@
 #define AURA_GAME_H_
 
 #include "gameslot.h"
+#include "timerwheel.h"
 
 #include <set>
+#include <array>
+#include <map>
 #include <queue>
+#include <functional>
 
 //
 // CGame
@@ -38,6 +42,7 @@ class CGamePlayer;
 class CMap;
 class CIncomingJoinPlayer;
 class CIncomingAction;
+class CActionBuffer;
 class CIncomingChatPlayer;
 class CIncomingMapSize;
 class CDBBan;
@@ -45,6 +50,9 @@ class CDBGamePlayer;
 class CStats;
 class CIRC;
 class CBNET;
+class CPoller;
+class CTCPSocket;
+class CGameWorker;
 
 class CGame
 {
@@ -52,20 +60,35 @@ public:
   CAura* m_Aura;
 
 protected:
-  CTCPServer*                    m_Socket;                        // listening socket
   CDBBan*                        m_DBBanLast;                     // last ban for the !banlast command - this is a pointer to one of the items in m_DBBans
   std::vector<CDBBan*>           m_DBBans;                        // std::vector of potential ban data for the database
   CStats*                        m_Stats;                         // class to keep track of game stats such as kills/deaths/assists in dota
   CGameProtocol*                 m_Protocol;                      // game protocol
   std::vector<CGameSlot>         m_Slots;                         // std::vector of slots
-  std::vector<CPotentialPlayer*> m_Potentials;                    // std::vector of potential players (connections that haven't sent a W3GS_REQJOIN packet yet)
   std::vector<CDBGamePlayer*>    m_DBGamePlayers;                 // std::vector of potential gameplayer data for the database
   std::vector<CGamePlayer*>      m_Players;                       // std::vector of players
-  std::queue<CIncomingAction*>   m_Actions;                       // queue of actions to be sent
+  CActionBuffer*                 m_Actions;                       // actions to be sent at the end of the current action interval
+  std::vector<uint8_t>           m_ActionPacket;                  // reused to build the action packets so sending them doesn't allocate
+  std::vector<uint8_t>           m_MapPartPacket;                 // reused to build the map part packets when players are downloading the map
+  std::vector<uint8_t>           m_LANGameInfo;                   // the W3GS_GAMEINFO packet sent to the local network, built when it's first needed and cleared when the game is rehosted
   std::vector<std::string>       m_Reserved;                      // std::vector of player names with reserved slots (from the !hold command)
   std::set<std::string>          m_IgnoredNames;                  // set of player names to NOT print ban messages for when joining because they've already been printed
   std::vector<uint8_t>           m_FakePlayers;                   // the fake player's PIDs (if present)
   CMap*                          m_Map;                           // map data
+  CGameWorker*                   m_Worker;                        // the game worker thread updating this game, nullptr while the main thread updates it
+  CPoller*                       m_Poller;                        // the poller the player sockets are registered with which also flushes them, nullptr while the game moves between threads
+  std::vector<CTCPSocket*>       m_FlushSockets;                  // reused to hand the player sockets to m_Poller when flushing
+  std::map<uint8_t, uint32_t>    m_ReconnectKeys;                 // the GProxy++ reconnect key of each PID when the game started loading, CAura indexes them (main thread only)
+  CTimerWheel*                   m_Timers;                        // the periodic work of the game and its players, advanced at the start of every update
+  CTimer                         m_PingTimer;                     // pings the players every 5 seconds
+  CTimer                         m_BroadcastTimer;                // broadcasts the lobby to the local network every lan_broadcastinterval seconds
+  CTimer                         m_RefreshTimer;                  // refreshes the lobby on battle.net every 3 seconds
+  CTimer                         m_LobbyTimer;                    // resets the download counter, sends pending slot info and checks the lobby time limit every second
+  CTimer                         m_DownloadTimer;                 // sends more map data every 100 ms while anyone is downloading the map
+  CTimer                         m_CountDownTimer;                // counts down every 500 ms while the countdown is running
+  CTimer                         m_LagScreenTimer;                // resets the lag screen every 60 seconds while it's up
+  CTimer                         m_KickVoteTimer;                 // expires the votekick 60 seconds after it started
+  CTimer                         m_GameOverTimer;                 // disconnects the remaining players 60 seconds after the gameover timer started
   std::string                    m_GameName;                      // game name
   std::string                    m_LastGameName;                  // last game name (the previous game name before it was rehosted)
   std::string                    m_VirtualHostName;               // host's name
@@ -77,26 +100,27 @@ protected:
   std::string                    m_MapPath;                       // store the map path to save in the database on game end
   int64_t                        m_GameTicks;                     // ingame ticks
   int64_t                        m_CreationTime;                  // GetTime when the game was created
-  int64_t                        m_LastPingTime;                  // GetTime when the last ping was sent
-  int64_t                        m_LastRefreshTime;               // GetTime when the last game refresh was sent
-  int64_t                        m_LastDownloadTicks;             // GetTicks when the last map download cycle was performed
-  int64_t                        m_LastDownloadCounterResetTicks; // GetTicks when the download counter was last reset
-  int64_t                        m_LastCountDownTicks;            // GetTicks when the last countdown message was sent
   int64_t                        m_StartedLoadingTicks;           // GetTicks when the game started loading
-  int64_t                        m_LastActionSentTicks;           // GetTicks when the last action packet was sent
-  int64_t                        m_LastActionLateBy;              // the number of ticks we were late sending the last action packet by
+  int64_t                        m_NextActionMicroTicks;          // GetMicroTicks when the next action packet is due, advanced by exactly the latency each time so lateness doesn't accumulate
+  std::array<uint32_t, 8>        m_ActionJitter;                  // histogram of how late the action packets were sent, see ActionJitterBuckets in game.cpp for the bucket limits
+  int64_t                        m_ActionJitterTotal;             // sum of the lateness of every action packet in microseconds (for the average)
+  int64_t                        m_ActionJitterMax;               // the most an action packet was late by in microseconds
+  uint64_t                       m_NumUpdates;                    // the number of times Update was called
+  uint64_t                       m_PacketsQueued;                 // the number of packets queued for the players (a packet sent to everyone counts once per player)
+  uint64_t                       m_SendCalls;                     // the number of send calls it took to flush them
   int64_t                        m_StartedLaggingTime;            // GetTime when the last lag screen started
   int64_t                        m_LastLagScreenTime;             // GetTime when the last lag screen was active (continuously updated)
   int64_t                        m_LastReservedSeen;              // GetTime when the last reserved player was seen in the lobby
-  int64_t                        m_StartedKickVoteTime;           // GetTime when the kick vote was started
   int64_t                        m_GameOverTime;                  // GetTime when the game was over
   int64_t                        m_LastPlayerLeaveTicks;          // GetTicks when the most recent player left the game
-  int64_t                        m_LastLagScreenResetTime;        // GetTime when the "lag" screen was last reset
   int64_t                        m_RandomSeed;                    // the random seed sent to the Warcraft III clients
   uint32_t                       m_HostCounter;                   // a unique game number
   uint32_t                       m_EntryKey;                      // random entry key for LAN, used to prove that a player is actually joining from LAN
   uint32_t                       m_Latency;                       // the number of ms to wait between sending action packets (we queue any received during this time)
   uint32_t                       m_SyncLimit;                     // the maximum number of packets a player can fall out of sync before starting the lag screen
+  uint32_t                       m_AutoKickPing;                  // copy of the config value, the game's thread never reads CAura's (see SetConfigs)
+  uint32_t                       m_VoteKickPercentage;            // copy of the config value
+  int32_t                        m_CommandTrigger;                // copy of the config value
   uint32_t                       m_SyncCounter;                   // the number of actions sent so far (for determining if anyone is lagging)
   uint32_t                       m_DownloadCounter;               // # of map bytes downloaded in the last second
   uint32_t                       m_CountDownCounter;              // the countdown is finished when this reaches zero
@@ -117,6 +141,7 @@ protected:
   bool                           m_GameLoaded;                    // if the game has loaded or not
   bool                           m_Lagging;                       // if the lag screen is active or not
   bool                           m_Desynced;                      // if the game has desynced or not
+  bool                           m_LCPings;                       // copy of the config value
 
 public:
   CGame(CAura* nAura, CMap* nMap, uint16_t nHostPort, uint8_t nGameState, std::string& nGameName, std::string& nOwnerName, std::string& nCreatorName, CBNET* nCreatorServer);
@@ -136,14 +161,17 @@ public:
   inline std::string    GetCreatorName() const { return m_CreatorName; }
   inline CBNET*         GetCreatorServer() const { return m_CreatorServer; }
   inline uint32_t       GetHostCounter() const { return m_HostCounter; }
+  inline CGameWorker*   GetWorker() const { return m_Worker; }
+  inline const std::map<uint8_t, uint32_t>& GetReconnectKeys() const { return m_ReconnectKeys; }
   inline int64_t        GetLastLagScreenTime() const { return m_LastLagScreenTime; }
   inline bool           GetLocked() const { return m_Locked; }
   inline bool           GetCountDownStarted() const { return m_CountDownStarted; }
   inline bool           GetGameLoading() const { return m_GameLoading; }
   inline bool           GetGameLoaded() const { return m_GameLoaded; }
   inline bool           GetLagging() const { return m_Lagging; }
+  inline CTimerWheel*   GetTimers() const { return m_Timers; }
 
-  int64_t     GetNextTimedActionTicks() const;
+  int64_t     GetNextTimedActionMicroTicks() const;
   uint32_t    GetSlotsOccupied() const;
   uint32_t    GetSlotsOpen() const;
   uint32_t    GetNumPlayers() const;
@@ -151,15 +179,19 @@ public:
   std::string GetDescription() const;
   std::string GetPlayers() const;
   std::string GetObservers() const;
+  std::string GetActionJitter() const;
+  std::string GetSendStats() const;
+
+  const std::vector<uint8_t>& GetLANGameInfo();
 
   inline void SetExiting(bool nExiting) { m_Exiting = nExiting; }
   inline void SetRefreshError(bool nRefreshError) { m_RefreshError = nRefreshError; }
 
   // processing functions
 
-  uint32_t SetFD(void* fd, void* send_fd, int32_t* nfds);
-  bool Update(void* fd, void* send_fd);
-  void UpdatePost(void* send_fd);
+  bool Update();
+  void UpdatePost();
+  void Flush();
 
   // generic functions to send packets to players
 
@@ -167,6 +199,7 @@ public:
   void Send(uint8_t PID, const std::vector<uint8_t>& data);
   void Send(const std::vector<uint8_t>& PIDs, const std::vector<uint8_t>& data);
   void SendAll(const std::vector<uint8_t>& data);
+  void SendAll(std::vector<uint8_t>&& data);
 
   // functions to send packets to players
 
@@ -182,7 +215,7 @@ public:
   void SendAllActions();
 
   // events
-  // note: these are only called while iterating through the m_Potentials or m_Players std::vectors
+  // note: these are only called while iterating through CAura's m_Potentials or the m_Players std::vector
   // therefore you can't modify those std::vectors and must use the player's m_DeleteMe member to flag for deletion
 
   void EventPlayerDeleted(CGamePlayer* player);
@@ -192,10 +225,11 @@ public:
   void EventPlayerJoined(CPotentialPlayer* potential, CIncomingJoinPlayer* joinPlayer);
   void EventPlayerLeft(CGamePlayer* player, uint32_t reason);
   void EventPlayerLoaded(CGamePlayer* player);
-  void EventPlayerAction(CGamePlayer* player, CIncomingAction* action);
+  void EventPlayerAction(CGamePlayer* player, const CIncomingAction& action);
   void EventPlayerKeepAlive(CGamePlayer* player);
   void EventPlayerChatToHost(CGamePlayer* player, CIncomingChatPlayer* chatPlayer);
-  bool EventPlayerBotCommand(CGamePlayer* player, std::string& command, std::string& payload);
+  void EventPlayerBotCommand(CGamePlayer* player, const std::string& command, const std::string& payload);
+  void ExecutePlayerBotCommand(CGamePlayer* player, const std::string& command, const std::string& payload, bool adminCheck, bool rootAdminCheck);
   void EventPlayerChangeTeam(CGamePlayer* player, uint8_t team);
   void EventPlayerChangeColour(CGamePlayer* player, uint8_t colour);
   void EventPlayerChangeRace(CGamePlayer* player, uint8_t race);
@@ -209,6 +243,19 @@ public:
   void EventGameStarted();
   void EventGameLoaded();
 
+  // timer events
+  // note: these are called while the timers are advanced at the start of Update and each one reschedules its own timer if it should fire again
+
+  void EventPingTimer();
+  void EventBroadcastTimer();
+  void EventRefreshTimer();
+  void EventLobbyTimer();
+  void EventDownloadTimer();
+  void EventCountDownTimer();
+  void EventLagScreenTimer();
+  void EventKickVoteTimer();
+  void EventGameOverTimer();
+
   // other functions
 
   uint8_t GetSIDFromPID(uint8_t PID) const;
@@ -246,6 +293,13 @@ public:
   void DeleteVirtualHost();
   void CreateFakePlayer();
   void DeleteFakePlayers();
+
+  // game worker functions
+
+  void SetWorker(CGameWorker* worker);
+  void SetPoller(CPoller* poller);
+  void SetConfigs(uint32_t autoKickPing, uint32_t voteKickPercentage, int32_t commandTrigger, bool lcPings);
+  void QueryMain(std::function<std::string()> query, std::function<void(CGame*, const std::string&)> reply);
 };
 
 #endif // AURA_GAME_H_
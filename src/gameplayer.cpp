@@ -34,9 +34,10 @@ using namespace std;
 // CPotentialPlayer
 //
 
-CPotentialPlayer::CPotentialPlayer(CGameProtocol* nProtocol, CGame* nGame, CTCPSocket* nSocket)
+CPotentialPlayer::CPotentialPlayer(CGameProtocol* nProtocol, CAura* nAura, CTCPSocket* nSocket)
   : m_Protocol(nProtocol),
-    m_Game(nGame),
+    m_Aura(nAura),
+    m_Game(nullptr),
     m_Socket(nSocket),
     m_IncomingJoinPlayer(nullptr),
     m_DeleteMe(false)
@@ -51,7 +52,7 @@ CPotentialPlayer::~CPotentialPlayer()
   delete m_IncomingJoinPlayer;
 }
 
-bool CPotentialPlayer::Update(void* fd)
+bool CPotentialPlayer::Update()
 {
   if (m_DeleteMe)
     return true;
@@ -59,13 +60,15 @@ bool CPotentialPlayer::Update(void* fd)
   if (!m_Socket)
     return false;
 
-  m_Socket->DoRecv(static_cast<fd_set*>(fd));
+  m_Socket->DoRecv();
 
   // extract as many packets as possible from the socket's receive buffer and process them
 
-  string*              RecvBuffer      = m_Socket->GetBytes();
-  std::vector<uint8_t> Bytes           = CreateByteArray((uint8_t*)RecvBuffer->c_str(), RecvBuffer->size());
-  uint32_t             LengthProcessed = 0;
+  // the packets are parsed in place so nothing may touch the receive buffer until we're done with Bytes
+
+  CByteBuffer* RecvBuffer      = m_Socket->GetBytes();
+  CByteView    Bytes           = CByteView(RecvBuffer->GetData(), RecvBuffer->GetSize());
+  uint32_t     LengthProcessed = 0;
 
   // a packet is at least 4 bytes so loop as long as the buffer contains 4 bytes
 
@@ -75,35 +78,37 @@ bool CPotentialPlayer::Update(void* fd)
     {
       // bytes 2 and 3 contain the length of the packet
 
-      const uint16_t             Length = ByteArrayToUInt16(Bytes, false, 2);
-      const std::vector<uint8_t> Data   = std::vector<uint8_t>(begin(Bytes), begin(Bytes) + Length);
+      const uint16_t Length = ByteArrayToUInt16(Bytes, false, 2);
 
-      if (Bytes.size() >= Length)
+      if (Length >= 4 && Bytes.size() >= Length)
       {
+        const CByteView Data = Bytes.SubView(0, Length);
+
         if (Bytes[0] == W3GS_HEADER_CONSTANT && Bytes[1] == CGameProtocol::W3GS_REQJOIN)
         {
           delete m_IncomingJoinPlayer;
           m_IncomingJoinPlayer = m_Protocol->RECEIVE_W3GS_REQJOIN(Data);
 
           if (m_IncomingJoinPlayer)
-            m_Game->EventPlayerJoined(this, m_IncomingJoinPlayer);
+            m_Aura->EventPlayerJoined(this, m_IncomingJoinPlayer);
 
           // this is the packet which int32_terests us for now, the remainder is left for CGamePlayer
 
           LengthProcessed += Length;
-          Bytes = std::vector<uint8_t>(begin(Bytes) + Length, end(Bytes));
           break;
         }
 
         LengthProcessed += Length;
-        Bytes = std::vector<uint8_t>(begin(Bytes) + Length, end(Bytes));
+        Bytes = Bytes.SubView(Length);
       }
       else
         break;
     }
+    else
+      break;
   }
 
-  *RecvBuffer = RecvBuffer->substr(LengthProcessed);
+  RecvBuffer->Consume(LengthProcessed);
 
   // don't call DoSend here because some other players may not have updated yet and may generate a packet for this player
   // also m_Socket may have been set to nullptr during ProcessPackets but we're banking on the fact that m_DeleteMe has been set to true as well so it'll short circuit before dereferencing
@@ -141,7 +146,9 @@ CGamePlayer::CGamePlayer(CPotentialPlayer* potential, uint8_t nPID, string nJoin
     m_StartedLaggingTicks(0),
     m_LastGProxyWaitNoticeSentTime(0),
     m_GProxyReconnectKey(GetTicks()),
-    m_LastGProxyAckTime(0),
+    m_WhoisTimer([this]() { EventWhoisTimer(); }),
+    m_TimeoutTimer([this]() { EventTimeoutTimer(); }),
+    m_GProxyAckTimer([this]() { EventGProxyAckTimer(); }),
     m_PID(nPID),
     m_Spoofed(false),
     m_Reserved(nReserved),
@@ -160,6 +167,8 @@ CGamePlayer::CGamePlayer(CPotentialPlayer* potential, uint8_t nPID, string nJoin
     m_GProxyDisconnectNoticeSent(false),
     m_DeleteMe(false)
 {
+  m_Game->GetTimers()->Schedule(&m_WhoisTimer, 4000);
+  m_Game->GetTimers()->Schedule(&m_TimeoutTimer, 30000);
 }
 
 CGamePlayer::~CGamePlayer()
@@ -187,56 +196,20 @@ uint32_t CGamePlayer::GetPing(bool LCPing) const
     return AvgPing;
 }
 
-bool CGamePlayer::Update(void* fd)
+bool CGamePlayer::Update()
 {
-  const int64_t Time = GetTime();
-
-  // wait 4 seconds after joining before sending the /whois or /w
-  // if we send the /whois too early battle.net may not have caught up with where the player is and return erroneous results
-
-  if (m_WhoisShouldBeSent && !m_Spoofed && !m_WhoisSent && !m_JoinedRealm.empty() && Time - m_JoinTime >= 4)
-  {
-    for (auto& bnet : m_Game->m_Aura->m_BNETs)
-    {
-      if (bnet->GetServer() == m_JoinedRealm)
-      {
-        if (m_Game->GetGameState() == GAME_PUBLIC || bnet->GetPvPGN())
-          bnet->QueueChatCommand("/whois " + m_Name);
-        else if (m_Game->GetGameState() == GAME_PRIVATE)
-          bnet->QueueChatCommand(R"(Spoof check by replying to this message with "sc" [ /r sc ])", m_Name, true, string());
-      }
-    }
-
-    m_WhoisSent = true;
-  }
-
-  // check for socket timeouts
-  // if we don't receive anything from a player for 30 seconds we can assume they've dropped
-  // this works because in the lobby we send pings every 5 seconds and expect a response to each one
-  // and in the game the Warcraft 3 client sends keepalives frequently (at least once per second it looks like)
-
-  if (m_Socket && Time - m_Socket->GetLastRecv() >= 30)
-    m_Game->EventPlayerDisconnectTimedOut(this);
-
-  // GProxy++ acks
-
-  if (m_GProxy && Time - m_LastGProxyAckTime >= 10)
-  {
-    m_Socket->PutBytes(m_Game->m_Aura->m_GPSProtocol->SEND_GPSS_ACK(m_TotalPacketsReceived));
-    m_LastGProxyAckTime = Time;
-  }
-
-  m_Socket->DoRecv(static_cast<fd_set*>(fd));
+  m_Socket->DoRecv();
 
   // extract as many packets as possible from the socket's receive buffer and process them
 
-  string*              RecvBuffer      = m_Socket->GetBytes();
-  std::vector<uint8_t> Bytes           = CreateByteArray((uint8_t*)RecvBuffer->c_str(), RecvBuffer->size());
-  uint32_t             LengthProcessed = 0;
+  // the packets are parsed in place so nothing may touch the receive buffer until we're done with Bytes
+
+  CByteBuffer* RecvBuffer      = m_Socket->GetBytes();
+  CByteView    Bytes           = CByteView(RecvBuffer->GetData(), RecvBuffer->GetSize());
+  uint32_t     LengthProcessed = 0;
 
   // a packet is at least 4 bytes so loop as long as the buffer contains 4 bytes
 
-  CIncomingAction*     Action;
   CIncomingChatPlayer* ChatPlayer;
   CIncomingMapSize*    MapSize;
   uint32_t             Pong;
@@ -245,15 +218,16 @@ bool CGamePlayer::Update(void* fd)
   {
     // bytes 2 and 3 contain the length of the packet
 
-    const uint16_t             Length = ByteArrayToUInt16(Bytes, false, 2);
-    const std::vector<uint8_t> Data   = std::vector<uint8_t>(begin(Bytes), begin(Bytes) + Length);
+    const uint16_t Length = ByteArrayToUInt16(Bytes, false, 2);
 
     if (Bytes[0] == W3GS_HEADER_CONSTANT)
     {
       ++m_TotalPacketsReceived;
 
-      if (Bytes.size() >= Length)
+      if (Length >= 4 && Bytes.size() >= Length)
       {
+        const CByteView Data = Bytes.SubView(0, Length);
+
         // byte 1 contains the packet ID
 
         switch (Bytes[1])
@@ -276,14 +250,16 @@ bool CGamePlayer::Update(void* fd)
             break;
 
           case CGameProtocol::W3GS_OUTGOING_ACTION:
-            Action = m_Protocol->RECEIVE_W3GS_OUTGOING_ACTION(Data, m_PID);
+          {
+            // the action points into our receive buffer, the game copies it into its action buffer
 
-            if (Action)
-              m_Game->EventPlayerAction(this, Action);
+            const CIncomingAction Action = m_Protocol->RECEIVE_W3GS_OUTGOING_ACTION(Data, m_PID);
 
-            // don't delete Action here because the game is going to store it in a queue and delete it later
+            if (Action.GetValid())
+              m_Game->EventPlayerAction(this, Action);
 
             break;
+          }
 
           case CGameProtocol::W3GS_OUTGOING_KEEPALIVE:
             m_CheckSums.push(m_Protocol->RECEIVE_W3GS_OUTGOING_KEEPALIVE(Data));
@@ -348,7 +324,7 @@ bool CGamePlayer::Update(void* fd)
         }
 
         LengthProcessed += Length;
-        Bytes = std::vector<uint8_t>(begin(Bytes) + Length, end(Bytes));
+        Bytes = Bytes.SubView(Length);
       }
       else
         break;
@@ -359,9 +335,9 @@ bool CGamePlayer::Update(void* fd)
       {
         if (Bytes.size() >= Length)
         {
-          if (Bytes[1] == CGPSProtocol::GPS_ACK && Data.size() == 8)
+          if (Bytes[1] == CGPSProtocol::GPS_ACK && Length == 8)
           {
-            const uint32_t LastPacket             = ByteArrayToUInt32(Data, false, 4);
+            const uint32_t LastPacket             = ByteArrayToUInt32(Bytes, false, 4);
             const uint32_t PacketsAlreadyUnqueued = m_TotalPacketsSent - m_GProxyBuffer.size();
 
             if (LastPacket > PacketsAlreadyUnqueued)
@@ -381,20 +357,23 @@ bool CGamePlayer::Update(void* fd)
           else if (Bytes[1] == CGPSProtocol::GPS_INIT)
           {
             m_GProxy = true;
+            m_Game->GetTimers()->Schedule(&m_GProxyAckTimer, 0);
             m_Socket->PutBytes(m_Game->m_Aura->m_GPSProtocol->SEND_GPSS_INIT(m_Game->m_Aura->m_ReconnectPort, m_PID, m_GProxyReconnectKey, m_Game->GetGProxyEmptyActions()));
             Print("[GAME: " + m_Game->GetGameName() + "] player [" + m_Name + "] is using GProxy++");
           }
         }
 
         LengthProcessed += Length;
-        Bytes = std::vector<uint8_t>(begin(Bytes) + Length, end(Bytes));
+        Bytes = Bytes.SubView(Length);
       }
       else
         break;
     }
+    else
+      break;
   }
 
-  *RecvBuffer = RecvBuffer->substr(LengthProcessed);
+  RecvBuffer->Consume(LengthProcessed);
 
   // try to find out why we're requesting deletion
   // in cases other than the ones covered here m_LeftReason should have been set when m_DeleteMe was set
@@ -425,6 +404,63 @@ bool CGamePlayer::Update(void* fd)
   return false;
 }
 
+void CGamePlayer::EventWhoisTimer()
+{
+  // we wait 4 seconds after joining before sending the /whois or /w
+  // if we send the /whois too early battle.net may not have caught up with where the player is and return erroneous results
+
+  if (m_WhoisShouldBeSent && !m_Spoofed && !m_WhoisSent && !m_JoinedRealm.empty())
+  {
+    // the game might have started already and be updated by a game worker thread so queue the messages on the main thread
+
+    CAura* const  Aura        = m_Game->m_Aura;
+    const string  JoinedRealm = m_JoinedRealm;
+    const string  Name        = m_Name;
+    const uint8_t GameState   = m_Game->GetGameState();
+
+    Aura->RunOnMain([Aura, JoinedRealm, Name, GameState]() {
+      for (auto& bnet : Aura->m_BNETs)
+      {
+        if (bnet->GetServer() == JoinedRealm)
+        {
+          if (GameState == GAME_PUBLIC || bnet->GetPvPGN())
+            bnet->QueueChatCommand("/whois " + Name);
+          else if (GameState == GAME_PRIVATE)
+            bnet->QueueChatCommand(R"(Spoof check by replying to this message with "sc" [ /r sc ])", Name, true, string());
+        }
+      }
+    });
+
+    m_WhoisSent = true;
+  }
+}
+
+void CGamePlayer::EventTimeoutTimer()
+{
+  // check for socket timeouts
+  // if we don't receive anything from a player for 30 seconds we can assume they've dropped
+  // this works because in the lobby we send pings every 5 seconds and expect a response to each one
+  // and in the game the Warcraft 3 client sends keepalives frequently (at least once per second it looks like)
+
+  const int64_t SinceLastRecv = m_Socket ? GetTime() - m_Socket->GetLastRecv() : 0;
+
+  if (SinceLastRecv >= 30)
+  {
+    // the game decides what to do about it (e.g. wait for a GProxy++ reconnect) so keep telling it every second until something changes
+
+    m_Game->EventPlayerDisconnectTimedOut(this);
+    m_Game->GetTimers()->Schedule(&m_TimeoutTimer, 1000);
+  }
+  else
+    m_Game->GetTimers()->Schedule(&m_TimeoutTimer, (30 - SinceLastRecv) * 1000);
+}
+
+void CGamePlayer::EventGProxyAckTimer()
+{
+  m_Socket->PutBytes(m_Game->m_Aura->m_GPSProtocol->SEND_GPSS_ACK(m_TotalPacketsReceived));
+  m_Game->GetTimers()->Schedule(&m_GProxyAckTimer, 10000);
+}
+
 void CGamePlayer::Send(const std::vector<uint8_t>& data)
 {
   // must start counting packet total from beginning of connection
@@ -434,9 +470,27 @@ void CGamePlayer::Send(const std::vector<uint8_t>& data)
   ++m_TotalPacketsSent;
 
   if (m_GProxy && m_Game->GetGameLoaded())
-    m_GProxyBuffer.push(data);
+  {
+    // the packet has to be kept around anyway so share it with the send queue instead of copying it twice
+
+    const CSharedPacket Packet = make_shared<const std::vector<uint8_t>>(data);
+    m_GProxyBuffer.push(Packet);
+    m_Socket->PutPacket(Packet);
+  }
+  else
+    m_Socket->PutBytes(data);
+}
+
+void CGamePlayer::Send(const CSharedPacket& packet)
+{
+  // same as above but the packet is already shared (e.g. by CGame::SendAll) so we only keep references to it
+
+  ++m_TotalPacketsSent;
+
+  if (m_GProxy && m_Game->GetGameLoaded())
+    m_GProxyBuffer.push(packet);
 
-  m_Socket->PutBytes(data);
+  m_Socket->PutPacket(packet);
 }
 
 void CGamePlayer::EventGProxyReconnect(CTCPSocket* NewSocket, uint32_t LastPacket)
@@ -463,11 +517,11 @@ void CGamePlayer::EventGProxyReconnect(CTCPSocket* NewSocket, uint32_t LastPacke
 
   // send remaining packets from buffer, preserve buffer
 
-  queue<std::vector<uint8_t>> TempBuffer;
+  queue<CSharedPacket> TempBuffer;
 
   while (!m_GProxyBuffer.empty())
   {
-    m_Socket->PutBytes(m_GProxyBuffer.front());
+    m_Socket->PutPacket(m_GProxyBuffer.front());
     TempBuffer.push(m_GProxyBuffer.front());
     m_GProxyBuffer.pop();
   }
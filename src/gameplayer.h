@@ -22,9 +22,11 @@
 #define AURA_GAMEPLAYER_H_
 
 #include "socket.h"
+#include "timerwheel.h"
 
 #include <queue>
 
+class CAura;
 class CTCPSocket;
 class CGameProtocol;
 class CGame;
@@ -38,7 +40,8 @@ class CPotentialPlayer
 {
 public:
   CGameProtocol* m_Protocol;
-  CGame*         m_Game;
+  CAura*         m_Aura;
+  CGame*         m_Game; // the lobby this connection has been routed to (nullptr until it sends a W3GS_REQJOIN for a lobby that exists)
 
 protected:
   // note: we permit m_Socket to be NULL in this class to allow for the virtual host player which doesn't really exist
@@ -49,7 +52,7 @@ protected:
   bool                 m_DeleteMe;
 
 public:
-  CPotentialPlayer(CGameProtocol* nProtocol, CGame* nGame, CTCPSocket* nSocket);
+  CPotentialPlayer(CGameProtocol* nProtocol, CAura* nAura, CTCPSocket* nSocket);
   ~CPotentialPlayer();
 
   inline CTCPSocket*          GetSocket() const { return m_Socket; }
@@ -63,7 +66,7 @@ public:
 
   // processing functions
 
-  bool Update(void* fd);
+  bool Update();
 
   // other functions
 
@@ -87,7 +90,7 @@ private:
   std::vector<uint8_t>             m_InternalIP;                   // the player's internal IP address as reported by the player when connecting
   std::vector<uint32_t>            m_Pings;                        // store the last few (10) pings received so we can take an average
   std::queue<uint32_t>             m_CheckSums;                    // the last few checksums the player has sent (for detecting desyncs)
-  std::queue<std::vector<uint8_t>> m_GProxyBuffer;                 // buffer with data used with GProxy++
+  std::queue<CSharedPacket>        m_GProxyBuffer;                 // buffer with data used with GProxy++ (shared with the socket's send queue)
   std::string                      m_LeftReason;                   // the reason the player left the game
   std::string                      m_SpoofedRealm;                 // the realm the player last spoof checked :wq
   std::string                      m_JoinedRealm;                  // the realm the player joined on (probable, can be spoofed)
@@ -96,7 +99,7 @@ private:
   uint32_t                         m_TotalPacketsReceived;         // the total number of packets received from the player
   uint32_t                         m_LeftCode;                     // the code to be sent in W3GS_PLAYERLEAVE_OTHERS for why this player left the game
   uint32_t                         m_SyncCounter;                  // the number of keepalive packets received from this player
-  int64_t                          m_JoinTime;                     // GetTime when the player joined the game (used to delay sending the /whois a few seconds to allow for some lag)
+  int64_t                          m_JoinTime;                     // GetTime when the player joined the game
   uint32_t                         m_LastMapPartSent;              // the last mappart sent to the player (for sending more than one part at a time)
   uint32_t                         m_LastMapPartAcked;             // the last mappart acknowledged by the player
   int64_t                          m_StartedDownloadingTicks;      // GetTicks when the player started downloading the map
@@ -105,7 +108,9 @@ private:
   int64_t                          m_StartedLaggingTicks;          // GetTicks when the player started laggin
   int64_t                          m_LastGProxyWaitNoticeSentTime; // GetTime when the last disconnection notice has been sent when using GProxy++
   uint32_t                         m_GProxyReconnectKey;           // the GProxy++ reconnect key
-  int64_t                          m_LastGProxyAckTime;            // GetTime when we last acknowledged GProxy++ packet
+  CTimer                           m_WhoisTimer;                   // sends the /whois 4 seconds after joining (to allow battle.net to catch up with where the player is)
+  CTimer                           m_TimeoutTimer;                 // checks if we haven't received anything from the player for 30 seconds
+  CTimer                           m_GProxyAckTimer;               // acknowledges the GProxy++ packets received every 10 seconds
   uint8_t                          m_PID;                          // the player's PID
   bool                             m_Spoofed;                      // if the player has spoof checked or not
   bool                             m_Reserved;                     // if the player is reserved (VIP) or not
@@ -197,11 +202,18 @@ public:
 
   // processing functions
 
-  bool Update(void* fd);
+  bool Update();
+
+  // timer events (see CGame for when they're called)
+
+  void EventWhoisTimer();
+  void EventTimeoutTimer();
+  void EventGProxyAckTimer();
 
   // other functions
 
   void Send(const std::vector<uint8_t>& data);
+  void Send(const CSharedPacket& packet);
   void EventGProxyReconnect(CTCPSocket* NewSocket, uint32_t LastPacket);
 };
 
@@ -45,7 +45,7 @@ CGameProtocol::~CGameProtocol() = default;
 // RECEIVE FUNCTIONS //
 ///////////////////////
 
-CIncomingJoinPlayer* CGameProtocol::RECEIVE_W3GS_REQJOIN(const std::vector<uint8_t>& data)
+CIncomingJoinPlayer* CGameProtocol::RECEIVE_W3GS_REQJOIN(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED W3GS_REQJOIN" );
   // DEBUG_Print( data );
@@ -78,7 +78,7 @@ CIncomingJoinPlayer* CGameProtocol::RECEIVE_W3GS_REQJOIN(const std::vector<uint8
   return nullptr;
 }
 
-uint32_t CGameProtocol::RECEIVE_W3GS_LEAVEGAME(const std::vector<uint8_t>& data)
+uint32_t CGameProtocol::RECEIVE_W3GS_LEAVEGAME(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED W3GS_LEAVEGAME" );
   // DEBUG_Print( data );
@@ -93,7 +93,7 @@ uint32_t CGameProtocol::RECEIVE_W3GS_LEAVEGAME(const std::vector<uint8_t>& data)
   return 0;
 }
 
-bool CGameProtocol::RECEIVE_W3GS_GAMELOADED_SELF(const std::vector<uint8_t>& data)
+bool CGameProtocol::RECEIVE_W3GS_GAMELOADED_SELF(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED W3GS_GAMELOADED_SELF" );
   // DEBUG_Print( data );
@@ -107,7 +107,7 @@ bool CGameProtocol::RECEIVE_W3GS_GAMELOADED_SELF(const std::vector<uint8_t>& dat
   return false;
 }
 
-CIncomingAction* CGameProtocol::RECEIVE_W3GS_OUTGOING_ACTION(const std::vector<uint8_t>& data, uint8_t PID)
+CIncomingAction CGameProtocol::RECEIVE_W3GS_OUTGOING_ACTION(const CByteView& data, uint8_t PID)
 {
   // DEBUG_Print( "RECEIVED W3GS_OUTGOING_ACTION" );
   // DEBUG_Print( data );
@@ -118,16 +118,12 @@ CIncomingAction* CGameProtocol::RECEIVE_W3GS_OUTGOING_ACTION(const std::vector<u
   // remainder of packet		-> Action
 
   if (PID != 255 && ValidateLength(data) && data.size() >= 8)
-  {
-    const std::vector<uint8_t> CRC    = std::vector<uint8_t>(begin(data) + 4, begin(data) + 8);
-    const std::vector<uint8_t> Action = std::vector<uint8_t>(begin(data) + 8, end(data));
-    return new CIncomingAction(PID, CRC, Action);
-  }
+    return CIncomingAction(PID, data.SubView(4, 4), data.SubView(8));
 
-  return nullptr;
+  return CIncomingAction();
 }
 
-uint32_t CGameProtocol::RECEIVE_W3GS_OUTGOING_KEEPALIVE(const std::vector<uint8_t>& data)
+uint32_t CGameProtocol::RECEIVE_W3GS_OUTGOING_KEEPALIVE(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED W3GS_OUTGOING_KEEPALIVE" );
   // DEBUG_Print( data );
@@ -143,7 +139,7 @@ uint32_t CGameProtocol::RECEIVE_W3GS_OUTGOING_KEEPALIVE(const std::vector<uint8_
   return 0;
 }
 
-CIncomingChatPlayer* CGameProtocol::RECEIVE_W3GS_CHAT_TO_HOST(const std::vector<uint8_t>& data)
+CIncomingChatPlayer* CGameProtocol::RECEIVE_W3GS_CHAT_TO_HOST(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED W3GS_CHAT_TO_HOST" );
   // DEBUG_Print( data );
@@ -210,7 +206,7 @@ CIncomingChatPlayer* CGameProtocol::RECEIVE_W3GS_CHAT_TO_HOST(const std::vector<
   return nullptr;
 }
 
-CIncomingMapSize* CGameProtocol::RECEIVE_W3GS_MAPSIZE(const std::vector<uint8_t>& data)
+CIncomingMapSize* CGameProtocol::RECEIVE_W3GS_MAPSIZE(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED W3GS_MAPSIZE" );
   // DEBUG_Print( data );
@@ -227,7 +223,7 @@ CIncomingMapSize* CGameProtocol::RECEIVE_W3GS_MAPSIZE(const std::vector<uint8_t>
   return nullptr;
 }
 
-uint32_t CGameProtocol::RECEIVE_W3GS_PONG_TO_HOST(const std::vector<uint8_t>& data)
+uint32_t CGameProtocol::RECEIVE_W3GS_PONG_TO_HOST(const CByteView& data)
 {
   // DEBUG_Print( "RECEIVED W3GS_PONG_TO_HOST" );
   // DEBUG_Print( data );
@@ -246,6 +242,25 @@ uint32_t CGameProtocol::RECEIVE_W3GS_PONG_TO_HOST(const std::vector<uint8_t>& da
   return 1;
 }
 
+uint32_t CGameProtocol::RECEIVE_W3GS_SEARCHGAME(const CByteView& data)
+{
+  // DEBUG_Print( "RECEIVED W3GS_SEARCHGAME" );
+  // DEBUG_Print( data );
+
+  // 2 bytes					-> Header
+  // 2 bytes					-> Length
+  // 4 bytes					-> Product ID ("PX3W" or "3RAW")
+  // 4 bytes					-> Version
+  // 4 bytes					-> Host Counter (always zero when searching)
+
+  // returns the version the client is searching for (it only lists games of that version)
+
+  if (ValidateLength(data) && data.size() >= 16)
+    return ByteArrayToUInt32(data, false, 8);
+
+  return 0;
+}
+
 ////////////////////
 // SEND FUNCTIONS //
 ////////////////////
@@ -378,39 +393,25 @@ std::vector<uint8_t> CGameProtocol::SEND_W3GS_COUNTDOWN_END()
   return std::vector<uint8_t>{W3GS_HEADER_CONSTANT, W3GS_COUNTDOWN_END, 4, 0};
 }
 
-std::vector<uint8_t> CGameProtocol::SEND_W3GS_INCOMING_ACTION(queue<CIncomingAction*> actions, uint16_t sendInterval)
+std::vector<uint8_t> CGameProtocol::SEND_W3GS_INCOMING_ACTION(const CByteView& actions, uint16_t sendInterval)
 {
-  std::vector<uint8_t> packet = {W3GS_HEADER_CONSTANT, W3GS_INCOMING_ACTION, 0, 0};
-  AppendByteArray(packet, sendInterval, false); // send int32_terval
-
-  // create subpacket
-
-  if (!actions.empty())
-  {
-    std::vector<uint8_t> subpacket;
-
-    do
-    {
-      CIncomingAction* Action = actions.front();
-      actions.pop();
-      subpacket.push_back(Action->GetPID());
-      AppendByteArray(subpacket, static_cast<uint16_t>(Action->GetAction()->size()), false);
-      AppendByteArrayFast(subpacket, *Action->GetAction());
-    } while (!actions.empty());
-
-    // calculate crc (we only care about the first 2 bytes though)
-
-    std::vector<uint8_t> crc32 = CreateByteArray(m_Aura->m_CRC->CalculateCRC((uint8_t*)string(begin(subpacket), end(subpacket)).c_str(), subpacket.size()), false);
-    crc32.resize(2);
-
-    // finish subpacket
+  std::vector<uint8_t> packet;
+  SEND_W3GS_INCOMING_ACTION(packet, actions, sendInterval);
+  return packet;
+}
 
-    AppendByteArrayFast(packet, crc32);     // crc
-    AppendByteArrayFast(packet, subpacket); // subpacket
-  }
+void CGameProtocol::SEND_W3GS_INCOMING_ACTION(std::vector<uint8_t>& packet, const CByteView& actions, uint16_t sendInterval)
+{
+  // the packet is built in place so the caller can reuse the same buffer every action interval
 
+  packet.clear();
+  packet.push_back(W3GS_HEADER_CONSTANT);
+  packet.push_back(W3GS_INCOMING_ACTION);
+  packet.push_back(0);
+  packet.push_back(0);
+  AppendByteArray(packet, sendInterval, false); // send int32_terval
+  AppendActions(packet, actions);
   AssignLength(packet);
-  return packet;
 }
 
 std::vector<uint8_t> CGameProtocol::SEND_W3GS_CHAT_FROM_HOST(uint8_t fromPID, const std::vector<uint8_t>& toPIDs, uint8_t flag, const std::vector<uint8_t>& flagExtra, const string& message)
@@ -552,82 +553,70 @@ std::vector<uint8_t> CGameProtocol::SEND_W3GS_STARTDOWNLOAD(uint8_t fromPID)
   return std::vector<uint8_t>{W3GS_HEADER_CONSTANT, W3GS_STARTDOWNLOAD, 9, 0, 1, 0, 0, 0, fromPID};
 }
 
-std::vector<uint8_t> CGameProtocol::SEND_W3GS_MAPPART(uint8_t fromPID, uint8_t toPID, uint32_t start, const string* mapData)
+void CGameProtocol::SEND_W3GS_MAPPART(std::vector<uint8_t>& packet, uint8_t fromPID, uint8_t toPID, uint32_t start, const CByteView& mapPart, uint32_t mapPartCRC)
 {
-  if (start < mapData->size())
-  {
-    std::vector<uint8_t> packet = {W3GS_HEADER_CONSTANT, W3GS_MAPPART, 0, 0, toPID, fromPID, 1, 0, 0, 0};
-    AppendByteArray(packet, start, false); // start position
-
-    // calculate end position (don't send more than 1442 map bytes in one packet)
-
-    uint32_t End = start + 1442;
+  // the map part and its crc come from CMap (see CMap::GetMapPart) so all that's left is filling in the header and copying the map bytes
+  // the packet is built in place so the caller can reuse the same buffer for every part
 
-    if (End > mapData->size())
-      End = mapData->size();
+  packet.clear();
 
-    // calculate crc
-
-    const std::vector<uint8_t> crc32 = CreateByteArray(m_Aura->m_CRC->CalculateCRC((uint8_t*)mapData->c_str() + start, End - start), false);
-    AppendByteArrayFast(packet, crc32);
-
-    // map data
-
-    const std::vector<uint8_t> data = CreateByteArray((uint8_t*)mapData->c_str() + start, End - start);
-    AppendByteArrayFast(packet, data);
-    AssignLength(packet);
-    return packet;
+  if (mapPart.empty())
+  {
+    Print("[GAMEPROTO] invalid parameters passed to SEND_W3GS_MAPPART");
+    return;
   }
 
-  Print("[GAMEPROTO] invalid parameters passed to SEND_W3GS_MAPPART");
-  return std::vector<uint8_t>();
+  packet.reserve(18 + mapPart.size());
+  packet.push_back(W3GS_HEADER_CONSTANT);
+  packet.push_back(W3GS_MAPPART);
+  packet.push_back(0);
+  packet.push_back(0);
+  packet.push_back(toPID);
+  packet.push_back(fromPID);
+  AppendByteArray(packet, static_cast<uint32_t>(1), false); // ???
+  AppendByteArray(packet, start, false);                    // start position
+  AppendByteArray(packet, mapPartCRC, false);               // crc
+  packet.insert(end(packet), begin(mapPart), end(mapPart)); // map data
+  AssignLength(packet);
 }
 
-std::vector<uint8_t> CGameProtocol::SEND_W3GS_INCOMING_ACTION2(queue<CIncomingAction*> actions)
+void CGameProtocol::SEND_W3GS_INCOMING_ACTION2(std::vector<uint8_t>& packet, const CByteView& actions)
 {
-  std::vector<uint8_t> packet = {W3GS_HEADER_CONSTANT, W3GS_INCOMING_ACTION2, 0, 0, 0, 0};
-
-  // create subpacket
-
-  if (!actions.empty())
-  {
-    std::vector<uint8_t> subpacket;
-
-    while (!actions.empty())
-    {
-      CIncomingAction* Action = actions.front();
-      actions.pop();
-      subpacket.push_back(Action->GetPID());
-      AppendByteArray(subpacket, static_cast<uint16_t>(Action->GetAction()->size()), false);
-      AppendByteArrayFast(subpacket, *Action->GetAction());
-    }
-
-    // calculate crc (we only care about the first 2 bytes though)
-
-    std::vector<uint8_t> crc32 = CreateByteArray(m_Aura->m_CRC->CalculateCRC((uint8_t*)string(begin(subpacket), end(subpacket)).c_str(), subpacket.size()), false);
-    crc32.resize(2);
-
-    // finish subpacket
-
-    AppendByteArrayFast(packet, crc32);     // crc
-    AppendByteArrayFast(packet, subpacket); // subpacket
-  }
-
+  packet.clear();
+  packet.push_back(W3GS_HEADER_CONSTANT);
+  packet.push_back(W3GS_INCOMING_ACTION2);
+  packet.push_back(0);
+  packet.push_back(0);
+  packet.push_back(0);
+  packet.push_back(0);
+  AppendActions(packet, actions);
   AssignLength(packet);
-  return packet;
 }
 
 /////////////////////
 // OTHER FUNCTIONS //
 /////////////////////
 
-bool CGameProtocol::ValidateLength(const std::vector<uint8_t>& content)
+bool CGameProtocol::ValidateLength(const CByteView& content)
 {
   // verify that bytes 3 and 4 (indices 2 and 3) of the content array describe the length
 
   return (static_cast<uint16_t>(content[3] << 8 | content[2]) == content.size());
 }
 
+void CGameProtocol::AppendActions(std::vector<uint8_t>& packet, const CByteView& actions)
+{
+  // the actions are already serialized (see CActionBuffer) so all that's left is the crc (we only care about the first 2 bytes though) followed by the actions themselves
+
+  if (actions.empty())
+    return;
+
+  const uint32_t CRC = m_Aura->m_CRC->CalculateCRC(actions.data(), actions.size());
+  packet.push_back(static_cast<uint8_t>(CRC));
+  packet.push_back(static_cast<uint8_t>(CRC >> 8));
+  packet.insert(end(packet), begin(actions), end(actions));
+}
+
 std::vector<uint8_t> CGameProtocol::EncodeSlotInfo(const vector<CGameSlot>& slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots)
 {
   std::vector<uint8_t> SlotInfo;
@@ -660,15 +649,45 @@ CIncomingJoinPlayer::~CIncomingJoinPlayer() = default;
 // CIncomingAction
 //
 
-CIncomingAction::CIncomingAction(uint8_t nPID, std::vector<uint8_t> nCRC, std::vector<uint8_t> nAction)
-  : m_CRC(std::move(nCRC)),
-    m_Action(std::move(nAction)),
+CIncomingAction::CIncomingAction()
+  : m_PID(255)
+{
+}
+
+CIncomingAction::CIncomingAction(uint8_t nPID, const CByteView& nCRC, const CByteView& nAction)
+  : m_CRC(nCRC),
+    m_Action(nAction),
     m_PID(nPID)
 {
 }
 
 CIncomingAction::~CIncomingAction() = default;
 
+//
+// CActionBuffer
+//
+
+CActionBuffer::CActionBuffer() = default;
+
+CActionBuffer::~CActionBuffer() = default;
+
+void CActionBuffer::Push(uint8_t PID, const CByteView& action)
+{
+  m_Offsets.push_back(m_Data.size());
+  m_Data.push_back(PID);
+  m_Data.push_back(static_cast<uint8_t>(action.size()));
+  m_Data.push_back(static_cast<uint8_t>(action.size() >> 8));
+  m_Data.insert(end(m_Data), begin(action), end(action));
+}
+
+void CActionBuffer::Clear()
+{
+  // clear() keeps the capacity around for the next action interval
+
+  m_Data.clear();
+  m_Offsets.clear();
+}
+
 //
 // CIncomingChatPlayer
 //
@@ -22,6 +22,7 @@
 #define AURA_GAMEPROTOCOL_H_
 
 #include "includes.h"
+#include "util.h"
 
 #include <queue>
 
@@ -56,6 +57,7 @@ class CAura;
 class CGamePlayer;
 class CIncomingJoinPlayer;
 class CIncomingAction;
+class CActionBuffer;
 class CIncomingChatPlayer;
 class CIncomingMapSize;
 class CGameSlot;
@@ -110,14 +112,15 @@ public:
 
   // receive functions
 
-  CIncomingJoinPlayer* RECEIVE_W3GS_REQJOIN(const std::vector<uint8_t>& data);
-  uint32_t RECEIVE_W3GS_LEAVEGAME(const std::vector<uint8_t>& data);
-  bool RECEIVE_W3GS_GAMELOADED_SELF(const std::vector<uint8_t>& data);
-  CIncomingAction* RECEIVE_W3GS_OUTGOING_ACTION(const std::vector<uint8_t>& data, uint8_t PID);
-  uint32_t RECEIVE_W3GS_OUTGOING_KEEPALIVE(const std::vector<uint8_t>& data);
-  CIncomingChatPlayer* RECEIVE_W3GS_CHAT_TO_HOST(const std::vector<uint8_t>& data);
-  CIncomingMapSize* RECEIVE_W3GS_MAPSIZE(const std::vector<uint8_t>& data);
-  uint32_t RECEIVE_W3GS_PONG_TO_HOST(const std::vector<uint8_t>& data);
+  CIncomingJoinPlayer* RECEIVE_W3GS_REQJOIN(const CByteView& data);
+  uint32_t RECEIVE_W3GS_LEAVEGAME(const CByteView& data);
+  bool RECEIVE_W3GS_GAMELOADED_SELF(const CByteView& data);
+  CIncomingAction RECEIVE_W3GS_OUTGOING_ACTION(const CByteView& data, uint8_t PID);
+  uint32_t RECEIVE_W3GS_OUTGOING_KEEPALIVE(const CByteView& data);
+  CIncomingChatPlayer* RECEIVE_W3GS_CHAT_TO_HOST(const CByteView& data);
+  CIncomingMapSize* RECEIVE_W3GS_MAPSIZE(const CByteView& data);
+  uint32_t RECEIVE_W3GS_PONG_TO_HOST(const CByteView& data);
+  uint32_t RECEIVE_W3GS_SEARCHGAME(const CByteView& data);
 
   // send functions
 
@@ -130,8 +133,9 @@ public:
   std::vector<uint8_t> SEND_W3GS_SLOTINFO(std::vector<CGameSlot>& slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots);
   std::vector<uint8_t> SEND_W3GS_COUNTDOWN_START();
   std::vector<uint8_t> SEND_W3GS_COUNTDOWN_END();
-  std::vector<uint8_t> SEND_W3GS_INCOMING_ACTION(std::queue<CIncomingAction*> actions, uint16_t sendInterval);
-  std::vector<uint8_t> SEND_W3GS_INCOMING_ACTION2(std::queue<CIncomingAction*> actions);
+  std::vector<uint8_t> SEND_W3GS_INCOMING_ACTION(const CByteView& actions, uint16_t sendInterval);
+  void SEND_W3GS_INCOMING_ACTION(std::vector<uint8_t>& packet, const CByteView& actions, uint16_t sendInterval);
+  void SEND_W3GS_INCOMING_ACTION2(std::vector<uint8_t>& packet, const CByteView& actions);
   std::vector<uint8_t> SEND_W3GS_CHAT_FROM_HOST(uint8_t fromPID, const std::vector<uint8_t>& toPIDs, uint8_t flag, const std::vector<uint8_t>& flagExtra, const std::string& message);
   std::vector<uint8_t> SEND_W3GS_START_LAG(std::vector<CGamePlayer*> players);
   std::vector<uint8_t> SEND_W3GS_STOP_LAG(CGamePlayer* player);
@@ -141,12 +145,13 @@ public:
   std::vector<uint8_t> SEND_W3GS_DECREATEGAME();
   std::vector<uint8_t> SEND_W3GS_MAPCHECK(const std::string& mapPath, const std::vector<uint8_t>& mapSize, const std::vector<uint8_t>& mapInfo, const std::vector<uint8_t>& mapCRC, const std::vector<uint8_t>& mapSHA1);
   std::vector<uint8_t> SEND_W3GS_STARTDOWNLOAD(uint8_t fromPID);
-  std::vector<uint8_t> SEND_W3GS_MAPPART(uint8_t fromPID, uint8_t toPID, uint32_t start, const std::string* mapData);
+  void SEND_W3GS_MAPPART(std::vector<uint8_t>& packet, uint8_t fromPID, uint8_t toPID, uint32_t start, const CByteView& mapPart, uint32_t mapPartCRC);
 
   // other functions
 
 private:
-  bool ValidateLength(const std::vector<uint8_t>& content);
+  bool ValidateLength(const CByteView& content);
+  void AppendActions(std::vector<uint8_t>& packet, const CByteView& actions);
   std::vector<uint8_t> EncodeSlotInfo(const std::vector<CGameSlot>& slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots);
 };
 
@@ -176,21 +181,53 @@ public:
 // CIncomingAction
 //
 
+// this only points into the player's receive buffer, CGame copies the action into its CActionBuffer before the buffer moves on
+
 class CIncomingAction
 {
 private:
-  std::vector<uint8_t> m_CRC;
-  std::vector<uint8_t> m_Action;
-  uint8_t              m_PID;
+  CByteView m_CRC;
+  CByteView m_Action;
+  uint8_t   m_PID;
 
 public:
-  CIncomingAction(uint8_t nPID, std::vector<uint8_t> nCRC, std::vector<uint8_t> nAction);
+  CIncomingAction();
+  CIncomingAction(uint8_t nPID, const CByteView& nCRC, const CByteView& nAction);
   ~CIncomingAction();
 
-  inline uint8_t               GetPID() const { return m_PID; }
-  inline std::vector<uint8_t>  GetCRC() const { return m_CRC; }
-  inline std::vector<uint8_t>* GetAction() { return &m_Action; }
-  inline uint32_t              GetLength() const { return m_Action.size() + 3; }
+  inline bool             GetValid() const { return m_PID != 255; }
+  inline uint8_t          GetPID() const { return m_PID; }
+  inline const CByteView& GetCRC() const { return m_CRC; }
+  inline const CByteView& GetAction() const { return m_Action; }
+  inline uint32_t         GetLength() const { return m_Action.size() + 3; }
+};
+
+//
+// CActionBuffer
+//
+
+// the actions queued during the current action interval, stored back to back in the W3GS_INCOMING_ACTION layout (PID, 2 byte length, action data)
+// the storage is cleared rather than freed after every interval so once it has grown to fit a busy interval queuing an action doesn't allocate
+
+class CActionBuffer
+{
+private:
+  std::vector<uint8_t>  m_Data;    // the serialized actions
+  std::vector<uint32_t> m_Offsets; // where each action starts in m_Data so the actions can be split over several packets
+
+public:
+  CActionBuffer();
+  ~CActionBuffer();
+  CActionBuffer(CActionBuffer&) = delete;
+
+  inline bool      GetEmpty() const { return m_Offsets.empty(); }
+  inline uint32_t  GetNumActions() const { return m_Offsets.size(); }
+  inline uint32_t  GetOffset(uint32_t i) const { return i < m_Offsets.size() ? m_Offsets[i] : m_Data.size(); }
+  inline CByteView GetActions(uint32_t start, uint32_t end) const { return CByteView(m_Data.data() + start, end - start); }
+  inline uint32_t  GetSize() const { return m_Data.size(); }
+
+  void Push(uint8_t PID, const CByteView& action);
+  void Clear();
 };
 
 //
@@ -0,0 +1,192 @@
+/*
+
+   Copyright [2010] [Josko Nikolic]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+ */
+
+#include "gameworker.h"
+#include "aura.h"
+#include "socket.h"
+#include "poller.h"
+#include "gameplayer.h"
+#include "gpsprotocol.h"
+#include "game.h"
+
+#include <algorithm>
+
+using namespace std;
+
+static thread_local CGameWorker* gCurrentWorker = nullptr;
+
+//
+// CJobQueue
+//
+
+CJobQueue::CJobQueue(CPoller* nPoller)
+  : m_Poller(nPoller)
+{
+}
+
+CJobQueue::~CJobQueue()
+{
+}
+
+void CJobQueue::Post(function<void()> job)
+{
+  {
+    lock_guard<mutex> Lock(m_Mutex);
+    m_Jobs.push_back(std::move(job));
+  }
+
+  m_Poller->Wake();
+}
+
+void CJobQueue::Run()
+{
+  // take the jobs out first so they can post more jobs (even to this queue) without deadlocking
+
+  vector<function<void()>> Jobs;
+
+  {
+    lock_guard<mutex> Lock(m_Mutex);
+    Jobs.swap(m_Jobs);
+  }
+
+  for (auto& job : Jobs)
+    job();
+}
+
+//
+// CGameWorker
+//
+
+CGameWorker::CGameWorker(CAura* nAura, CPoller* nPoller)
+  : m_Aura(nAura),
+    m_Poller(nPoller),
+    m_Jobs(nPoller),
+    m_Exiting(false)
+{
+  m_Thread = thread(&CGameWorker::Run, this);
+}
+
+CGameWorker::~CGameWorker()
+{
+  // the games are deleted by the main thread afterwards, we just take their sockets off our poller before it's gone
+  // anything still queued for this thread is thrown away
+
+  m_Exiting = true;
+  m_Poller->Wake();
+  m_Thread.join();
+
+  for (auto& game : m_Games)
+    game->SetPoller(nullptr);
+
+  delete m_Poller;
+}
+
+CGameWorker* CGameWorker::GetCurrent()
+{
+  return gCurrentWorker;
+}
+
+void CGameWorker::Run()
+{
+  gCurrentWorker = this;
+
+  while (!m_Exiting)
+  {
+    m_Jobs.Run();
+
+    // same as the main loop, block for at most 50 ms or until one of our games has to send its actions
+
+    int64_t usecBlock = 50000;
+
+    for (auto& game : m_Games)
+    {
+      if (game->GetNextTimedActionMicroTicks() < usecBlock)
+        usecBlock = game->GetNextTimedActionMicroTicks();
+    }
+
+    m_Poller->Wait(usecBlock);
+
+    for (auto i = begin(m_Games); i != end(m_Games);)
+    {
+      if ((*i)->Update())
+      {
+        // the game is over, hand it back to the main thread which saves it to the database when deleting it
+
+        CGame* Game = *i;
+        CAura* Aura = m_Aura;
+        Game->SetPoller(nullptr);
+        i = m_Games.erase(i);
+        m_Aura->RunOnMain([Aura, Game]() { Aura->DeleteGame(Game); });
+      }
+      else
+      {
+        (*i)->UpdatePost();
+        ++i;
+      }
+    }
+  }
+}
+
+void CGameWorker::Adopt(CGame* game)
+{
+  // the main thread has already taken the game's sockets off its poller
+
+  m_Jobs.Post([this, game]() {
+    game->SetPoller(m_Poller);
+    m_Games.push_back(game);
+  });
+}
+
+void CGameWorker::Post(CGame* game, function<void(CGame*)> job)
+{
+  // the game might have been handed back to the main thread by the time the job runs
+
+  m_Jobs.Post([this, game, job]() {
+    if (find(begin(m_Games), end(m_Games), game) != end(m_Games))
+      job(game);
+  });
+}
+
+void CGameWorker::Reconnect(CGame* game, CTCPSocket* socket, uint8_t PID, uint32_t reconnectKey, uint32_t lastPacket)
+{
+  // the main thread only knows the reconnect keys as they were when the game was handed over so check the player again here
+
+  m_Jobs.Post([this, game, socket, PID, reconnectKey, lastPacket]() {
+    CGamePlayer* Match = nullptr;
+
+    if (find(begin(m_Games), end(m_Games), game) != end(m_Games) && game->GetGameLoaded())
+    {
+      CGamePlayer* Player = game->GetPlayerFromPID(PID);
+
+      if (Player && Player->GetGProxy() && Player->GetGProxyReconnectKey() == reconnectKey)
+        Match = Player;
+    }
+
+    socket->SetPoller(m_Poller);
+    socket->Register();
+
+    if (Match)
+      Match->EventGProxyReconnect(socket, lastPacket);
+    else
+    {
+      socket->PutBytes(m_Aura->m_GPSProtocol->SEND_GPSS_REJECT(REJECTGPS_NOTFOUND));
+      socket->DoSend();
+      delete socket;
+    }
+  });
+}
@@ -0,0 +1,91 @@
+/*
+
+   Copyright [2010] [Josko Nikolic]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+ */
+
+#ifndef AURA_GAMEWORKER_H_
+#define AURA_GAMEWORKER_H_
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+class CAura;
+class CGame;
+class CPoller;
+class CTCPSocket;
+
+//
+// CJobQueue
+//
+
+// threads never reach into state owned by another thread, instead they post jobs to the owning thread's queue
+// the owning thread runs them in the order they were posted the next time it calls Run, Post wakes up its poller so that's right away
+
+class CJobQueue
+{
+private:
+  std::vector<std::function<void()>> m_Jobs;
+  std::mutex                         m_Mutex;
+  CPoller*                           m_Poller; // the owning thread's poller
+
+public:
+  explicit CJobQueue(CPoller* nPoller);
+  ~CJobQueue();
+  CJobQueue(CJobQueue&) = delete;
+
+  void Post(std::function<void()> job);
+  void Run();
+};
+
+//
+// CGameWorker
+//
+
+// updates games in progress on a separate thread with its own poller so busy games don't hold up each other, the lobby, battle.net and irc
+// a game is handed over right after it starts loading and handed back to the main thread to be deleted once it's over
+// the main thread owns battle.net, irc and the database, games reach those through CAura::RunOnMain and get the results back through CAura::RunOnGame
+
+class CGameWorker
+{
+private:
+  CAura*              m_Aura;
+  CPoller*            m_Poller;  // waits for socket events on the sockets of our games
+  CJobQueue           m_Jobs;    // jobs posted to this thread
+  std::vector<CGame*> m_Games;   // the games updated by this thread (only touched by this thread)
+  std::thread         m_Thread;
+  std::atomic<bool>   m_Exiting;
+
+  void Run();
+
+public:
+  CGameWorker(CAura* nAura, CPoller* nPoller);
+  ~CGameWorker();
+  CGameWorker(CGameWorker&) = delete;
+
+  // returns the game worker running the calling thread or nullptr on any other thread
+
+  static CGameWorker* GetCurrent();
+
+  void Adopt(CGame* game);
+  void Post(CGame* game, std::function<void(CGame*)> job);
+  void Reconnect(CGame* game, CTCPSocket* socket, uint8_t PID, uint32_t reconnectKey, uint32_t lastPacket);
+};
+
+#endif // AURA_GAMEWORKER_H_
@@ -27,6 +27,7 @@
 #include <string>
 #include <cstdint>
 #include <chrono>
+#include <mutex>
 
 // time
 
@@ -42,15 +43,31 @@ inline int64_t GetTicks()
   return std::chrono::duration_cast<std::chrono::milliseconds>(time_now.time_since_epoch()).count();
 }
 
+inline int64_t GetMicroTicks()
+{
+  const std::chrono::steady_clock::time_point time_now = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(time_now.time_since_epoch()).count();
+}
+
 // output
 
+// the map loader thread prints too and the console isn't synchronized with stdio so it needs a lock
+
+inline std::mutex& GetPrintMutex()
+{
+  static std::mutex PrintMutex;
+  return PrintMutex;
+}
+
 inline void Print(const std::string& message) // outputs to console
 {
+  std::lock_guard<std::mutex> Lock(GetPrintMutex());
   std::cout << message << std::endl;
 }
 
 inline void Print(const char* message)
 {
+  std::lock_guard<std::mutex> Lock(GetPrintMutex());
   std::cout << message << std::endl;
 }
 
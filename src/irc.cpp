@@ -21,6 +21,7 @@
 #include "irc.h"
 #include "aura.h"
 #include "socket.h"
+#include "resolver.h"
 #include "util.h"
 #include "bnetprotocol.h"
 #include "bnet.h"
@@ -50,8 +51,10 @@ CIRC::CIRC(CAura* nAura, string nServer, const string& nNickname, const string&
     m_CommandTrigger(nCommandTrigger),
     m_Exiting(false),
     m_WaitingToConnect(true),
+    m_Resolving(false),
     m_OriginalNick(true)
 {
+  m_Socket->SetPoller(m_Aura->m_Poller);
   sort(begin(m_RootAdmins), end(m_RootAdmins));
 
   if (!nUsername.empty())
@@ -65,20 +68,7 @@ CIRC::~CIRC()
   delete m_Socket;
 }
 
-uint32_t CIRC::SetFD(void* fd, void* send_fd, int32_t* nfds)
-{
-  // irc socket
-
-  if (!m_Socket->HasError() && m_Socket->GetConnected())
-  {
-    m_Socket->SetFD(static_cast<fd_set*>(fd), static_cast<fd_set*>(send_fd), nfds);
-    return 0;
-  }
-
-  return 1;
-}
-
-bool CIRC::Update(void* fd, void* send_fd)
+bool CIRC::Update()
 {
   const int64_t Time = GetTime();
 
@@ -111,9 +101,9 @@ bool CIRC::Update(void* fd, void* send_fd)
       m_LastAntiIdleTime = Time;
     }
 
-    m_Socket->DoRecv(static_cast<fd_set*>(fd));
+    m_Socket->DoRecv();
     ExtractPackets();
-    m_Socket->DoSend(static_cast<fd_set*>(send_fd));
+    m_Socket->DoSend();
     return m_Exiting;
   }
 
@@ -145,7 +135,7 @@ bool CIRC::Update(void* fd, void* send_fd)
       SendIRC("NICK " + m_Nickname);
       SendIRC("USER " + m_Username + " " + m_Nickname + " " + m_Username + " :aura-bot");
 
-      m_Socket->DoSend(static_cast<fd_set*>(send_fd));
+      m_Socket->DoSend();
 
       Print("[IRC: " + m_Server + "] connected");
 
@@ -165,30 +155,29 @@ bool CIRC::Update(void* fd, void* send_fd)
     }
   }
 
-  if (!m_Socket->GetConnecting() && !m_Socket->GetConnected() && (Time - m_LastConnectionAttemptTime > 60))
+  if (!m_Socket->GetConnecting() && !m_Socket->GetConnected() && !m_Resolving && (Time - m_LastConnectionAttemptTime > 60))
   {
     // attempt to connect to irc
+    // the server name is resolved on the resolver thread, we connect when the address comes back (right away if it's cached)
 
     Print("[IRC: " + m_Server + "] connecting to server [" + m_Server + "] on port " + to_string(m_Port));
+    m_Resolving = true;
 
-    if (m_ServerIP.empty())
-    {
-      m_Socket->Connect(string(), m_Server, m_Port);
+    m_Aura->m_Resolver->Resolve(m_Server, [this](const string& address) {
+      m_Resolving                 = false;
+      m_LastConnectionAttemptTime = GetTime();
 
-      if (!m_Socket->HasError())
+      if (!address.empty())
+        m_ServerIP = address;
+      else if (m_ServerIP.empty())
       {
-        m_ServerIP = m_Socket->GetIPString();
+        Print("[IRC: " + m_Server + "] unable to resolve server, waiting 60 seconds to reconnect");
+        return;
       }
-    }
-    else
-    {
-      // use cached server IP address since resolving takes time and is blocking
 
       m_Socket->Connect(string(), m_ServerIP, m_Port);
-    }
-
-    m_WaitingToConnect          = false;
-    m_LastConnectionAttemptTime = Time;
+      m_WaitingToConnect = false;
+    });
   }
 
   return m_Exiting;
@@ -197,11 +186,22 @@ bool CIRC::Update(void* fd, void* send_fd)
 void CIRC::ExtractPackets()
 {
   const int64_t Time = GetTime();
-  string*       Recv = m_Socket->GetBytes();
+  CByteBuffer*  Recv = m_Socket->GetBytes();
+
+  // only look at complete lines, a partial one at the end stays in the buffer until the rest of it arrives
+
+  const char* Data   = reinterpret_cast<const char*>(Recv->GetData());
+  size_t      Length = Recv->GetSize();
+
+  while (Length > 0 && Data[Length - 1] != '\n')
+    --Length;
+
+  if (Length == 0)
+    return;
 
   // separate packets using the CRLF delimiter
 
-  vector<string> Packets = Tokenize(*Recv, '\n');
+  vector<string> Packets = Tokenize(string(Data, Length), '\n');
 
   for (auto& Packets_Packet : Packets)
   {
@@ -393,10 +393,9 @@ void CIRC::ExtractPackets()
     }
   }
 
-  // clear the whole buffer
-  //TODO: delete only full packets we've processed and leave partial ones in buffer
+  // delete the lines we've processed
 
-  m_Socket->ClearRecvBuffer();
+  Recv->Consume(Length);
 }
 
 void CIRC::SendIRC(const string& message)
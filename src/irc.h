@@ -50,14 +50,14 @@ public:
   int8_t                   m_CommandTrigger;
   bool                     m_Exiting;
   bool                     m_WaitingToConnect;
+  bool                     m_Resolving;
   bool                     m_OriginalNick;
 
   CIRC(CAura* nAura, std::string nServer, const std::string& nNickname, const std::string& nUsername, std::string nPassword, std::vector<std::string> nChannels, std::vector<std::string> nRootAdmins, uint16_t nPort, int8_t nCommandTrigger);
   ~CIRC();
   CIRC(CIRC&) = delete;
 
-  uint32_t SetFD(void* fd, void* send_fd, int32_t* nfds);
-  bool Update(void* fd, void* send_fd);
+  bool Update();
   void ExtractPackets();
   void SendIRC(const std::string& message);
   void SendMessageIRC(const std::string& message, const std::string& target);
@@ -27,6 +27,8 @@
 #include "config.h"
 #include "gameslot.h"
 
+#include <algorithm>
+
 #define __STORMLIB_SELF__
 #include <StormLib.h>
 
@@ -39,10 +41,10 @@ using namespace std;
 // CMap
 //
 
-CMap::CMap(CAura* nAura, CConfig* CFG, const string& nCFGFile)
+CMap::CMap(CAura* nAura, const CMapLoadSettings& settings, CConfig* CFG, const string& nCFGFile)
   : m_Aura(nAura)
 {
-  Load(CFG, nCFGFile);
+  Load(settings, CFG, nCFGFile);
 }
 
 CMap::~CMap() = default;
@@ -197,7 +199,7 @@ uint8_t CMap::GetMapLayoutStyle() const
   return 3;
 }
 
-void CMap::Load(CConfig* CFG, const string& nCFGFile)
+void CMap::Load(const CMapLoadSettings& settings, CConfig* CFG, const string& nCFGFile)
 {
   m_Valid   = true;
   m_CFGFile = nCFGFile;
@@ -205,62 +207,86 @@ void CMap::Load(CConfig* CFG, const string& nCFGFile)
   // load the map data
 
   m_MapLocalPath = CFG->GetString("map_localpath", string());
-  m_MapData.clear();
+  m_MapData.reset();
+  m_MapPartCRCs.clear();
 
   if (!m_MapLocalPath.empty())
-    m_MapData = FileRead(m_Aura->m_MapPath + m_MapLocalPath);
+    m_MapData = CSharedFile::Open(settings.m_MapPath + m_MapLocalPath);
+
+  // check if we've already calculated everything for this map file, if so we don't need to touch the map MPQ at all
+
+  string          MapMPQFileName = settings.m_MapPath + m_MapLocalPath;
+  const CByteView MapData        = GetMapData();
+  CMapCacheEntry  CachedMap;
+  const bool      Cached = !MapData.empty() && m_Aura->m_MapCache->Get(MapMPQFileName, m_MapData->GetSize(), m_MapData->GetModifiedTime(), settings.m_War3Version, CachedMap);
 
   // load the map MPQ
 
-  string MapMPQFileName = m_Aura->m_MapPath + m_MapLocalPath;
   HANDLE MapMPQ;
   bool   MapMPQReady = false;
 
+  if (!Cached)
+  {
 #ifdef WIN32
-  const wstring MapMPQFileNameW = wstring(begin(MapMPQFileName), end(MapMPQFileName));
+    const wstring MapMPQFileNameW = wstring(begin(MapMPQFileName), end(MapMPQFileName));
 
-  if (SFileOpenArchive(MapMPQFileNameW.c_str(), 0, MPQ_OPEN_FORCE_MPQ_V1, &MapMPQ))
+    if (SFileOpenArchive(MapMPQFileNameW.c_str(), 0, MPQ_OPEN_FORCE_MPQ_V1, &MapMPQ))
 #else
-  if (SFileOpenArchive(MapMPQFileName.c_str(), 0, MPQ_OPEN_FORCE_MPQ_V1, &MapMPQ))
+    if (SFileOpenArchive(MapMPQFileName.c_str(), 0, MPQ_OPEN_FORCE_MPQ_V1, &MapMPQ))
 #endif
-  {
-    Print("[MAP] loading MPQ file [" + MapMPQFileName + "]");
-    MapMPQReady = true;
+    {
+      Print("[MAP] loading MPQ file [" + MapMPQFileName + "]");
+      MapMPQReady = true;
+    }
+    else
+      Print("[MAP] warning - unable to load MPQ file [" + MapMPQFileName + "]");
   }
-  else
-    Print("[MAP] warning - unable to load MPQ file [" + MapMPQFileName + "]");
 
   // try to calculate map_size, map_info, map_crc, map_sha1
 
   std::vector<uint8_t> MapSize, MapInfo, MapCRC, MapSHA1;
 
-  if (!m_MapData.empty())
+  if (Cached)
   {
-    m_Aura->m_SHA->Reset();
+    Print("[MAP] map file [" + MapMPQFileName + "] hasn't changed since it was last loaded, using cached values");
+    MapSize = CachedMap.m_MapSize;
+    MapInfo = CachedMap.m_MapInfo;
+    MapCRC  = CachedMap.m_MapCRC;
+    MapSHA1 = CachedMap.m_MapSHA1;
+    Print("[MAP] cached map_size = " + ByteArrayToDecString(MapSize));
+    Print("[MAP] cached map_info = " + ByteArrayToDecString(MapInfo));
+    Print("[MAP] cached map_crc = " + ByteArrayToDecString(MapCRC));
+    Print("[MAP] cached map_sha1 = " + ByteArrayToDecString(MapSHA1));
+  }
+  else if (!MapData.empty())
+  {
+    // the map might be loading on the map loader thread so use our own SHA1 context
+
+    CSHA1 SHA;
 
     // calculate map_size
 
-    MapSize = CreateByteArray(static_cast<uint32_t>(m_MapData.size()), false);
+    MapSize = CreateByteArray(static_cast<uint32_t>(MapData.size()), false);
     Print("[MAP] calculated map_size = " + ByteArrayToDecString(MapSize));
 
     // calculate map_info (this is actually the CRC)
 
-    MapInfo = CreateByteArray(m_Aura->m_CRC->CalculateCRC((uint8_t*)m_MapData.c_str(), m_MapData.size()), false);
+    MapInfo = CreateByteArray(m_Aura->m_CRC->CalculateCRC(MapData.data(), MapData.size()), false);
     Print("[MAP] calculated map_info = " + ByteArrayToDecString(MapInfo));
 
     // calculate map_crc (this is not the CRC) and map_sha1
     // a big thank you to Strilanc for figuring the map_crc algorithm out
 
-    string CommonJ = FileRead(m_Aura->m_MapCFGPath + "common.j");
+    string CommonJ = FileRead(settings.m_MapCFGPath + "common.j");
 
     if (CommonJ.empty())
-      Print("[MAP] unable to calculate map_crc/sha1 - unable to read file [" + m_Aura->m_MapCFGPath + "common.j]");
+      Print("[MAP] unable to calculate map_crc/sha1 - unable to read file [" + settings.m_MapCFGPath + "common.j]");
     else
     {
-      string BlizzardJ = FileRead(m_Aura->m_MapCFGPath + "blizzard.j");
+      string BlizzardJ = FileRead(settings.m_MapCFGPath + "blizzard.j");
 
       if (BlizzardJ.empty())
-        Print("[MAP] unable to calculate map_crc/sha1 - unable to read file [" + m_Aura->m_MapCFGPath + "blizzard.j]");
+        Print("[MAP] unable to calculate map_crc/sha1 - unable to read file [" + settings.m_MapCFGPath + "blizzard.j]");
       else
       {
         uint32_t Val = 0;
@@ -291,7 +317,7 @@ void CMap::Load(CConfig* CFG, const string& nCFGFile)
                 Print("[MAP] overriding default common.j with map copy while calculating map_crc/sha1");
                 OverrodeCommonJ = true;
                 Val             = Val ^ XORRotateLeft(reinterpret_cast<uint8_t*>(SubFileData), BytesRead);
-                m_Aura->m_SHA->Update(reinterpret_cast<uint8_t*>(SubFileData), BytesRead);
+                SHA.Update(reinterpret_cast<uint8_t*>(SubFileData), BytesRead);
               }
 
               delete[] SubFileData;
@@ -304,7 +330,7 @@ void CMap::Load(CConfig* CFG, const string& nCFGFile)
         if (!OverrodeCommonJ)
         {
           Val = Val ^ XORRotateLeft((uint8_t*)CommonJ.c_str(), CommonJ.size());
-          m_Aura->m_SHA->Update((uint8_t*)CommonJ.c_str(), CommonJ.size());
+          SHA.Update((uint8_t*)CommonJ.c_str(), CommonJ.size());
         }
 
         if (MapMPQReady)
@@ -327,7 +353,7 @@ void CMap::Load(CConfig* CFG, const string& nCFGFile)
                 Print("[MAP] overriding default blizzard.j with map copy while calculating map_crc/sha1");
                 OverrodeBlizzardJ = true;
                 Val               = Val ^ XORRotateLeft(reinterpret_cast<uint8_t*>(SubFileData), BytesRead);
-                m_Aura->m_SHA->Update(reinterpret_cast<uint8_t*>(SubFileData), BytesRead);
+                SHA.Update(reinterpret_cast<uint8_t*>(SubFileData), BytesRead);
               }
 
               delete[] SubFileData;
@@ -340,12 +366,12 @@ void CMap::Load(CConfig* CFG, const string& nCFGFile)
         if (!OverrodeBlizzardJ)
         {
           Val = Val ^ XORRotateLeft((uint8_t*)BlizzardJ.c_str(), BlizzardJ.size());
-          m_Aura->m_SHA->Update((uint8_t*)BlizzardJ.c_str(), BlizzardJ.size());
+          SHA.Update((uint8_t*)BlizzardJ.c_str(), BlizzardJ.size());
         }
 
         Val = ROTL(Val, 3);
         Val = ROTL(Val ^ 0x03F1379E, 3);
-        m_Aura->m_SHA->Update((uint8_t*)"\x9E\x37\xF1\x03", 4);
+        SHA.Update((uint8_t*)"\x9E\x37\xF1\x03", 4);
 
         if (MapMPQReady)
         {
@@ -386,7 +412,7 @@ void CMap::Load(CConfig* CFG, const string& nCFGFile)
                     FoundScript = true;
 
                   Val = ROTL(Val ^ XORRotateLeft((uint8_t*)SubFileData, BytesRead), 3);
-                  m_Aura->m_SHA->Update(reinterpret_cast<uint8_t*>(SubFileData), BytesRead);
+                  SHA.Update(reinterpret_cast<uint8_t*>(SubFileData), BytesRead);
                 }
 
                 delete[] SubFileData;
@@ -402,10 +428,10 @@ void CMap::Load(CConfig* CFG, const string& nCFGFile)
           MapCRC = CreateByteArray(Val, false);
           Print("[MAP] calculated map_crc = " + ByteArrayToDecString(MapCRC));
 
-          m_Aura->m_SHA->Final();
+          SHA.Final();
           uint8_t SHA1[20];
           memset(SHA1, 0, sizeof(uint8_t) * 20);
-          m_Aura->m_SHA->GetHash(SHA1);
+          SHA.GetHash(SHA1);
           MapSHA1 = CreateByteArray(SHA1, 20);
           Print("[MAP] calculated map_sha1 = " + ByteArrayToDecString(MapSHA1));
         }
@@ -427,7 +453,17 @@ void CMap::Load(CConfig* CFG, const string& nCFGFile)
   uint32_t             MapNumTeams   = 0;
   vector<CGameSlot>    Slots;
 
-  if (!m_MapData.empty())
+  if (Cached)
+  {
+    MapOptions    = CachedMap.m_MapOptions;
+    MapWidth      = CachedMap.m_MapWidth;
+    MapHeight     = CachedMap.m_MapHeight;
+    MapNumPlayers = CachedMap.m_MapNumPlayers;
+    MapNumTeams   = CachedMap.m_MapNumTeams;
+    MapFilterType = CachedMap.m_MapFilterType;
+    Slots         = CachedMap.m_Slots;
+  }
+  else if (!MapData.empty())
   {
     if (MapMPQReady)
     {
@@ -665,6 +701,29 @@ void CMap::Load(CConfig* CFG, const string& nCFGFile)
   if (MapMPQReady)
     SFileCloseArchive(MapMPQ);
 
+  // remember the calculated values for next time
+  // if map_crc/sha1 couldn't be calculated something is missing (e.g. common.j) which might not be missing next time so don't bother
+
+  if (!Cached && !MapCRC.empty() && !MapSHA1.empty())
+  {
+    CMapCacheEntry Entry;
+    Entry.m_MapSize       = MapSize;
+    Entry.m_MapInfo       = MapInfo;
+    Entry.m_MapCRC        = MapCRC;
+    Entry.m_MapSHA1       = MapSHA1;
+    Entry.m_MapWidth      = MapWidth;
+    Entry.m_MapHeight     = MapHeight;
+    Entry.m_Slots         = Slots;
+    Entry.m_FileSize      = m_MapData->GetSize();
+    Entry.m_ModifiedTime  = m_MapData->GetModifiedTime();
+    Entry.m_MapOptions    = MapOptions;
+    Entry.m_MapNumPlayers = MapNumPlayers;
+    Entry.m_MapNumTeams   = MapNumTeams;
+    Entry.m_MapFilterType = MapFilterType;
+    Entry.m_War3Version   = settings.m_War3Version;
+    m_Aura->m_MapCache->Set(MapMPQFileName, Entry);
+  }
+
   m_MapPath = CFG->GetString("map_path", string());
 
   if (MapSize.empty())
@@ -840,6 +899,50 @@ void CMap::Load(CConfig* CFG, const string& nCFGFile)
     Print(std::string("[MAP] ") + ErrorMessage);
 }
 
+CByteView CMap::GetMapData() const
+{
+  if (!m_MapData)
+    return CByteView();
+
+  return CByteView(m_MapData->GetData(), m_MapData->GetSize());
+}
+
+CByteView CMap::GetMapPart(uint32_t start) const
+{
+  const CByteView MapData = GetMapData();
+
+  if (start >= MapData.size())
+    return CByteView();
+
+  return MapData.SubView(start, min<size_t>(MAPPART_SIZE, MapData.size() - start));
+}
+
+uint32_t CMap::GetMapPartCRC(uint32_t start)
+{
+  // the map data doesn't change while it's loaded so the crc of each chunk only has to be calculated once for all downloaders
+
+  const CByteView MapData = GetMapData();
+
+  if (m_MapPartCRCs.empty() && !MapData.empty())
+  {
+    m_MapPartCRCs.reserve(MapData.size() / MAPPART_SIZE + 1);
+
+    for (uint32_t i = 0; i < MapData.size(); i += MAPPART_SIZE)
+    {
+      const CByteView Part = GetMapPart(i);
+      m_MapPartCRCs.push_back(m_Aura->m_CRC->CalculateCRC(Part.data(), Part.size()));
+    }
+  }
+
+  if (start % MAPPART_SIZE == 0 && start / MAPPART_SIZE < m_MapPartCRCs.size())
+    return m_MapPartCRCs[start / MAPPART_SIZE];
+
+  // the chunks are always sent at multiples of MAPPART_SIZE so this shouldn't happen
+
+  const CByteView Part = GetMapPart(start);
+  return m_Aura->m_CRC->CalculateCRC(Part.data(), Part.size());
+}
+
 const char* CMap::CheckValid()
 {
   // TODO: should this code fix any errors it sees rather than just warning the user?
@@ -858,7 +961,7 @@ const char* CMap::CheckValid()
     m_Valid = false;
     return "invalid map_size detected";
   }
-  else if (!m_MapData.empty() && m_MapData.size() != ByteArrayToUInt32(m_MapSize, false))
+  else if (m_MapData && m_MapData->GetSize() != ByteArrayToUInt32(m_MapSize, false))
   {
     m_Valid = false;
     return "invalid map_size detected - size mismatch with actual map data";
@@ -933,27 +1036,195 @@ const char* CMap::CheckValid()
   return nullptr;
 }
 
-uint32_t CMap::XORRotateLeft(uint8_t* data, uint32_t length)
+uint32_t CMap::XORRotateLeft(const uint8_t* data, uint32_t length)
 {
   // a big thank you to Strilanc for figuring this out
+  // the value is Val = ROTL(Val ^ word, 3) over every little endian 32 bit word and then Val = ROTL(Val ^ byte, 3) over the leftover bytes
+  // every word ends up rotated left by 3 * (its distance from the last word + 1) and 3 * 32 is a multiple of 32
+  // so words 32 apart get the same rotation and can simply be XOR'd together first (which the compiler vectorizes), only the 32 lanes have to be rotated at the end
+
+  const uint32_t NumWords  = length / 4;
+  uint32_t       Lanes[32] = {0};
+  uint32_t       Block[32];
+  uint32_t       i = 0;
+
+  for (; i + 32 <= NumWords; i += 32)
+  {
+    memcpy(Block, data + i * 4, sizeof(Block));
+
+    for (uint32_t j = 0; j < 32; ++j)
+      Lanes[j] ^= Block[j];
+  }
+
+  for (uint32_t j = 0; i + j < NumWords; ++j)
+  {
+    memcpy(&Block[j], data + (i + j) * 4, 4);
+    Lanes[j] ^= Block[j];
+  }
 
-  uint32_t i   = 0;
   uint32_t Val = 0;
 
-  if (length > 3)
+  for (uint32_t j = 0; j < 32; ++j)
   {
-    while (i < length - 3)
+#if defined(__BYTE_ORDER) && __BYTE_ORDER == __BIG_ENDIAN
+    const uint32_t Lane = ((Lanes[j] & 0xFF) << 24) | ((Lanes[j] & 0xFF00) << 8) | ((Lanes[j] >> 8) & 0xFF00) | (Lanes[j] >> 24);
+#else
+    const uint32_t Lane = Lanes[j];
+#endif
+
+    // lane j holds words j, j + 32, j + 64... which are all rotated by 3 * (NumWords - j) mod 32
+
+    const uint32_t Rotate = (3 * NumWords - 3 * j) & 31;
+    Val ^= Rotate ? ROTL(Lane, Rotate) : Lane;
+  }
+
+  for (i = NumWords * 4; i < length; ++i)
+    Val = ROTL(Val ^ data[i], 3);
+
+  return Val;
+}
+
+//
+// CMapCacheEntry
+//
+
+CMapCacheEntry::CMapCacheEntry()
+  : m_FileSize(0),
+    m_ModifiedTime(0),
+    m_MapOptions(0),
+    m_MapNumPlayers(0),
+    m_MapNumTeams(0),
+    m_MapFilterType(0),
+    m_War3Version(0)
+{
+}
+
+CMapCacheEntry::~CMapCacheEntry() = default;
+
+//
+// CMapCache
+//
+
+// the cache file has one line per map file with tab separated fields:
+// path, file size, modification time, war3 version, map_size, map_info, map_crc, map_sha1, map_options, map_width, map_height, map_numplayers, map_numteams, map_filter_type, map_slot<x>...
+// byte arrays are written the same way as in the map config files
+
+static vector<uint8_t> ExtractCachedNumbers(const string& s, const uint32_t count)
+{
+  if (s.empty())
+    return vector<uint8_t>();
+
+  return ExtractNumbers(s, count);
+}
+
+CMapCache::CMapCache(string nFile)
+  : m_File(std::move(nFile))
+{
+  if (m_File.empty() || !FileExists(m_File))
+    return;
+
+  istringstream ISS(FileRead(m_File));
+  string        Line;
+
+  while (getline(ISS, Line))
+  {
+    if (Line.empty() || Line[0] == '#')
+      continue;
+
+    Line.erase(remove(begin(Line), end(Line), '\r'), end(Line));
+
+    vector<string> Fields;
+    istringstream  LineSS(Line);
+    string         Field;
+
+    while (getline(LineSS, Field, '\t'))
+      Fields.push_back(Field);
+
+    if (Fields.size() < 14)
+      continue;
+
+    CMapCacheEntry Entry;
+    Entry.m_FileSize      = strtoll(Fields[1].c_str(), nullptr, 10);
+    Entry.m_ModifiedTime  = strtoll(Fields[2].c_str(), nullptr, 10);
+    Entry.m_War3Version   = static_cast<uint8_t>(strtoul(Fields[3].c_str(), nullptr, 10));
+    Entry.m_MapSize       = ExtractCachedNumbers(Fields[4], 4);
+    Entry.m_MapInfo       = ExtractCachedNumbers(Fields[5], 4);
+    Entry.m_MapCRC        = ExtractCachedNumbers(Fields[6], 4);
+    Entry.m_MapSHA1       = ExtractCachedNumbers(Fields[7], 20);
+    Entry.m_MapOptions    = strtoul(Fields[8].c_str(), nullptr, 10);
+    Entry.m_MapWidth      = ExtractCachedNumbers(Fields[9], 2);
+    Entry.m_MapHeight     = ExtractCachedNumbers(Fields[10], 2);
+    Entry.m_MapNumPlayers = strtoul(Fields[11].c_str(), nullptr, 10);
+    Entry.m_MapNumTeams   = strtoul(Fields[12].c_str(), nullptr, 10);
+    Entry.m_MapFilterType = strtoul(Fields[13].c_str(), nullptr, 10);
+
+    for (uint32_t i = 14; i < Fields.size() && Entry.m_Slots.size() < MAX_SLOTS; ++i)
     {
-      Val = ROTL(Val ^ ((uint32_t)data[i] + (uint32_t)(data[i + 1] << 8) + (uint32_t)(data[i + 2] << 16) + (uint32_t)(data[i + 3] << 24)), 3);
-      i += 4;
+      const vector<uint8_t> SlotData = ExtractCachedNumbers(Fields[i], 9);
+
+      if (SlotData.size() == 9)
+        Entry.m_Slots.emplace_back(SlotData);
     }
+
+    m_Entries[Fields[0]] = Entry;
   }
 
-  while (i < length)
+  Print("[MAP] loaded " + to_string(m_Entries.size()) + " cached maps from [" + m_File + "]");
+}
+
+CMapCache::~CMapCache() = default;
+
+bool CMapCache::Get(const string& path, int64_t fileSize, int64_t modifiedTime, uint8_t war3Version, CMapCacheEntry& entry) const
+{
+  lock_guard<mutex> Lock(m_Mutex);
+  auto              i = m_Entries.find(path);
+
+  if (i == end(m_Entries) || i->second.m_FileSize != fileSize || i->second.m_ModifiedTime != modifiedTime || i->second.m_War3Version != war3Version)
+    return false;
+
+  entry = i->second;
+  return true;
+}
+
+void CMapCache::Set(const string& path, const CMapCacheEntry& entry)
+{
+  if (m_File.empty() || path.find_first_of("\t\r\n") != string::npos)
+    return;
+
+  lock_guard<mutex> Lock(m_Mutex);
+  m_Entries[path] = entry;
+  Save();
+}
+
+void CMapCache::Save()
+{
+  string Data = "# this file is generated by Aura, it's safe to delete it\n";
+
+  for (auto& entry : m_Entries)
   {
-    Val = ROTL(Val ^ data[i], 3);
-    ++i;
+    const CMapCacheEntry& Entry = entry.second;
+
+    Data += entry.first;
+    Data += "\t" + to_string(Entry.m_FileSize);
+    Data += "\t" + to_string(Entry.m_ModifiedTime);
+    Data += "\t" + to_string(Entry.m_War3Version);
+    Data += "\t" + ByteArrayToDecString(Entry.m_MapSize);
+    Data += "\t" + ByteArrayToDecString(Entry.m_MapInfo);
+    Data += "\t" + ByteArrayToDecString(Entry.m_MapCRC);
+    Data += "\t" + ByteArrayToDecString(Entry.m_MapSHA1);
+    Data += "\t" + to_string(Entry.m_MapOptions);
+    Data += "\t" + ByteArrayToDecString(Entry.m_MapWidth);
+    Data += "\t" + ByteArrayToDecString(Entry.m_MapHeight);
+    Data += "\t" + to_string(Entry.m_MapNumPlayers);
+    Data += "\t" + to_string(Entry.m_MapNumTeams);
+    Data += "\t" + to_string(Entry.m_MapFilterType);
+
+    for (auto& slot : Entry.m_Slots)
+      Data += "\t" + ByteArrayToDecString(slot.GetByteArray());
+
+    Data += "\n";
   }
 
-  return Val;
+  if (!FileWrite(m_File, reinterpret_cast<uint8_t*>(&Data[0]), Data.size()))
+    Print("[MAP] warning - unable to write map cache file [" + m_File + "]");
 }
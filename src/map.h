@@ -83,18 +83,40 @@
 #define MAPGAMETYPE_OBSONDEATH 1 << 21
 #define MAPGAMETYPE_OBSNONE 1 << 22
 
-//
-// CMap
-//
+#define MAPPART_SIZE 1442 // the number of map bytes sent in each W3GS_MAPPART packet
 
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <memory>
+#include <map>
+#include <mutex>
 
 class CAura;
+class CByteView;
+class CSharedFile;
 class CGameSlot;
 class CConfig;
 
+//
+// CMapLoadSettings
+//
+
+// the bot settings a map is loaded with, copied on the main thread when the load is queued
+// maps are loaded on the map loader thread which mustn't read them from CAura since !reload changes them on the main thread
+
+class CMapLoadSettings
+{
+public:
+  std::string m_MapPath;     // where the map files are (bot_mappath)
+  std::string m_MapCFGPath;  // where common.j and blizzard.j are (bot_mapcfgpath)
+  uint8_t     m_War3Version; // the warcraft 3 version common.j and blizzard.j were extracted for
+};
+
+//
+// CMap
+//
+
 class CMap
 {
 public:
@@ -108,12 +130,13 @@ private:
   std::vector<uint8_t>   m_MapWidth;  // config value: map width (2 bytes)
   std::vector<uint8_t>   m_MapHeight; // config value: map height (2 bytes)
   std::vector<CGameSlot> m_Slots;
+  std::vector<uint32_t>  m_MapPartCRCs; // the crc32 of every MAPPART_SIZE byte chunk of m_MapData, calculated the first time the map is downloaded
   std::string            m_CFGFile;
   std::string            m_MapPath;       // config value: map path
   std::string            m_MapType;       // config value: map type (for stats class)
   std::string            m_MapDefaultHCL; // config value: map default HCL to use (this should really be specified elsewhere and not part of the map config)
   std::string            m_MapLocalPath;  // config value: map local path
-  std::string            m_MapData;       // the map data itself, for sending the map to players
+  std::shared_ptr<const CSharedFile> m_MapData; // the map data itself, for sending the map to players (shared with every other CMap using the same file)
   uint32_t               m_MapOptions;
   uint32_t               m_MapNumPlayers; // config value: max map number of players
   uint32_t               m_MapNumTeams;   // config value: max map number of teams
@@ -128,7 +151,7 @@ private:
   bool                   m_Valid;
 
 public:
-  CMap(CAura* nAura, CConfig* CFG, const std::string& nCFGFile);
+  CMap(CAura* nAura, const CMapLoadSettings& settings, CConfig* CFG, const std::string& nCFGFile);
   ~CMap();
 
   inline bool                   GetValid() const { return m_Valid; }
@@ -151,14 +174,64 @@ public:
   inline std::string            GetMapType() const { return m_MapType; }
   inline std::string            GetMapDefaultHCL() const { return m_MapDefaultHCL; }
   inline std::string            GetMapLocalPath() const { return m_MapLocalPath; }
-  inline std::string*           GetMapData() { return &m_MapData; }
   inline uint32_t               GetMapNumPlayers() const { return m_MapNumPlayers; }
   inline uint32_t               GetMapNumTeams() const { return m_MapNumTeams; }
   inline std::vector<CGameSlot> GetSlots() const { return m_Slots; }
 
-  void Load(CConfig* CFG, const std::string& nCFGFile);
+  CByteView GetMapData() const;
+  CByteView GetMapPart(uint32_t start) const;
+  uint32_t  GetMapPartCRC(uint32_t start);
+
+  void Load(const CMapLoadSettings& settings, CConfig* CFG, const std::string& nCFGFile);
   const char* CheckValid();
-  uint32_t XORRotateLeft(uint8_t* data, uint32_t length);
+  uint32_t XORRotateLeft(const uint8_t* data, uint32_t length);
+};
+
+//
+// CMapCache
+//
+
+// everything CMap::Load calculates from a map file only depends on that file and on common.j/blizzard.j (which depend on the war3 version)
+// so the results are saved to disk and a map which hasn't changed since it was last loaded doesn't have to be opened and hashed again
+
+class CMapCacheEntry
+{
+public:
+  std::vector<uint8_t>   m_MapSize;
+  std::vector<uint8_t>   m_MapInfo;
+  std::vector<uint8_t>   m_MapCRC;
+  std::vector<uint8_t>   m_MapSHA1;
+  std::vector<uint8_t>   m_MapWidth;
+  std::vector<uint8_t>   m_MapHeight;
+  std::vector<CGameSlot> m_Slots;
+  int64_t                m_FileSize;     // the map file's size when the values were calculated
+  int64_t                m_ModifiedTime; // the map file's modification time when the values were calculated
+  uint32_t               m_MapOptions;
+  uint32_t               m_MapNumPlayers;
+  uint32_t               m_MapNumTeams;
+  uint32_t               m_MapFilterType;
+  uint8_t                m_War3Version; // the war3 version common.j and blizzard.j were extracted for when the values were calculated
+
+  CMapCacheEntry();
+  ~CMapCacheEntry();
+};
+
+class CMapCache
+{
+private:
+  std::map<std::string, CMapCacheEntry> m_Entries; // map file path -> the values calculated from it
+  std::string                           m_File;    // config value: the file the cache is saved to (empty to disable the cache)
+  mutable std::mutex                    m_Mutex;   // maps are loaded on the map loader thread
+
+  void Save();
+
+public:
+  explicit CMapCache(std::string nFile);
+  ~CMapCache();
+  CMapCache(CMapCache&) = delete;
+
+  bool Get(const std::string& path, int64_t fileSize, int64_t modifiedTime, uint8_t war3Version, CMapCacheEntry& entry) const;
+  void Set(const std::string& path, const CMapCacheEntry& entry);
 };
 
 #endif // AURA_MAP_H_
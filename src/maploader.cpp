@@ -0,0 +1,124 @@
+/*
+
+   Copyright [2010] [Josko Nikolic]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+ */
+
+#include "maploader.h"
+#include "gameslot.h"
+#include "map.h"
+
+using namespace std;
+
+//
+// CMapLoadRequest
+//
+
+CMapLoadRequest::CMapLoadRequest(CConfig nCFG, CMapLoadSettings nSettings, string nCFGFile, string nUser, string nIRC, CBNET* nServer, bool nWhisper)
+  : m_CFG(std::move(nCFG)),
+    m_Settings(std::move(nSettings)),
+    m_CFGFile(std::move(nCFGFile)),
+    m_User(std::move(nUser)),
+    m_IRC(std::move(nIRC)),
+    m_Server(nServer),
+    m_Map(nullptr),
+    m_Whisper(nWhisper)
+{
+}
+
+CMapLoadRequest::~CMapLoadRequest()
+{
+  delete m_Map;
+}
+
+//
+// CMapLoader
+//
+
+CMapLoader::CMapLoader(CAura* nAura)
+  : m_Aura(nAura),
+    m_Exiting(false)
+{
+  m_Thread = thread(&CMapLoader::Run, this);
+}
+
+CMapLoader::~CMapLoader()
+{
+  // a map which is being loaded right now is finished first, anything still waiting is thrown away
+
+  {
+    lock_guard<mutex> Lock(m_Mutex);
+    m_Exiting = true;
+  }
+
+  m_Wake.notify_one();
+  m_Thread.join();
+
+  while (!m_Requests.empty())
+  {
+    delete m_Requests.front();
+    m_Requests.pop();
+  }
+
+  while (!m_Finished.empty())
+  {
+    delete m_Finished.front();
+    m_Finished.pop();
+  }
+}
+
+void CMapLoader::Run()
+{
+  unique_lock<mutex> Lock(m_Mutex);
+
+  while (true)
+  {
+    m_Wake.wait(Lock, [this]() { return m_Exiting || !m_Requests.empty(); });
+
+    if (m_Exiting)
+      return;
+
+    CMapLoadRequest* Request = m_Requests.front();
+    m_Requests.pop();
+
+    Lock.unlock();
+    Request->m_Map = new CMap(m_Aura, Request->m_Settings, &Request->m_CFG, Request->m_CFGFile);
+    Lock.lock();
+
+    m_Finished.push(Request);
+  }
+}
+
+void CMapLoader::Load(CMapLoadRequest* request)
+{
+  {
+    lock_guard<mutex> Lock(m_Mutex);
+    m_Requests.push(request);
+  }
+
+  m_Wake.notify_one();
+}
+
+CMapLoadRequest* CMapLoader::GetFinished()
+{
+  lock_guard<mutex> Lock(m_Mutex);
+
+  if (m_Finished.empty())
+    return nullptr;
+
+  CMapLoadRequest* Request = m_Finished.front();
+  m_Finished.pop();
+  return Request;
+}
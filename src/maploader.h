@@ -0,0 +1,85 @@
+/*
+
+   Copyright [2010] [Josko Nikolic]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+ */
+
+#ifndef AURA_MAPLOADER_H_
+#define AURA_MAPLOADER_H_
+
+#include "config.h"
+#include "map.h"
+
+#include <string>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class CAura;
+class CBNET;
+
+//
+// CMapLoadRequest
+//
+
+class CMapLoadRequest
+{
+public:
+  CConfig          m_CFG;      // the map config to load the map with
+  CMapLoadSettings m_Settings; // the bot settings to load the map with, copied when the request is made
+  std::string      m_CFGFile;
+  std::string      m_User;     // the user who asked for the map to be loaded, to report back to
+  std::string      m_IRC;
+  CBNET*           m_Server;
+  CMap*            m_Map;      // the loaded map, set by the map loader thread
+  bool             m_Whisper;
+
+  CMapLoadRequest(CConfig nCFG, CMapLoadSettings nSettings, std::string nCFGFile, std::string nUser, std::string nIRC, CBNET* nServer, bool nWhisper);
+  ~CMapLoadRequest();
+  CMapLoadRequest(CMapLoadRequest&) = delete;
+};
+
+//
+// CMapLoader
+//
+
+// loading a map means reading the whole map file, hashing it and parsing it with StormLib which can take seconds for big maps
+// so it's done on a separate thread, the main loop picks up the finished maps with GetFinished and swaps them in
+// requests are handled one at a time in the order they were queued so the last map asked for is the one that ends up loaded
+
+class CMapLoader
+{
+private:
+  CAura*                       m_Aura;
+  std::queue<CMapLoadRequest*> m_Requests; // requests waiting to be loaded
+  std::queue<CMapLoadRequest*> m_Finished; // requests which have been loaded, waiting for the main loop
+  std::mutex                   m_Mutex;    // protects the queues and m_Exiting
+  std::condition_variable      m_Wake;     // signalled when a request is queued or we're exiting
+  std::thread                  m_Thread;
+  bool                         m_Exiting;
+
+  void Run();
+
+public:
+  explicit CMapLoader(CAura* nAura);
+  ~CMapLoader();
+  CMapLoader(CMapLoader&) = delete;
+
+  void Load(CMapLoadRequest* request);
+  CMapLoadRequest* GetFinished();
+};
+
+#endif // AURA_MAPLOADER_H_
@@ -0,0 +1,1012 @@
+/*
+
+   Copyright [2010] [Josko Nikolic]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+ */
+
+// winsock's fd_set is an array of FD_SETSIZE sockets so it has to be raised before winsock2.h is included
+
+#ifdef WIN32
+#undef FD_SETSIZE
+#define FD_SETSIZE 1024
+#endif
+
+#include "poller.h"
+#include "socket.h"
+#include "includes.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <linux/io_uring.h>
+
+// the io_uring poller needs the extended enter arguments (Linux 5.11) for its timeouts, older headers only get epoll
+
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(IORING_ENTER_EXT_ARG)
+#define AURA_IO_URING
+#endif
+#endif
+
+using namespace std;
+
+//
+// CPoller
+//
+
+CPoller::CPoller()
+  : m_NumSockets(0),
+    m_WakePending(false)
+{
+}
+
+CPoller::~CPoller() = default;
+
+void CPoller::ClearReady()
+{
+  for (auto& socket : m_Ready)
+  {
+    socket->m_Readable = false;
+    socket->m_Writable = false;
+  }
+
+  m_Ready.clear();
+}
+
+void CPoller::MarkReady(CSocket* socket, bool readable, bool writable)
+{
+  if (!readable && !writable)
+    return;
+
+  socket->m_Readable = readable;
+  socket->m_Writable = writable;
+  m_Ready.push_back(socket);
+}
+
+void CPoller::ForgetReady(CSocket* socket)
+{
+  // the socket is going away so make sure we don't touch it when clearing the ready list
+
+  auto i = find(begin(m_Ready), end(m_Ready), socket);
+
+  if (i != end(m_Ready))
+    m_Ready.erase(i);
+}
+
+void CPoller::Wake()
+{
+  if (!m_WakePending.exchange(true))
+    Signal();
+}
+
+uint32_t CPoller::Flush(const vector<CTCPSocket*>& sockets)
+{
+  uint32_t Calls = 0;
+
+  for (auto& socket : sockets)
+    Calls += socket->DoSend();
+
+  return Calls;
+}
+
+#ifdef __linux__
+
+//
+// CEPollPoller
+//
+
+class CEPollPoller final : public CPoller
+{
+private:
+  std::vector<struct epoll_event> m_Events;
+  int                             m_EPoll;
+  int                             m_TimerFD; // CLOCK_MONOTONIC timer for timeouts which aren't a whole number of milliseconds
+  int                             m_WakeFD;  // eventfd signalled by Wake
+
+  void Signal();
+
+public:
+  CEPollPoller();
+  ~CEPollPoller();
+
+  inline bool GetValid() const { return m_EPoll != -1; }
+
+  const char* GetName() const { return "epoll"; }
+  bool        Register(CSocket* socket);
+  void        Unregister(CSocket* socket);
+  void        UpdateInterest(CSocket* socket);
+  uint32_t    Wait(int64_t usecTimeout);
+};
+
+CEPollPoller::CEPollPoller()
+  : CPoller(),
+    m_Events(256),
+    m_EPoll(epoll_create1(EPOLL_CLOEXEC)),
+    m_TimerFD(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+    m_WakeFD(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+  // the timer and the wakeup are the only descriptors registered without a socket, they're told apart from the sockets by the null pointer and m_WakeFD's address
+
+  if (m_EPoll != -1 && m_TimerFD != -1)
+  {
+    struct epoll_event Event;
+    Event.events   = EPOLLIN;
+    Event.data.ptr = nullptr;
+
+    if (epoll_ctl(m_EPoll, EPOLL_CTL_ADD, m_TimerFD, &Event) == -1)
+    {
+      close(m_TimerFD);
+      m_TimerFD = -1;
+    }
+  }
+
+  if (m_EPoll != -1 && m_WakeFD != -1)
+  {
+    struct epoll_event Event;
+    Event.events   = EPOLLIN;
+    Event.data.ptr = &m_WakeFD;
+
+    if (epoll_ctl(m_EPoll, EPOLL_CTL_ADD, m_WakeFD, &Event) == -1)
+    {
+      close(m_WakeFD);
+      m_WakeFD = -1;
+    }
+  }
+}
+
+CEPollPoller::~CEPollPoller()
+{
+  if (m_WakeFD != -1)
+    close(m_WakeFD);
+
+  if (m_TimerFD != -1)
+    close(m_TimerFD);
+
+  if (m_EPoll != -1)
+    close(m_EPoll);
+}
+
+void CEPollPoller::Signal()
+{
+  const uint64_t One = 1;
+
+  if (m_WakeFD != -1 && write(m_WakeFD, &One, sizeof(One)) == -1)
+  {
+    // do nothing, the counter can't overflow with the writes limited by m_WakePending
+  }
+}
+
+bool CEPollPoller::Register(CSocket* socket)
+{
+  struct epoll_event Event;
+  Event.events   = socket->GetWantWrite() ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+  Event.data.ptr = socket;
+
+  if (epoll_ctl(m_EPoll, EPOLL_CTL_ADD, socket->GetFD(), &Event) == -1)
+    return false;
+
+  ++m_NumSockets;
+  return true;
+}
+
+void CEPollPoller::Unregister(CSocket* socket)
+{
+  // the descriptor is still open at this point (it gets closed right after) so remove it explicitly
+
+  struct epoll_event Event;
+  epoll_ctl(m_EPoll, EPOLL_CTL_DEL, socket->GetFD(), &Event);
+  ForgetReady(socket);
+  --m_NumSockets;
+}
+
+void CEPollPoller::UpdateInterest(CSocket* socket)
+{
+  struct epoll_event Event;
+  Event.events   = socket->GetWantWrite() ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+  Event.data.ptr = socket;
+  epoll_ctl(m_EPoll, EPOLL_CTL_MOD, socket->GetFD(), &Event);
+}
+
+uint32_t CEPollPoller::Wait(int64_t usecTimeout)
+{
+  ClearReady();
+
+  // epoll only has millisecond resolution so the game's action packets would go out up to a millisecond late
+  // when the timeout isn't a whole number of milliseconds arm the timer instead and let it wake us up
+
+  int32_t Timeout = static_cast<int32_t>((usecTimeout + 999) / 1000);
+
+  if (m_TimerFD != -1 && usecTimeout > 0 && usecTimeout % 1000 != 0)
+  {
+    struct itimerspec Spec;
+    Spec.it_interval.tv_sec  = 0;
+    Spec.it_interval.tv_nsec = 0;
+    Spec.it_value.tv_sec     = static_cast<time_t>(usecTimeout / 1000000);
+    Spec.it_value.tv_nsec    = static_cast<long>(usecTimeout % 1000000) * 1000;
+
+    if (timerfd_settime(m_TimerFD, 0, &Spec, nullptr) == 0)
+      Timeout = -1;
+  }
+
+  const int32_t Count = epoll_wait(m_EPoll, m_Events.data(), static_cast<int32_t>(m_Events.size()), Timeout);
+
+  if (Count <= 0)
+    return 0;
+
+  uint32_t NumReady = 0;
+
+  for (int32_t i = 0; i < Count; ++i)
+  {
+    const uint32_t Events = m_Events[i].events;
+
+    if (!m_Events[i].data.ptr)
+    {
+      // the timer expired (possibly one armed by an earlier call which was woken up by a socket first), acknowledge it
+
+      uint64_t Expirations;
+
+      if (read(m_TimerFD, &Expirations, sizeof(Expirations)) == -1)
+      {
+        // do nothing, it's non-blocking and there's nothing to acknowledge
+      }
+
+      continue;
+    }
+
+    if (m_Events[i].data.ptr == &m_WakeFD)
+    {
+      // another thread posted a job, clear the flag before resetting the counter so a Wake after this signals again
+
+      uint64_t Value;
+      m_WakePending = false;
+
+      if (read(m_WakeFD, &Value, sizeof(Value)) == -1)
+      {
+        // do nothing, it's non-blocking and there's nothing to reset
+      }
+
+      continue;
+    }
+
+    ++NumReady;
+
+    // errors and hangups are reported as readable so the next recv picks them up
+
+    MarkReady(static_cast<CSocket*>(m_Events[i].data.ptr), (Events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0, (Events & (EPOLLOUT | EPOLLERR)) != 0);
+  }
+
+  // if every slot was used there may be more events waiting, make room for them next time
+
+  if (static_cast<size_t>(Count) == m_Events.size())
+    m_Events.resize(m_Events.size() * 2);
+
+  return NumReady;
+}
+
+#endif
+
+#ifdef AURA_IO_URING
+
+//
+// CIOURingPoller
+//
+
+// every registered socket has one poll request outstanding in the ring, they're one-shot so a socket which fired gets re-armed on the next call to Wait
+// this gives the same level-triggered behaviour as the epoll poller, while arming, removing, waiting and reaping all happen in a single system call per loop
+// a completion is matched to its socket through the slot index and generation packed into the user data, stale completions are ignored
+// Flush queues a sendmsg request for every socket with something to send and submits and reaps all of them with one system call
+// the sends are non-blocking so they complete during the submission, a socket whose buffer is full just waits for its poll request like with DoSend
+
+class CIOURingPoller final : public CPoller
+{
+private:
+  struct CSlot
+  {
+    CSocket* m_Socket;
+    uint32_t m_Generation;
+    bool     m_Armed;
+  };
+
+  struct CSend
+  {
+    CTCPSocket*   m_Socket;
+    struct msghdr m_Message;
+    struct iovec  m_Buffers[64];
+    size_t        m_Size;   // the number of bytes in m_Buffers
+    int32_t       m_Result; // the result of the sendmsg request once it has completed
+  };
+
+  std::vector<CSlot>               m_Slots;
+  std::vector<uint32_t>            m_FreeSlots;
+  std::vector<uint32_t>            m_Rearm;        // slots which fired during the last call to Wait
+  std::vector<struct io_uring_cqe> m_Polls;        // poll completions reaped but not yet handed out (Flush reaps them too)
+  std::vector<CSend>               m_Sends;        // the sendmsg requests of the current round of Flush
+  std::vector<CTCPSocket*>         m_FlushSockets; // the sockets Flush has to go around again for
+  std::map<CSocket*, uint32_t>     m_SlotMap;      // socket -> slot index
+  struct io_uring_sqe*             m_SQEs;
+  struct io_uring_cqe*             m_CQEs;
+  void*                            m_SQRing;
+  void*                            m_CQRing;
+  size_t                           m_SQRingSize;
+  size_t                           m_CQRingSize;
+  size_t                           m_SQEsSize;
+  uint32_t*                        m_SQHead;
+  uint32_t*                        m_SQTail;
+  uint32_t*                        m_CQHead;
+  uint32_t*                        m_CQTail;
+  uint32_t                         m_SQMask;
+  uint32_t                         m_SQEntries;
+  uint32_t                         m_CQMask;
+  int                              m_Ring;
+  int                              m_WakeFD;       // eventfd signalled by Wake, it has its own poll request
+  bool                             m_WakeArmed;    // set while the poll request of m_WakeFD is outstanding
+
+  // poll requests use the generation (31 bits) and slot, the top bit marks a send request with its index in m_Sends
+  // the removals and the wakeup's poll request use the two highest values
+
+  static const uint64_t RemoveUserData = UINT64_MAX;
+  static const uint64_t WakeUserData   = UINT64_MAX - 1;
+  static const uint64_t SendUserData   = 1ULL << 63;
+
+  static inline uint64_t GetUserData(uint32_t slot, uint32_t generation) { return (static_cast<uint64_t>(generation) << 32) | slot; }
+
+  inline uint32_t GetSQPending() const { return *m_SQTail - __atomic_load_n(m_SQHead, __ATOMIC_ACQUIRE); }
+
+  struct io_uring_sqe* GetSQE();
+  void Submit();
+  void Arm(uint32_t slot);
+  void Disarm(uint32_t slot);
+  uint32_t Reap();
+  void Signal();
+
+public:
+  CIOURingPoller();
+  ~CIOURingPoller();
+
+  inline bool GetValid() const { return m_Ring != -1; }
+
+  const char* GetName() const { return "io_uring"; }
+  bool        Register(CSocket* socket);
+  void        Unregister(CSocket* socket);
+  void        UpdateInterest(CSocket* socket);
+  uint32_t    Wait(int64_t usecTimeout);
+  uint32_t    Flush(const std::vector<CTCPSocket*>& sockets);
+};
+
+CIOURingPoller::CIOURingPoller()
+  : CPoller(),
+    m_SQEs(nullptr),
+    m_CQEs(nullptr),
+    m_SQRing(MAP_FAILED),
+    m_CQRing(MAP_FAILED),
+    m_SQRingSize(0),
+    m_CQRingSize(0),
+    m_SQEsSize(0),
+    m_SQHead(nullptr),
+    m_SQTail(nullptr),
+    m_CQHead(nullptr),
+    m_CQTail(nullptr),
+    m_SQMask(0),
+    m_SQEntries(0),
+    m_CQMask(0),
+    m_Ring(-1),
+    m_WakeFD(-1),
+    m_WakeArmed(false)
+{
+  // the completion queue is sized for one poll per socket plus the removals, the kernel buffers any overflow anyway
+
+  struct io_uring_params Params;
+  memset(&Params, 0, sizeof(Params));
+  Params.flags      = IORING_SETUP_CQSIZE;
+  Params.cq_entries = 4096;
+
+  const int Ring = static_cast<int>(syscall(__NR_io_uring_setup, 256, &Params));
+
+  if (Ring == -1)
+    return;
+
+  if (!(Params.features & IORING_FEAT_EXT_ARG))
+  {
+    close(Ring);
+    return;
+  }
+
+  m_SQRingSize = Params.sq_off.array + Params.sq_entries * sizeof(uint32_t);
+  m_CQRingSize = Params.cq_off.cqes + Params.cq_entries * sizeof(struct io_uring_cqe);
+  m_SQEsSize   = Params.sq_entries * sizeof(struct io_uring_sqe);
+
+  if (Params.features & IORING_FEAT_SINGLE_MMAP)
+    m_SQRingSize = m_CQRingSize = max(m_SQRingSize, m_CQRingSize);
+
+  m_SQRing = mmap(nullptr, m_SQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_SQ_RING);
+
+  if (m_SQRing == MAP_FAILED)
+  {
+    close(Ring);
+    return;
+  }
+
+  if (Params.features & IORING_FEAT_SINGLE_MMAP)
+    m_CQRing = m_SQRing;
+  else
+    m_CQRing = mmap(nullptr, m_CQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_CQ_RING);
+
+  void* SQEs = (m_CQRing == MAP_FAILED) ? MAP_FAILED : mmap(nullptr, m_SQEsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, IORING_OFF_SQES);
+
+  if (SQEs == MAP_FAILED)
+  {
+    if (m_CQRing != MAP_FAILED && m_CQRing != m_SQRing)
+      munmap(m_CQRing, m_CQRingSize);
+
+    munmap(m_SQRing, m_SQRingSize);
+    m_SQRing = m_CQRing = MAP_FAILED;
+    close(Ring);
+    return;
+  }
+
+  uint8_t* SQ = static_cast<uint8_t*>(m_SQRing);
+  uint8_t* CQ = static_cast<uint8_t*>(m_CQRing);
+  m_SQEs      = static_cast<struct io_uring_sqe*>(SQEs);
+  m_CQEs      = reinterpret_cast<struct io_uring_cqe*>(CQ + Params.cq_off.cqes);
+  m_SQHead    = reinterpret_cast<uint32_t*>(SQ + Params.sq_off.head);
+  m_SQTail    = reinterpret_cast<uint32_t*>(SQ + Params.sq_off.tail);
+  m_CQHead    = reinterpret_cast<uint32_t*>(CQ + Params.cq_off.head);
+  m_CQTail    = reinterpret_cast<uint32_t*>(CQ + Params.cq_off.tail);
+  m_SQMask    = *reinterpret_cast<uint32_t*>(SQ + Params.sq_off.ring_mask);
+  m_SQEntries = Params.sq_entries;
+  m_CQMask    = *reinterpret_cast<uint32_t*>(CQ + Params.cq_off.ring_mask);
+
+  // the submission array is an indirection we don't need, map every position to the entry with the same index once
+
+  uint32_t* Array = reinterpret_cast<uint32_t*>(SQ + Params.sq_off.array);
+
+  for (uint32_t i = 0; i < m_SQEntries; ++i)
+    Array[i] = i;
+
+  m_Ring   = Ring;
+  m_WakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+CIOURingPoller::~CIOURingPoller()
+{
+  if (m_Ring == -1)
+    return;
+
+  if (m_WakeFD != -1)
+    close(m_WakeFD);
+
+  munmap(m_SQEs, m_SQEsSize);
+
+  if (m_CQRing != m_SQRing)
+    munmap(m_CQRing, m_CQRingSize);
+
+  munmap(m_SQRing, m_SQRingSize);
+  close(m_Ring);
+}
+
+struct io_uring_sqe* CIOURingPoller::GetSQE()
+{
+  // we're the only producer so the tail is ours, the kernel only moves the head when it consumes entries
+
+  if (GetSQPending() == m_SQEntries)
+    Submit();
+
+  const uint32_t       Tail = *m_SQTail;
+  struct io_uring_sqe* SQE  = &m_SQEs[Tail & m_SQMask];
+  memset(SQE, 0, sizeof(struct io_uring_sqe));
+  __atomic_store_n(m_SQTail, Tail + 1, __ATOMIC_RELEASE);
+  return SQE;
+}
+
+void CIOURingPoller::Submit()
+{
+  const uint32_t Pending = GetSQPending();
+
+  if (Pending > 0)
+    syscall(__NR_io_uring_enter, m_Ring, Pending, 0, 0, nullptr, 0);
+}
+
+void CIOURingPoller::Arm(uint32_t slot)
+{
+  CSlot& Slot = m_Slots[slot];
+
+  struct io_uring_sqe* SQE = GetSQE();
+  SQE->opcode              = IORING_OP_POLL_ADD;
+  SQE->fd                  = Slot.m_Socket->GetFD();
+  SQE->poll32_events       = Slot.m_Socket->GetWantWrite() ? (POLLIN | POLLOUT) : POLLIN;
+  SQE->user_data           = GetUserData(slot, Slot.m_Generation);
+  Slot.m_Armed             = true;
+}
+
+void CIOURingPoller::Disarm(uint32_t slot)
+{
+  // the poll request completes with -ECANCELED under its old generation and is ignored
+
+  CSlot& Slot = m_Slots[slot];
+
+  if (Slot.m_Armed)
+  {
+    struct io_uring_sqe* SQE = GetSQE();
+    SQE->opcode              = IORING_OP_POLL_REMOVE;
+    SQE->fd                  = -1;
+    SQE->addr                = GetUserData(slot, Slot.m_Generation);
+    SQE->user_data           = RemoveUserData;
+    Slot.m_Armed             = false;
+  }
+
+  Slot.m_Generation = (Slot.m_Generation + 1) & 0x7FFFFFFF;
+}
+
+uint32_t CIOURingPoller::Reap()
+{
+  // poll completions are kept for Wait, send completions are stored with their request and counted
+
+  uint32_t       NumSends = 0;
+  uint32_t       Head     = *m_CQHead;
+  const uint32_t Tail     = __atomic_load_n(m_CQTail, __ATOMIC_ACQUIRE);
+
+  for (; Head != Tail; ++Head)
+  {
+    const struct io_uring_cqe& CQE = m_CQEs[Head & m_CQMask];
+
+    if (CQE.user_data == RemoveUserData)
+      continue;
+
+    if (CQE.user_data == WakeUserData)
+    {
+      m_WakeArmed = false;
+      continue;
+    }
+
+    if (CQE.user_data & SendUserData)
+    {
+      m_Sends[static_cast<uint32_t>(CQE.user_data)].m_Result = CQE.res;
+      ++NumSends;
+    }
+    else
+      m_Polls.push_back(CQE);
+  }
+
+  __atomic_store_n(m_CQHead, Head, __ATOMIC_RELEASE);
+  return NumSends;
+}
+
+void CIOURingPoller::Signal()
+{
+  const uint64_t One = 1;
+
+  if (m_WakeFD != -1 && write(m_WakeFD, &One, sizeof(One)) == -1)
+  {
+    // do nothing, the counter can't overflow with the writes limited by m_WakePending
+  }
+}
+
+bool CIOURingPoller::Register(CSocket* socket)
+{
+  uint32_t Index;
+
+  if (!m_FreeSlots.empty())
+  {
+    Index = m_FreeSlots.back();
+    m_FreeSlots.pop_back();
+  }
+  else
+  {
+    Index = static_cast<uint32_t>(m_Slots.size());
+    m_Slots.push_back(CSlot{nullptr, 0, false});
+  }
+
+  m_Slots[Index].m_Socket = socket;
+  m_SlotMap[socket]       = Index;
+  Arm(Index);
+  ++m_NumSockets;
+  return true;
+}
+
+void CIOURingPoller::Unregister(CSocket* socket)
+{
+  auto i = m_SlotMap.find(socket);
+
+  if (i == end(m_SlotMap))
+    return;
+
+  const uint32_t Index = i->second;
+  m_SlotMap.erase(i);
+  Disarm(Index);
+  m_Slots[Index].m_Socket = nullptr;
+  m_FreeSlots.push_back(Index);
+  ForgetReady(socket);
+  --m_NumSockets;
+
+  // the removal goes out with the next submission (at the latest the next call to Wait), until then the outstanding poll keeps the descriptor alive
+  // a stale completion can't be mistaken for whichever socket reuses the slot or the descriptor because of the generation
+}
+
+void CIOURingPoller::UpdateInterest(CSocket* socket)
+{
+  // sockets which fired are re-armed with their current interest anyway, only an outstanding poll has to be replaced
+
+  auto i = m_SlotMap.find(socket);
+
+  if (i == end(m_SlotMap) || !m_Slots[i->second].m_Armed)
+    return;
+
+  Disarm(i->second);
+  Arm(i->second);
+}
+
+uint32_t CIOURingPoller::Wait(int64_t usecTimeout)
+{
+  ClearReady();
+
+  for (const auto& Index : m_Rearm)
+  {
+    if (m_Slots[Index].m_Socket && !m_Slots[Index].m_Armed)
+      Arm(Index);
+  }
+
+  m_Rearm.clear();
+
+  // the wakeup's poll request fires right away if Wake was called since it was last reset
+
+  if (m_WakeFD != -1 && !m_WakeArmed)
+  {
+    struct io_uring_sqe* SQE = GetSQE();
+    SQE->opcode              = IORING_OP_POLL_ADD;
+    SQE->fd                  = m_WakeFD;
+    SQE->poll32_events       = POLLIN;
+    SQE->user_data           = WakeUserData;
+    m_WakeArmed              = true;
+  }
+
+  // submit everything queued since the last call and wait for the first completion in the same call
+
+  struct __kernel_timespec Timeout;
+  Timeout.tv_sec  = usecTimeout / 1000000;
+  Timeout.tv_nsec = (usecTimeout % 1000000) * 1000;
+
+  struct io_uring_getevents_arg Arg;
+  memset(&Arg, 0, sizeof(Arg));
+  Arg.ts = reinterpret_cast<uint64_t>(&Timeout);
+
+  // don't block if Flush already reaped poll completions which still have to be handed out
+
+  const uint32_t Flags = (usecTimeout > 0 && m_Polls.empty()) ? (IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG) : 0;
+
+  if (Flags)
+    syscall(__NR_io_uring_enter, m_Ring, GetSQPending(), 1, Flags, &Arg, sizeof(Arg));
+  else
+    Submit();
+
+  Reap();
+
+  if (m_WakeFD != -1 && !m_WakeArmed)
+  {
+    // another thread posted a job (the completion may have been reaped by Flush), clear the flag before resetting the counter so a Wake after this signals again
+
+    uint64_t Value;
+    m_WakePending = false;
+
+    if (read(m_WakeFD, &Value, sizeof(Value)) == -1)
+    {
+      // do nothing, it's non-blocking and there's nothing to reset
+    }
+  }
+
+  uint32_t NumReady = 0;
+
+  for (const auto& CQE : m_Polls)
+  {
+    const uint32_t Index      = static_cast<uint32_t>(CQE.user_data);
+    const uint32_t Generation = static_cast<uint32_t>(CQE.user_data >> 32);
+
+    if (Index >= m_Slots.size() || !m_Slots[Index].m_Socket || m_Slots[Index].m_Generation != Generation)
+      continue;
+
+    m_Slots[Index].m_Armed = false;
+    m_Rearm.push_back(Index);
+    ++NumReady;
+
+    // errors and hangups are reported as readable so the next recv picks them up, as is a poll request the kernel refused
+
+    if (CQE.res < 0)
+      MarkReady(m_Slots[Index].m_Socket, true, false);
+    else
+      MarkReady(m_Slots[Index].m_Socket, (CQE.res & (POLLIN | POLLERR | POLLHUP)) != 0, (CQE.res & (POLLOUT | POLLERR)) != 0);
+  }
+
+  m_Polls.clear();
+  return NumReady;
+}
+
+uint32_t CIOURingPoller::Flush(const vector<CTCPSocket*>& sockets)
+{
+  // every round queues one sendmsg request per socket and submits them together, waiting for all of them to complete in the same system call
+  // a socket goes around again only when its whole batch was accepted and it has more than one batch queued (more than 64 segments)
+
+  uint32_t Calls = 0;
+  m_FlushSockets.assign(begin(sockets), end(sockets));
+
+  while (!m_FlushSockets.empty())
+  {
+    // the requests point into m_Sends so it mustn't be reallocated until they've all completed
+
+    m_Sends.resize(m_FlushSockets.size());
+    uint32_t NumSends = 0;
+
+    for (auto& socket : m_FlushSockets)
+    {
+      CSend&         Send = m_Sends[NumSends];
+      const uint8_t* Data[64];
+      size_t         Sizes[64];
+      const uint32_t Count = socket->GatherSend(Data, Sizes, 64, Send.m_Size);
+
+      if (Count == 0)
+        continue;
+
+      for (uint32_t i = 0; i < Count; ++i)
+      {
+        Send.m_Buffers[i].iov_base = const_cast<uint8_t*>(Data[i]);
+        Send.m_Buffers[i].iov_len  = Sizes[i];
+      }
+
+      memset(&Send.m_Message, 0, sizeof(Send.m_Message));
+      Send.m_Message.msg_iov    = Send.m_Buffers;
+      Send.m_Message.msg_iovlen = Count;
+      Send.m_Socket             = socket;
+
+      // MSG_DONTWAIT makes a full socket buffer complete the request with EAGAIN instead of leaving it waiting in the kernel
+
+      struct io_uring_sqe* SQE = GetSQE();
+      SQE->opcode              = IORING_OP_SENDMSG;
+      SQE->fd                  = socket->GetFD();
+      SQE->addr                = reinterpret_cast<uint64_t>(&Send.m_Message);
+      SQE->len                 = 1;
+      SQE->msg_flags           = MSG_NOSIGNAL | MSG_DONTWAIT;
+      SQE->user_data           = SendUserData | NumSends;
+      ++NumSends;
+    }
+
+    m_FlushSockets.clear();
+
+    if (NumSends == 0)
+      break;
+
+    for (uint32_t Remaining = NumSends; Remaining > 0;)
+    {
+      syscall(__NR_io_uring_enter, m_Ring, GetSQPending(), Remaining, IORING_ENTER_GETEVENTS, nullptr, 0);
+      Remaining -= Reap();
+      ++Calls;
+    }
+
+    for (uint32_t i = 0; i < NumSends; ++i)
+    {
+      const CSend& Send = m_Sends[i];
+
+      if (Send.m_Socket->EventSent(Send.m_Result < 0 ? SOCKET_ERROR : Send.m_Result, Send.m_Size, -Send.m_Result))
+        m_FlushSockets.push_back(Send.m_Socket);
+    }
+  }
+
+  return Calls;
+}
+
+#endif
+
+//
+// CSelectPoller
+//
+
+class CSelectPoller final : public CPoller
+{
+private:
+  std::vector<CSocket*> m_Sockets;
+  SOCKET                m_WakeSocket; // UDP socket connected to itself, Wake sends it a byte (a pipe can't be selected on Windows)
+
+  void Signal();
+
+public:
+  CSelectPoller();
+  ~CSelectPoller();
+
+  const char* GetName() const { return "select"; }
+  bool        Register(CSocket* socket);
+  void        Unregister(CSocket* socket);
+  void        UpdateInterest(CSocket* socket);
+  uint32_t    Wait(int64_t usecTimeout);
+};
+
+CSelectPoller::CSelectPoller()
+  : CPoller(),
+    m_WakeSocket(socket(AF_INET, SOCK_DGRAM, 0))
+{
+  if (m_WakeSocket == INVALID_SOCKET)
+    return;
+
+  struct sockaddr_in Address;
+  socklen_t          Length = sizeof(Address);
+  memset(&Address, 0, sizeof(Address));
+  Address.sin_family      = AF_INET;
+  Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  Address.sin_port        = 0;
+
+  if (::bind(m_WakeSocket, reinterpret_cast<struct sockaddr*>(&Address), sizeof(Address)) == SOCKET_ERROR || getsockname(m_WakeSocket, reinterpret_cast<struct sockaddr*>(&Address), &Length) == SOCKET_ERROR || connect(m_WakeSocket, reinterpret_cast<struct sockaddr*>(&Address), sizeof(Address)) == SOCKET_ERROR)
+  {
+    closesocket(m_WakeSocket);
+    m_WakeSocket = INVALID_SOCKET;
+    return;
+  }
+
+#ifdef WIN32
+  u_long Mode = 1;
+  ioctlsocket(m_WakeSocket, FIONBIO, &Mode);
+#else
+  fcntl(m_WakeSocket, F_SETFL, fcntl(m_WakeSocket, F_GETFL) | O_NONBLOCK);
+#endif
+}
+
+CSelectPoller::~CSelectPoller()
+{
+  if (m_WakeSocket != INVALID_SOCKET)
+    closesocket(m_WakeSocket);
+}
+
+void CSelectPoller::Signal()
+{
+  if (m_WakeSocket != INVALID_SOCKET)
+    send(m_WakeSocket, "", 1, 0);
+}
+
+bool CSelectPoller::Register(CSocket* socket)
+{
+#ifdef WIN32
+  if (m_Sockets.size() >= FD_SETSIZE)
+#else
+  if (socket->GetFD() >= FD_SETSIZE)
+#endif
+  {
+    Print("[POLLER] too many sockets for select (FD_SETSIZE is " + to_string(FD_SETSIZE) + "), use the epoll poller instead");
+    return false;
+  }
+
+  m_Sockets.push_back(socket);
+  ++m_NumSockets;
+  return true;
+}
+
+void CSelectPoller::Unregister(CSocket* socket)
+{
+  auto i = find(begin(m_Sockets), end(m_Sockets), socket);
+
+  if (i != end(m_Sockets))
+  {
+    m_Sockets.erase(i);
+    --m_NumSockets;
+  }
+
+  ForgetReady(socket);
+}
+
+void CSelectPoller::UpdateInterest(CSocket*)
+{
+  // the fd_sets are rebuilt on every call to Wait so there's nothing to do here
+}
+
+uint32_t CSelectPoller::Wait(int64_t usecTimeout)
+{
+  ClearReady();
+
+  if (m_Sockets.empty() && m_WakeSocket == INVALID_SOCKET)
+  {
+    // select returns immediately (or fails on Windows) when there's nothing to wait for and we'd chew up the CPU, so sleep instead
+
+    std::this_thread::sleep_for(std::chrono::microseconds(usecTimeout));
+    return 0;
+  }
+
+  fd_set  fd, send_fd;
+  int32_t nfds = 0;
+  FD_ZERO(&fd);
+  FD_ZERO(&send_fd);
+
+  if (m_WakeSocket != INVALID_SOCKET)
+  {
+    FD_SET(m_WakeSocket, &fd);
+
+#ifndef WIN32
+    nfds = m_WakeSocket;
+#endif
+  }
+
+  for (auto& socket : m_Sockets)
+  {
+    FD_SET(socket->GetFD(), &fd);
+
+    if (socket->GetWantWrite())
+      FD_SET(socket->GetFD(), &send_fd);
+
+#ifndef WIN32
+    if (socket->GetFD() > nfds)
+      nfds = socket->GetFD();
+#endif
+  }
+
+  struct timeval tv;
+  tv.tv_sec  = static_cast<long int>(usecTimeout / 1000000);
+  tv.tv_usec = static_cast<long int>(usecTimeout % 1000000);
+
+  if (select(nfds + 1, &fd, &send_fd, nullptr, &tv) <= 0)
+    return 0;
+
+  if (m_WakeSocket != INVALID_SOCKET && FD_ISSET(m_WakeSocket, &fd))
+  {
+    // another thread posted a job, clear the flag before draining the socket so a Wake after this signals again
+
+    char Buffer[16];
+    m_WakePending = false;
+
+    while (recv(m_WakeSocket, Buffer, sizeof(Buffer), 0) > 0)
+      ;
+  }
+
+  for (auto& socket : m_Sockets)
+    MarkReady(socket, FD_ISSET(socket->GetFD(), &fd) != 0, FD_ISSET(socket->GetFD(), &send_fd) != 0);
+
+  return m_Ready.size();
+}
+
+CPoller* CPoller::Create(const string& backend)
+{
+#ifdef __linux__
+  if (backend == "io_uring")
+  {
+#ifdef AURA_IO_URING
+    auto Poller = new CIOURingPoller();
+
+    if (Poller->GetValid())
+      return Poller;
+
+    Print("[POLLER] unable to create io_uring instance (requires Linux 5.11), falling back to epoll");
+    delete Poller;
+#else
+    Print("[POLLER] poller [io_uring] isn't supported by this build, falling back to epoll");
+#endif
+  }
+
+  if (backend != "select")
+  {
+    auto Poller = new CEPollPoller();
+
+    if (Poller->GetValid())
+      return Poller;
+
+    Print("[POLLER] unable to create epoll instance, falling back to select");
+    delete Poller;
+  }
+#else
+  if (!backend.empty() && backend != "select")
+    Print("[POLLER] poller [" + backend + "] isn't available on this platform, falling back to select");
+#endif
+
+  return new CSelectPoller();
+}
@@ -0,0 +1,85 @@
+/*
+
+   Copyright [2010] [Josko Nikolic]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+ */
+
+#ifndef AURA_POLLER_H_
+#define AURA_POLLER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CSocket;
+class CTCPSocket;
+
+//
+// CPoller
+//
+
+// sockets are registered once (when they start connecting, listening or are accepted) instead of being thrown into a fresh fd_set every loop
+// after Wait returns only the sockets which are actually ready have their readable/writable flags set, the rest are left untouched
+// write interest is only requested while a socket has data it couldn't send (or is still connecting) so idle sockets never wake us up
+// other threads can interrupt Wait with Wake (through a descriptor only the poller itself waits on) when they post a job to the thread owning the poller
+
+class CPoller
+{
+protected:
+  std::vector<CSocket*> m_Ready;       // sockets flagged ready by the last call to Wait, their flags are cleared on the next call
+  uint32_t              m_NumSockets;  // number of registered sockets
+  std::atomic<bool>     m_WakePending; // set from the first call to Wake until Wait consumes the wakeup so posting many jobs only signals once
+
+  CPoller();
+
+  // makes the current or next call to Wait return, Wait clears m_WakePending when it consumes the signal
+
+  virtual void Signal() = 0;
+
+  void ClearReady();
+  void MarkReady(CSocket* socket, bool readable, bool writable);
+  void ForgetReady(CSocket* socket);
+
+public:
+  virtual ~CPoller();
+  CPoller(CPoller&) = delete;
+
+  // creates the poller named by backend ("io_uring", "epoll" or "select"), falling back to the best one available on this platform
+
+  static CPoller* Create(const std::string& backend);
+
+  virtual const char* GetName() const = 0;
+  virtual bool Register(CSocket* socket)   = 0;
+  virtual void Unregister(CSocket* socket) = 0;
+  virtual void UpdateInterest(CSocket* socket) = 0;
+
+  // blocks for at most usecTimeout microseconds and returns the number of ready sockets
+
+  virtual uint32_t Wait(int64_t usecTimeout) = 0;
+
+  // makes the current or next call to Wait return right away, this is the only function which can be called from any thread
+
+  void Wake();
+
+  // sends what's queued on the sockets (which must be registered with this poller or none at all) and returns the number of system calls it took
+  // by default each socket is flushed with its own send calls, a poller may batch them
+
+  virtual uint32_t Flush(const std::vector<CTCPSocket*>& sockets);
+
+  inline uint32_t GetNumSockets() const { return m_NumSockets; }
+};
+
+#endif // AURA_POLLER_H_
@@ -0,0 +1,166 @@
+/*
+
+   Copyright [2010] [Josko Nikolic]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+ */
+
+#include "resolver.h"
+#include "socket.h"
+#include "includes.h"
+
+#include <cstring>
+
+#ifdef WIN32
+#include <ws2tcpip.h>
+#endif
+
+using namespace std;
+
+//
+// CResolver
+//
+
+CResolver::CResolver(int64_t nTTL)
+  : m_TTL(nTTL),
+    m_Exiting(false)
+{
+  m_Thread = thread(&CResolver::Run, this);
+}
+
+CResolver::~CResolver()
+{
+  // a lookup which is running right now is finished first, anything still waiting is thrown away along with its callbacks
+
+  {
+    lock_guard<mutex> Lock(m_Mutex);
+    m_Exiting = true;
+  }
+
+  m_Wake.notify_one();
+  m_Thread.join();
+}
+
+void CResolver::Run()
+{
+  unique_lock<mutex> Lock(m_Mutex);
+
+  while (true)
+  {
+    m_Wake.wait(Lock, [this]() { return m_Exiting || !m_Requests.empty(); });
+
+    if (m_Exiting)
+      return;
+
+    const string Host = m_Requests.front();
+    m_Requests.pop();
+
+    Lock.unlock();
+
+    struct addrinfo  Hints;
+    struct addrinfo* Result = nullptr;
+    string           Address;
+    memset(&Hints, 0, sizeof(Hints));
+    Hints.ai_family   = AF_INET;
+    Hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(Host.c_str(), nullptr, &Hints, &Result) == 0 && Result)
+    {
+      // inet_ntoa isn't safe to call from more than one thread so build the string ourselves
+
+      const uint8_t* IP = reinterpret_cast<const uint8_t*>(&reinterpret_cast<struct sockaddr_in*>(Result->ai_addr)->sin_addr);
+      Address           = to_string(IP[0]) + "." + to_string(IP[1]) + "." + to_string(IP[2]) + "." + to_string(IP[3]);
+    }
+
+    if (Result)
+      freeaddrinfo(Result);
+
+    Lock.lock();
+
+    m_Finished.emplace(Host, Address);
+  }
+}
+
+void CResolver::Resolve(const string& host, function<void(const string&)> callback)
+{
+  // addresses don't need resolving
+
+  if (inet_addr(host.c_str()) != INADDR_NONE)
+  {
+    callback(host);
+    return;
+  }
+
+  auto Cached = m_Cache.find(host);
+
+  if (Cached != end(m_Cache))
+  {
+    if (GetTime() < Cached->second.second)
+    {
+      callback(Cached->second.first);
+      return;
+    }
+
+    m_Cache.erase(Cached);
+  }
+
+  // only look each host name up once no matter how many are waiting for it
+
+  auto& Callbacks = m_Pending[host];
+  Callbacks.push_back(std::move(callback));
+
+  if (Callbacks.size() > 1)
+    return;
+
+  {
+    lock_guard<mutex> Lock(m_Mutex);
+    m_Requests.push(host);
+  }
+
+  m_Wake.notify_one();
+}
+
+void CResolver::Update()
+{
+  queue<pair<string, string>> Finished;
+
+  {
+    lock_guard<mutex> Lock(m_Mutex);
+    Finished.swap(m_Finished);
+  }
+
+  while (!Finished.empty())
+  {
+    const string Host    = Finished.front().first;
+    const string Address = Finished.front().second;
+    Finished.pop();
+
+    if (!Address.empty())
+      m_Cache[Host] = make_pair(Address, GetTime() + m_TTL);
+
+    // take the callbacks out first so they can resolve the same host name again if they want to
+
+    auto Pending = m_Pending.find(Host);
+
+    if (Pending == end(m_Pending))
+      continue;
+
+    vector<function<void(const string&)>> Callbacks;
+    Callbacks.swap(Pending->second);
+    m_Pending.erase(Pending);
+
+    for (auto& callback : Callbacks)
+      callback(Address);
+  }
+}
@@ -0,0 +1,68 @@
+/*
+
+   Copyright [2010] [Josko Nikolic]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+ */
+
+#ifndef AURA_RESOLVER_H_
+#define AURA_RESOLVER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <queue>
+#include <utility>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//
+// CResolver
+//
+
+// resolving a host name can take seconds when the name server is slow or unreachable and the main loop would stop updating everything in the meantime
+// so the lookups are done with getaddrinfo on a separate thread, the main loop picks up the results in Update and hands them to the callbacks
+// successful lookups are cached for m_TTL seconds so reconnecting over and over doesn't mean looking the same name up over and over
+
+class CResolver
+{
+private:
+  std::queue<std::string>                                                      m_Requests; // host names waiting to be resolved
+  std::queue<std::pair<std::string, std::string>>                              m_Finished; // host names which have been resolved and their address (empty if the lookup failed)
+  std::map<std::string, std::vector<std::function<void(const std::string&)>>> m_Pending;  // callbacks waiting for a host name to be resolved (only touched by the main thread)
+  std::map<std::string, std::pair<std::string, int64_t>>                       m_Cache;    // resolved addresses and the GetTime they expire at (only touched by the main thread)
+  std::mutex                                                                   m_Mutex;    // protects the queues and m_Exiting
+  std::condition_variable                                                      m_Wake;     // signalled when a host name is queued or we're exiting
+  std::thread                                                                  m_Thread;
+  int64_t                                                                      m_TTL;
+  bool                                                                         m_Exiting;
+
+  void Run();
+
+public:
+  explicit CResolver(int64_t nTTL);
+  ~CResolver();
+  CResolver(CResolver&) = delete;
+
+  // the callback gets the address as a dotted decimal string or an empty string if the host name couldn't be resolved
+  // it's called right away if the host is already an address or cached, otherwise from Update once the lookup is done
+
+  void Resolve(const std::string& host, std::function<void(const std::string&)> callback);
+  void Update();
+};
+
+#endif // AURA_RESOLVER_H_
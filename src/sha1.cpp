@@ -1,215 +1,452 @@
-/*
-  100% free public domain implementation of the SHA-1
-  algorithm by Dominik Reichl <Dominik.Reichl@tiscali.de>
-
- * modified by Trevor Hogan for use with GHost++ *
-
-  === Test Vectors (from FIPS PUB 180-1) ===
-
-  "abc"
-    A9993E36 4706816A BA3E2571 7850C26C 9CD0D89D
-
-  "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
-    84983E44 1C3BD26E BAAE4AA1 F95129E5 E54670F1
-
-  A million repetitions of "a"
-    34AA973C D4C4DAA4 F61EEB2B DBAD2731 6534016F
- */
-
-#include "sha1.h"
-
-CSHA1::CSHA1()
-{
-  Reset();
-}
-
-CSHA1::~CSHA1()
-{
-  Reset();
-}
-
-void CSHA1::Reset()
-{
-  // SHA1 initialization constants
-  m_state[0] = 0x67452301;
-  m_state[1] = 0xEFCDAB89;
-  m_state[2] = 0x98BADCFE;
-  m_state[3] = 0x10325476;
-  m_state[4] = 0xC3D2E1F0;
-
-  m_count[0] = 0;
-  m_count[1] = 0;
-}
-
-void CSHA1::Transform(uint32_t state[5], uint8_t buffer[64])
-{
-  uint32_t a = 0, b = 0, c = 0, d = 0, e = 0;
-
-  SHA1_WORKSPACE_BLOCK* block;
-  static uint8_t        workspace[64];
-  block = reinterpret_cast<SHA1_WORKSPACE_BLOCK*>(workspace);
-  memcpy(block, buffer, 64);
-
-  // Copy state[] to working vars
-  a = state[0];
-  b = state[1];
-  c = state[2];
-  d = state[3];
-  e = state[4];
-
-  // 4 rounds of 20 operations each. Loop unrolled.
-  R0(a, b, c, d, e, 0);
-  R0(e, a, b, c, d, 1);
-  R0(d, e, a, b, c, 2);
-  R0(c, d, e, a, b, 3);
-  R0(b, c, d, e, a, 4);
-  R0(a, b, c, d, e, 5);
-  R0(e, a, b, c, d, 6);
-  R0(d, e, a, b, c, 7);
-  R0(c, d, e, a, b, 8);
-  R0(b, c, d, e, a, 9);
-  R0(a, b, c, d, e, 10);
-  R0(e, a, b, c, d, 11);
-  R0(d, e, a, b, c, 12);
-  R0(c, d, e, a, b, 13);
-  R0(b, c, d, e, a, 14);
-  R0(a, b, c, d, e, 15);
-  R1(e, a, b, c, d, 16);
-  R1(d, e, a, b, c, 17);
-  R1(c, d, e, a, b, 18);
-  R1(b, c, d, e, a, 19);
-  R2(a, b, c, d, e, 20);
-  R2(e, a, b, c, d, 21);
-  R2(d, e, a, b, c, 22);
-  R2(c, d, e, a, b, 23);
-  R2(b, c, d, e, a, 24);
-  R2(a, b, c, d, e, 25);
-  R2(e, a, b, c, d, 26);
-  R2(d, e, a, b, c, 27);
-  R2(c, d, e, a, b, 28);
-  R2(b, c, d, e, a, 29);
-  R2(a, b, c, d, e, 30);
-  R2(e, a, b, c, d, 31);
-  R2(d, e, a, b, c, 32);
-  R2(c, d, e, a, b, 33);
-  R2(b, c, d, e, a, 34);
-  R2(a, b, c, d, e, 35);
-  R2(e, a, b, c, d, 36);
-  R2(d, e, a, b, c, 37);
-  R2(c, d, e, a, b, 38);
-  R2(b, c, d, e, a, 39);
-  R3(a, b, c, d, e, 40);
-  R3(e, a, b, c, d, 41);
-  R3(d, e, a, b, c, 42);
-  R3(c, d, e, a, b, 43);
-  R3(b, c, d, e, a, 44);
-  R3(a, b, c, d, e, 45);
-  R3(e, a, b, c, d, 46);
-  R3(d, e, a, b, c, 47);
-  R3(c, d, e, a, b, 48);
-  R3(b, c, d, e, a, 49);
-  R3(a, b, c, d, e, 50);
-  R3(e, a, b, c, d, 51);
-  R3(d, e, a, b, c, 52);
-  R3(c, d, e, a, b, 53);
-  R3(b, c, d, e, a, 54);
-  R3(a, b, c, d, e, 55);
-  R3(e, a, b, c, d, 56);
-  R3(d, e, a, b, c, 57);
-  R3(c, d, e, a, b, 58);
-  R3(b, c, d, e, a, 59);
-  R4(a, b, c, d, e, 60);
-  R4(e, a, b, c, d, 61);
-  R4(d, e, a, b, c, 62);
-  R4(c, d, e, a, b, 63);
-  R4(b, c, d, e, a, 64);
-  R4(a, b, c, d, e, 65);
-  R4(e, a, b, c, d, 66);
-  R4(d, e, a, b, c, 67);
-  R4(c, d, e, a, b, 68);
-  R4(b, c, d, e, a, 69);
-  R4(a, b, c, d, e, 70);
-  R4(e, a, b, c, d, 71);
-  R4(d, e, a, b, c, 72);
-  R4(c, d, e, a, b, 73);
-  R4(b, c, d, e, a, 74);
-  R4(a, b, c, d, e, 75);
-  R4(e, a, b, c, d, 76);
-  R4(d, e, a, b, c, 77);
-  R4(c, d, e, a, b, 78);
-  R4(b, c, d, e, a, 79);
-
-  // Add the working vars back into state[]
-  state[0] += a;
-  state[1] += b;
-  state[2] += c;
-  state[3] += d;
-  state[4] += e;
-}
-
-// Use this function to hash in binary data and strings
-
-void CSHA1::Update(uint8_t* data, uint32_t len)
-{
-  uint32_t i = 0, j = 0;
-
-  j = (m_count[0] >> 3) & 63;
-
-  if ((m_count[0] += len << 3) < (len << 3))
-    m_count[1]++;
-
-  m_count[1] += (len >> 29);
-
-  if ((j + len) > 63)
-  {
-    memcpy(&m_buffer[j], data, (i = 64 - j));
-    Transform(m_state, m_buffer);
-
-    for (; i + 63 < len; i += 64)
-    {
-      Transform(m_state, &data[i]);
-    }
-
-    j = 0;
-  }
-  else
-    i = 0;
-
-  memcpy(&m_buffer[j], &data[i], len - i);
-}
-
-void CSHA1::Final()
-{
-  uint32_t i             = 0;
-  uint8_t  finalcount[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-
-  for (i          = 0; i < 8; ++i)
-    finalcount[i] = static_cast<uint8_t>((m_count[(i >= 4 ? 0 : 1)] >> ((3 - (i & 3)) * 8)) & 255); // Endian independent
-
-  Update((uint8_t*)"\200", 1);
-
-  while ((m_count[0] & 504) != 448)
-    Update((uint8_t*)"\0", 1);
-
-  Update(finalcount, 8); // Cause a SHA1Transform()
-
-  for (i = 0; i < 20; ++i)
-  {
-    m_digest[i] = static_cast<uint8_t>((m_state[i >> 2] >> ((3 - (i & 3)) * 8)) & 255);
-  }
-
-  // Wipe variables for security reasons
-  memset(m_buffer, 0, 64);
-  memset(m_state, 0, 20);
-  memset(m_count, 0, 8);
-  memset(finalcount, 0, 8);
-
-  Transform(m_state, m_buffer);
-}
-
-// Get the raw message digest
-
-void CSHA1::GetHash(uint8_t* uDest)
-{
-  memcpy(uDest, m_digest, 20);
-}
+/*
+  100% free public domain implementation of the SHA-1
+  algorithm by Dominik Reichl <Dominik.Reichl@tiscali.de>
+
+ * modified by Trevor Hogan for use with GHost++ *
+
+  === Test Vectors (from FIPS PUB 180-1) ===
+
+  "abc"
+    A9993E36 4706816A BA3E2571 7850C26C 9CD0D89D
+
+  "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+    84983E44 1C3BD26E BAAE4AA1 F95129E5 E54670F1
+
+  A million repetitions of "a"
+    34AA973C D4C4DAA4 F61EEB2B DBAD2731 6534016F
+ */
+
+#include "sha1.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define AURA_SHA1_SHANI
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SHANI_TARGET
+#else
+#include <cpuid.h>
+#define SHANI_TARGET __attribute__((target("sha,ssse3,sse4.1")))
+#endif
+#endif
+
+#ifdef AURA_SHA1_SHANI
+
+// the SHA extensions (on x86 CPUs since AMD Zen and Intel Goldmont/Ice Lake) do a whole block in a few dozen instructions
+// this is only compiled for those instructions and only called if the CPU reports having them so the binary still runs everywhere
+
+static bool HasSHAExtensions()
+{
+#ifdef _MSC_VER
+  int Info[4];
+  __cpuid(Info, 0);
+
+  if (Info[0] < 7)
+    return false;
+
+  __cpuid(Info, 1);
+  const bool SSSE3 = (Info[2] & (1 << 9)) != 0;
+  const bool SSE41 = (Info[2] & (1 << 19)) != 0;
+  __cpuidex(Info, 7, 0);
+  return SSSE3 && SSE41 && (Info[1] & (1 << 29)) != 0;
+#else
+  uint32_t a, b, c, d;
+
+  if (!__get_cpuid(1, &a, &b, &c, &d))
+    return false;
+
+  const bool SSSE3 = (c & (1 << 9)) != 0;
+  const bool SSE41 = (c & (1 << 19)) != 0;
+
+  if (!__get_cpuid_count(7, 0, &a, &b, &c, &d))
+    return false;
+
+  return SSSE3 && SSE41 && (b & (1 << 29)) != 0;
+#endif
+}
+
+SHANI_TARGET static void TransformSHANI(uint32_t state[5], const uint8_t* data, uint32_t blocks)
+{
+  const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+  __m128i       ABCD = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+  __m128i       E0   = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+  __m128i       E1, MSG0, MSG1, MSG2, MSG3;
+
+  for (; blocks > 0; --blocks, data += 64)
+  {
+    const __m128i ABCD_SAVE = ABCD;
+    const __m128i E0_SAVE   = E0;
+
+    // rounds 0-3
+    MSG0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0)), MASK);
+    E0   = _mm_add_epi32(E0, MSG0);
+    E1   = ABCD;
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+
+    // rounds 4-7
+    MSG1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)), MASK);
+    E1   = _mm_sha1nexte_epu32(E1, MSG1);
+    E0   = ABCD;
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+    MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+
+    // rounds 8-11
+    MSG2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)), MASK);
+    E0   = _mm_sha1nexte_epu32(E0, MSG2);
+    E1   = ABCD;
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+    MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+    MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+    // rounds 12-15
+    MSG3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)), MASK);
+    E1   = _mm_sha1nexte_epu32(E1, MSG3);
+    E0   = ABCD;
+    MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+    MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+    MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+    // rounds 16-19
+    E0   = _mm_sha1nexte_epu32(E0, MSG0);
+    E1   = ABCD;
+    MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+    MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+    MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+    // rounds 20-23
+    E1   = _mm_sha1nexte_epu32(E1, MSG1);
+    E0   = ABCD;
+    MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+    MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+    MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+    // rounds 24-27
+    E0   = _mm_sha1nexte_epu32(E0, MSG2);
+    E1   = ABCD;
+    MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+    MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+    MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+    // rounds 28-31
+    E1   = _mm_sha1nexte_epu32(E1, MSG3);
+    E0   = ABCD;
+    MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+    MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+    MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+    // rounds 32-35
+    E0   = _mm_sha1nexte_epu32(E0, MSG0);
+    E1   = ABCD;
+    MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+    MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+    MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+    // rounds 36-39
+    E1   = _mm_sha1nexte_epu32(E1, MSG1);
+    E0   = ABCD;
+    MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+    MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+    MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+    // rounds 40-43
+    E0   = _mm_sha1nexte_epu32(E0, MSG2);
+    E1   = ABCD;
+    MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+    MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+    MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+    // rounds 44-47
+    E1   = _mm_sha1nexte_epu32(E1, MSG3);
+    E0   = ABCD;
+    MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+    MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+    MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+    // rounds 48-51
+    E0   = _mm_sha1nexte_epu32(E0, MSG0);
+    E1   = ABCD;
+    MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+    MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+    MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+    // rounds 52-55
+    E1   = _mm_sha1nexte_epu32(E1, MSG1);
+    E0   = ABCD;
+    MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+    MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+    MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+    // rounds 56-59
+    E0   = _mm_sha1nexte_epu32(E0, MSG2);
+    E1   = ABCD;
+    MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+    MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+    MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+    // rounds 60-63
+    E1   = _mm_sha1nexte_epu32(E1, MSG3);
+    E0   = ABCD;
+    MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+    MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+    MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+    // rounds 64-67
+    E0   = _mm_sha1nexte_epu32(E0, MSG0);
+    E1   = ABCD;
+    MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+    MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+    MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+    // rounds 68-71
+    E1   = _mm_sha1nexte_epu32(E1, MSG1);
+    E0   = ABCD;
+    MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+    MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+    // rounds 72-75
+    E0   = _mm_sha1nexte_epu32(E0, MSG2);
+    E1   = ABCD;
+    MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+
+    // rounds 76-79
+    E1   = _mm_sha1nexte_epu32(E1, MSG3);
+    E0   = ABCD;
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+
+    // add the working vars back into state
+    E0   = _mm_sha1nexte_epu32(E0, E0_SAVE);
+    ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+  }
+
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(ABCD, 0x1B));
+  state[4] = static_cast<uint32_t>(_mm_extract_epi32(E0, 3));
+}
+
+#endif
+
+CSHA1::CSHA1()
+{
+  Reset();
+}
+
+CSHA1::~CSHA1()
+{
+  Reset();
+}
+
+void CSHA1::Reset()
+{
+  // SHA1 initialization constants
+  m_state[0] = 0x67452301;
+  m_state[1] = 0xEFCDAB89;
+  m_state[2] = 0x98BADCFE;
+  m_state[3] = 0x10325476;
+  m_state[4] = 0xC3D2E1F0;
+
+  m_count[0] = 0;
+  m_count[1] = 0;
+}
+
+void CSHA1::Transform(uint32_t state[5], const uint8_t buffer[64])
+{
+  uint32_t a = 0, b = 0, c = 0, d = 0, e = 0;
+
+  // the workspace is on the stack (not static) so separate CSHA1's can be used from separate threads
+  SHA1_WORKSPACE_BLOCK  workspace;
+  SHA1_WORKSPACE_BLOCK* block = &workspace;
+  memcpy(block, buffer, 64);
+
+  // Copy state[] to working vars
+  a = state[0];
+  b = state[1];
+  c = state[2];
+  d = state[3];
+  e = state[4];
+
+  // 4 rounds of 20 operations each. Loop unrolled.
+  R0(a, b, c, d, e, 0);
+  R0(e, a, b, c, d, 1);
+  R0(d, e, a, b, c, 2);
+  R0(c, d, e, a, b, 3);
+  R0(b, c, d, e, a, 4);
+  R0(a, b, c, d, e, 5);
+  R0(e, a, b, c, d, 6);
+  R0(d, e, a, b, c, 7);
+  R0(c, d, e, a, b, 8);
+  R0(b, c, d, e, a, 9);
+  R0(a, b, c, d, e, 10);
+  R0(e, a, b, c, d, 11);
+  R0(d, e, a, b, c, 12);
+  R0(c, d, e, a, b, 13);
+  R0(b, c, d, e, a, 14);
+  R0(a, b, c, d, e, 15);
+  R1(e, a, b, c, d, 16);
+  R1(d, e, a, b, c, 17);
+  R1(c, d, e, a, b, 18);
+  R1(b, c, d, e, a, 19);
+  R2(a, b, c, d, e, 20);
+  R2(e, a, b, c, d, 21);
+  R2(d, e, a, b, c, 22);
+  R2(c, d, e, a, b, 23);
+  R2(b, c, d, e, a, 24);
+  R2(a, b, c, d, e, 25);
+  R2(e, a, b, c, d, 26);
+  R2(d, e, a, b, c, 27);
+  R2(c, d, e, a, b, 28);
+  R2(b, c, d, e, a, 29);
+  R2(a, b, c, d, e, 30);
+  R2(e, a, b, c, d, 31);
+  R2(d, e, a, b, c, 32);
+  R2(c, d, e, a, b, 33);
+  R2(b, c, d, e, a, 34);
+  R2(a, b, c, d, e, 35);
+  R2(e, a, b, c, d, 36);
+  R2(d, e, a, b, c, 37);
+  R2(c, d, e, a, b, 38);
+  R2(b, c, d, e, a, 39);
+  R3(a, b, c, d, e, 40);
+  R3(e, a, b, c, d, 41);
+  R3(d, e, a, b, c, 42);
+  R3(c, d, e, a, b, 43);
+  R3(b, c, d, e, a, 44);
+  R3(a, b, c, d, e, 45);
+  R3(e, a, b, c, d, 46);
+  R3(d, e, a, b, c, 47);
+  R3(c, d, e, a, b, 48);
+  R3(b, c, d, e, a, 49);
+  R3(a, b, c, d, e, 50);
+  R3(e, a, b, c, d, 51);
+  R3(d, e, a, b, c, 52);
+  R3(c, d, e, a, b, 53);
+  R3(b, c, d, e, a, 54);
+  R3(a, b, c, d, e, 55);
+  R3(e, a, b, c, d, 56);
+  R3(d, e, a, b, c, 57);
+  R3(c, d, e, a, b, 58);
+  R3(b, c, d, e, a, 59);
+  R4(a, b, c, d, e, 60);
+  R4(e, a, b, c, d, 61);
+  R4(d, e, a, b, c, 62);
+  R4(c, d, e, a, b, 63);
+  R4(b, c, d, e, a, 64);
+  R4(a, b, c, d, e, 65);
+  R4(e, a, b, c, d, 66);
+  R4(d, e, a, b, c, 67);
+  R4(c, d, e, a, b, 68);
+  R4(b, c, d, e, a, 69);
+  R4(a, b, c, d, e, 70);
+  R4(e, a, b, c, d, 71);
+  R4(d, e, a, b, c, 72);
+  R4(c, d, e, a, b, 73);
+  R4(b, c, d, e, a, 74);
+  R4(a, b, c, d, e, 75);
+  R4(e, a, b, c, d, 76);
+  R4(d, e, a, b, c, 77);
+  R4(c, d, e, a, b, 78);
+  R4(b, c, d, e, a, 79);
+
+  // Add the working vars back into state[]
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+// Use this function to hash in binary data and strings
+
+void CSHA1::Update(uint8_t* data, uint32_t len)
+{
+  uint32_t i = 0, j = 0;
+
+  j = (m_count[0] >> 3) & 63;
+
+  if ((m_count[0] += len << 3) < (len << 3))
+    m_count[1]++;
+
+  m_count[1] += (len >> 29);
+
+  if ((j + len) > 63)
+  {
+    memcpy(&m_buffer[j], data, (i = 64 - j));
+    TransformBlocks(m_buffer, 1);
+
+    const uint32_t blocks = (len - i) / 64;
+    TransformBlocks(&data[i], blocks);
+    i += blocks * 64;
+
+    j = 0;
+  }
+  else
+    i = 0;
+
+  memcpy(&m_buffer[j], &data[i], len - i);
+}
+
+void CSHA1::Final()
+{
+  uint32_t i             = 0;
+  uint8_t  finalcount[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+  for (i          = 0; i < 8; ++i)
+    finalcount[i] = static_cast<uint8_t>((m_count[(i >= 4 ? 0 : 1)] >> ((3 - (i & 3)) * 8)) & 255); // Endian independent
+
+  Update((uint8_t*)"\200", 1);
+
+  while ((m_count[0] & 504) != 448)
+    Update((uint8_t*)"\0", 1);
+
+  Update(finalcount, 8); // Cause a SHA1Transform()
+
+  for (i = 0; i < 20; ++i)
+  {
+    m_digest[i] = static_cast<uint8_t>((m_state[i >> 2] >> ((3 - (i & 3)) * 8)) & 255);
+  }
+
+  // Wipe variables for security reasons
+  memset(m_buffer, 0, 64);
+  memset(m_state, 0, 20);
+  memset(m_count, 0, 8);
+  memset(finalcount, 0, 8);
+
+  Transform(m_state, m_buffer);
+}
+
+void CSHA1::TransformBlocks(const uint8_t* data, uint32_t blocks)
+{
+#ifdef AURA_SHA1_SHANI
+  static const bool UseSHANI = HasSHAExtensions();
+
+  if (UseSHANI)
+  {
+    TransformSHANI(m_state, data, blocks);
+    return;
+  }
+#endif
+
+  for (uint32_t i = 0; i < blocks; ++i)
+    Transform(m_state, &data[i * 64]);
+}
+
+// Get the raw message digest
+
+void CSHA1::GetHash(uint8_t* uDest)
+{
+  memcpy(uDest, m_digest, 20);
+}
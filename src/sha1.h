@@ -100,7 +100,10 @@ public:
 
 private:
   // Private SHA-1 transformation
-  void Transform(uint32_t state[5], uint8_t buffer[64]);
+  void Transform(uint32_t state[5], const uint8_t buffer[64]);
+
+  // Transform a run of whole blocks, using the SHA extensions if the CPU has them
+  void TransformBlocks(const uint8_t* data, uint32_t blocks);
 };
 
 #endif // AURA_SHA1_H_
@@ -18,12 +18,18 @@
  */
 
 #include <cstring>
+#include <algorithm>
 
 #include "aura.h"
 #include "util.h"
 #include "socket.h"
+#include "poller.h"
 #include "includes.h"
 
+#ifndef WIN32
+#include <poll.h>
+#endif
+
 using namespace std;
 
 #ifndef WIN32
@@ -33,13 +39,204 @@ int32_t GetLastError()
 }
 #endif
 
+//
+// CByteBuffer
+//
+
+CByteBuffer::CByteBuffer()
+  : m_Data(nullptr),
+    m_Capacity(0),
+    m_Start(0),
+    m_End(0)
+{
+}
+
+CByteBuffer::~CByteBuffer()
+{
+  delete[] m_Data;
+}
+
+uint8_t* CByteBuffer::Prepare(size_t size)
+{
+  if (m_Capacity - m_End >= size)
+    return m_Data + m_End;
+
+  const size_t Size = GetSize();
+
+  if (m_Start >= Size && m_Capacity - Size >= size)
+  {
+    // at least half of the used space has already been consumed so move the rest to the front instead of growing
+    // this keeps the cost of the move proportional to the number of bytes consumed since the last one
+
+    memmove(m_Data, m_Data + m_Start, Size);
+  }
+  else
+  {
+    size_t Capacity = m_Capacity ? m_Capacity * 2 : 4096;
+
+    while (Capacity < Size + size)
+      Capacity *= 2;
+
+    auto Data = new uint8_t[Capacity];
+
+    if (Size)
+      memcpy(Data, m_Data + m_Start, Size);
+
+    delete[] m_Data;
+    m_Data     = Data;
+    m_Capacity = Capacity;
+  }
+
+  m_Start = 0;
+  m_End   = Size;
+  return m_Data + m_End;
+}
+
+void CByteBuffer::Append(const uint8_t* data, size_t size)
+{
+  if (!size)
+    return;
+
+  memcpy(Prepare(size), data, size);
+  m_End += size;
+}
+
+void CByteBuffer::Consume(size_t size)
+{
+  m_Start += size;
+
+  // once everything has been consumed we can start over at the front for free
+
+  if (m_Start >= m_End)
+    m_Start = m_End = 0;
+}
+
+void CByteBuffer::Clear()
+{
+  m_Start = m_End = 0;
+}
+
+//
+// CSendQueue
+//
+
+CSendQueue::CSendQueue()
+  : m_Offset(0),
+    m_Size(0)
+{
+}
+
+CSendQueue::~CSendQueue() = default;
+
+void CSendQueue::Append(const uint8_t* data, size_t size)
+{
+  if (!size)
+    return;
+
+  m_Buffer.Append(data, size);
+  m_Size += size;
+
+  // merge with the previous segment if its bytes are in the buffer too, they're contiguous
+
+  if (!m_Segments.empty() && !m_Segments.back().m_Packet)
+    m_Segments.back().m_Size += size;
+  else
+    m_Segments.push_back(CSegment{nullptr, size});
+}
+
+void CSendQueue::Append(const CSharedPacket& packet)
+{
+  if (!packet || packet->empty())
+    return;
+
+  m_Size += packet->size();
+  m_Segments.push_back(CSegment{packet, packet->size()});
+}
+
+uint32_t CSendQueue::Gather(const uint8_t** data, size_t* sizes, uint32_t max) const
+{
+  // the non shared segments are stored back to back in m_Buffer so we just have to keep track of where the next one starts
+
+  const uint8_t* Buffer = m_Buffer.GetData();
+  uint32_t       Count  = 0;
+
+  for (auto& segment : m_Segments)
+  {
+    if (Count == max)
+      break;
+
+    if (segment.m_Packet)
+    {
+      const size_t Offset = Count == 0 ? m_Offset : 0;
+      data[Count]         = segment.m_Packet->data() + Offset;
+      sizes[Count]        = segment.m_Size - Offset;
+    }
+    else
+    {
+      data[Count]  = Buffer;
+      sizes[Count] = segment.m_Size;
+      Buffer += segment.m_Size;
+    }
+
+    ++Count;
+  }
+
+  return Count;
+}
+
+void CSendQueue::Consume(size_t size)
+{
+  m_Size -= size;
+
+  while (size > 0)
+  {
+    CSegment& Front = m_Segments.front();
+
+    if (Front.m_Packet)
+    {
+      const size_t Sent = min(size, Front.m_Size - m_Offset);
+      m_Offset += Sent;
+      size -= Sent;
+
+      if (m_Offset == Front.m_Size)
+      {
+        m_Segments.pop_front();
+        m_Offset = 0;
+      }
+    }
+    else
+    {
+      const size_t Sent = min(size, Front.m_Size);
+      m_Buffer.Consume(Sent);
+      Front.m_Size -= Sent;
+      size -= Sent;
+
+      if (Front.m_Size == 0)
+        m_Segments.pop_front();
+    }
+  }
+}
+
+void CSendQueue::Clear()
+{
+  m_Buffer.Clear();
+  m_Segments.clear();
+  m_Offset = 0;
+  m_Size   = 0;
+}
+
 //
 // CSocket
 //
 
 CSocket::CSocket()
   : m_Socket(INVALID_SOCKET),
+    m_Poller(nullptr),
     m_HasError(false),
+    m_Registered(false),
+    m_Readable(false),
+    m_Writable(false),
+    m_WantWrite(false),
     m_Error(0)
 {
   memset(&m_SIN, 0, sizeof(m_SIN));
@@ -48,13 +245,20 @@ CSocket::CSocket()
 CSocket::CSocket(SOCKET nSocket, struct sockaddr_in nSIN)
   : m_Socket(nSocket),
     m_SIN(nSIN),
+    m_Poller(nullptr),
     m_HasError(false),
+    m_Registered(false),
+    m_Readable(false),
+    m_Writable(false),
+    m_WantWrite(false),
     m_Error(0)
 {
 }
 
 CSocket::~CSocket()
 {
+  Unregister();
+
   if (m_Socket != INVALID_SOCKET)
     closesocket(m_Socket);
 }
@@ -143,18 +347,52 @@ string CSocket::GetErrorString() const
   return "UNKNOWN ERROR (" + to_string(m_Error) + ")";
 }
 
-void CSocket::SetFD(fd_set* fd, fd_set* send_fd, int* nfds)
+void CSocket::SetPoller(CPoller* poller)
 {
-  if (m_Socket == INVALID_SOCKET)
+  // move the socket to another poller, keeping its registration if it had one
+
+  const bool Registered = m_Registered;
+  Unregister();
+  m_Poller = poller;
+
+  if (Registered)
+    Register();
+}
+
+void CSocket::Register()
+{
+  if (!m_Poller || m_Registered || m_Socket == INVALID_SOCKET)
     return;
 
-  FD_SET(m_Socket, fd);
-  FD_SET(m_Socket, send_fd);
+  if (m_Poller->Register(this))
+    m_Registered = true;
+  else
+  {
+    m_HasError = true;
+    m_Error    = GetLastError();
+    Print("[SOCKET] error (register) - " + GetErrorString());
+  }
+}
 
-#ifndef WIN32
-  if (m_Socket > *nfds)
-    *nfds = m_Socket;
-#endif
+void CSocket::Unregister()
+{
+  if (m_Registered)
+    m_Poller->Unregister(this);
+
+  m_Registered = false;
+  m_Readable   = false;
+  m_Writable   = false;
+}
+
+void CSocket::SetWantWrite(bool wantWrite)
+{
+  if (m_WantWrite == wantWrite)
+    return;
+
+  m_WantWrite = wantWrite;
+
+  if (m_Registered)
+    m_Poller->UpdateInterest(this);
 }
 
 void CSocket::Allocate(int type)
@@ -172,13 +410,16 @@ void CSocket::Allocate(int type)
 
 void CSocket::Reset()
 {
+  Unregister();
+
   if (m_Socket != INVALID_SOCKET)
     closesocket(m_Socket);
 
   m_Socket = INVALID_SOCKET;
   memset(&m_SIN, 0, sizeof(m_SIN));
-  m_HasError = false;
-  m_Error    = 0;
+  m_HasError  = false;
+  m_WantWrite = false;
+  m_Error     = 0;
 }
 
 //
@@ -212,20 +453,24 @@ CTCPSocket::CTCPSocket(SOCKET nSocket, struct sockaddr_in nSIN)
     m_LastRecv(GetTime()),
     m_Connected(true)
 {
-// make socket non blocking
+// make socket non blocking (on Linux CTCPServer::AcceptSocket already did with accept4)
 
 #ifdef WIN32
   int32_t iMode = 1;
   ioctlsocket(m_Socket, FIONBIO, (u_long FAR*)&iMode);
-#else
+#elif !defined(__linux__)
   fcntl(m_Socket, F_SETFL, fcntl(m_Socket, F_GETFL) | O_NONBLOCK);
 #endif
+
+  // disable Nagle's algorithm, not every platform passes it on from the listening socket
+  // we already collect everything queued for a socket during an update into one send so Nagle would only hold back the latency critical packets
+
+  int32_t OptVal = 1;
+  setsockopt(m_Socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&OptVal), sizeof(int32_t));
 }
 
 CTCPSocket::~CTCPSocket()
 {
-  if (m_Socket != INVALID_SOCKET)
-    closesocket(m_Socket);
 }
 
 void CTCPSocket::Reset()
@@ -234,8 +479,8 @@ void CTCPSocket::Reset()
   Allocate(SOCK_STREAM);
 
   m_Connected = false;
-  m_RecvBuffer.clear();
-  m_SendBuffer.clear();
+  m_RecvBuffer.Clear();
+  m_SendBuffer.Clear();
   m_LastRecv = GetTime();
 
 // make socket non blocking
@@ -248,23 +493,24 @@ void CTCPSocket::Reset()
 #endif
 }
 
-void CTCPSocket::DoRecv(fd_set* fd)
+void CTCPSocket::DoRecv()
 {
   if (m_Socket == INVALID_SOCKET || m_HasError || !m_Connected)
     return;
 
-  if (FD_ISSET(m_Socket, fd))
+  if (m_Readable)
   {
-    // data is waiting, receive it
+    // data is waiting, receive it straight into the buffer
+    // use whatever room is left at the back of the buffer (at least 4 KB) so one call usually drains the socket
 
-    char    buffer[1024];
-    int32_t c = recv(m_Socket, buffer, 1024, 0);
+    uint8_t*      Buffer = m_RecvBuffer.Prepare(4096);
+    const int32_t c      = recv(m_Socket, reinterpret_cast<char*>(Buffer), static_cast<int32_t>(m_RecvBuffer.GetWritable()), 0);
 
     if (c > 0)
     {
       // success! add the received data to the buffer
 
-      m_RecvBuffer += string(buffer, c);
+      m_RecvBuffer.Commit(c);
       m_LastRecv = GetTime();
     }
     else if (c == SOCKET_ERROR && GetLastError() != EWOULDBLOCK)
@@ -286,32 +532,119 @@ void CTCPSocket::DoRecv(fd_set* fd)
   }
 }
 
-void CTCPSocket::DoSend(fd_set* send_fd)
+uint32_t CTCPSocket::GatherSend(const uint8_t** data, size_t* sizes, uint32_t max, size_t& size) const
 {
-  if (m_Socket == INVALID_SOCKET || m_HasError || !m_Connected || m_SendBuffer.empty())
-    return;
+  size = 0;
+
+  if (m_Socket == INVALID_SOCKET || m_HasError || !m_Connected || m_SendBuffer.GetEmpty())
+    return 0;
+
+  // if the last send didn't go through completely we wait for the poller to tell us the socket is writable again
+  // otherwise we just try to send right away since the socket is almost always writable
+
+  if (m_WantWrite && !m_Writable)
+    return 0;
+
+  const uint32_t Count = m_SendBuffer.Gather(data, sizes, max);
+
+  for (uint32_t i = 0; i < Count; ++i)
+    size += sizes[i];
 
-  if (FD_ISSET(m_Socket, send_fd))
+  return Count;
+}
+
+bool CTCPSocket::EventSent(int32_t sent, size_t size, int error)
+{
+  if (sent > 0)
   {
-    // socket is ready, send it
+    // success! only some of the data may have been sent, remove it from the buffer
 
-    int32_t s = send(m_Socket, m_SendBuffer.c_str(), static_cast<int32_t>(m_SendBuffer.size()), MSG_NOSIGNAL);
+    m_SendBuffer.Consume(sent);
+  }
+  else if (sent == SOCKET_ERROR && error != EWOULDBLOCK)
+  {
+    // send error
 
-    if (s > 0)
-    {
-      // success! only some of the data may have been sent, remove it from the buffer
+    m_HasError = true;
+    m_Error    = error;
+    Print("[TCPSOCKET] error (send) - " + GetErrorString());
+    return false;
+  }
 
-      m_SendBuffer = m_SendBuffer.substr(s);
-    }
-    else if (s == SOCKET_ERROR && GetLastError() != EWOULDBLOCK)
+  if (sent != static_cast<int32_t>(size))
+  {
+    // the socket's send buffer is full, ask to be woken up when there's room in it again
+
+    m_Writable = false;
+    SetWantWrite(true);
+    return false;
+  }
+
+  if (m_SendBuffer.GetEmpty())
+    SetWantWrite(false);
+
+  return true;
+}
+
+uint32_t CTCPSocket::DoSend()
+{
+  uint32_t Calls = 0;
+
+  while (true)
+  {
+    // send as many of the queued segments as we can in one go (64 at a time)
+
+    const uint8_t* Data[64];
+    size_t         Sizes[64];
+    size_t         Size;
+    const uint32_t Count = GatherSend(Data, Sizes, 64, Size);
+
+    if (Count == 0)
+      return Calls;
+
+#ifdef WIN32
+    WSABUF Buffers[64];
+    DWORD  Sent = 0;
+
+    for (uint32_t i = 0; i < Count; ++i)
     {
-      // send error
+      Buffers[i].buf = reinterpret_cast<CHAR*>(const_cast<uint8_t*>(Data[i]));
+      Buffers[i].len = static_cast<ULONG>(Sizes[i]);
+    }
 
-      m_HasError = true;
-      m_Error    = GetLastError();
-      Print("[TCPSOCKET] error (send) - " + GetErrorString());
-      return;
+    const int32_t s = WSASend(m_Socket, Buffers, Count, &Sent, 0, nullptr, nullptr) == SOCKET_ERROR ? SOCKET_ERROR : static_cast<int32_t>(Sent);
+#else
+    struct iovec  Buffers[64];
+    struct msghdr Message;
+    memset(&Message, 0, sizeof(Message));
+
+    for (uint32_t i = 0; i < Count; ++i)
+    {
+      Buffers[i].iov_base = const_cast<uint8_t*>(Data[i]);
+      Buffers[i].iov_len  = Sizes[i];
     }
+
+    Message.msg_iov    = Buffers;
+    Message.msg_iovlen = Count;
+
+    // when there's more queued than fits in one call tell the kernel so it doesn't push a partial TCP segment between the calls
+    // we only keep looping after a batch was fully accepted so the next call (without MSG_MORE once it's the last) follows right away
+    // a short send means the socket's send buffer filled up and the kernel has already pushed what it took
+
+    int32_t Flags = MSG_NOSIGNAL;
+
+#ifdef MSG_MORE
+    if (Size < m_SendBuffer.GetSize())
+      Flags |= MSG_MORE;
+#endif
+
+    const int32_t s = static_cast<int32_t>(sendmsg(m_Socket, &Message, Flags));
+#endif
+
+    ++Calls;
+
+    if (!EventSent(s, Size, s == SOCKET_ERROR ? GetLastError() : 0))
+      return Calls;
   }
 }
 
@@ -377,22 +710,17 @@ void CTCPClient::Connect(const string& localaddress, const string& address, uint
     }
   }
 
-  // get IP address
+  // host names have to be resolved with CResolver first, looking them up here would block the thread
 
-  struct hostent* HostInfo;
-  uint32_t        HostAddress;
-  HostInfo = gethostbyname(address.c_str());
+  const uint32_t HostAddress = inet_addr(address.c_str());
 
-  if (!HostInfo)
+  if (HostAddress == INADDR_NONE)
   {
     m_HasError = true;
-    // m_Error = h_error;
-    Print("[TCPCLIENT] error (gethostbyname)");
+    Print("[TCPCLIENT] error (inet_addr) - [" + address + "] is not an IP address");
     return;
   }
 
-  memcpy(&HostAddress, HostInfo->h_addr, HostInfo->h_length);
-
   // connect
 
   m_SIN.sin_family      = AF_INET;
@@ -413,6 +741,11 @@ void CTCPClient::Connect(const string& localaddress, const string& address, uint
   }
 
   m_Connecting = true;
+
+  // a non blocking connect completes when the socket becomes writable
+
+  m_WantWrite = true;
+  Register();
 }
 
 bool CTCPClient::CheckConnect()
@@ -420,6 +753,10 @@ bool CTCPClient::CheckConnect()
   if (m_Socket == INVALID_SOCKET || m_HasError || !m_Connecting)
     return false;
 
+  // check if the socket is connected
+  // use poll where we can since select can't handle descriptors above FD_SETSIZE
+
+#ifdef WIN32
   fd_set fd;
   FD_ZERO(&fd);
   FD_SET(m_Socket, &fd);
@@ -428,37 +765,49 @@ bool CTCPClient::CheckConnect()
   tv.tv_sec  = 0;
   tv.tv_usec = 0;
 
-// check if the socket is connected
-
-#ifdef WIN32
   if (select(1, nullptr, &fd, nullptr, &tv) == SOCKET_ERROR)
+  {
+    m_HasError = true;
+    m_Error    = GetLastError();
+    return false;
+  }
+
+  const bool Connected = FD_ISSET(m_Socket, &fd) != 0;
 #else
-  if (select(m_Socket + 1, nullptr, &fd, nullptr, &tv) == SOCKET_ERROR)
-#endif
+  struct pollfd pfd;
+  pfd.fd      = m_Socket;
+  pfd.events  = POLLOUT;
+  pfd.revents = 0;
+
+  if (poll(&pfd, 1, 0) == SOCKET_ERROR)
   {
     m_HasError = true;
     m_Error    = GetLastError();
     return false;
   }
 
-  if (FD_ISSET(m_Socket, &fd))
+  const bool Connected = pfd.revents != 0;
+#endif
+
+  if (Connected)
   {
     m_Connecting = false;
     m_Connected  = true;
+    SetWantWrite(false);
     return true;
   }
 
   return false;
 }
 
-void CTCPClient::DoRecv(fd_set* fd)
+void CTCPClient::DoRecv()
 {
-  CTCPSocket::DoRecv(fd);
+  CTCPSocket::DoRecv();
 }
 
-void CTCPClient::DoSend(fd_set* send_fd)
+void CTCPClient::DoSend()
 {
-  CTCPSocket::DoSend(send_fd);
+  CTCPSocket::DoSend();
 }
 
 //
@@ -527,37 +876,80 @@ bool CTCPServer::Listen(const string& address, uint16_t port)
     return false;
   }
 
-  return true;
+  Register();
+  return !m_HasError;
 }
 
-CTCPSocket* CTCPServer::Accept(fd_set* fd)
+SOCKET CTCPServer::AcceptSocket(struct sockaddr_in& address)
+{
+  int32_t AddrLen = sizeof(address);
+
+#ifdef WIN32
+  return accept(m_Socket, (struct sockaddr*)&address, &AddrLen);
+#elif defined(__linux__)
+  // accept4 saves the two fcntl calls per connection to make it non blocking
+
+  return accept4(m_Socket, reinterpret_cast<struct sockaddr*>(&address), reinterpret_cast<socklen_t*>(&AddrLen), SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+  return accept(m_Socket, reinterpret_cast<struct sockaddr*>(&address), reinterpret_cast<socklen_t*>(&AddrLen));
+#endif
+}
+
+CTCPSocket* CTCPServer::Accept()
 {
   if (m_Socket == INVALID_SOCKET || m_HasError)
     return nullptr;
 
-  if (FD_ISSET(m_Socket, fd))
+  if (m_Readable)
   {
     // a connection is waiting, accept it
 
     struct sockaddr_in Addr;
-    int32_t            AddrLen = sizeof(Addr);
     SOCKET             NewSocket;
 
-#ifdef WIN32
-    if ((NewSocket = accept(m_Socket, (struct sockaddr*)&Addr, &AddrLen)) != INVALID_SOCKET)
-#else
-    if ((NewSocket = accept(m_Socket, reinterpret_cast<struct sockaddr*>(&Addr), reinterpret_cast<socklen_t*>(&AddrLen))) != INVALID_SOCKET)
-#endif
+    if ((NewSocket = AcceptSocket(Addr)) != INVALID_SOCKET)
     {
-      // success! return the new socket
+      // success! return the new socket, it's dispatched by the same poller as the listening socket
 
-      return new CTCPSocket(NewSocket, Addr);
+      CTCPSocket* Socket = new CTCPSocket(NewSocket, Addr);
+      Socket->SetPoller(m_Poller);
+      Socket->Register();
+      return Socket;
     }
   }
 
   return nullptr;
 }
 
+uint32_t CTCPServer::Accept(vector<CTCPSocket*>& sockets, const function<bool(const struct sockaddr_in&)>& admit)
+{
+  if (m_Socket == INVALID_SOCKET || m_HasError || !m_Readable)
+    return 0;
+
+  // the listening socket is non blocking so keep going until the backlog is empty
+
+  struct sockaddr_in Addr;
+  SOCKET             NewSocket;
+  uint32_t           Rejected = 0;
+
+  while ((NewSocket = AcceptSocket(Addr)) != INVALID_SOCKET)
+  {
+    if (!admit(Addr))
+    {
+      closesocket(NewSocket);
+      ++Rejected;
+      continue;
+    }
+
+    CTCPSocket* Socket = new CTCPSocket(NewSocket, Addr);
+    Socket->SetPoller(m_Poller);
+    Socket->Register();
+    sockets.push_back(Socket);
+  }
+
+  return Rejected;
+}
+
 //
 // CUDPSocket
 //
@@ -599,21 +991,16 @@ bool CUDPSocket::SendTo(const string& address, uint16_t port, const std::vector<
   if (m_Socket == INVALID_SOCKET || m_HasError)
     return false;
 
-  // get IP address
+  // host names have to be resolved with CResolver first, looking them up here would block the thread
 
-  struct hostent* HostInfo;
-  uint32_t        HostAddress;
-  HostInfo = gethostbyname(address.c_str());
+  const uint32_t HostAddress = inet_addr(address.c_str());
 
-  if (!HostInfo)
+  if (HostAddress == INADDR_NONE)
   {
-    m_HasError = true;
-    // m_Error = h_error;
-    Print("[UDPSOCKET] error (gethostbyname)");
+    Print("[UDPSOCKET] error (inet_addr) - [" + address + "] is not an IP address");
     return false;
   }
 
-  memcpy(&HostAddress, HostInfo->h_addr, HostInfo->h_length);
   struct sockaddr_in sin;
   sin.sin_family      = AF_INET;
   sin.sin_addr.s_addr = HostAddress;
@@ -643,6 +1030,67 @@ bool CUDPSocket::Broadcast(uint16_t port, const std::vector<uint8_t>& message)
   return true;
 }
 
+bool CUDPSocket::Bind(uint16_t port)
+{
+  if (m_Socket == INVALID_SOCKET || m_HasError)
+    return false;
+
+  // make socket non blocking so RecvFrom returns once everything has been read
+
+#ifdef WIN32
+  int32_t iMode = 1;
+  ioctlsocket(m_Socket, FIONBIO, (u_long FAR*)&iMode);
+#else
+  fcntl(m_Socket, F_SETFL, fcntl(m_Socket, F_GETFL) | O_NONBLOCK);
+#endif
+
+  // share the port with a Warcraft III client running on the same machine
+  // we always bind to every address because we wouldn't receive broadcasts otherwise
+
+  int32_t OptVal = 1;
+  setsockopt(m_Socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&OptVal), sizeof(int32_t));
+
+  struct sockaddr_in sin;
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family      = AF_INET;
+  sin.sin_addr.s_addr = INADDR_ANY;
+  sin.sin_port        = htons(port);
+
+  if (::bind(m_Socket, reinterpret_cast<struct sockaddr*>(&sin), sizeof(sin)) == SOCKET_ERROR)
+  {
+    // the socket can still be used for sending so don't flag an error
+
+    m_Error = GetLastError();
+    Print("[UDPSOCKET] error (bind) - " + GetErrorString());
+    return false;
+  }
+
+  return true;
+}
+
+bool CUDPSocket::RecvFrom(std::vector<uint8_t>& message, struct sockaddr_in& sin)
+{
+  if (m_Socket == INVALID_SOCKET || m_HasError)
+    return false;
+
+  // W3GS packets sent over UDP are much smaller than this, anything longer is cut off and ignored by the caller
+
+  char    Buffer[1024];
+  int32_t SinLen = sizeof(sin);
+
+#ifdef WIN32
+  const int32_t c = recvfrom(m_Socket, Buffer, sizeof(Buffer), 0, (struct sockaddr*)&sin, &SinLen);
+#else
+  const int32_t c = recvfrom(m_Socket, Buffer, sizeof(Buffer), 0, reinterpret_cast<struct sockaddr*>(&sin), reinterpret_cast<socklen_t*>(&SinLen));
+#endif
+
+  if (c == SOCKET_ERROR)
+    return false;
+
+  message.assign(Buffer, Buffer + c);
+  return true;
+}
+
 void CUDPSocket::SetBroadcastTarget(const string& subnet)
 {
   if (subnet.empty())
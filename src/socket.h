@@ -23,6 +23,10 @@
 
 #include "util.h"
 
+#include <deque>
+#include <memory>
+#include <functional>
+
 #ifdef WIN32
 #include <winsock2.h>
 #include <errno.h>
@@ -109,6 +113,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 typedef int32_t SOCKET;
@@ -133,21 +138,113 @@ typedef int32_t SOCKET;
 #define SHUT_RDWR 2
 #endif
 
+//
+// CByteBuffer
+//
+
+// a growable byte buffer which is appended to at the back and consumed from the front
+// consuming just advances an offset and the unused space at the front is only reclaimed when we'd otherwise have to grow, so both ends are amortised O(1)
+// the stored bytes are always contiguous so packets can be parsed straight out of the buffer
+
+class CByteBuffer
+{
+private:
+  uint8_t* m_Data;
+  size_t   m_Capacity;
+  size_t   m_Start; // offset of the first stored byte
+  size_t   m_End;   // offset one past the last stored byte
+
+public:
+  CByteBuffer();
+  ~CByteBuffer();
+  CByteBuffer(CByteBuffer&) = delete;
+
+  inline const uint8_t* GetData() const { return m_Data + m_Start; }
+  inline size_t         GetSize() const { return m_End - m_Start; }
+  inline bool           GetEmpty() const { return m_Start == m_End; }
+
+  // returns space for at least size more bytes at the back, call Commit afterwards with the number of bytes actually written
+
+  uint8_t*    Prepare(size_t size);
+  inline void Commit(size_t size) { m_End += size; }
+  inline size_t GetWritable() const { return m_Capacity - m_End; }
+
+  void Append(const uint8_t* data, size_t size);
+  void Consume(size_t size);
+  void Clear();
+};
+
+//
+// CSendQueue
+//
+
+// a packet which is built once and then shared by every send queue (and GProxy++ buffer) it's put on instead of being copied into each of them
+// it must not be modified after it has been queued
+
+typedef std::shared_ptr<const std::vector<uint8_t>> CSharedPacket;
+
+// the bytes waiting to be sent on a TCP socket in the order they were queued
+// ordinary packets are copied into a contiguous buffer (consecutive ones end up in a single segment) while shared packets are only referenced
+// DoSend hands all the segments to the kernel at once with sendmsg/WSASend
+
+class CSendQueue
+{
+private:
+  struct CSegment
+  {
+    CSharedPacket m_Packet; // nullptr if the segment's bytes are stored in m_Buffer
+    size_t        m_Size;   // the number of bytes in the segment still waiting to be sent (for shared packets this doesn't include m_Offset)
+  };
+
+  CByteBuffer          m_Buffer;   // the bytes of the non shared segments
+  std::deque<CSegment> m_Segments; // the segments in the order they were queued
+  size_t               m_Offset;   // the number of bytes of the first segment already sent (only used for shared packets)
+  size_t               m_Size;     // the total number of bytes waiting to be sent
+
+public:
+  CSendQueue();
+  ~CSendQueue();
+  CSendQueue(CSendQueue&) = delete;
+
+  inline size_t GetSize() const { return m_Size; }
+  inline bool   GetEmpty() const { return m_Size == 0; }
+
+  void Append(const uint8_t* data, size_t size);
+  void Append(const CSharedPacket& packet);
+
+  // fills data/sizes with at most max segments, starting at the first unsent byte, and returns the number of segments filled
+
+  uint32_t Gather(const uint8_t** data, size_t* sizes, uint32_t max) const;
+  void Consume(size_t size);
+  void Clear();
+};
+
 //
 // CSocket
 //
 
+class CPoller;
+
 class CSocket
 {
+  friend class CPoller;
+
 protected:
   SOCKET             m_Socket;
   struct sockaddr_in m_SIN;
+  CPoller*           m_Poller;     // the poller this socket is dispatched by (if any)
   bool               m_HasError;
+  bool               m_Registered; // set if m_Socket is currently registered with m_Poller
+  bool               m_Readable;   // set by the poller when m_Socket is ready for reading
+  bool               m_Writable;   // set by the poller when m_Socket is ready for writing
+  bool               m_WantWrite;  // set if we want to be woken up when m_Socket becomes writable
   int                m_Error;
 
   CSocket();
   CSocket(SOCKET nSocket, struct sockaddr_in nSIN);
 
+  void SetWantWrite(bool wantWrite);
+
 public:
   ~CSocket();
 
@@ -155,10 +252,17 @@ public:
   inline std::vector<uint8_t> GetPort() const { return CreateByteArray(m_SIN.sin_port, false); }
   inline std::vector<uint8_t> GetIP() const { return CreateByteArray(static_cast<uint32_t>(m_SIN.sin_addr.s_addr), false); }
   inline std::string          GetIPString() const { return inet_ntoa(m_SIN.sin_addr); }
+  inline uint32_t             GetIPAddress() const { return m_SIN.sin_addr.s_addr; }
   inline int32_t              GetError() const { return m_Error; }
   inline bool                 HasError() const { return m_HasError; }
-
-  void SetFD(fd_set* fd, fd_set* send_fd, int32_t* nfds);
+  inline SOCKET               GetFD() const { return m_Socket; }
+  inline bool                 GetReadable() const { return m_Readable; }
+  inline bool                 GetWritable() const { return m_Writable; }
+  inline bool                 GetWantWrite() const { return m_WantWrite; }
+
+  void SetPoller(CPoller* poller);
+  void Register();
+  void Unregister();
   void Reset();
   void Allocate(int type);
 };
@@ -170,8 +274,8 @@ public:
 class CTCPSocket : public CSocket
 {
 protected:
-  std::string m_RecvBuffer;
-  std::string m_SendBuffer;
+  CByteBuffer m_RecvBuffer;
+  CSendQueue  m_SendBuffer;
   uint32_t    m_LastRecv;
   bool        m_Connected;
 
@@ -180,21 +284,32 @@ public:
   CTCPSocket(SOCKET nSocket, struct sockaddr_in nSIN);
   ~CTCPSocket();
 
-  inline std::string* GetBytes() { return &m_RecvBuffer; }
+  inline CByteBuffer* GetBytes() { return &m_RecvBuffer; }
   inline uint32_t     GetLastRecv() const { return m_LastRecv; }
   inline bool         GetConnected() const { return m_Connected; }
 
-  inline void PutBytes(const std::string& bytes) { m_SendBuffer += bytes; }
-  inline void PutBytes(const std::vector<uint8_t>& bytes) { m_SendBuffer += std::string(begin(bytes), end(bytes)); }
+  inline void PutBytes(const std::string& bytes) { m_SendBuffer.Append(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()); }
+  inline void PutBytes(const std::vector<uint8_t>& bytes) { m_SendBuffer.Append(bytes.data(), bytes.size()); }
+  inline void PutPacket(const CSharedPacket& packet) { m_SendBuffer.Append(packet); }
 
-  inline void ClearRecvBuffer() { m_RecvBuffer.clear(); }
-  inline void SubstrRecvBuffer(uint32_t i) { m_RecvBuffer = m_RecvBuffer.substr(i); }
-  inline void                           ClearSendBuffer() { m_SendBuffer.clear(); }
+  inline void ClearRecvBuffer() { m_RecvBuffer.Clear(); }
+  inline void SubstrRecvBuffer(uint32_t i) { m_RecvBuffer.Consume(i); }
+  inline void ClearSendBuffer() { m_SendBuffer.Clear(); }
 
-  void DoRecv(fd_set* fd);
-  void DoSend(fd_set* send_fd);
+  void DoRecv();
   void Disconnect();
 
+  // sends everything queued (until the socket's send buffer is full) and returns the number of send calls it took
+
+  uint32_t DoSend();
+
+  // the two halves of DoSend for pollers which hand the sends of many sockets to the kernel at once (see CPoller::Flush)
+  // GatherSend fills data/sizes with the next batch and returns 0 if there's nothing to send right now
+  // EventSent takes the result of sending that batch (SOCKET_ERROR and the error code on failure) and returns true if all of it was accepted
+
+  uint32_t GatherSend(const uint8_t** data, size_t* sizes, uint32_t max, size_t& size) const;
+  bool     EventSent(int32_t sent, size_t size, int error);
+
   void Reset();
 };
 
@@ -211,20 +326,20 @@ public:
   CTCPClient();
   ~CTCPClient();
 
-  inline std::string* GetBytes() { return &m_RecvBuffer; }
+  inline CByteBuffer* GetBytes() { return &m_RecvBuffer; }
   inline bool         GetConnected() const { return m_Connected; }
   inline bool         GetConnecting() const { return m_Connecting; }
 
   void        Reset();
-  inline void PutBytes(const std::string& bytes) { m_SendBuffer += bytes; }
-  inline void PutBytes(const std::vector<uint8_t>& bytes) { m_SendBuffer += std::string(begin(bytes), end(bytes)); }
+  inline void PutBytes(const std::string& bytes) { m_SendBuffer.Append(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()); }
+  inline void PutBytes(const std::vector<uint8_t>& bytes) { m_SendBuffer.Append(bytes.data(), bytes.size()); }
 
   bool        CheckConnect();
-  inline void ClearRecvBuffer() { m_RecvBuffer.clear(); }
-  inline void SubstrRecvBuffer(uint32_t i) { m_RecvBuffer = m_RecvBuffer.substr(i); }
-  inline void                           ClearSendBuffer() { m_SendBuffer.clear(); }
-  void DoRecv(fd_set* fd);
-  void DoSend(fd_set* send_fd);
+  inline void ClearRecvBuffer() { m_RecvBuffer.Clear(); }
+  inline void SubstrRecvBuffer(uint32_t i) { m_RecvBuffer.Consume(i); }
+  inline void ClearSendBuffer() { m_SendBuffer.Clear(); }
+  void DoRecv();
+  void DoSend();
   void Disconnect();
   void Connect(const std::string& localaddress, const std::string& address, uint16_t port);
 };
@@ -235,12 +350,20 @@ public:
 
 class CTCPServer final : public CTCPSocket
 {
+private:
+  SOCKET AcceptSocket(struct sockaddr_in& address);
+
 public:
   CTCPServer();
   ~CTCPServer();
 
   bool Listen(const std::string& address, uint16_t port);
-  CTCPSocket* Accept(fd_set* fd);
+  CTCPSocket* Accept();
+
+  // accepts every connection waiting in the backlog, admit is asked about each one before anything is allocated for it and the connection is closed right away if it says no
+  // returns the number of connections which were turned away
+
+  uint32_t Accept(std::vector<CTCPSocket*>& sockets, const std::function<bool(const struct sockaddr_in&)>& admit);
 };
 
 //
@@ -259,6 +382,8 @@ public:
   bool SendTo(struct sockaddr_in sin, const std::vector<uint8_t>& message);
   bool SendTo(const std::string& address, uint16_t port, const std::vector<uint8_t>& message);
   bool Broadcast(uint16_t port, const std::vector<uint8_t>& message);
+  bool Bind(uint16_t port);
+  bool RecvFrom(std::vector<uint8_t>& message, struct sockaddr_in& sin);
 
   void Reset();
   void SetBroadcastTarget(const std::string& subnet);
@@ -51,11 +51,11 @@ CStats::~CStats()
   }
 }
 
-bool CStats::ProcessAction(CIncomingAction* Action)
+bool CStats::ProcessAction(const CIncomingAction& Action)
 {
-  uint32_t                    i          = 0;
-  const std::vector<uint8_t>* ActionData = Action->GetAction();
-  std::vector<uint8_t>        Data, Key, Value;
+  uint32_t             i          = 0;
+  const CByteView&     ActionData = Action.GetAction();
+  std::vector<uint8_t> Data, Key, Value;
 
   // dota actions with real time replay data start with 0x6b then the nullptr terminated string "dr.x"
   // unfortunately more than one action can be sent in a single packet and the length of each action isn't explicitly represented in the packet
@@ -65,28 +65,28 @@ bool CStats::ProcessAction(CIncomingAction* Action)
 
   do
   {
-    if ((*ActionData)[i] == 0x6b && (*ActionData)[i + 1] == 0x64 && (*ActionData)[i + 2] == 0x72 && (*ActionData)[i + 3] == 0x2e && (*ActionData)[i + 4] == 0x78 && (*ActionData)[i + 5] == 0x00)
+    if (ActionData[i] == 0x6b && ActionData[i + 1] == 0x64 && ActionData[i + 2] == 0x72 && ActionData[i + 3] == 0x2e && ActionData[i + 4] == 0x78 && ActionData[i + 5] == 0x00)
     {
       // we think we've found an action with real time replay data (but we can't be 100% sure)
       // next we parse out two nullptr terminated strings and a 4 byte int32_teger
 
-      if (ActionData->size() >= i + 7)
+      if (ActionData.size() >= i + 7)
       {
         // the first nullptr terminated string should either be the strings "Data" or "Global" or a player id in ASCII representation, e.g. "1" or "2"
 
-        Data = ExtractCString(*ActionData, i + 6);
+        Data = ExtractCString(ActionData, i + 6);
 
-        if (ActionData->size() >= i + 8 + Data.size())
+        if (ActionData.size() >= i + 8 + Data.size())
         {
           // the second nullptr terminated string should be the key
 
-          Key = ExtractCString(*ActionData, i + 7 + Data.size());
+          Key = ExtractCString(ActionData, i + 7 + Data.size());
 
-          if (ActionData->size() >= i + 12 + Data.size() + Key.size())
+          if (ActionData.size() >= i + 12 + Data.size() + Key.size())
           {
             // the 4 byte int32_teger should be the value
 
-            Value                     = std::vector<uint8_t>(ActionData->begin() + i + 8 + Data.size() + Key.size(), ActionData->begin() + i + 12 + Data.size() + Key.size());
+            Value                     = std::vector<uint8_t>(ActionData.begin() + i + 8 + Data.size() + Key.size(), ActionData.begin() + i + 12 + Data.size() + Key.size());
             const string   DataString = string(begin(Data), end(Data));
             const string   KeyString  = string(begin(Key), end(Key));
             const uint32_t ValueInt   = ByteArrayToUInt32(Value, false);
@@ -274,78 +274,70 @@ bool CStats::ProcessAction(CIncomingAction* Action)
     }
     else
       ++i;
-  } while (ActionData->size() >= i + 6);
+  } while (ActionData.size() >= i + 6);
 
   return m_Winner != 0;
 }
 
-void CStats::Save(CAura* Aura, CAuraDB* DB)
+void CStats::Save(CAuraDB* DB)
 {
-  if (DB->Begin())
-  {
-    // since we only record the end game information it's possible we haven't recorded anything yet if the game didn't end with a tree/throne death
-    // this will happen if all the players leave before properly finishing the game
-    // the dotagame stats are always saved (with winner = 0 if the game didn't properly finish)
-    // the dotaplayer stats are only saved if the game is properly finished
+  // since we only record the end game information it's possible we haven't recorded anything yet if the game didn't end with a tree/throne death
+  // this will happen if all the players leave before properly finishing the game
+  // the dotagame stats are always saved (with winner = 0 if the game didn't properly finish)
+  // the dotaplayer stats are only saved if the game is properly finished
 
-    uint32_t Players = 0;
+  uint32_t Players = 0;
 
-    // check for invalid colours and duplicates
-    // this can only happen if DotA sends us garbage in the "id" value but we should check anyway
+  // check for invalid colours and duplicates
+  // this can only happen if DotA sends us garbage in the "id" value but we should check anyway
 
-    for (uint32_t i = 0; i < 12; ++i)
+  for (uint32_t i = 0; i < 12; ++i)
+  {
+    if (m_Players[i])
     {
-      if (m_Players[i])
-      {
-        const uint32_t Colour = m_Players[i]->GetNewColour();
+      const uint32_t Colour = m_Players[i]->GetNewColour();
 
-        if (!((Colour >= 1 && Colour <= 5) || (Colour >= 7 && Colour <= 11)))
-        {
-          Print("[STATS: " + m_Game->GetGameName() + "] discarding player data, invalid colour found");
-          delete m_Players[i];
-          m_Players[i] = nullptr;
-          continue;
-        }
+      if (!((Colour >= 1 && Colour <= 5) || (Colour >= 7 && Colour <= 11)))
+      {
+        Print("[STATS: " + m_Game->GetGameName() + "] discarding player data, invalid colour found");
+        delete m_Players[i];
+        m_Players[i] = nullptr;
+        continue;
+      }
 
-        for (uint32_t j = i + 1; j < 12; ++j)
+      for (uint32_t j = i + 1; j < 12; ++j)
+      {
+        if (m_Players[j] && Colour == m_Players[j]->GetNewColour())
         {
-          if (m_Players[j] && Colour == m_Players[j]->GetNewColour())
-          {
-            Print("[STATS: " + m_Game->GetGameName() + "] discarding player data, duplicate colour found");
-            delete m_Players[j];
-            m_Players[j] = nullptr;
-          }
+          Print("[STATS: " + m_Game->GetGameName() + "] discarding player data, duplicate colour found");
+          delete m_Players[j];
+          m_Players[j] = nullptr;
         }
       }
     }
+  }
 
-    for (auto& player : m_Players)
+  for (auto& player : m_Players)
+  {
+    if (player)
     {
-      if (player)
-      {
-        const uint32_t Colour = player->GetNewColour();
-        const string   Name   = m_Game->GetDBPlayerNameFromColour(Colour);
+      const uint32_t Colour = player->GetNewColour();
+      const string   Name   = m_Game->GetDBPlayerNameFromColour(Colour);
 
-        if (Name.empty())
-          continue;
+      if (Name.empty())
+        continue;
 
-        uint8_t Win = 0;
+      uint8_t Win = 0;
 
-        if ((m_Winner == 1 && Colour >= 1 && Colour <= 5) || (m_Winner == 2 && Colour >= 7 && Colour <= 11))
-          Win = 1;
-        else if ((m_Winner == 2 && Colour >= 1 && Colour <= 5) || (m_Winner == 1 && Colour >= 7 && Colour <= 11))
-          Win = 2;
+      if ((m_Winner == 1 && Colour >= 1 && Colour <= 5) || (m_Winner == 2 && Colour >= 7 && Colour <= 11))
+        Win = 1;
+      else if ((m_Winner == 2 && Colour >= 1 && Colour <= 5) || (m_Winner == 1 && Colour >= 7 && Colour <= 11))
+        Win = 2;
 
-        Aura->m_DB->DotAPlayerAdd(Name, Win, player->GetKills(), player->GetDeaths(), player->GetCreepKills(), player->GetCreepDenies(), player->GetAssists(), player->GetNeutralKills(), player->GetTowerKills(), player->GetRaxKills(), player->GetCourierKills());
-        ++Players;
-      }
+      DB->DotAPlayerAdd(Name, Win, player->GetKills(), player->GetDeaths(), player->GetCreepKills(), player->GetCreepDenies(), player->GetAssists(), player->GetNeutralKills(), player->GetTowerKills(), player->GetRaxKills(), player->GetCourierKills());
+      ++Players;
     }
-
-    if (DB->Commit())
-      Print("[STATS: " + m_Game->GetGameName() + "] saving " + to_string(Players) + " players");
-    else
-      Print("[STATS: " + m_Game->GetGameName() + "] unable to commit database transaction, data not saved");
   }
-  else
-    Print("[STATS: " + m_Game->GetGameName() + "] unable to begin database transaction, data not saved");
+
+  Print("[STATS: " + m_Game->GetGameName() + "] saving " + to_string(Players) + " players");
 }
@@ -36,7 +36,6 @@
 class CGame;
 class CDBDotAPlayer;
 class CIncomingAction;
-class CAura;
 class CAuraDB;
 class CStats
 {
@@ -50,8 +49,8 @@ public:
   ~CStats();
   CStats(CStats&) = delete;
 
-  bool ProcessAction(CIncomingAction* Action);
-  void Save(CAura* CAura, CAuraDB* DB);
+  bool ProcessAction(const CIncomingAction& Action);
+  void Save(CAuraDB* DB);
 };
 
 #endif // AURA_STATS_H_
@@ -0,0 +1,214 @@
+/*
+
+   Copyright [2010] [Josko Nikolic]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+ */
+
+#include "timerwheel.h"
+
+#include <utility>
+
+using namespace std;
+
+//
+// CTimer
+//
+
+CTimer::CTimer(function<void()> nCallback)
+  : m_Callback(std::move(nCallback)),
+    m_Wheel(nullptr),
+    m_Slot(nullptr),
+    m_Prev(nullptr),
+    m_Next(nullptr),
+    m_Expiry(0)
+{
+}
+
+CTimer::~CTimer()
+{
+  Cancel();
+}
+
+void CTimer::Cancel()
+{
+  if (m_Wheel)
+    m_Wheel->Unlink(this);
+}
+
+//
+// CTimerWheel
+//
+
+CTimerWheel::CTimerWheel(int64_t nNow)
+  : m_Slots(),
+    m_Overflow(nullptr),
+    m_Now(nNow),
+    m_NumTimers(0)
+{
+}
+
+CTimerWheel::~CTimerWheel()
+{
+  // the timers are owned by someone else and may outlive us, just forget we ever scheduled them
+
+  const auto Forget = [](CTimer* timer) {
+    for (; timer; timer = timer->m_Next)
+      timer->m_Wheel = nullptr;
+  };
+
+  for (auto& level : m_Slots)
+  {
+    for (auto& slot : level)
+      Forget(slot);
+  }
+
+  Forget(m_Overflow);
+}
+
+void CTimerWheel::Link(CTimer* timer)
+{
+  // the level is the highest group of bits in which the expiry differs from the current time
+
+  const uint64_t Diff = static_cast<uint64_t>(timer->m_Expiry ^ m_Now);
+  CTimer**       Slot = &m_Overflow;
+
+  for (uint32_t Level = 0; Level < LEVELS; ++Level)
+  {
+    if (Diff >> (SLOT_BITS * (Level + 1)) == 0)
+    {
+      Slot = &m_Slots[Level][(timer->m_Expiry >> (SLOT_BITS * Level)) & (SLOTS - 1)];
+      break;
+    }
+  }
+
+  timer->m_Slot = Slot;
+  timer->m_Prev = nullptr;
+  timer->m_Next = *Slot;
+
+  if (*Slot)
+    (*Slot)->m_Prev = timer;
+
+  *Slot = timer;
+}
+
+void CTimerWheel::Unlink(CTimer* timer)
+{
+  if (timer->m_Prev)
+    timer->m_Prev->m_Next = timer->m_Next;
+  else
+    *timer->m_Slot = timer->m_Next;
+
+  if (timer->m_Next)
+    timer->m_Next->m_Prev = timer->m_Prev;
+
+  timer->m_Wheel = nullptr;
+  --m_NumTimers;
+}
+
+void CTimerWheel::Cascade(CTimer** slot)
+{
+  CTimer* Timer = *slot;
+  *slot         = nullptr;
+
+  while (Timer)
+  {
+    CTimer* Next = Timer->m_Next;
+    Link(Timer);
+    Timer = Next;
+  }
+}
+
+void CTimerWheel::Schedule(CTimer* timer, int64_t delay)
+{
+  if (timer->m_Wheel)
+    timer->m_Wheel->Unlink(timer);
+
+  // the slot for the current time has already been fired so the earliest a timer can fire is the next millisecond
+
+  timer->m_Expiry = m_Now + (delay > 0 ? delay : 1);
+  timer->m_Wheel  = this;
+  ++m_NumTimers;
+  Link(timer);
+}
+
+void CTimerWheel::Advance(int64_t now)
+{
+  while (m_Now < now)
+  {
+    // an empty wheel has nothing to cascade or fire so it can skip ahead
+
+    if (m_NumTimers == 0)
+    {
+      m_Now = now;
+      break;
+    }
+
+    ++m_Now;
+
+    // move the timers in the slots we just reached down the wheel, top level first so they can keep falling
+
+    if ((m_Now & ((int64_t(1) << (SLOT_BITS * LEVELS)) - 1)) == 0)
+      Cascade(&m_Overflow);
+
+    for (uint32_t Level = LEVELS - 1; Level > 0; --Level)
+    {
+      if ((m_Now & ((int64_t(1) << (SLOT_BITS * Level)) - 1)) == 0)
+        Cascade(&m_Slots[Level][(m_Now >> (SLOT_BITS * Level)) & (SLOTS - 1)]);
+    }
+
+    // every timer left in this slot expires right now
+    // a callback may reschedule (or cancel) any timer but mustn't destroy its own
+
+    CTimer** Slot = &m_Slots[0][m_Now & (SLOTS - 1)];
+
+    while (*Slot)
+    {
+      CTimer* Timer = *Slot;
+      Unlink(Timer);
+      Timer->m_Callback();
+    }
+  }
+}
+
+int64_t CTimerWheel::GetNextExpiry() const
+{
+  if (m_NumTimers == 0)
+    return -1;
+
+  const auto Earliest = [](const CTimer* timer) {
+    int64_t Expiry = timer->m_Expiry;
+
+    for (timer = timer->m_Next; timer; timer = timer->m_Next)
+    {
+      if (timer->m_Expiry < Expiry)
+        Expiry = timer->m_Expiry;
+    }
+
+    return Expiry;
+  };
+
+  // every timer on a level expires after every timer on the levels below it and the slots of a level are in order starting after the current time's slot
+
+  for (uint32_t Level = 0; Level < LEVELS; ++Level)
+  {
+    for (uint32_t Index = ((m_Now >> (SLOT_BITS * Level)) & (SLOTS - 1)) + 1; Index < SLOTS; ++Index)
+    {
+      if (m_Slots[Level][Index])
+        return Earliest(m_Slots[Level][Index]);
+    }
+  }
+
+  return Earliest(m_Overflow);
+}
@@ -0,0 +1,107 @@
+/*
+
+   Copyright [2010] [Josko Nikolic]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+ */
+
+#ifndef AURA_TIMERWHEEL_H_
+#define AURA_TIMERWHEEL_H_
+
+#include <cstdint>
+#include <functional>
+
+class CTimerWheel;
+
+//
+// CTimer
+//
+
+// a timer is owned by whoever it calls back (usually as a member) and is scheduled on a CTimerWheel when it should fire
+// destroying a scheduled timer cancels it so the owner never has to remember to do that itself
+
+class CTimer
+{
+  friend class CTimerWheel;
+
+private:
+  std::function<void()> m_Callback;
+  CTimerWheel*          m_Wheel;  // the wheel this timer is scheduled on (nullptr while it isn't scheduled)
+  CTimer**              m_Slot;   // the slot list this timer is linked into
+  CTimer*               m_Prev;
+  CTimer*               m_Next;
+  int64_t               m_Expiry; // GetTicks when this timer fires
+
+public:
+  explicit CTimer(std::function<void()> nCallback);
+  ~CTimer();
+  CTimer(CTimer&) = delete;
+
+  inline bool    GetScheduled() const { return m_Wheel != nullptr; }
+  inline int64_t GetExpiry() const { return m_Expiry; }
+
+  void Cancel();
+};
+
+//
+// CTimerWheel
+//
+
+// a hierarchical timer wheel with millisecond resolution
+// level 0 has a slot for each of the next 64 ms, every level above covers 64 times the time of the level below it
+// a timer is put on the lowest level where its expiry shares all the higher bits with the current time and moved down a level each time the wheel reaches its slot
+// so scheduling, cancelling and firing a timer are O(1) and advancing the wheel costs one slot per millisecond no matter how many timers there are
+
+class CTimerWheel
+{
+  friend class CTimer;
+
+public:
+  static const uint32_t SLOT_BITS = 6;
+  static const uint32_t SLOTS     = 1 << SLOT_BITS;
+  static const uint32_t LEVELS    = 4; // 2^24 ms (about 4.6 hours), anything later waits on the overflow list
+
+private:
+  CTimer*  m_Slots[LEVELS][SLOTS];
+  CTimer*  m_Overflow;  // timers too far in the future for the top level
+  int64_t  m_Now;       // GetTicks the wheel has been advanced to
+  uint32_t m_NumTimers; // number of scheduled timers
+
+  void Link(CTimer* timer);
+  void Unlink(CTimer* timer);
+  void Cascade(CTimer** slot);
+
+public:
+  explicit CTimerWheel(int64_t nNow);
+  ~CTimerWheel();
+  CTimerWheel(CTimerWheel&) = delete;
+
+  inline int64_t  GetNow() const { return m_Now; }
+  inline uint32_t GetNumTimers() const { return m_NumTimers; }
+
+  // (re)schedules timer to fire delay ms after the time the wheel has been advanced to
+  // timers rescheduling themselves from their callback therefore don't drift even when the wheel is advanced late
+
+  void Schedule(CTimer* timer, int64_t delay);
+
+  // fires every timer which expires at or before now in the order they expire
+
+  void Advance(int64_t now);
+
+  // returns the GetTicks when the next timer fires or -1 if no timer is scheduled
+
+  int64_t GetNextExpiry() const;
+};
+
+#endif // AURA_TIMERWHEEL_H_
@@ -27,6 +27,52 @@
 #include <sstream>
 #include <iomanip>
 
+//
+// CByteView
+//
+
+// a non-owning view of a contiguous range of bytes so packets can be parsed in place, e.g. straight out of a socket's receive buffer
+// it doesn't keep the bytes alive so it must not be used after the underlying buffer is modified or destroyed
+// the accessors mirror std::vector's so the parsing functions work the same whether they're given a view or a vector
+
+class CByteView
+{
+private:
+  const uint8_t* m_Data;
+  size_t         m_Size;
+
+public:
+  CByteView()
+    : m_Data(nullptr),
+      m_Size(0)
+  {
+  }
+
+  CByteView(const uint8_t* data, size_t size)
+    : m_Data(data),
+      m_Size(size)
+  {
+  }
+
+  CByteView(const std::vector<uint8_t>& b)
+    : m_Data(b.data()),
+      m_Size(b.size())
+  {
+  }
+
+  inline const uint8_t* data() const { return m_Data; }
+  inline size_t         size() const { return m_Size; }
+  inline bool           empty() const { return m_Size == 0; }
+  inline const uint8_t* begin() const { return m_Data; }
+  inline const uint8_t* end() const { return m_Data + m_Size; }
+  inline uint8_t operator[](size_t i) const { return m_Data[i]; }
+
+  // the caller is responsible for making sure the range lies within this view
+
+  inline CByteView SubView(size_t start, size_t length) const { return CByteView(m_Data + start, length); }
+  inline CByteView SubView(size_t start) const { return CByteView(m_Data + start, m_Size - start); }
+};
+
 inline std::string ToHexString(uint32_t i)
 {
   std::string       result;
@@ -80,7 +126,7 @@ inline std::vector<uint8_t> CreateByteArray(const int64_t i, bool reverse)
     return std::vector<uint8_t>{static_cast<uint8_t>(i >> 24), static_cast<uint8_t>(i >> 16), static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i)};
 }
 
-inline uint16_t ByteArrayToUInt16(const std::vector<uint8_t>& b, bool reverse, const uint32_t start = 0)
+inline uint16_t ByteArrayToUInt16(const CByteView& b, bool reverse, const uint32_t start = 0)
 {
   if (b.size() < start + 2)
     return 0;
@@ -91,7 +137,7 @@ inline uint16_t ByteArrayToUInt16(const std::vector<uint8_t>& b, bool reverse, c
     return static_cast<uint16_t>(b[start] << 8 | b[start + 1]);
 }
 
-inline uint32_t ByteArrayToUInt32(const std::vector<uint8_t>& b, bool reverse, const uint32_t start = 0)
+inline uint32_t ByteArrayToUInt32(const CByteView& b, bool reverse, const uint32_t start = 0)
 {
   if (b.size() < start + 4)
     return 0;
@@ -168,22 +214,48 @@ inline void AppendByteArrayFast(std::vector<uint8_t>& b, const std::string& appe
     b.push_back(0);
 }
 
+// these append the bytes directly instead of going through CreateByteArray so building a packet doesn't allocate a temporary for every field
+
 inline void AppendByteArray(std::vector<uint8_t>& b, const uint16_t i, bool reverse)
 {
-  AppendByteArray(b, CreateByteArray(i, reverse));
+  if (!reverse)
+  {
+    b.push_back(static_cast<uint8_t>(i));
+    b.push_back(static_cast<uint8_t>(i >> 8));
+  }
+  else
+  {
+    b.push_back(static_cast<uint8_t>(i >> 8));
+    b.push_back(static_cast<uint8_t>(i));
+  }
 }
 
 inline void AppendByteArray(std::vector<uint8_t>& b, const uint32_t i, bool reverse)
 {
-  AppendByteArray(b, CreateByteArray(i, reverse));
+  if (!reverse)
+  {
+    b.push_back(static_cast<uint8_t>(i));
+    b.push_back(static_cast<uint8_t>(i >> 8));
+    b.push_back(static_cast<uint8_t>(i >> 16));
+    b.push_back(static_cast<uint8_t>(i >> 24));
+  }
+  else
+  {
+    b.push_back(static_cast<uint8_t>(i >> 24));
+    b.push_back(static_cast<uint8_t>(i >> 16));
+    b.push_back(static_cast<uint8_t>(i >> 8));
+    b.push_back(static_cast<uint8_t>(i));
+  }
 }
 
 inline void AppendByteArray(std::vector<uint8_t>& b, const int64_t i, bool reverse)
 {
-  AppendByteArray(b, CreateByteArray(i, reverse));
+  // only the low 4 bytes are appended (same as CreateByteArray)
+
+  AppendByteArray(b, static_cast<uint32_t>(i), reverse);
 }
 
-inline std::vector<uint8_t> ExtractCString(const std::vector<uint8_t>& b, const uint32_t start)
+inline std::vector<uint8_t> ExtractCString(const CByteView& b, const uint32_t start)
 {
   // start searching the byte array at position 'start' for the first null value
   // if found, return the subarray from 'start' to the null value but not including the null value
@@ -193,18 +265,18 @@ inline std::vector<uint8_t> ExtractCString(const std::vector<uint8_t>& b, const
     for (uint32_t i = start; i < b.size(); ++i)
     {
       if (b[i] == 0)
-        return std::vector<uint8_t>(begin(b) + start, begin(b) + i);
+        return std::vector<uint8_t>(std::begin(b) + start, std::begin(b) + i);
     }
 
     // no null value found, return the rest of the byte array
 
-    return std::vector<uint8_t>(begin(b) + start, end(b));
+    return std::vector<uint8_t>(std::begin(b) + start, std::end(b));
   }
 
   return std::vector<uint8_t>();
 }
 
-inline uint8_t ExtractHex(const std::vector<uint8_t>& b, const uint32_t start, bool reverse)
+inline uint8_t ExtractHex(const CByteView& b, const uint32_t start, bool reverse)
 {
   // consider the byte array to contain a 2 character ASCII encoded hex value at b[start] and b[start + 1] e.g. "FF"
   // extract it as a single decoded byte
@@ -212,7 +284,7 @@ inline uint8_t ExtractHex(const std::vector<uint8_t>& b, const uint32_t start, b
   if (start + 1 < b.size())
   {
     uint32_t    c;
-    std::string temp = std::string(begin(b) + start, begin(b) + start + 2);
+    std::string temp = std::string(std::begin(b) + start, std::begin(b) + start + 2);
 
     if (reverse)
       temp = std::string(temp.rend(), temp.rbegin());